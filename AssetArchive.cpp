@@ -0,0 +1,88 @@
+#include "AssetArchive.hpp"
+
+#include "data_path.hpp"
+#include "NameMap.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+uint64_t hash_bytes(char const *data, size_t size) {
+	return hash_name(std::string_view(data, size));
+}
+
+AssetArchive::AssetArchive(std::string const &filename) : file(filename) {
+	char const *at = file.begin();
+
+	ChunkSpan< char > names;
+	read_chunk(&at, file.end(), "str0", &names);
+	ChunkSpan< DirectoryEntry > directory;
+	read_chunk(&at, file.end(), "dir0", &directory);
+	ChunkSpan< char > contents;
+	read_chunk(&at, file.end(), "dat0", &contents);
+
+	if (at != file.end()) {
+		std::cerr << "WARNING: trailing data in asset archive '" << filename << "'" << std::endl;
+	}
+
+	files.reserve(directory.size());
+	for (auto const &entry : directory) {
+		if (!(entry.name_begin <= entry.name_end && entry.name_end <= names.size())) {
+			throw std::runtime_error("asset archive '" + filename + "' has directory entry with out-of-range name");
+		}
+		if (!(entry.offset <= contents.size() && entry.size <= contents.size() - entry.offset)) {
+			throw std::runtime_error("asset archive '" + filename + "' has directory entry with out-of-range contents");
+		}
+		std::string name(names.data() + entry.name_begin, names.data() + entry.name_end);
+		File f;
+		f.data = contents.data() + entry.offset;
+		f.size = entry.size;
+		f.hash = entry.hash;
+		bool inserted = files.emplace(name, f).second;
+		if (!inserted) {
+			std::cerr << "WARNING: asset archive '" << filename << "' contains '" << name << "' more than once." << std::endl;
+		}
+	}
+}
+
+AssetArchive::File const *AssetArchive::find(std::string const &name) const {
+	auto f = files.find(name);
+	if (f == files.end()) return nullptr;
+	return &f->second;
+}
+
+AssetArchive const *asset_archive() {
+	//(function-local static, so it is mapped exactly once, even if called from several threads)
+	static std::unique_ptr< AssetArchive > archive = []() -> std::unique_ptr< AssetArchive > {
+		std::string filename = data_path("assets.pack");
+		try {
+			std::unique_ptr< AssetArchive > ret(new AssetArchive(filename));
+			std::cout << "Using asset archive '" << filename << "' (" << ret->files.size() << " files)." << std::endl;
+			return ret;
+		} catch (std::exception &e) {
+			//a missing archive is fine -- loaders will use loose files:
+			return nullptr;
+		}
+	}();
+	return archive.get();
+}
+
+std::string asset_archive_name(std::string const &path) {
+	std::string prefix = data_path("");
+	return (path.compare(0, prefix.size(), prefix) == 0 ? path.substr(prefix.size()) : path);
+}
+
+AssetFile::AssetFile(std::string const &path, Source source) {
+	AssetArchive const *archive = (source == ArchiveOrLoose ? asset_archive() : nullptr);
+	if (archive) {
+		if (AssetArchive::File const *f = archive->find(asset_archive_name(path))) {
+			data = f->data;
+			size = f->size;
+			hash = f->hash;
+			return;
+		}
+	}
+
+	mapped.reset(new MappedFile(path));
+	data = mapped->data;
+	size = mapped->size;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+/*
+ * An AssetArchive packs many data files into a single file, which is
+ *  memory-mapped once; loaders then read their files straight out of the
+ *  mapping instead of opening (and seeking around in) each file separately.
+ *
+ * Archive layout (chunks as in read_write_chunk.hpp):
+ *  str0: file names (padded so that dir0 is 8-byte aligned)
+ *  dir0: DirectoryEntry for each file
+ *  dat0: file contents; every file starts 16-byte aligned (relative to the archive start)
+ *
+ * Archives are built with the 'pack-assets' tool.
+ *
+ */
+
+#include "MappedFile.hpp"
+#include "read_write_chunk.hpp"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+//64-bit FNV-1a hash of some bytes (used for archive content hashes; the same as hash_name() in NameMap.hpp):
+uint64_t hash_bytes(char const *data, size_t size);
+
+struct AssetArchive {
+	//map archive; throws on failure:
+	AssetArchive(std::string const &filename);
+
+	struct DirectoryEntry {
+		uint32_t name_begin, name_end; //range in str0
+		uint32_t offset, size; //byte range in dat0
+		uint64_t hash; //hash_bytes() of contents
+	};
+	static_assert(sizeof(DirectoryEntry) == 4*4 + 8, "DirectoryEntry is packed.");
+
+	struct File {
+		char const *data = nullptr;
+		size_t size = 0;
+		uint64_t hash = 0;
+	};
+
+	//look up a file by name (relative to the archive's directory, with '/' separators):
+	// returns nullptr if not present
+	File const *find(std::string const &name) const;
+
+	//-- internals ---
+	MappedFile file;
+	std::unordered_map< std::string, File > files;
+};
+
+//The archive used by asset loaders: data_path("assets.pack"), mapped on first call:
+// returns nullptr if there is no archive (loaders then read loose files)
+AssetArchive const *asset_archive();
+
+//The archive's name for a data file path (the path relative to the data directory):
+std::string asset_archive_name(std::string const &path);
+
+//An AssetFile gives read-only access to the bytes of a data file:
+// they come from asset_archive() if it contains the file, or else from mapping the file itself.
+struct AssetFile {
+	//with LooseOnly, the archive is skipped and the file itself is always mapped
+	// (hot reloads use this: the archive was mapped at startup, so it never has the re-exported file)
+	enum Source { ArchiveOrLoose, LooseOnly };
+
+	//throws if the file can't be found (either way):
+	AssetFile(std::string const &path, Source source = ArchiveOrLoose);
+
+	char const *data = nullptr;
+	size_t size = 0;
+	uint64_t hash = 0; //content hash (only known for files from the archive; otherwise 0)
+
+	char const *begin() const { return data; }
+	char const *end() const { return data + size; }
+
+	//-- internals ---
+	std::unique_ptr< MappedFile > mapped; //(if not from the archive)
+};
@@ -0,0 +1,254 @@
+#include "AtlasPacker.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+namespace AtlasPacker {
+
+namespace {
+
+//A skyline page tracks the top of the packed area as segments covering [0, size.x), left to right:
+struct SkylinePage {
+	SkylinePage(glm::uvec2 size_) : size(size_) {
+		skyline.emplace_back(Segment{ 0, 0, size.x });
+	}
+	glm::uvec2 size;
+	struct Segment {
+		uint32_t x, y, width;
+	};
+	std::vector< Segment > skyline;
+
+	//where would a rect of 'rect' size sit if its left edge were at segment 'i'? (false if it doesn't fit)
+	bool fit(size_t i, glm::uvec2 rect, uint32_t *y_, uint64_t *waste_) const {
+		if (skyline[i].x + rect.x > size.x) return false;
+		uint32_t y = 0;
+		for (size_t j = i; j < skyline.size() && skyline[j].x < skyline[i].x + rect.x; ++j) {
+			y = std::max(y, skyline[j].y);
+		}
+		if (y + rect.y > size.y) return false;
+		//area trapped under the rect:
+		uint64_t waste = 0;
+		for (size_t j = i; j < skyline.size() && skyline[j].x < skyline[i].x + rect.x; ++j) {
+			uint32_t overlap = std::min(skyline[j].x + skyline[j].width, skyline[i].x + rect.x) - skyline[j].x;
+			waste += uint64_t(y - skyline[j].y) * overlap;
+		}
+		*y_ = y;
+		*waste_ = waste;
+		return true;
+	}
+
+	bool place(glm::uvec2 rect, glm::uvec2 *at) {
+		//lowest top edge, then least trapped area, then leftmost:
+		size_t best = skyline.size();
+		uint32_t best_y = 0;
+		uint64_t best_waste = 0;
+		for (size_t i = 0; i < skyline.size(); ++i) {
+			uint32_t y;
+			uint64_t waste;
+			if (!fit(i, rect, &y, &waste)) continue;
+			if (best == skyline.size() || y < best_y || (y == best_y && waste < best_waste)) {
+				best = i;
+				best_y = y;
+				best_waste = waste;
+			}
+		}
+		if (best == skyline.size()) return false;
+
+		*at = glm::uvec2(skyline[best].x, best_y);
+
+		//raise the skyline under the rect:
+		Segment raised{ skyline[best].x, best_y + rect.y, rect.x };
+		uint32_t right = raised.x + raised.width;
+		size_t j = best;
+		while (j < skyline.size() && skyline[j].x < right) {
+			uint32_t end = skyline[j].x + skyline[j].width;
+			if (end <= right) {
+				skyline.erase(skyline.begin() + j);
+			} else {
+				skyline[j].width = end - right;
+				skyline[j].x = right;
+				break;
+			}
+		}
+		skyline.insert(skyline.begin() + best, raised);
+
+		//merge neighbors at the same height:
+		for (size_t k = (best > 0 ? best - 1 : 0); k + 1 < skyline.size() && k <= best + 1; ) {
+			if (skyline[k].y == skyline[k+1].y) {
+				skyline[k].width += skyline[k+1].width;
+				skyline.erase(skyline.begin() + k + 1);
+			} else {
+				++k;
+			}
+		}
+		return true;
+	}
+};
+
+//A max-rects page tracks every maximal free rectangle (they overlap each other):
+struct MaxRectsPage {
+	MaxRectsPage(glm::uvec2 size_) : size(size_) {
+		free.emplace_back(Rect{ glm::uvec2(0), size });
+	}
+	glm::uvec2 size;
+	struct Rect {
+		glm::uvec2 min, max;
+		bool contains(Rect const &o) const {
+			return min.x <= o.min.x && min.y <= o.min.y && o.max.x <= max.x && o.max.y <= max.y;
+		}
+	};
+	std::vector< Rect > free;
+
+	bool place(glm::uvec2 rect, glm::uvec2 *at) {
+		//best short side fit (then best long side fit):
+		size_t best = free.size();
+		uint32_t best_short = 0, best_long = 0;
+		for (size_t i = 0; i < free.size(); ++i) {
+			glm::uvec2 room = free[i].max - free[i].min;
+			if (room.x < rect.x || room.y < rect.y) continue;
+			uint32_t a = room.x - rect.x, b = room.y - rect.y;
+			uint32_t s = std::min(a, b), l = std::max(a, b);
+			if (best == free.size() || s < best_short || (s == best_short && l < best_long)) {
+				best = i;
+				best_short = s;
+				best_long = l;
+			}
+		}
+		if (best == free.size()) return false;
+
+		Rect used{ free[best].min, free[best].min + rect };
+		*at = used.min;
+
+		//split every free rect that overlaps 'used' into the (up to four) maximal rects around it:
+		size_t kept_count = 0;
+		std::vector< Rect > added;
+		for (size_t i = 0; i < free.size(); ++i) {
+			Rect const f = free[i];
+			if (f.min.x >= used.max.x || used.min.x >= f.max.x || f.min.y >= used.max.y || used.min.y >= f.max.y) {
+				free[kept_count++] = f;
+				continue;
+			}
+			if (used.min.x > f.min.x) added.emplace_back(Rect{ f.min, glm::uvec2(used.min.x, f.max.y) });
+			if (used.max.x < f.max.x) added.emplace_back(Rect{ glm::uvec2(used.max.x, f.min.y), f.max });
+			if (used.min.y > f.min.y) added.emplace_back(Rect{ f.min, glm::uvec2(f.max.x, used.min.y) });
+			if (used.max.y < f.max.y) added.emplace_back(Rect{ glm::uvec2(f.min.x, used.max.y), f.max });
+		}
+		free.resize(kept_count);
+
+		//drop rects contained in others (old rects never contain each other, so only pairs with a new rect need checking):
+		std::vector< Rect > kept;
+		for (size_t a = 0; a < added.size(); ++a) {
+			bool contained = false;
+			for (size_t b = 0; b < added.size() && !contained; ++b) {
+				//(of identical rects, the first is kept)
+				if (a != b && added[b].contains(added[a]) && (!added[a].contains(added[b]) || b < a)) contained = true;
+			}
+			for (size_t b = 0; b < free.size() && !contained; ++b) {
+				if (free[b].contains(added[a])) contained = true;
+			}
+			if (!contained) kept.emplace_back(added[a]);
+		}
+		free.erase(std::remove_if(free.begin(), free.end(), [&kept](Rect const &f) {
+			for (Rect const &k : kept) {
+				if (k.contains(f)) return true;
+			}
+			return false;
+		}), free.end());
+		free.insert(free.end(), kept.begin(), kept.end());
+		return true;
+	}
+};
+
+template< typename Page >
+uint32_t pack_pages(std::vector< glm::uvec2 > const &sizes, std::vector< uint32_t > const &order, glm::uvec2 page_size, uint32_t padding, std::vector< Placement > *placements) {
+	std::vector< Page > pages;
+	for (uint32_t i : order) {
+		glm::uvec2 padded = sizes[i] + glm::uvec2(2 * padding);
+		Placement &placement = (*placements)[i];
+		glm::uvec2 at;
+		bool placed = false;
+		for (uint32_t p = 0; p < pages.size(); ++p) {
+			if (pages[p].place(padded, &at)) {
+				placement.page = p;
+				placed = true;
+				break;
+			}
+		}
+		if (!placed) {
+			pages.emplace_back(page_size);
+			placement.page = uint32_t(pages.size() - 1);
+			placed = pages.back().place(padded, &at);
+			assert(placed); //(rects were checked against the page size)
+		}
+		placement.position = at + glm::uvec2(padding);
+	}
+	return uint32_t(pages.size());
+}
+
+} //namespace
+
+uint32_t pack(std::vector< glm::uvec2 > const &sizes, glm::uvec2 page_size, uint32_t padding, Method method, std::vector< Placement > *placements) {
+	assert(placements);
+	placements->assign(sizes.size(), Placement());
+
+	for (auto const &size : sizes) {
+		if (size.x + 2 * padding > page_size.x || size.y + 2 * padding > page_size.y) {
+			throw std::runtime_error("Can't pack a " + std::to_string(size.x) + "x" + std::to_string(size.y) + " image (with " + std::to_string(padding) + " texels of padding) into " + std::to_string(page_size.x) + "x" + std::to_string(page_size.y) + " pages.");
+		}
+	}
+
+	//tallest (then widest) first:
+	std::vector< uint32_t > order(sizes.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&sizes](uint32_t a, uint32_t b) {
+		if (sizes[a].y != sizes[b].y) return sizes[a].y > sizes[b].y;
+		return sizes[a].x > sizes[b].x;
+	});
+
+	if (method == MaxRects) {
+		return pack_pages< MaxRectsPage >(sizes, order, page_size, padding, placements);
+	} else {
+		return pack_pages< SkylinePage >(sizes, order, page_size, padding, placements);
+	}
+}
+
+float packing_efficiency(std::vector< glm::uvec2 > const &sizes, glm::uvec2 page_size, uint32_t pages) {
+	if (pages == 0) return 0.0f;
+	uint64_t area = 0;
+	for (auto const &size : sizes) area += uint64_t(size.x) * size.y;
+	return float(double(area) / (double(pages) * page_size.x * page_size.y));
+}
+
+void compose_pages(std::vector< glm::uvec2 > const &sizes, std::vector< glm::u8vec4 const * > const &images,
+	std::vector< Placement > const &placements, glm::uvec2 page_size, uint32_t padding, uint32_t pages,
+	std::vector< glm::u8vec4 > *texels) {
+	assert(images.size() == sizes.size());
+	assert(placements.size() == sizes.size());
+	assert(texels);
+
+	texels->assign(size_t(pages) * page_size.x * page_size.y, glm::u8vec4(0));
+	for (size_t i = 0; i < sizes.size(); ++i) {
+		glm::uvec2 size = sizes[i];
+		if (size.x == 0 || size.y == 0) continue;
+		Placement const &placement = placements[i];
+		assert(placement.page < pages);
+		glm::u8vec4 *page = texels->data() + size_t(placement.page) * page_size.x * page_size.y;
+		int32_t pad = int32_t(padding);
+		for (int32_t y = -pad; y < int32_t(size.y) + pad; ++y) {
+			uint32_t sy = uint32_t((y % int32_t(size.y) + int32_t(size.y)) % int32_t(size.y));
+			glm::u8vec4 const *src = images[i] + size_t(sy) * size.x;
+			glm::u8vec4 *dst = page + size_t(placement.position.y + y) * page_size.x + placement.position.x;
+			std::memcpy(dst, src, size.x * sizeof(glm::u8vec4));
+			for (int32_t x = 1; x <= pad; ++x) {
+				dst[-x] = src[((size.x - uint32_t(x) % size.x) % size.x)];
+				dst[size.x - 1 + x] = src[(uint32_t(x) - 1) % size.x];
+			}
+		}
+	}
+}
+
+} //namespace AtlasPacker
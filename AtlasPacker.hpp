@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+ * AtlasPacker packs rectangles (e.g., the images of a texture atlas) into
+ *  fixed-size pages (e.g., the layers of an array texture):
+ *  - Skyline keeps the top edge of the packed area as a list of horizontal
+ *    segments and puts each rectangle where its top ends up lowest (fast;
+ *    some space under overhangs is lost),
+ *  - MaxRects keeps every maximal free rectangle and puts each rectangle in
+ *    the one it fits most snugly ("best short side fit"; packs tighter, but
+ *    the free list makes it slower for many rectangles).
+ *
+ * Rectangles are placed largest (tallest) first, each on the first page that
+ *  has room. Each gets 'padding' texels of gutter on every side, which
+ *  compose_pages fills by wrapping the image around, so that filtering (and
+ *  the first few mip levels) near an image's edges don't pick up its neighbors
+ *  and repeating textures stay seamless.
+ *
+ * This code uses no OpenGL, so it can be run (and benchmarked) headlessly;
+ *  see TextureAtlas.hpp for the upload side.
+ *
+ */
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+namespace AtlasPacker {
+
+enum Method : uint8_t {
+	Skyline,
+	MaxRects,
+};
+
+struct Placement {
+	uint32_t page = 0;
+	glm::uvec2 position = glm::uvec2(0); //lower left corner of the rectangle (not including padding)
+};
+
+//Place rectangles of the given sizes on pages of 'page_size':
+// returns the number of pages used; throws if a rectangle (plus padding) is larger than a page.
+uint32_t pack(std::vector< glm::uvec2 > const &sizes, glm::uvec2 page_size, uint32_t padding, Method method, std::vector< Placement > *placements);
+
+//Fraction of the pages' area covered by the rectangles themselves (not counting padding):
+float packing_efficiency(std::vector< glm::uvec2 > const &sizes, glm::uvec2 page_size, uint32_t pages);
+
+//Copy images (rows bottom to top) to their placements in 'pages' pages, stored one after another in 'texels',
+// filling each image's padding by wrapping its texels around; unused space is transparent black:
+void compose_pages(std::vector< glm::uvec2 > const &sizes, std::vector< glm::u8vec4 const * > const &images,
+	std::vector< Placement > const &placements, glm::uvec2 page_size, uint32_t padding, uint32_t pages,
+	std::vector< glm::u8vec4 > *texels);
+
+} //namespace AtlasPacker
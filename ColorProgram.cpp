@@ -3,7 +3,7 @@
 #include "gl_compile_program.hpp"
 #include "gl_errors.hpp"
 
-Load< ColorProgram > color_program(LoadTagEarly);
+Load< ColorProgram > color_program(LoadTagDefault, "color_program", {}, new_T< ColorProgram >);
 
 ColorProgram::ColorProgram() {
 	//Compile vertex and fragment shaders using the convenient 'gl_compile_program' helper function:
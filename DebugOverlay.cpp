@@ -0,0 +1,77 @@
+#include "DebugOverlay.hpp"
+
+#include "HUD.hpp"
+#include "StreamBuffer.hpp"
+#include "GL.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+bool debug_overlay_enabled = false;
+
+void draw_debug_overlay(glm::uvec2 const &drawable_size) {
+	//totals since the displayed values were last updated:
+	static StreamBuffer::Stats totals;
+	static HUD::Stats hud_totals;
+	static uint32_t frames = 0;
+	static auto window_start = std::chrono::high_resolution_clock::now();
+	static std::vector< std::string > lines{ "(measuring)" };
+
+	StreamBuffer::Stats stats = vertex_stream().take_stats();
+	totals.bytes += stats.bytes;
+	totals.maps += stats.maps;
+	totals.orphans += stats.orphans;
+	totals.driver_ms += stats.driver_ms;
+	HUD::Stats hud_stats = HUD::take_stats();
+	hud_totals.vertices_regenerated += hud_stats.vertices_regenerated;
+	hud_totals.bytes_uploaded += hud_stats.bytes_uploaded;
+	frames += 1;
+
+	auto now = std::chrono::high_resolution_clock::now();
+	if (now - window_start >= std::chrono::milliseconds(500)) {
+		char buffer[128];
+		lines.clear();
+		std::snprintf(buffer, sizeof(buffer), "stream: %.1f kB/frame", double(totals.bytes) / frames / 1024.0);
+		lines.emplace_back(buffer);
+		std::snprintf(buffer, sizeof(buffer), "driver: %.3f ms/frame", totals.driver_ms / frames);
+		lines.emplace_back(buffer);
+		std::snprintf(buffer, sizeof(buffer), "maps: %.1f/frame, orphans: %.2f/frame", double(totals.maps) / frames, double(totals.orphans) / frames);
+		lines.emplace_back(buffer);
+		std::snprintf(buffer, sizeof(buffer), "hud: %.1f vertices re-generated/frame, %.2f kB/frame", double(hud_totals.vertices_regenerated) / frames, double(hud_totals.bytes_uploaded) / frames / 1024.0);
+		lines.emplace_back(buffer);
+		totals = StreamBuffer::Stats();
+		hud_totals = HUD::Stats();
+		frames = 0;
+		window_start = now;
+	}
+
+	if (!debug_overlay_enabled) return;
+
+	//the overlay is itself a HUD (so it is only re-tessellated when its numbers change):
+	static HUD *hud = nullptr;
+	if (!hud) hud = new HUD();
+	float const H = 16.0f;
+	glm::vec3 at(H * 0.5f, float(drawable_size.y) - H * 1.5f, 0.0f);
+	for (uint32_t i = 0; i < lines.size(); ++i) {
+		if (i == hud->elements.size()) hud->add();
+		hud->set_text(i, lines[i], at, glm::vec3(H, 0.0f, 0.0f), glm::vec3(0.0f, H, 0.0f), glm::u8vec4(0xff, 0xff, 0x88, 0xff));
+		at.y -= H * 1.3f;
+	}
+	for (uint32_t i = 0; i < hud->elements.size(); ++i) {
+		hud->set_visible(i, i < lines.size());
+	}
+
+	//draw in pixel coordinates:
+	GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+	glDisable(GL_DEPTH_TEST);
+	glm::vec2 scale = 2.0f / glm::vec2(drawable_size);
+	hud->draw(glm::mat4(
+		scale.x, 0.0f, 0.0f, 0.0f,
+		0.0f, scale.y, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		-1.0f, -1.0f, 0.0f, 1.0f
+	));
+	if (depth_test) glEnable(GL_DEPTH_TEST);
+}
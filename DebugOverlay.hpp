@@ -0,0 +1,25 @@
+#pragma once
+
+/*
+ * A corner of the screen with per-frame engine stats, for seeing what
+ *  immediate-mode drawing costs while the game runs:
+ *  - bytes streamed through vertex_stream() (see StreamBuffer.hpp),
+ *  - CPU time spent in the driver mapping and unmapping them,
+ *  - maps and orphaned buffers,
+ *  - vertices HUDs re-tessellated and uploaded (see HUD.hpp; the overlay is a HUD too).
+ *
+ * Values are averaged over half a second so they can be read.
+ *
+ * e.g., in the main loop (F3 toggles the overlay):
+ *   Mode::current->draw(drawable_size);
+ *   draw_debug_overlay(drawable_size);
+ *
+ */
+
+#include <glm/glm.hpp>
+
+extern bool debug_overlay_enabled;
+
+//draw the overlay (if enabled) over the frame just drawn; uses OpenGL:
+// (stream stats are taken every frame either way, so they start fresh when it's turned on)
+void draw_debug_overlay(glm::uvec2 const &drawable_size);
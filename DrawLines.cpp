@@ -1,24 +1,26 @@
 #include "DrawLines.hpp"
 #include "PathFont.hpp"
 #include "ColorProgram.hpp"
+#include "StreamBuffer.hpp"
 
 #include "gl_errors.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
-//All DrawLines instances share a vertex array object and vertex buffer, initialized at load time:
+#include <cstring>
+
+//All DrawLines instances stream vertices through the shared vertex_stream() (see StreamBuffer.hpp)
+// and share a vertex array object reading from it, initialized at load time:
 
 //n.b. declared static so they don't conflict with similarly named global variables elsewhere:
-static GLuint vertex_buffer = 0;
 static GLuint vertex_buffer_for_color_program = 0;
 
-static Load< void > setup_buffers(LoadTagDefault, [](){
-	//you may recognize this init code from DrawSprites.cpp:
+//attribs storage handed from one DrawLines to the next, so a frame's lines don't regrow it from empty:
+static std::vector< DrawLines::Vertex > spare_attribs;
 
-	{ //set up vertex buffer:
-		glGenBuffers(1, &vertex_buffer);
-		//for now, buffer will be un-filled.
-	}
+static Load< void > setup_buffers(LoadTagDefault, "draw_lines_buffers", {"color_program", "vertex_stream"}, [](){
+	//you may recognize this init code from DrawSprites.cpp:
+	GLuint vertex_buffer = vertex_stream().buffer;
 
 	{ //vertex array mapping buffer for color_program:
 		//ask OpenGL to fill vertex_buffer_for_color_program with the name of an unused vertex array object:
@@ -64,6 +66,8 @@ static Load< void > setup_buffers(LoadTagDefault, [](){
 
 
 DrawLines::DrawLines(glm::mat4 const &world_to_clip_) : world_to_clip(world_to_clip_) {
+	attribs.swap(spare_attribs);
+	attribs.clear();
 }
 
 void DrawLines::draw(glm::vec3 const &a, glm::vec3 const &b, glm::u8vec4 const &color) {
@@ -90,57 +94,29 @@ void DrawLines::draw_box(glm::mat4x3 const &mat, glm::u8vec4 const &color) {
 	draw(mat * glm::vec4( 1.0f, 1.0f,-1.0f, 1.0f), mat * glm::vec4( 1.0f, 1.0f, 1.0f, 1.0f), color);
 }
 
-void DrawLines::draw_text(std::string const &text, glm::vec3 const &anchor_in, glm::vec3 const &x, glm::vec3 const &y, glm::u8vec4 const &color, glm::vec3 *anchor_out) {
-
-	glm::vec3 anchor = anchor_in;
-
-	uint32_t start = 0;
-	while (start < text.size()) {
-		uint32_t end = start;
-		uint32_t glyph = -1U;
-		while (end < text.size()) {
-			end += 1;
-			auto f = PathFont::font.glyph_map.find(text.substr(start, end-start));
-			if (f == PathFont::font.glyph_map.end()) {
-				end -= 1;
-				break;
-			}
-			glyph = f->second;
-		}
-		if (glyph == -1U) {
-			assert(start == end);
-			end += 1;
-			//missing! draw a tofu:
-			for (const auto &pt : {
-				glm::vec2(0.1f, 0.1f), glm::vec2(0.6f, 0.1f),
-				glm::vec2(0.6f, 0.1f), glm::vec2(0.6f, 0.9f),
-				glm::vec2(0.9f, 0.6f), glm::vec2(0.1f, 0.9f),
-				glm::vec2(0.1f, 0.9f), glm::vec2(0.1f, 0.1f)
-			}) {
-				attribs.emplace_back(anchor + pt.x * x + pt.y * y, color);
-			}
-			anchor += x * 0.6f;
-		} else {
-			for (uint32_t c = PathFont::font.glyph_coord_starts[glyph]; c + 1 < PathFont::font.glyph_coord_starts[glyph+1]; c += 2) {
-				attribs.emplace_back(anchor + x * PathFont::font.coords[c] + y * PathFont::font.coords[c+1], color);
-			}
-			anchor += x * PathFont::font.glyph_widths[glyph];
-		}
-		start = end;
+void DrawLines::draw_text(std::string const &text, glm::vec3 const &anchor, glm::vec3 const &x, glm::vec3 const &y, glm::u8vec4 const &color, glm::vec3 *anchor_out) {
+
+	//glyph lookup and layout happen once per distinct string (see PathFont::layout):
+	PathFont::Layout const &layout = PathFont::font.layout(text);
+	glm::vec2 const *coords = PathFont::font.layout_coords.data();
+	for (uint32_t c = layout.coords_begin; c < layout.coords_end; ++c) {
+		attribs.emplace_back(anchor + x * coords[c].x + y * coords[c].y, color);
 	}
 
-	if (anchor_out) *anchor_out = anchor;
+	if (anchor_out) *anchor_out = anchor + x * layout.width;
 }
 
 DrawLines::~DrawLines() {
-	if (attribs.empty()) return;
-
-	//based on DrawSprites.cpp :
+	if (attribs.empty()) {
+		if (attribs.capacity() > spare_attribs.capacity()) attribs.swap(spare_attribs);
+		return;
+	}
 
-	//upload vertices to vertex_buffer:
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer); //set vertex_buffer as current
-	glBufferData(GL_ARRAY_BUFFER, attribs.size() * sizeof(attribs[0]), attribs.data(), GL_STREAM_DRAW); //upload attribs array
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//copy vertices into the stream buffer:
+	GLintptr offset = 0;
+	void *mapped = vertex_stream().map(attribs.size() * sizeof(attribs[0]), sizeof(attribs[0]), &offset);
+	std::memcpy(mapped, attribs.data(), attribs.size() * sizeof(attribs[0]));
+	vertex_stream().unmap();
 
 	//set color_program as current program:
 	glUseProgram(color_program->program);
@@ -151,14 +127,15 @@ DrawLines::~DrawLines() {
 	//use the mapping vertex_buffer_for_color_program to fetch vertex data:
 	glBindVertexArray(vertex_buffer_for_color_program);
 
-	//run the OpenGL pipeline:
-	glDrawArrays(GL_LINES, 0, GLsizei(attribs.size()));
+	//run the OpenGL pipeline (on the vertices just streamed):
+	glDrawArrays(GL_LINES, GLint(offset / sizeof(attribs[0])), GLsizei(attribs.size()));
 
 	//reset vertex array to none:
 	glBindVertexArray(0);
 
 	//reset current program to none:
 	glUseProgram(0);
-}
-
 
+	//keep the storage for the next DrawLines:
+	if (attribs.capacity() > spare_attribs.capacity()) attribs.swap(spare_attribs);
+}
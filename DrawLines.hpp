@@ -6,6 +6,10 @@
  *
  * Similar usage pattern to DrawSprites.
  *
+ * Vertices are streamed through vertex_stream() (see StreamBuffer.hpp), and
+ *  the attribs array is handed on to the next DrawLines, so drawing lines
+ *  every frame doesn't reallocate GPU or CPU storage.
+ *
  */
 
 
@@ -33,7 +37,7 @@ struct DrawLines {
 		glm::u8vec4 const &color = glm::u8vec4(0xff),
 		glm::vec3 *anchor_out = nullptr);
 
-	//Finish drawing (push attribs to GPU):
+	//Finish drawing (stream attribs to GPU and draw them):
 	~DrawLines();
 
 
@@ -0,0 +1,194 @@
+#include "HUD.hpp"
+
+#include "ColorProgram.hpp"
+#include "PathFont.hpp"
+
+#include "gl_errors.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+//n.b. declared static so it doesn't conflict with similarly named global variables elsewhere:
+static HUD::Stats stats;
+
+HUD::HUD() {
+	glGenBuffers(1, &buffer);
+
+	//vertex array mapping buffer for color_program (the same layout as DrawLines uses):
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	glVertexAttribPointer(
+		color_program->Position_vec4, //attribute
+		3, //size
+		GL_FLOAT, //type
+		GL_FALSE, //normalized
+		sizeof(DrawLines::Vertex), //stride
+		(GLbyte *)0 + offsetof(DrawLines::Vertex, Position) //offset
+	);
+	glEnableVertexAttribArray(color_program->Position_vec4);
+
+	glVertexAttribPointer(
+		color_program->Color_vec4, //attribute
+		4, //size
+		GL_UNSIGNED_BYTE, //type
+		GL_TRUE, //normalized
+		sizeof(DrawLines::Vertex), //stride
+		(GLbyte *)0 + offsetof(DrawLines::Vertex, Color) //offset
+	);
+	glEnableVertexAttribArray(color_program->Color_vec4);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	GL_ERRORS();
+}
+
+HUD::~HUD() {
+	glDeleteVertexArrays(1, &vao);
+	vao = 0;
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+uint32_t HUD::add() {
+	elements.emplace_back();
+	return uint32_t(elements.size() - 1);
+}
+
+void HUD::set_text(uint32_t index, std::string_view text, glm::vec3 const &anchor, glm::vec3 const &x, glm::vec3 const &y, glm::u8vec4 const &color) {
+	assert(index < elements.size());
+	Element &element = elements[index];
+	if (element.kind == Element::Text && element.text == text
+	 && element.anchor == anchor && element.x == x && element.y == y && element.color == color) return;
+
+	element.kind = Element::Text;
+	element.text = text;
+	element.anchor = anchor;
+	element.x = x;
+	element.y = y;
+	element.endpoints.clear();
+	element.color = color;
+
+	scratch.clear();
+	PathFont::Layout const &layout = PathFont::font.layout(text);
+	glm::vec2 const *coords = PathFont::font.layout_coords.data();
+	for (uint32_t c = layout.coords_begin; c < layout.coords_end; ++c) {
+		scratch.emplace_back(anchor + x * coords[c].x + y * coords[c].y, color);
+	}
+	store(element);
+}
+
+void HUD::set_lines(uint32_t index, std::vector< glm::vec3 > const &endpoints, glm::u8vec4 const &color) {
+	assert(index < elements.size());
+	assert(endpoints.size() % 2 == 0);
+	Element &element = elements[index];
+	if (element.kind == Element::Lines && element.endpoints == endpoints && element.color == color) return;
+
+	element.kind = Element::Lines;
+	element.text.clear();
+	element.endpoints = endpoints;
+	element.color = color;
+
+	scratch.clear();
+	for (auto const &pt : endpoints) {
+		scratch.emplace_back(pt, color);
+	}
+	store(element);
+}
+
+void HUD::set_visible(uint32_t index, bool visible) {
+	assert(index < elements.size());
+	elements[index].visible = visible;
+}
+
+void HUD::store(Element &element) {
+	stats.vertices_regenerated += scratch.size();
+
+	if (scratch.size() > element.capacity) {
+		//doesn't fit where it was; move to the end, with some room to grow (text often changes length a bit):
+		garbage += element.capacity;
+		element.first = uint32_t(vertices.size());
+		element.capacity = uint32_t(scratch.size() + scratch.size() / 4);
+		vertices.resize(element.first + element.capacity, DrawLines::Vertex(glm::vec3(0.0f), glm::u8vec4(0)));
+	}
+	std::copy(scratch.begin(), scratch.end(), vertices.begin() + element.first);
+	element.count = uint32_t(scratch.size());
+
+	dirty_begin = std::min(dirty_begin, element.first);
+	dirty_end = std::max(dirty_end, element.first + element.count);
+
+	if (garbage > vertices.size() / 2) compact();
+}
+
+void HUD::compact() {
+	std::vector< DrawLines::Vertex > packed;
+	packed.reserve(vertices.size() - garbage);
+	for (auto &element : elements) {
+		uint32_t first = uint32_t(packed.size());
+		packed.insert(packed.end(), vertices.begin() + element.first, vertices.begin() + element.first + element.capacity);
+		element.first = first;
+	}
+	vertices = std::move(packed);
+	garbage = 0;
+
+	dirty_begin = 0;
+	dirty_end = uint32_t(vertices.size());
+}
+
+void HUD::draw(glm::mat4 const &world_to_clip) {
+	//upload whatever changed:
+	if (dirty_begin < dirty_end) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		GLsizeiptr needed = GLsizeiptr(vertices.size() * sizeof(vertices[0]));
+		if (needed > buffer_size) {
+			//grow (and upload everything):
+			buffer_size = std::max(needed, 2 * buffer_size);
+			glBufferData(GL_ARRAY_BUFFER, buffer_size, nullptr, GL_DYNAMIC_DRAW);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, needed, vertices.data());
+			stats.bytes_uploaded += uint64_t(needed);
+		} else {
+			GLsizeiptr bytes = GLsizeiptr((dirty_end - dirty_begin) * sizeof(vertices[0]));
+			glBufferSubData(GL_ARRAY_BUFFER, GLintptr(dirty_begin * sizeof(vertices[0])), bytes, vertices.data() + dirty_begin);
+			stats.bytes_uploaded += uint64_t(bytes);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		dirty_begin = -1U;
+		dirty_end = 0;
+	}
+
+	//ranges to draw (merging neighbors):
+	draw_firsts.clear();
+	draw_counts.clear();
+	for (auto const &element : elements) {
+		if (!element.visible || element.count == 0) continue;
+		if (!draw_firsts.empty() && GLuint(draw_firsts.back() + draw_counts.back()) == element.first) {
+			draw_counts.back() += GLsizei(element.count);
+		} else {
+			draw_firsts.emplace_back(GLint(element.first));
+			draw_counts.emplace_back(GLsizei(element.count));
+		}
+	}
+	if (draw_firsts.empty()) return;
+
+	glUseProgram(color_program->program);
+	glUniformMatrix4fv(color_program->OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(world_to_clip));
+	glBindVertexArray(vao);
+
+	glMultiDrawArrays(GL_LINES, draw_firsts.data(), draw_counts.data(), GLsizei(draw_firsts.size()));
+
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	GL_ERRORS();
+}
+
+HUD::Stats HUD::take_stats() {
+	Stats ret = stats;
+	stats = Stats();
+	return ret;
+}
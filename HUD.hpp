@@ -0,0 +1,97 @@
+#pragma once
+
+/*
+ * Retained-mode HUD: text and line elements whose vertices stay in a vertex
+ *  buffer from frame to frame, drawn with color_program (like DrawLines).
+ *
+ * Setting an element to what it already shows does nothing, so code can set
+ *  everything every frame; an element is only re-tessellated (and its range
+ *  of the buffer re-uploaded) when its content or placement changes.
+ *
+ * e.g.:
+ *   HUD hud;
+ *   uint32_t score = hud.add();
+ *   ...every frame...
+ *   hud.set_text(score, score_text, anchor, x, y, color);
+ *   hud.draw(world_to_clip);
+ *
+ * Uses OpenGL; make HUDs after load time.
+ *
+ */
+
+#include "DrawLines.hpp"
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct HUD {
+	HUD();
+	~HUD();
+	HUD(HUD const &) = delete;
+	HUD &operator=(HUD const &) = delete;
+
+	//add an (empty) element; returns its index:
+	uint32_t add();
+
+	//set element content (re-tessellates only if it differs from the current content):
+
+	//wireframe text, as DrawLines::draw_text:
+	void set_text(uint32_t element, std::string_view text,
+		glm::vec3 const &anchor,
+		glm::vec3 const &x = glm::vec3(1.0f, 0.0f, 0.0f),
+		glm::vec3 const &y = glm::vec3(0.0f, 1.0f, 0.0f),
+		glm::u8vec4 const &color = glm::u8vec4(0xff));
+
+	//lines between pairs of points:
+	void set_lines(uint32_t element, std::vector< glm::vec3 > const &endpoints, glm::u8vec4 const &color = glm::u8vec4(0xff));
+
+	//hidden elements keep their vertices but aren't drawn:
+	void set_visible(uint32_t element, bool visible);
+
+	//upload changed vertices and draw the visible elements:
+	void draw(glm::mat4 const &world_to_clip);
+
+	//counters, summed over all HUDs (reset by take_stats(); e.g., once per frame for an overlay):
+	struct Stats {
+		uint64_t vertices_regenerated = 0; //vertices re-tessellated because an element changed
+		uint64_t bytes_uploaded = 0;
+	};
+	static Stats take_stats();
+
+	//-- internals ---
+	struct Element {
+		//content (compared by the set_* functions):
+		enum Kind : uint8_t { Empty, Text, Lines } kind = Empty;
+		std::string text;
+		glm::vec3 anchor = glm::vec3(0.0f), x = glm::vec3(0.0f), y = glm::vec3(0.0f);
+		std::vector< glm::vec3 > endpoints;
+		glm::u8vec4 color = glm::u8vec4(0);
+		bool visible = true;
+
+		//vertices are vertices[first, first+count), with room up to first+capacity:
+		uint32_t first = 0, count = 0, capacity = 0;
+	};
+	std::vector< Element > elements;
+
+	//copy of the buffer's contents (same layout as DrawLines uses):
+	std::vector< DrawLines::Vertex > vertices;
+	uint32_t garbage = 0; //vertices left behind by elements that outgrew their space
+
+	//range of 'vertices' changed since the last upload:
+	uint32_t dirty_begin = -1U, dirty_end = 0;
+
+	GLuint buffer = 0;
+	GLsizeiptr buffer_size = 0; //bytes
+	GLuint vao = 0;
+
+	std::vector< DrawLines::Vertex > scratch; //(re-tessellation happens here)
+	std::vector< GLint > draw_firsts; //(per-element draw ranges, for glMultiDrawArrays)
+	std::vector< GLsizei > draw_counts;
+
+	void store(Element &element); //move 'scratch' into element's vertices
+	void compact();
+};
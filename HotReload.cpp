@@ -0,0 +1,211 @@
+#include "HotReload.hpp"
+
+#include "AssetArchive.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	//files are reloaded once they have been quiet this long (exporters often write a file more than once):
+	constexpr std::chrono::milliseconds SettleTime(150);
+
+	struct Watcher {
+		std::mutex mutex;
+		std::condition_variable applied_cv;
+
+		std::unordered_map< std::string, std::function< std::function< void() >() > > reloads; //by path
+		std::function< void() > apply; //waiting for update_hot_reload()
+		std::string apply_path;
+
+		bool stop = false;
+		std::thread thread;
+
+#if defined(__linux__)
+		int inotify = -1;
+		std::unordered_map< int, std::string > watch_dirs; //inotify watch descriptor -> directory
+		std::set< std::string > dirs;
+#endif
+
+		~Watcher() {
+			shutdown();
+		}
+
+		void shutdown() {
+			{
+				std::unique_lock< std::mutex > lock(mutex);
+				stop = true;
+			}
+			applied_cv.notify_all();
+			if (thread.joinable()) thread.join();
+#if defined(__linux__)
+			if (inotify != -1) {
+				close(inotify);
+				inotify = -1;
+			}
+#endif
+		}
+
+#if defined(__linux__)
+		void run() {
+			std::map< std::string, Clock::time_point > changed; //path -> time of last change
+
+			while (true) {
+				{
+					std::unique_lock< std::mutex > lock(mutex);
+					if (stop) return;
+				}
+
+				//wait (briefly, so 'stop' is noticed) for inotify events:
+				pollfd pfd;
+				pfd.fd = inotify;
+				pfd.events = POLLIN;
+				pfd.revents = 0;
+				if (poll(&pfd, 1, 50) > 0 && (pfd.revents & POLLIN)) {
+					alignas(inotify_event) char buffer[4096];
+					ssize_t got = read(inotify, buffer, sizeof(buffer));
+					for (ssize_t at = 0; at + ssize_t(sizeof(inotify_event)) <= got; ) {
+						inotify_event const &event = *reinterpret_cast< inotify_event const * >(buffer + at);
+						at += sizeof(inotify_event) + event.len;
+						if (event.len == 0) continue;
+
+						std::unique_lock< std::mutex > lock(mutex);
+						auto dir = watch_dirs.find(event.wd);
+						if (dir == watch_dirs.end()) continue;
+						std::string path = dir->second + "/" + std::string(event.name);
+						if (reloads.count(path)) changed[path] = Clock::now();
+					}
+				}
+
+				//reload files that have settled, one at a time:
+				for (auto c = changed.begin(); c != changed.end(); /* later */) {
+					if (Clock::now() - c->second < SettleTime) {
+						++c;
+						continue;
+					}
+					std::string path = c->first;
+					c = changed.erase(c);
+
+					std::function< std::function< void() >() > reload;
+					{
+						std::unique_lock< std::mutex > lock(mutex);
+						reload = reloads.at(path);
+					}
+
+					std::cout << "Hot reload: reloading '" << path << "'..." << std::endl;
+					auto before = Clock::now();
+					std::function< void() > fresh;
+					try {
+						fresh = reload();
+					} catch (std::exception const &e) {
+						std::cerr << "Hot reload: failed to reload '" << path << "' (keeping old version):\n  " << e.what() << std::endl;
+						continue;
+					}
+					std::cout << "Hot reload: loaded '" << path << "' in "
+						<< std::chrono::duration< double, std::milli >(Clock::now() - before).count() << " ms." << std::endl;
+
+					//hand off to the main thread and wait until it has been applied:
+					std::unique_lock< std::mutex > lock(mutex);
+					apply = fresh;
+					apply_path = path;
+					applied_cv.wait(lock, [this]() { return stop || !apply; });
+					if (stop) return;
+				}
+			}
+		}
+#endif
+	};
+
+	Watcher &get_watcher() {
+		static Watcher watcher;
+		return watcher;
+	}
+}
+
+void watch_file(std::string const &path, std::function< std::function< void() >() > const &reload) {
+#if defined(__linux__)
+	Watcher &watcher = get_watcher();
+	std::unique_lock< std::mutex > lock(watcher.mutex);
+
+	if (watcher.inotify == -1) {
+		watcher.inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (watcher.inotify == -1) {
+			std::cerr << "Hot reload: inotify_init1 failed; files won't be reloaded." << std::endl;
+			return;
+		}
+	}
+
+	//watch the directory (not the file), since exporters may replace files rather than rewrite them:
+	std::string dir = ".";
+	std::string::size_type slash = path.rfind('/');
+	if (slash != std::string::npos) dir = path.substr(0, slash);
+	if (watcher.dirs.insert(dir).second) {
+		int wd = inotify_add_watch(watcher.inotify, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (wd == -1) {
+			std::cerr << "Hot reload: can't watch '" << dir << "'; files there won't be reloaded." << std::endl;
+			return;
+		}
+		watcher.watch_dirs[wd] = dir;
+	}
+	watcher.reloads[(slash == std::string::npos ? "./" : "") + path] = reload;
+
+	if (!watcher.thread.joinable()) {
+		watcher.thread = std::thread(&Watcher::run, &watcher);
+	}
+	std::cout << "Hot reload: watching '" << path << "'." << std::endl;
+
+	//the archive is mapped once, so re-exports of packed files only reach loaders that skip it:
+	if (AssetArchive const *archive = asset_archive()) {
+		if (archive->find(asset_archive_name(path))) {
+			std::cerr << "Hot reload: '" << path << "' is also in the asset archive; reloads must read the loose file"
+				" (AssetFile::LooseOnly), and restarts will use the packed copy until the archive is rebuilt." << std::endl;
+		}
+	}
+#else
+	(void)path;
+	(void)reload;
+#endif
+}
+
+void update_hot_reload() {
+	Watcher &watcher = get_watcher();
+	std::function< void() > apply;
+	std::string path;
+	{
+		std::unique_lock< std::mutex > lock(watcher.mutex);
+		if (!watcher.apply) return;
+		apply = watcher.apply;
+		path = watcher.apply_path;
+	}
+
+	try {
+		apply();
+		std::cout << "Hot reload: applied '" << path << "'." << std::endl;
+	} catch (std::exception const &e) {
+		std::cerr << "Hot reload: failed to apply '" << path << "':\n  " << e.what() << std::endl;
+	}
+
+	{
+		std::unique_lock< std::mutex > lock(watcher.mutex);
+		watcher.apply = nullptr;
+	}
+	watcher.applied_cv.notify_one();
+}
+
+void stop_hot_reload() {
+	get_watcher().shutdown();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+/*
+ * Hot reloading: watches data files for changes (using inotify, so only on Linux)
+ *  and reloads them while the game keeps running.
+ *
+ * watch_file() registers a 'reload' function for a file. When the file changes:
+ *  - 'reload' is called on a background thread; it must not call OpenGL.
+ *    It reads the file and returns an 'apply' function holding the new data.
+ *  - 'apply' is called on the main thread at the next frame boundary (from update_hot_reload())
+ *    and swaps the new data in; it may call OpenGL.
+ *
+ * Files are reloaded one at a time (each reload waits for the previous apply),
+ *  so reload functions can safely read anything that apply functions change.
+ *
+ * The asset archive (see AssetArchive.hpp) is mapped once at startup, so it never
+ *  has a re-exported file: 'reload' should read the loose file (AssetFile::LooseOnly),
+ *  and watched files are best left out of the archive (watch_file() warns if they aren't).
+ *
+ * e.g.:
+ *   watch_file(data_path("level.pnct"), []() -> std::function< void() > {
+ *       auto fresh = std::make_shared< MeshBuffer >(data_path("level.pnct"), MeshBuffer::UploadLater, AssetFile::LooseOnly);
+ *       return [fresh]() { level_meshes_editable->replace(std::move(*fresh)); };
+ *   });
+ *   //(Sound::Sample reads through the archive, so only unpacked sounds can be reloaded this way)
+ *   watch_file(data_path("boing.opus"), []() -> std::function< void() > {
+ *       auto fresh = std::make_shared< Sound::Sample >(data_path("boing.opus"));
+ *       return [fresh]() { Sound::replace_sample_data(*boing_editable, std::move(fresh->data)); };
+ *   });
+ *
+ * Errors thrown by 'reload' (e.g., from a half-written file) are printed and the old data is kept.
+ *
+ */
+
+#include <functional>
+#include <string>
+
+//reload 'path' whenever it changes:
+void watch_file(std::string const &path, std::function< std::function< void() >() > const &reload);
+
+//apply finished reloads (call once per frame from the main loop, outside of update/draw):
+void update_hot_reload();
+
+//stop watching (call before exiting):
+void stop_hot_reload();
@@ -0,0 +1,117 @@
+#include "LightClusters.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+void LightClusters::clear() {
+	lights.clear();
+}
+
+void LightClusters::add(Light const &light_) {
+	lights.emplace_back(light_);
+	Light &light = lights.back();
+	if (light.type == float(Point) || light.type == float(Spot)) {
+		//shaders attenuate as energy / distance^2, so contribution drops below energy_cutoff at:
+		float peak = std::max(light.energy.r, std::max(light.energy.g, light.energy.b));
+		light.radius = std::sqrt(std::max(0.0f, peak) / energy_cutoff);
+	} else {
+		light.radius = 0.0f;
+	}
+}
+
+void LightClusters::build(glm::mat4x3 const &world_to_view, glm::vec2 const &clip_scale) {
+	assert(grid.x > 0 && grid.y > 0 && grid.z > 0);
+	assert(0.0f < near && near < far);
+
+	uint32_t const cluster_count = grid.x * grid.y * grid.z;
+	depth_scale = float(grid.z) / std::log(far / near);
+
+	//---- global lights go first in the index list ----
+	indices.clear();
+	for (uint32_t l = 0; l < lights.size(); ++l) {
+		if (lights[l].type == float(Hemisphere) || lights[l].type == float(Directional)) {
+			indices.emplace_back(l);
+		}
+	}
+	global_count = uint32_t(indices.size());
+
+	//---- find the range of clusters touched by each local light ----
+	ranges.clear();
+
+	//helpers to map normalized device coordinates and depth to cluster indices:
+	auto tile = [](float ndc, uint32_t count) -> uint32_t {
+		float t = std::floor((ndc * 0.5f + 0.5f) * float(count));
+		return uint32_t(std::max(0.0f, std::min(float(count - 1), t)));
+	};
+	auto slice = [this](float depth) -> uint32_t {
+		if (depth <= near) return 0;
+		float s = std::floor(std::log(depth / near) * depth_scale);
+		return uint32_t(std::min(float(grid.z - 1), s));
+	};
+
+	for (uint32_t l = 0; l < lights.size(); ++l) {
+		Light const &light = lights[l];
+		if (!(light.type == float(Point) || light.type == float(Spot))) continue;
+		if (light.radius <= 0.0f) continue;
+
+		glm::vec3 center = world_to_view * glm::vec4(light.position, 1.0f);
+		float r = light.radius;
+
+		//depth range of the light's bounding sphere (camera looks along -z):
+		float d_max = -center.z + r;
+		if (d_max <= 0.0f) continue; //entirely behind the camera
+		float d_min = std::max(-center.z - r, 1e-4f);
+
+		//conservative range of x/depth and y/depth over the sphere's bounding box:
+		auto project_range = [&](float lo, float hi, float scale, float *ndc_min, float *ndc_max) {
+			*ndc_min = scale * (lo >= 0.0f ? lo / d_max : lo / d_min);
+			*ndc_max = scale * (hi >= 0.0f ? hi / d_min : hi / d_max);
+		};
+		float x_min, x_max, y_min, y_max;
+		project_range(center.x - r, center.x + r, clip_scale.x, &x_min, &x_max);
+		project_range(center.y - r, center.y + r, clip_scale.y, &y_min, &y_max);
+		if (x_max < -1.0f || x_min > 1.0f || y_max < -1.0f || y_min > 1.0f) continue; //off screen
+
+		Range range;
+		range.light = l;
+		range.min = glm::uvec3(tile(x_min, grid.x), tile(y_min, grid.y), slice(d_min));
+		range.max = glm::uvec3(tile(x_max, grid.x), tile(y_max, grid.y), slice(d_max));
+		ranges.emplace_back(range);
+	}
+
+	//---- count lights per cluster ----
+	clusters.assign(cluster_count, glm::uvec2(0));
+	for (auto const &range : ranges) {
+		for (uint32_t z = range.min.z; z <= range.max.z; ++z) {
+			for (uint32_t y = range.min.y; y <= range.max.y; ++y) {
+				glm::uvec2 *row = &clusters[grid.x * (y + grid.y * z)];
+				for (uint32_t x = range.min.x; x <= range.max.x; ++x) {
+					row[x].y += 1;
+				}
+			}
+		}
+	}
+
+	//---- prefix sum to find where each cluster's list starts ----
+	uint32_t total = global_count;
+	for (auto &cluster : clusters) {
+		cluster.x = total;
+		total += cluster.y;
+		cluster.y = 0; //reset; will count up again while filling
+	}
+	indices.resize(total);
+
+	//---- fill per-cluster lists ----
+	for (auto const &range : ranges) {
+		for (uint32_t z = range.min.z; z <= range.max.z; ++z) {
+			for (uint32_t y = range.min.y; y <= range.max.y; ++y) {
+				glm::uvec2 *row = &clusters[grid.x * (y + grid.y * z)];
+				for (uint32_t x = range.min.x; x <= range.max.x; ++x) {
+					indices[row[x].x + row[x].y] = range.light;
+					row[x].y += 1;
+				}
+			}
+		}
+	}
+}
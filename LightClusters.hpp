@@ -0,0 +1,87 @@
+#pragma once
+
+/*
+ * LightClusters bins lights into a grid of view-space "froxels" (frustum voxels)
+ * so that a fragment shader only has to loop over the lights that can reach
+ * the cluster it lies in.
+ *
+ * Clusters tile the screen in x and y (in normalized device coordinates) and
+ * slice view depth exponentially between 'near' and 'far' in z.
+ *
+ * Global lights (hemisphere and directional) reach everything, so they are
+ * listed once at the start of 'indices' instead of in every cluster.
+ *
+ * This code uses no OpenGL, so it can be run (and benchmarked) headlessly;
+ * see set_lights() in UniformBlocks.hpp for the upload side.
+ *
+ */
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+struct LightClusters {
+	//light types (same numbering as used in the shaders):
+	enum Type : uint32_t {
+		Point = 0,
+		Hemisphere = 1,
+		Spot = 2,
+		Directional = 3,
+	};
+
+	//Light data, laid out as three vec4 texels per light for direct upload:
+	struct Light {
+		glm::vec3 position = glm::vec3(0.0f); //light space
+		float type = float(Point);
+		glm::vec3 direction = glm::vec3(0.0f, 0.0f,-1.0f); //light space
+		float cutoff = 1.0f; //cosine of spot half-angle
+		glm::vec3 energy = glm::vec3(1.0f);
+		float radius = 0.0f; //distance at which contribution is faded to zero (point and spot lights only)
+	};
+	static_assert(sizeof(Light) == 3 * 16, "Light is three vec4s.");
+
+	//------ parameters ------
+
+	//number of clusters in x, y, and z:
+	glm::uvec3 grid = glm::uvec3(16, 9, 24);
+	//view depths covered by the z slices (fragments past 'far' use the last slice):
+	float near = 0.1f;
+	float far = 100.0f;
+	//point and spot lights are cut off where their contribution falls below this:
+	float energy_cutoff = 1.0f / 256.0f;
+
+	//------ input ------
+
+	std::vector< Light > lights;
+
+	//remove all lights (keeps allocated storage):
+	void clear();
+
+	//add a light; sets 'radius' from energy_cutoff for point and spot lights:
+	void add(Light const &light);
+
+	//------ output (computed by build) ------
+
+	//per-cluster (first index, count) into 'indices', cluster (x,y,z) at x + grid.x * (y + grid.y * z):
+	std::vector< glm::uvec2 > clusters;
+	//indices into 'lights'; the first 'global_count' entries are the global lights:
+	std::vector< uint32_t > indices;
+	uint32_t global_count = 0;
+
+	//slice scale used to map depth to z slice, as in: slice = floor(log(depth / near) * depth_scale):
+	float depth_scale = 0.0f;
+
+	//Assign lights to clusters:
+	// world_to_view takes light-space positions to view space (camera looking along -z)
+	// clip_scale holds the x and y scale factors of a symmetric perspective projection
+	//   (i.e., projection[0][0] and projection[1][1])
+	void build(glm::mat4x3 const &world_to_view, glm::vec2 const &clip_scale);
+
+	//internals used by build():
+	struct Range {
+		uint32_t light;
+		glm::uvec3 min, max; //inclusive
+	};
+	std::vector< Range > ranges;
+};
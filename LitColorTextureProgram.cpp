@@ -2,43 +2,35 @@
 
 #include "gl_compile_program.hpp"
 #include "gl_errors.hpp"
+#include "UniformBlocks.hpp"
+#include "Mesh.hpp"
 
 Scene::Drawable::Pipeline lit_color_texture_program_pipeline;
 
-Load< LitColorTextureProgram > lit_color_texture_program(LoadTagEarly, []() -> LitColorTextureProgram const * {
+Load< LitColorTextureProgram > lit_color_texture_program(LoadTagDefault, "lit_color_texture_program", {}, []() -> LitColorTextureProgram const * {
 	LitColorTextureProgram *ret = new LitColorTextureProgram();
 
 	//----- build the pipeline template -----
 	lit_color_texture_program_pipeline.program = ret->program;
 
-	lit_color_texture_program_pipeline.OBJECT_TO_CLIP_mat4 = ret->OBJECT_TO_CLIP_mat4;
-	lit_color_texture_program_pipeline.OBJECT_TO_LIGHT_mat4x3 = ret->OBJECT_TO_LIGHT_mat4x3;
-	lit_color_texture_program_pipeline.NORMAL_TO_LIGHT_mat3 = ret->NORMAL_TO_LIGHT_mat3;
+	//(lights come from the shared Lights block and light buffers; see set_lights())
 
-	/* This will be used later if/when we build a light loop into the Scene:
-	lit_color_texture_program_pipeline.LIGHT_TYPE_int = ret->LIGHT_TYPE_int;
-	lit_color_texture_program_pipeline.LIGHT_LOCATION_vec3 = ret->LIGHT_LOCATION_vec3;
-	lit_color_texture_program_pipeline.LIGHT_DIRECTION_vec3 = ret->LIGHT_DIRECTION_vec3;
-	lit_color_texture_program_pipeline.LIGHT_ENERGY_vec3 = ret->LIGHT_ENERGY_vec3;
-	lit_color_texture_program_pipeline.LIGHT_CUTOFF_float = ret->LIGHT_CUTOFF_float;
-	*/
-
-	//make a 1-pixel white texture to bind by default:
+	//make a 1-pixel white (array) texture to bind by default:
 	GLuint tex;
 	glGenTextures(1, &tex);
 
-	glBindTexture(GL_TEXTURE_2D, tex);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, tex);
 	std::vector< glm::u8vec4 > tex_data(1, glm::u8vec4(0xff));
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, tex_data.data());
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, 1, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, tex_data.data());
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
 
 
 	lit_color_texture_program_pipeline.textures[0].texture = tex;
-	lit_color_texture_program_pipeline.textures[0].target = GL_TEXTURE_2D;
+	lit_color_texture_program_pipeline.textures[0].target = GL_TEXTURE_2D_ARRAY;
 
 	return ret;
 });
@@ -47,62 +39,81 @@ LitColorTextureProgram::LitColorTextureProgram() {
 	//Compile vertex and fragment shaders using the convenient 'gl_compile_program' helper function:
 	program = gl_compile_program(
 		//vertex shader:
-		"#version 330\n"
-		"uniform mat4 OBJECT_TO_CLIP;\n"
-		"uniform mat4x3 OBJECT_TO_LIGHT;\n"
-		"uniform mat3 NORMAL_TO_LIGHT;\n"
+		std::string("#version 330\n")
+		+ scene_blocks_glsl
+		+ octahedral_normal_glsl +
 		"in vec4 Position;\n"
-		"in vec3 Normal;\n"
+		"in vec2 Normal;\n"
 		"in vec4 Color;\n"
 		"in vec2 TexCoord;\n"
 		"out vec3 position;\n"
 		"out vec3 normal;\n"
 		"out vec4 color;\n"
 		"out vec2 texCoord;\n"
+		"out vec3 clipPosition;\n"
 		"void main() {\n"
 		"	gl_Position = OBJECT_TO_CLIP * Position;\n"
 		"	position = OBJECT_TO_LIGHT * Position;\n"
-		"	normal = NORMAL_TO_LIGHT * Normal;\n"
+		"	normal = NORMAL_TO_LIGHT * decode_normal(Normal);\n"
 		"	color = Color;\n"
 		"	texCoord = TexCoord;\n"
+		"	clipPosition = gl_Position.xyw;\n"
 		"}\n"
 	,
 		//fragment shader:
-		"#version 330\n"
-		"uniform sampler2D TEX;\n"
-		"uniform int LIGHT_TYPE;\n"
-		"uniform vec3 LIGHT_LOCATION;\n"
-		"uniform vec3 LIGHT_DIRECTION;\n"
-		"uniform vec3 LIGHT_ENERGY;\n"
-		"uniform float LIGHT_CUTOFF;\n"
+		std::string("#version 330\n")
+		+ scene_blocks_glsl +
+		"uniform sampler2DArray TEX;\n"
 		"in vec3 position;\n"
 		"in vec3 normal;\n"
 		"in vec4 color;\n"
 		"in vec2 texCoord;\n"
+		"in vec3 clipPosition;\n"
 		"out vec4 fragColor;\n"
+		//light 'index' is stored as three texels in LIGHTS (see LightClusters::Light):
+		"vec3 shade(uint index, vec3 n) {\n"
+		"	vec4 a = texelFetch(LIGHTS, int(3u*index+0u));\n" //position, type
+		"	vec4 b = texelFetch(LIGHTS, int(3u*index+1u));\n" //direction, cutoff
+		"	vec4 c = texelFetch(LIGHTS, int(3u*index+2u));\n" //energy, radius
+		"	int type = int(a.w);\n"
+		"	if (type == 1) { //hemi light \n"
+		"		return (dot(n,-b.xyz) * 0.5 + 0.5) * c.rgb;\n"
+		"	} else if (type == 3) { //directional light \n"
+		"		return max(0.0, dot(n,-b.xyz)) * c.rgb;\n"
+		"	}\n"
+		//point and spot lights fade to zero at their cluster radius:
+		"	vec3 l = (a.xyz - position);\n"
+		"	float dis2 = dot(l,l);\n"
+		"	l = normalize(l);\n"
+		"	float nl = max(0.0, dot(n, l)) / max(1.0, dis2);\n"
+		"	float r2 = c.w * c.w;\n"
+		"	float f = clamp(1.0 - (dis2 * dis2) / (r2 * r2), 0.0, 1.0);\n"
+		"	nl *= f * f;\n"
+		"	if (type == 2) { //spot light \n"
+		"		float cs = dot(l,-b.xyz);\n"
+		"		nl *= smoothstep(b.w,mix(b.w,1.0,0.1), cs);\n"
+		"	}\n"
+		"	return nl * c.rgb;\n"
+		"}\n"
 		"void main() {\n"
 		"	vec3 n = normalize(normal);\n"
-		"	vec3 e;\n"
-		"	if (LIGHT_TYPE == 0) { //point light \n"
-		"		vec3 l = (LIGHT_LOCATION - position);\n"
-		"		float dis2 = dot(l,l);\n"
-		"		l = normalize(l);\n"
-		"		float nl = max(0.0, dot(n, l)) / max(1.0, dis2);\n"
-		"		e = nl * LIGHT_ENERGY;\n"
-		"	} else if (LIGHT_TYPE == 1) { //hemi light \n"
-		"		e = (dot(n,-LIGHT_DIRECTION) * 0.5 + 0.5) * LIGHT_ENERGY;\n"
-		"	} else if (LIGHT_TYPE == 2) { //spot light \n"
-		"		vec3 l = (LIGHT_LOCATION - position);\n"
-		"		float dis2 = dot(l,l);\n"
-		"		l = normalize(l);\n"
-		"		float nl = max(0.0, dot(n, l)) / max(1.0, dis2);\n"
-		"		float c = dot(l,-LIGHT_DIRECTION);\n"
-		"		nl *= smoothstep(LIGHT_CUTOFF,mix(LIGHT_CUTOFF,1.0,0.1), c);\n"
-		"		e = nl * LIGHT_ENERGY;\n"
-		"	} else { //(LIGHT_TYPE == 3) //directional light \n"
-		"		e = max(0.0, dot(n,-LIGHT_DIRECTION)) * LIGHT_ENERGY;\n"
+		"	vec3 e = vec3(0.0);\n"
+		//global lights are listed first:
+		"	for (uint i = 0u; i < CLUSTER_GRID.w; ++i) {\n"
+		"		e += shade(texelFetch(LIGHT_INDICES, int(i)).r, n);\n"
+		"	}\n"
+		//find this fragment's cluster (same math as LightClusters::build):
+		"	vec2 ndc = clipPosition.xy / clipPosition.z;\n"
+		"	uvec2 tile = uvec2(clamp(floor((ndc * 0.5 + 0.5) * vec2(CLUSTER_GRID.xy)), vec2(0.0), vec2(CLUSTER_GRID.xy - 1u)));\n"
+		"	float s = floor(log(max(clipPosition.z / CLUSTER_DEPTH.x, 1.0)) * CLUSTER_DEPTH.y);\n"
+		"	uint slice = uint(min(s, float(CLUSTER_GRID.z - 1u)));\n"
+		"	uvec2 cluster = texelFetch(CLUSTERS, int(tile.x + CLUSTER_GRID.x * (tile.y + CLUSTER_GRID.y * slice))).rg;\n"
+		"	for (uint i = cluster.x; i < cluster.x + cluster.y; ++i) {\n"
+		"		e += shade(texelFetch(LIGHT_INDICES, int(i)).r, n);\n"
 		"	}\n"
-		"	vec4 albedo = texture(TEX, texCoord) * color;\n"
+		//texCoord repeats within the drawable's atlas region (gradients come from the unwrapped coordinates, so mip levels don't jump at the wrap):
+		"	vec2 atlasCoord = TEXCOORD_TO_ATLAS.zw + fract(texCoord) * TEXCOORD_TO_ATLAS.xy;\n"
+		"	vec4 albedo = textureGrad(TEX, vec3(atlasCoord, ATLAS_LAYER), dFdx(texCoord) * TEXCOORD_TO_ATLAS.xy, dFdy(texCoord) * TEXCOORD_TO_ATLAS.xy) * color;\n"
 		"	fragColor = vec4(e*albedo.rgb / (max(-position.x + position.y, 1.)), albedo.a);\n"
 		"}\n"
 	);
@@ -111,28 +122,20 @@ LitColorTextureProgram::LitColorTextureProgram() {
 
 	//look up the locations of vertex attributes:
 	Position_vec4 = glGetAttribLocation(program, "Position");
-	Normal_vec3 = glGetAttribLocation(program, "Normal");
+	Normal_vec2 = glGetAttribLocation(program, "Normal");
 	Color_vec4 = glGetAttribLocation(program, "Color");
 	TexCoord_vec2 = glGetAttribLocation(program, "TexCoord");
 
-	//look up the locations of uniforms:
-	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
-	OBJECT_TO_LIGHT_mat4x3 = glGetUniformLocation(program, "OBJECT_TO_LIGHT");
-	NORMAL_TO_LIGHT_mat3 = glGetUniformLocation(program, "NORMAL_TO_LIGHT");
-
-	LIGHT_TYPE_int = glGetUniformLocation(program, "LIGHT_TYPE");
-	LIGHT_LOCATION_vec3 = glGetUniformLocation(program, "LIGHT_LOCATION");
-	LIGHT_DIRECTION_vec3 = glGetUniformLocation(program, "LIGHT_DIRECTION");
-	LIGHT_ENERGY_vec3 = glGetUniformLocation(program, "LIGHT_ENERGY");
-	LIGHT_CUTOFF_float = glGetUniformLocation(program, "LIGHT_CUTOFF");
+	//connect the shared Frame/Lights/Object uniform blocks:
+	bind_scene_blocks(program);
 
-
-	GLuint TEX_sampler2D = glGetUniformLocation(program, "TEX");
+	//look up the locations of uniforms:
+	GLuint TEX_sampler2DArray = glGetUniformLocation(program, "TEX");
 
 	//set TEX to always refer to texture binding zero:
 	glUseProgram(program); //bind program -- glUniform* calls refer to this program now
 
-	glUniform1i(TEX_sampler2D, 0); //set TEX to sample from GL_TEXTURE0
+	glUniform1i(TEX_sampler2DArray, 0); //set TEX to sample from GL_TEXTURE0
 
 	glUseProgram(0); //unbind program -- glUniform* calls refer to ??? now
 }
@@ -13,28 +13,22 @@ struct LitColorTextureProgram {
 
 	//Attribute (per-vertex variable) locations:
 	GLuint Position_vec4 = -1U;
-	GLuint Normal_vec3 = -1U;
+	GLuint Normal_vec2 = -1U; //octahedral-encoded (see Mesh.hpp)
 	GLuint Color_vec4 = -1U;
 	GLuint TexCoord_vec2 = -1U;
 
-	//Uniform (per-invocation variable) locations:
-	GLuint OBJECT_TO_CLIP_mat4 = -1U;
-	GLuint OBJECT_TO_LIGHT_mat4x3 = -1U;
-	GLuint NORMAL_TO_LIGHT_mat3 = -1U;
-
-	//lighting:
-	GLuint LIGHT_TYPE_int = -1U;
-	GLuint LIGHT_LOCATION_vec3 = -1U;
-	GLuint LIGHT_DIRECTION_vec3 = -1U;
-	GLuint LIGHT_ENERGY_vec3 = -1U;
-	GLuint LIGHT_CUTOFF_float = -1U;
-	
+	//Uniform blocks (bound with bind_scene_blocks; see UniformBlocks.hpp):
+	//Object - OBJECT_TO_CLIP, OBJECT_TO_LIGHT, NORMAL_TO_LIGHT
+	//Lights - CLUSTER_GRID, CLUSTER_DEPTH
+
 	//Textures:
-	//TEXTURE0 - texture that is accessed by TexCoord
+	//TEXTURE0 - array texture that is accessed by TexCoord, mapped into the drawable's atlas region (TEXCOORD_TO_ATLAS, ATLAS_LAYER; see TextureAtlas.hpp)
+	//TEXTURE4..6 - clustered light buffers (LIGHTS, CLUSTERS, LIGHT_INDICES; see set_lights())
 };
 
 extern Load< LitColorTextureProgram > lit_color_texture_program;
 
 //For convenient scene-graph setup, copy this object:
 // NOTE: by default, has texture bound to 1-pixel white texture -- so it's okay to use with vertex-color-only meshes.
+//  (to use an image, point the pipeline at it with TextureAtlas::apply)
 extern Scene::Drawable::Pipeline lit_color_texture_program_pipeline;
@@ -1,17 +1,210 @@
 #include "Load.hpp"
 
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <iomanip>
+#include <iostream>
 #include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <cassert>
 
 namespace {
-	std::array< std::list< std::function< void() > >, MaxLoadTag > &get_load_lists() {
-		static std::array< std::list< std::function< void() > >, MaxLoadTag > load_lists;
+	std::array< std::list< LoadFunction >, MaxLoadTag > &get_load_lists() {
+		static std::array< std::list< LoadFunction >, MaxLoadTag > load_lists;
 		return load_lists;
 	}
+
+	using Clock = std::chrono::high_resolution_clock;
+
+	struct Loader {
+		LoadFunction fn;
+		LoadTag tag = LoadTagDefault;
+		std::vector< size_t > dependents; //loaders waiting on this one
+		uint32_t waiting_on = 0; //unfinished loaders this one needs
+		bool loaded = false; //'load' phase finished
+		double started_at = 0.0, finished_at = 0.0, load_ms = 0.0, upload_ms = 0.0; //for the timing table
+	};
+
+	//State shared by call_load_functions(), update_load_functions(), and the worker threads:
+	// (created on first use -- after all global Load<> objects -- so it is destroyed before them)
+	struct Loading {
+		std::vector< Loader > loaders;
+		Clock::time_point start;
+
+		std::mutex mutex;
+		std::condition_variable load_cv, upload_cv;
+		std::deque< size_t > load_queue; //loaders ready for their 'load' phase (run by workers)
+		std::deque< size_t > upload_queue; //loaders ready for their 'upload' phase (run by main thread)
+		std::exception_ptr error;
+		bool stop = false;
+		size_t remaining = 0; //loaders not yet finished
+		size_t remaining_blocking = 0; //...of which call_load_functions() waits for
+
+		uint32_t worker_count = 0;
+		std::vector< std::thread > workers;
+
+		~Loading() {
+			stop_workers();
+		}
+
+		double ms_since_start() const {
+			return std::chrono::duration< double, std::milli >(Clock::now() - start).count();
+		}
+
+		//(call with mutex held)
+		void make_ready(size_t i) {
+			if (loaders[i].fn.load && worker_count > 0) {
+				load_queue.emplace_back(i);
+				load_cv.notify_one();
+			} else {
+				//no load phase (or no workers): main thread does everything:
+				upload_queue.emplace_back(i);
+				upload_cv.notify_one();
+			}
+		}
+
+		void worker() {
+			std::unique_lock< std::mutex > lock(mutex);
+			while (true) {
+				load_cv.wait(lock, [&]() { return stop || !load_queue.empty(); });
+				if (stop) return;
+				size_t i = load_queue.front();
+				load_queue.pop_front();
+				lock.unlock();
+
+				loaders[i].started_at = ms_since_start();
+				auto before = Clock::now();
+				try {
+					loaders[i].fn.load();
+				} catch (...) {
+					lock.lock();
+					if (!error) error = std::current_exception();
+					upload_cv.notify_one();
+					continue;
+				}
+				loaders[i].load_ms = std::chrono::duration< double, std::milli >(Clock::now() - before).count();
+
+				lock.lock();
+				loaders[i].loaded = true;
+				upload_queue.emplace_back(i);
+				upload_cv.notify_one();
+			}
+		}
+
+		//run the main-thread part of the first loader in upload_queue and release its dependents:
+		// (call with mutex held and upload_queue non-empty; mutex is held again on return or throw)
+		void finish_one(std::unique_lock< std::mutex > &lock) {
+			size_t i = upload_queue.front();
+			upload_queue.pop_front();
+			lock.unlock();
+
+			Loader &loader = loaders[i];
+			try {
+				if (!loader.loaded) loader.started_at = ms_since_start();
+				if (loader.fn.load && !loader.loaded) {
+					auto before = Clock::now();
+					loader.fn.load();
+					loader.load_ms = std::chrono::duration< double, std::milli >(Clock::now() - before).count();
+					loader.loaded = true;
+				}
+				if (loader.fn.upload) {
+					auto before = Clock::now();
+					loader.fn.upload();
+					loader.upload_ms = std::chrono::duration< double, std::milli >(Clock::now() - before).count();
+				}
+			} catch (...) {
+				lock.lock();
+				throw;
+			}
+			loader.finished_at = ms_since_start();
+
+			lock.lock();
+			remaining -= 1;
+			if (loader.tag != LoadTagStream) remaining_blocking -= 1;
+			for (size_t d : loader.dependents) {
+				if (--loaders[d].waiting_on == 0) make_ready(d);
+			}
+		}
+
+		//stop workers (letting any load in progress finish) and rethrow 'error':
+		// (call with mutex held)
+		void fail(std::unique_lock< std::mutex > &lock) {
+			assert(error);
+			lock.unlock();
+			stop_workers();
+			lock.lock();
+			std::rethrow_exception(error);
+		}
+
+		//once everything is loaded, stop workers and print timing table:
+		// (call with mutex held; returns true if everything is loaded)
+		bool check_done(std::unique_lock< std::mutex > &lock, char const *what) {
+			if (remaining != 0) return false;
+			lock.unlock();
+			stop_workers();
+			report(what);
+			lock.lock();
+			return true;
+		}
+
+		void stop_workers() {
+			{
+				std::unique_lock< std::mutex > lock(mutex);
+				stop = true;
+			}
+			load_cv.notify_all();
+			for (auto &worker : workers) {
+				worker.join();
+			}
+			workers.clear();
+		}
+
+		void report(char const *what) const {
+			double work_ms = 0.0;
+			for (auto const &loader : loaders) {
+				work_ms += loader.load_ms + loader.upload_ms;
+			}
+			std::cout << what << " " << loaders.size() << " things in " << std::fixed << std::setprecision(1) << ms_since_start() << " ms"
+				<< " (" << work_ms << " ms of work; " << worker_count << " worker threads):\n";
+			std::cout << "  " << std::left << std::setw(32) << "loader" << std::right
+				<< std::setw(10) << "start ms"
+				<< std::setw(10) << "load ms"
+				<< std::setw(11) << "upload ms"
+				<< std::setw(10) << "done ms" << "\n";
+			for (auto const &loader : loaders) {
+				std::cout << "  " << std::left << std::setw(32) << (loader.fn.name.empty() ? "(unnamed)" : loader.fn.name) << std::right
+					<< std::setw(10) << std::setprecision(2) << loader.started_at
+					<< std::setw(10) << loader.load_ms
+					<< std::setw(11) << loader.upload_ms
+					<< std::setw(10) << loader.finished_at
+					<< (loader.tag == LoadTagStream ? "  (streamed)" : "") << "\n";
+			}
+			std::cout << std::defaultfloat;
+			std::cout.flush();
+		}
+	};
+
+	Loading &get_loading() {
+		static Loading loading;
+		return loading;
+	}
 }
 
 void add_load_function(LoadTag tag, std::function< void() > const &fn) {
+	//unnamed loaders run on the main thread, as they always have:
+	LoadFunction load_function;
+	load_function.upload = fn;
+	add_load_function(tag, load_function);
+}
+
+void add_load_function(LoadTag tag, LoadFunction const &fn) {
 	auto &load_lists = get_load_lists();
 	assert(tag < load_lists.size());
 	load_lists[tag].emplace_back(fn);
@@ -22,11 +215,154 @@ void call_load_functions() {
 	assert(!has_been_called && "call_load_functions should only be called *once*");
 	has_been_called = true;
 
+	Loading &loading = get_loading();
+	loading.start = Clock::now();
+
+	//---- build dependency graph ----
+	auto &loaders = loading.loaders;
 	auto &load_lists = get_load_lists();
-	for (auto &fn_list : load_lists) {
-		while (!fn_list.empty()) {
-			(*fn_list.begin())(); //call first function in the list
-			fn_list.pop_front(); //remove from list
+	for (uint32_t tag = 0; tag < load_lists.size(); ++tag) {
+		for (auto &fn : load_lists[tag]) {
+			loaders.emplace_back();
+			loaders.back().fn = std::move(fn);
+			loaders.back().tag = LoadTag(tag);
+		}
+		load_lists[tag].clear();
+	}
+
+	std::unordered_map< std::string, size_t > by_name;
+	for (size_t i = 0; i < loaders.size(); ++i) {
+		if (loaders[i].fn.name.empty()) continue;
+		if (!by_name.emplace(loaders[i].fn.name, i).second) {
+			throw std::runtime_error("Two loaders are named '" + loaders[i].fn.name + "'.");
+		}
+	}
+
+	for (size_t i = 0; i < loaders.size(); ++i) {
+		std::vector< size_t > needs;
+		for (auto const &name : loaders[i].fn.after) {
+			auto f = by_name.find(name);
+			if (f == by_name.end()) {
+				throw std::runtime_error("Loader '" + loaders[i].fn.name + "' runs after '" + name + "', but there is no loader with that name.");
+			}
+			needs.emplace_back(f->second);
+		}
+		//tags still sequence loading; loaders wait for everything with an earlier tag:
+		for (size_t j = 0; j < loaders.size() && loaders[j].tag < loaders[i].tag; ++j) {
+			needs.emplace_back(j);
+		}
+		std::sort(needs.begin(), needs.end());
+		needs.erase(std::unique(needs.begin(), needs.end()), needs.end());
+		for (size_t j : needs) {
+			loaders[j].dependents.emplace_back(i);
+		}
+		loaders[i].waiting_on = uint32_t(needs.size());
+	}
+
+	{ //check for cycles, which would otherwise leave loaders waiting forever:
+		std::vector< uint32_t > waiting_on(loaders.size());
+		std::vector< size_t > ready;
+		for (size_t i = 0; i < loaders.size(); ++i) {
+			waiting_on[i] = loaders[i].waiting_on;
+			if (waiting_on[i] == 0) ready.emplace_back(i);
+		}
+		size_t visited = 0;
+		while (!ready.empty()) {
+			size_t i = ready.back();
+			ready.pop_back();
+			visited += 1;
+			for (size_t d : loaders[i].dependents) {
+				if (--waiting_on[d] == 0) ready.emplace_back(d);
+			}
+		}
+		if (visited != loaders.size()) {
+			std::string names;
+			for (size_t i = 0; i < loaders.size(); ++i) {
+				if (waiting_on[i] != 0) names += " '" + loaders[i].fn.name + "'";
+			}
+			throw std::runtime_error("Loaders have circular dependencies; involved:" + names);
+		}
+	}
+
+	//---- run ----
+	//one worker per core (leaving one for the main thread), but no more than there is work for:
+	uint32_t cores = std::thread::hardware_concurrency(); //(may be 0 if unknown)
+	loading.worker_count = (cores > 2 ? cores - 1 : 1);
+	loading.worker_count = std::min(loading.worker_count, uint32_t(std::count_if(loaders.begin(), loaders.end(), [](Loader const &loader) {
+		return bool(loader.fn.load);
+	})));
+	if (char const *threads = std::getenv("LOAD_THREADS")) {
+		loading.worker_count = uint32_t(std::max(0, std::atoi(threads)));
+	}
+
+	for (uint32_t w = 0; w < loading.worker_count; ++w) {
+		loading.workers.emplace_back(&Loading::worker, &loading);
+	}
+
+	std::unique_lock< std::mutex > lock(loading.mutex);
+	loading.remaining = loaders.size();
+	loading.remaining_blocking = std::count_if(loaders.begin(), loaders.end(), [](Loader const &loader) {
+		return loader.tag != LoadTagStream;
+	});
+	for (size_t i = 0; i < loaders.size(); ++i) {
+		if (loaders[i].waiting_on == 0) loading.make_ready(i);
+	}
+
+	//main thread runs upload phases until everything but streaming loaders is done:
+	try {
+		while (loading.remaining_blocking > 0) {
+			loading.upload_cv.wait(lock, [&]() { return loading.error || !loading.upload_queue.empty(); });
+			if (loading.error) break;
+			loading.finish_one(lock);
 		}
+	} catch (...) {
+		if (!loading.error) loading.error = std::current_exception();
+	}
+	if (loading.error) loading.fail(lock);
+
+	if (!loading.check_done(lock, "Loaded")) {
+		std::cout << "Loaded " << (loaders.size() - loading.remaining) << " things in " << std::fixed << std::setprecision(1) << loading.ms_since_start() << " ms;"
+			<< " streaming " << loading.remaining << " more in the background." << std::defaultfloat << std::endl;
 	}
 }
+
+bool update_load_functions(float budget_ms) {
+	Loading &loading = get_loading();
+	std::unique_lock< std::mutex > lock(loading.mutex);
+	if (loading.remaining == 0 || loading.stop) return false;
+
+	auto before = Clock::now();
+	try {
+		//(always finish at least one loader, even if it alone takes longer than the budget)
+		while (!loading.error && !loading.upload_queue.empty()) {
+			loading.finish_one(lock);
+			if (std::chrono::duration< float, std::milli >(Clock::now() - before).count() >= budget_ms) break;
+		}
+	} catch (...) {
+		if (!loading.error) loading.error = std::current_exception();
+	}
+	if (loading.error) loading.fail(lock);
+
+	return !loading.check_done(lock, "Streamed");
+}
+
+void wait_for_load_function() {
+	Loading &loading = get_loading();
+	std::unique_lock< std::mutex > lock(loading.mutex);
+	if (loading.remaining == 0 || loading.stop) {
+		throw std::runtime_error("Waiting for a loader, but nothing is loading.");
+	}
+	try {
+		loading.upload_cv.wait(lock, [&]() { return loading.error || !loading.upload_queue.empty(); });
+		if (!loading.error) loading.finish_one(lock);
+	} catch (...) {
+		if (!loading.error) loading.error = std::current_exception();
+	}
+	if (loading.error) loading.fail(lock);
+	loading.check_done(lock, "Streamed");
+}
+
+void stop_load_functions() {
+	Loading &loading = get_loading();
+	loading.stop_workers();
+}
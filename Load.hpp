@@ -20,28 +20,88 @@
  * These functions are grouped by 'tags', which allow some sequencing of calls.
  * (particularly, this is useful for loading large data blobs [e.g. Meshes] before looking up individual elements within them.)
  *
+ * Loaders can also be given a name and a list of (names of) loaders they need to run after.
+ * call_load_functions() starts each loader as soon as those loaders -- and all loaders with earlier tags -- are done.
+ * A loader's work may be split into two phases:
+ *  - 'load', which runs on a pool of worker threads (so must *not* call OpenGL), and
+ *  - 'upload', which runs on the main thread (which owns the OpenGL context).
+ * This lets disk reads, decoding, and parsing of different assets overlap with each other and with OpenGL work:
+ *
+ * Load< MeshBuffer > main_meshes(LoadTagDefault, "main_meshes", {}, []() -> MeshBuffer * {
+ *     return new MeshBuffer(data_path("main.pnct"), MeshBuffer::UploadLater); //worker thread
+ * }, [](MeshBuffer &buffer) {
+ *     buffer.upload(); //main thread
+ * });
+ *
+ * Load< Scene > main_scene(LoadTagDefault, "main_scene", {"main_meshes"}, []() -> Scene const * {
+ *     return new Scene(...); //can use main_meshes->lookup()
+ * }, LoadOnWorkerThread);
+ *
+ * When everything is loaded, call_load_functions() prints how long each loader took.
+ * (set the environment variable LOAD_THREADS=0 to run everything on the main thread, for comparison)
+ *
+ * Loaders tagged LoadTagStream are not waited for: they keep loading in the background after
+ *  call_load_functions() returns, while the main loop calls update_load_functions() once per frame
+ *  to run their main-thread work within a time budget. Code using them should check ready() (or use
+ *  value_or() with a placeholder) until they arrive:
+ *
+ * Load< Scene > big_scene(LoadTagStream, "big_scene", {}, ..., LoadOnWorkerThread);
+ *
+ * void GameMode::draw() {
+ *     if (!big_scene.ready()) { draw_loading_screen(); return; }
+ *     big_scene->draw(camera);
+ * }
+ *
  */
 
 #include <functional>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <vector>
 #include <cstdint>
 
 enum LoadTag : uint32_t {
 	LoadTagEarly,
 	LoadTagDefault,
 	LoadTagLate,
+	LoadTagStream, //<-- loaded in the background after call_load_functions() returns
 	MaxLoadTag //<-- just used to track # of load tags
 };
 
+//Where a single-phase loader runs:
+enum LoadThread : uint32_t {
+	LoadOnMainThread, //may call OpenGL
+	LoadOnWorkerThread, //must not call OpenGL
+};
+
+struct LoadFunction {
+	std::string name; //shown in the timing table; loaders named in 'after' lists must have unique names
+	std::vector< std::string > after; //names of loaders that must finish before this one starts
+	std::function< void() > load; //(optional) run on a worker thread
+	std::function< void() > upload; //(optional) run on the main thread, after 'load'
+};
+
 //Add a function to an internal list of loading functions:
 // (only call *before* "call_load_functions()")
 void add_load_function(LoadTag tag, std::function< void() > const &fn);
+void add_load_function(LoadTag tag, LoadFunction const &fn);
 
-//Call all loading functions:
+//Call all loading functions (except those tagged LoadTagStream, which are started in the background):
 // (loading functions may throw exceptions if they fail.)
 // (only call *once*)
 void call_load_functions();
 
+//Run main-thread work of streaming loaders for about 'budget_ms' milliseconds:
+// (call once per frame; rethrows exceptions from loaders; returns true while streaming loaders remain)
+bool update_load_functions(float budget_ms);
+
+//Block until at least one more loader is finished (used by Load< T >::wait()):
+void wait_for_load_function();
+
+//Stop background loading (waits for loads already running on worker threads; call before exiting):
+void stop_load_functions();
+
 
 //work-around for MSVC not accepting this as a lambda:
 template< typename T >
@@ -50,13 +110,50 @@ T const *new_T() { return new T; }
 template< typename T >
 struct Load {
 	//Constructing a Load< T > adds the passed function to the list of functions to call:
-	Load(LoadTag tag, const std::function< T const *() > &load_fn = new_T< T >) : value(nullptr) {
-		add_load_function(tag, [this,load_fn](){
-			this->value = load_fn();
-			if (!(this->value)) {
-				throw std::runtime_error("Loading failed.");
+	Load(LoadTag tag, const std::function< T const *() > &load_fn = new_T< T >) : Load(tag, "", {}, load_fn) { }
+
+	//Named loader with dependencies, run in one phase:
+	Load(LoadTag tag, std::string const &name, std::vector< std::string > const &after, const std::function< T const *() > &load_fn, LoadThread thread = LoadOnMainThread) : value(nullptr) {
+		LoadFunction fn;
+		fn.name = name;
+		fn.after = after;
+		auto result = std::make_shared< T const * >(nullptr);
+		auto call = [result,name,load_fn](){
+			*result = load_fn();
+			if (!(*result)) {
+				throw std::runtime_error("Loading " + (name.empty() ? std::string("") : "'" + name + "' ") + "failed.");
+			}
+		};
+		//(value is only ever set on the main thread, so ready() can be checked there without locking)
+		auto publish = [this,result](){
+			this->value = *result;
+		};
+		if (thread == LoadOnWorkerThread) {
+			fn.load = call;
+			fn.upload = publish;
+		} else {
+			fn.upload = [call,publish](){ call(); publish(); };
+		}
+		add_load_function(tag, fn);
+	}
+
+	//Named loader with dependencies, run in two phases: load_fn on a worker thread, then upload_fn on the main thread:
+	Load(LoadTag tag, std::string const &name, std::vector< std::string > const &after, const std::function< T *() > &load_fn, const std::function< void(T &) > &upload_fn) : value(nullptr) {
+		LoadFunction fn;
+		fn.name = name;
+		fn.after = after;
+		auto result = std::make_shared< T * >(nullptr);
+		fn.load = [result,name,load_fn](){
+			*result = load_fn();
+			if (!(*result)) {
+				throw std::runtime_error("Loading '" + name + "' failed.");
 			}
-		});
+		};
+		fn.upload = [this,result,upload_fn](){
+			upload_fn(**result);
+			this->value = *result;
+		};
+		add_load_function(tag, fn);
 	}
 
 	//Make a "Load< T >" behave like a "T const *":
@@ -65,6 +162,15 @@ struct Load {
 	T const &operator*() { return *value; }
 	T const *operator->() { return value; }
 
+	//For streaming (LoadTagStream) loaders -- check on the main thread:
+	bool ready() const { return value != nullptr; }
+	T const *value_or(T const *placeholder) const { return value ? value : placeholder; }
+	//finish loading now (runs other loaders' main-thread work as needed):
+	T const &wait() {
+		while (!value) wait_for_load_function();
+		return *value;
+	}
+
 	T const *value;
 };
 
@@ -77,6 +183,13 @@ struct Load< void > {
 	Load( LoadTag tag, const std::function< void() > &load_fn) {
 		add_load_function(tag, load_fn);
 	}
-};
-
 
+	//Named loader with dependencies:
+	Load(LoadTag tag, std::string const &name, std::vector< std::string > const &after, const std::function< void() > &load_fn, LoadThread thread = LoadOnMainThread) {
+		LoadFunction fn;
+		fn.name = name;
+		fn.after = after;
+		(thread == LoadOnWorkerThread ? fn.load : fn.upload) = load_fn;
+		add_load_function(tag, fn);
+	}
+};
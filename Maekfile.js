@@ -128,34 +128,66 @@ if (maek.OS === 'windows') {
 // cppFile: name of c++ file to compile
 // objFileBase (optional): base name object file to produce (if not supplied, set to options.objDir + '/' + cppFile without the extension)
 //returns objFile: objFileBase + a platform-dependant suffix ('.o' or '.obj')
+//audio decoding (uses opusfile, but not SDL or OpenGL; shared by the game and the audio benchmarks):
+const audio_names = [
+	maek.CPP('load_opus.cpp'),
+	maek.CPP('SoundStream.cpp'),
+	maek.CPP('audio_cache.cpp')
+];
+
+//the game's audio system (uses SDL for the audio device; shared by the game and bench/audio-script):
+const sound_names = [
+	maek.CPP('Sound.cpp'),
+	maek.CPP('load_wav.cpp'),
+	...audio_names
+];
+
 const client_names = [
 	maek.CPP('client.cpp'),
 	maek.CPP('PlayMode.cpp'),
 	maek.CPP('LitColorTextureProgram.cpp'),
 	//maek.CPP('ColorTextureProgram.cpp'),  //not used right now, but you might want it
-	maek.CPP('Sound.cpp'),
-	maek.CPP('load_wav.cpp'),
-	maek.CPP('load_opus.cpp')
+	...sound_names
 ];
 
 const server_names = [
 	maek.CPP('server.cpp')
 ];
 
-const common_names = [
-	maek.CPP('Game.cpp'),
-	maek.CPP('data_path.cpp'),
+//code that doesn't touch OpenGL or SDL; shared by the game and the headless benchmarks:
+const headless_names = [
+	maek.CPP('LightClusters.cpp'),
+	maek.CPP('MappedFile.cpp'),
+	maek.CPP('AssetArchive.cpp'),
+	maek.CPP('NameIndex.cpp'),
+	maek.CPP('SoundMixer.cpp'),
+	maek.CPP('SoundResampler.cpp'),
+	maek.CPP('SoundCodec.cpp'),
+	maek.CPP('load_save_png.cpp'),
+	maek.CPP('AtlasPacker.cpp'),
 	maek.CPP('PathFont.cpp'),
 	maek.CPP('PathFont-font.cpp'),
+	maek.CPP('data_path.cpp')
+];
+
+const common_names = [
+	...headless_names,
+	maek.CPP('Game.cpp'),
 	maek.CPP('DrawLines.cpp'),
+	maek.CPP('StreamBuffer.cpp'),
+	maek.CPP('HUD.cpp'),
+	maek.CPP('DebugOverlay.cpp'),
 	maek.CPP('ColorProgram.cpp'),
 	maek.CPP('Scene.cpp'),
+	maek.CPP('UniformBlocks.cpp'),
 	maek.CPP('Mesh.cpp'),
-	maek.CPP('load_save_png.cpp'),
+	maek.CPP('Screenshot.cpp'),
+	maek.CPP('TextureAtlas.cpp'),
 	maek.CPP('gl_compile_program.cpp'),
 	maek.CPP('Mode.cpp'),
 	maek.CPP('GL.cpp'),
 	maek.CPP('Load.cpp'),
+	maek.CPP('HotReload.cpp'),
 	maek.CPP('Connection.cpp'),
 	maek.CPP('hex_dump.cpp')
 ];
@@ -172,6 +204,82 @@ const show_scene_names = [
 	maek.CPP('ShowSceneMode.cpp')
 ];
 
+//offline asset tools (no window needed):
+const cook_meshes_names = [
+	maek.CPP('cook-meshes.cpp'),
+	maek.CPP('MeshCooker.cpp')
+];
+
+const cook_scene_names = [
+	maek.CPP('cook-scene.cpp')
+];
+
+const pack_assets_names = [
+	maek.CPP('pack-assets.cpp')
+];
+
+//headless benchmarks (run from the command line; no window needed):
+const bench_light_clusters_names = [
+	maek.CPP('bench-light-clusters.cpp')
+];
+
+const bench_asset_load_names = [
+	maek.CPP('bench-asset-load.cpp')
+];
+
+const bench_asset_startup_names = [
+	maek.CPP('bench-asset-startup.cpp')
+];
+
+const bench_name_map_names = [
+	maek.CPP('bench-name-map.cpp')
+];
+
+//(loads scenes and meshes without a window, but links with the rest of the game's code to do so)
+const bench_mix_names = [
+	maek.CPP('bench-mix.cpp')
+];
+
+const bench_voices_names = [
+	maek.CPP('bench-voices.cpp')
+];
+
+const bench_opus_stream_names = [
+	maek.CPP('bench-opus-stream.cpp')
+];
+
+const bench_audio_script_names = [
+	maek.CPP('bench-audio-script.cpp')
+];
+
+const bench_audio_decode_names = [
+	maek.CPP('bench-audio-decode.cpp')
+];
+
+const bench_resample_names = [
+	maek.CPP('bench-resample.cpp')
+];
+
+const bench_sample_storage_names = [
+	maek.CPP('bench-sample-storage.cpp')
+];
+
+const bench_png_names = [
+	maek.CPP('bench-png.cpp')
+];
+
+const bench_atlas_pack_names = [
+	maek.CPP('bench-atlas-pack.cpp')
+];
+
+const bench_text_names = [
+	maek.CPP('bench-text.cpp')
+];
+
+const bench_scene_load_names = [
+	maek.CPP('bench-scene-load.cpp')
+];
+
 //the '[exeFile =] LINK(objFiles, exeFileBase, [, options])' links an array of objects into an executable:
 // objFiles: array of objects to link
 // exeFileBase: name of executable file to produce
@@ -180,9 +288,27 @@ const client_exe = maek.LINK([...client_names, ...common_names], 'dist/client');
 const server_exe = maek.LINK([...server_names, ...common_names], 'dist/server');
 const show_meshes_exe = maek.LINK([...show_meshes_names, ...common_names], 'scenes/show-meshes');
 const show_scene_exe = maek.LINK([...show_scene_names, ...common_names], 'scenes/show-scene');
+const cook_meshes_exe = maek.LINK([...cook_meshes_names], 'scenes/cook-meshes');
+const cook_scene_exe = maek.LINK([...cook_scene_names, ...headless_names], 'scenes/cook-scene');
+const pack_assets_exe = maek.LINK([...pack_assets_names, ...headless_names], 'scenes/pack-assets');
+const bench_light_clusters_exe = maek.LINK([...bench_light_clusters_names, ...headless_names], 'bench/light-clusters');
+const bench_asset_load_exe = maek.LINK([...bench_asset_load_names, ...headless_names], 'bench/asset-load');
+const bench_asset_startup_exe = maek.LINK([...bench_asset_startup_names, ...headless_names], 'bench/asset-startup');
+const bench_name_map_exe = maek.LINK([...bench_name_map_names, ...headless_names], 'bench/name-map');
+const bench_mix_exe = maek.LINK([...bench_mix_names, ...headless_names], 'bench/mix');
+const bench_voices_exe = maek.LINK([...bench_voices_names, ...headless_names], 'bench/voices');
+const bench_opus_stream_exe = maek.LINK([...bench_opus_stream_names, ...audio_names, ...headless_names], 'bench/opus-stream');
+const bench_audio_script_exe = maek.LINK([...bench_audio_script_names, ...sound_names, ...headless_names], 'bench/audio-script');
+const bench_audio_decode_exe = maek.LINK([...bench_audio_decode_names, ...sound_names, ...headless_names], 'bench/audio-decode');
+const bench_resample_exe = maek.LINK([...bench_resample_names, ...headless_names], 'bench/resample');
+const bench_sample_storage_exe = maek.LINK([...bench_sample_storage_names, ...sound_names, ...headless_names], 'bench/sample-storage');
+const bench_png_exe = maek.LINK([...bench_png_names, ...headless_names], 'bench/png');
+const bench_atlas_pack_exe = maek.LINK([...bench_atlas_pack_names, ...headless_names], 'bench/atlas-pack');
+const bench_text_exe = maek.LINK([...bench_text_names, ...headless_names], 'bench/text');
+const bench_scene_load_exe = maek.LINK([...bench_scene_load_names, ...common_names], 'bench/scene-load');
 
 //set the default target to the game (and copy the readme files):
-maek.TARGETS = [client_exe, server_exe, show_meshes_exe, show_scene_exe, ...copies];
+maek.TARGETS = [client_exe, server_exe, show_meshes_exe, show_scene_exe, cook_meshes_exe, cook_scene_exe, pack_assets_exe, bench_light_clusters_exe, bench_asset_load_exe, bench_asset_startup_exe, bench_name_map_exe, bench_mix_exe, bench_voices_exe, bench_opus_stream_exe, bench_audio_script_exe, bench_audio_decode_exe, bench_resample_exe, bench_sample_storage_exe, bench_png_exe, bench_atlas_pack_exe, bench_text_exe, bench_scene_load_exe, ...copies];
 
 //Note that tasks that produce ':abstract targets' are never cached.
 // This is similar to how .PHONY targets behave in make.
@@ -0,0 +1,79 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(std::string const &filename) {
+	file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		throw std::runtime_error("Failed to open '" + filename + "' for mapping.");
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size)) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size = size_t(file_size.QuadPart);
+	if (size == 0) return; //can't map empty files; leave data as nullptr
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to create mapping of '" + filename + "'.");
+	}
+	data = reinterpret_cast< char const * >(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!data) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error("Failed to map '" + filename + "'.");
+	}
+}
+
+MappedFile::~MappedFile() {
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+}
+
+#else //POSIX
+
+MappedFile::MappedFile(std::string const &filename) {
+	fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		throw std::runtime_error("Failed to open '" + filename + "' for mapping.");
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size = size_t(info.st_size);
+	if (size == 0) return; //can't map empty files; leave data as nullptr
+
+	void *ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (ptr == MAP_FAILED) {
+		close(fd);
+		throw std::runtime_error("Failed to map '" + filename + "'.");
+	}
+	data = reinterpret_cast< char const * >(ptr);
+}
+
+MappedFile::~MappedFile() {
+	if (data) munmap(const_cast< char * >(data), size);
+	if (fd != -1) close(fd);
+}
+
+#endif
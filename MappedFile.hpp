@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+ * A MappedFile maps a whole file read-only into memory.
+ *
+ * Combined with the in-place version of read_chunk (see read_write_chunk.hpp),
+ *  this lets loaders use file contents directly instead of first copying
+ *  them through a stream into temporary vectors.
+ *
+ * Pages are only read from disk when touched, and are shared with the OS
+ *  file cache, so loading the same asset twice costs little extra memory.
+ *
+ */
+
+#include <string>
+#include <cstddef>
+
+struct MappedFile {
+	//map the file; throws on failure:
+	MappedFile(std::string const &filename);
+	~MappedFile();
+
+	MappedFile(MappedFile const &) = delete;
+	MappedFile &operator=(MappedFile const &) = delete;
+
+	//file contents (nullptr for empty files):
+	char const *data = nullptr;
+	size_t size = 0;
+
+	char const *begin() const { return data; }
+	char const *end() const { return data + size; }
+
+	//-- internals ---
+#ifdef _WIN32
+	void *file = nullptr; //HANDLE
+	void *mapping = nullptr; //HANDLE
+#else
+	int fd = -1;
+#endif
+};
@@ -1,20 +1,34 @@
 #include "Mesh.hpp"
 #include "read_write_chunk.hpp"
+#include "AssetArchive.hpp"
 
 #include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
 
+#include <chrono>
+#include <cmath>
 #include <stdexcept>
-#include <fstream>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <set>
 #include <cstddef>
+#include <cassert>
 
-MeshBuffer::MeshBuffer(std::string const &filename) {
-	glGenBuffers(1, &buffer);
+char const *octahedral_normal_glsl =
+	"vec3 decode_normal(vec2 e) {\n"
+	"	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+	"	float t = max(-n.z, 0.0);\n" //unfold lower hemisphere
+	"	n.x += (n.x >= 0.0 ? -t : t);\n"
+	"	n.y += (n.y >= 0.0 ? -t : t);\n"
+	"	return normalize(n);\n"
+	"}\n"
+;
 
-	std::ifstream file(filename, std::ios::binary);
+MeshBuffer::MeshBuffer(std::string const &filename, Upload when, AssetFile::Source source) {
+	//file contents are used in place, from the asset archive or a mapping of the file (see AssetArchive.hpp):
+	AssetFile file(filename, source);
+	char const *at = file.begin();
 
 	GLuint total = 0;
 
@@ -25,68 +39,186 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		glm::vec2 TexCoord;
 	};
 	static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
-	std::vector< Vertex > data;
+	ChunkSpan< Vertex > data;
 
-	//read + upload data chunk:
-	if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".pnct") {
-		read_chunk(file, "pnct", &data);
+	struct Box {
+		glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+		glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+	};
+	std::vector< Box > quantize_boxes; //box for each index entry
+	std::vector< uint32_t > vertex_box; //index entry each vertex belongs to (or -1U if none)
+	Box buffer_box; //box around all vertices (used when meshes share vertices)
+	bool shared_vertices = false;
 
-		//upload data:
-		glBindBuffer(GL_ARRAY_BUFFER, buffer);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//read data chunk (uploaded, quantized, once mesh bounds are known):
+	if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".pnct") {
+		read_chunk(&at, file.end(), "pnct", &data);
 
 		total = GLuint(data.size()); //store total for later checks on index
-
-		//store attrib locations:
-		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
-		Normal = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Normal));
-		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
-		TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
+		vertex_box.assign(data.size(), -1U);
+		for (auto const &vertex : data) {
+			buffer_box.min = glm::min(buffer_box.min, vertex.Position);
+			buffer_box.max = glm::max(buffer_box.max, vertex.Position);
+		}
 	} else {
 		throw std::runtime_error("Unknown file type '" + filename + "'");
 	}
 
-	std::vector< char > strings;
-	read_chunk(file, "str0", &strings);
+	ChunkSpan< char > strings;
+	read_chunk(&at, file.end(), "str0", &strings);
 
-	{ //read index chunk, add to meshes:
+	{ //read index chunk(s), add to meshes:
 		struct IndexEntry {
 			uint32_t name_begin, name_end;
 			uint32_t vertex_begin, vertex_end;
 		};
 		static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
 
-		std::vector< IndexEntry > index;
-		read_chunk(file, "idx0", &index);
+		ChunkSpan< IndexEntry > index;
+		read_chunk(&at, file.end(), "idx0", &index);
 
-		for (auto const &entry : index) {
-			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
-				throw std::runtime_error("index entry has out-of-range name begin/end");
+		//cooked files follow with per-mesh element ranges and the element data itself:
+		struct ElementEntry {
+			uint32_t element_begin, element_end; //byte range in element data
+			uint32_t element_size; //bytes per index (2 or 4), or 0 if the mesh isn't indexed
+		};
+		static_assert(sizeof(ElementEntry) == 12, "Element entry should be packed");
+
+		ChunkSpan< ElementEntry > elements;
+		ChunkSpan< char > element_data;
+		if (at != file.end()) {
+			read_chunk(&at, file.end(), "idx1", &elements);
+			read_chunk(&at, file.end(), "ele0", &element_data);
+			if (elements.size() != index.size()) {
+				throw std::runtime_error("element entry count doesn't match index entry count");
 			}
+
+			has_elements = true;
+			pending_elements.assign(element_data.begin(), element_data.end());
+		}
+
+		//positions are quantized relative to the bounding box of the mesh they belong to:
+		std::vector< Box > boxes(index.size());
+		for (uint32_t i = 0; i < index.size(); ++i) {
+			IndexEntry const &entry = index[i];
 			if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= total)) {
 				throw std::runtime_error("index entry has out-of-range vertex start/count");
 			}
-			std::string name(&strings[0] + entry.name_begin, &strings[0] + entry.name_end);
+			for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
+				boxes[i].min = glm::min(boxes[i].min, data[v].Position);
+				boxes[i].max = glm::max(boxes[i].max, data[v].Position);
+				//(if meshes share vertices, everything is quantized relative to the whole buffer's box instead)
+				if (vertex_box[v] != -1U) shared_vertices = true;
+				vertex_box[v] = i;
+			}
+		}
+		if (shared_vertices) boxes.assign(index.size(), buffer_box);
+		quantize_boxes = boxes;
+
+		std::string all_names;
+		for (uint32_t i = 0; i < index.size(); ++i) {
+			IndexEntry const &entry = index[i];
+			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
+				throw std::runtime_error("index entry has out-of-range name begin/end");
+			}
+			std::string name(strings.data() + entry.name_begin, strings.data() + entry.name_end);
 			Mesh mesh;
 			mesh.type = GL_TRIANGLES;
 			mesh.start = entry.vertex_begin;
 			mesh.count = entry.vertex_end - entry.vertex_begin;
+			if (!elements.empty() && elements[i].element_size != 0) {
+				ElementEntry const &element = elements[i];
+				if (element.element_size == 2) mesh.index_type = GL_UNSIGNED_SHORT;
+				else if (element.element_size == 4) mesh.index_type = GL_UNSIGNED_INT;
+				else throw std::runtime_error("element entry has unsupported element size");
+				if (!(element.element_begin <= element.element_end && element.element_end <= element_data.size())) {
+					throw std::runtime_error("element entry has out-of-range begin/end");
+				}
+				if (element.element_begin % element.element_size != 0 || element.element_end % element.element_size != 0) {
+					throw std::runtime_error("element entry is misaligned");
+				}
+				mesh.start = element.element_begin / element.element_size;
+				mesh.count = (element.element_end - element.element_begin) / element.element_size;
+				mesh.base_vertex = GLint(entry.vertex_begin);
+			}
 			for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
 				mesh.min = glm::min(mesh.min, data[v].Position);
 				mesh.max = glm::max(mesh.max, data[v].Position);
 			}
-			bool inserted = meshes.insert(std::make_pair(name, mesh)).second;
-			if (!inserted) {
+			if (entry.vertex_begin < entry.vertex_end) {
+				mesh.position_offset = boxes[i].min;
+				mesh.position_scale = boxes[i].max - boxes[i].min;
+			}
+			auto ret = meshes.insert(name, mesh);
+			if (!ret.second) {
 				std::cerr << "WARNING: mesh name '" + name + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
 			}
+			mesh_ids_in_file_order.emplace_back(ret.first);
+			all_names += name;
+			all_names += '\0';
 		}
+		names_hash = hash_bytes(all_names.data(), all_names.size());
 	}
 
-	if (file.peek() != EOF) {
+	if (at != file.end()) {
 		std::cerr << "WARNING: trailing data in mesh file '" << filename << "'" << std::endl;
 	}
 
+	{ //quantize vertex data (reading straight from the mapped file):
+		auto before = std::chrono::high_resolution_clock::now();
+
+		std::vector< PackedVertex > &packed = pending_vertices;
+		packed.resize(data.size());
+		for (uint32_t v = 0; v < data.size(); ++v) {
+			Vertex const &in = data[v];
+			PackedVertex &out = packed[v];
+
+			//positions: 16-bit fixed point within bounding box:
+			Box const &box = (vertex_box[v] != -1U ? quantize_boxes[vertex_box[v]] : buffer_box);
+			glm::vec3 extent = box.max - box.min;
+			for (uint32_t c = 0; c < 3; ++c) {
+				float t = (extent[c] > 0.0f ? (in.Position[c] - box.min[c]) / extent[c] : 0.0f);
+				out.Position[c] = uint16_t(std::round(glm::clamp(t, 0.0f, 1.0f) * 65535.0f));
+			}
+			out.Position[3] = 0;
+
+			//normals: octahedral encoding, two signed 16-bit values (see octahedral_normal_glsl):
+			glm::vec3 n = in.Normal;
+			float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+			glm::vec2 e = (l1 > 0.0f ? glm::vec2(n.x, n.y) / l1 : glm::vec2(0.0f));
+			if (l1 > 0.0f && n.z < 0.0f) {
+				//fold lower hemisphere over the diagonals:
+				e = glm::vec2(
+					(1.0f - std::abs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f),
+					(1.0f - std::abs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f)
+				);
+			}
+			out.Normal = glm::i16vec2(
+				int16_t(std::round(glm::clamp(e.x, -1.0f, 1.0f) * 32767.0f)),
+				int16_t(std::round(glm::clamp(e.y, -1.0f, 1.0f) * 32767.0f))
+			);
+
+			out.Color = in.Color;
+
+			//texture coordinates: half floats:
+			out.TexCoord = glm::u16vec2(glm::packHalf1x16(in.TexCoord.x), glm::packHalf1x16(in.TexCoord.y));
+		}
+
+		auto after_quantize = std::chrono::high_resolution_clock::now();
+
+		//store attrib locations:
+		Position = Attrib(3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), offsetof(PackedVertex, Position));
+		Normal = Attrib(2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), offsetof(PackedVertex, Normal));
+		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), offsetof(PackedVertex, Color));
+		TexCoord = Attrib(2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), offsetof(PackedVertex, TexCoord));
+
+		std::cout << "MeshBuffer '" << filename << "': " << data.size() << " vertices at "
+			<< sizeof(PackedVertex) << " bytes each (were " << sizeof(Vertex) << ");"
+			<< " quantizing took " << std::chrono::duration< double, std::milli >(after_quantize - before).count() << " ms." << std::endl;
+	}
+
+	if (when == UploadNow) upload();
+
 	/* //DEBUG:
 	std::cout << "File '" << filename << "' contained meshes";
 	for (auto const &m : meshes) {
@@ -98,12 +230,58 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 	*/
 }
 
-const Mesh &MeshBuffer::lookup(std::string const &name) const {
-	auto f = meshes.find(name);
-	if (f == meshes.end()) {
-		throw std::runtime_error("Looking up mesh '" + name + "' that doesn't exist.");
+void MeshBuffer::upload() {
+	assert(buffer == 0 && "MeshBuffer should only be uploaded once.");
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, pending_vertices.size() * sizeof(PackedVertex), pending_vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	//(always made -- even if empty -- so that a replace() that adds indices doesn't need new vertex array objects)
+	glGenBuffers(1, &index_buffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, pending_elements.size(), pending_elements.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	//(data lives on the GPU now)
+	pending_vertices = std::vector< PackedVertex >();
+	pending_elements = std::vector< char >();
+}
+
+void MeshBuffer::replace(MeshBuffer &&fresh) {
+	assert(buffer != 0 && "Can only replace the contents of an uploaded MeshBuffer.");
+	assert(fresh.buffer == 0 && "Replacement should be constructed with UploadLater.");
+
+	//vertex format doesn't depend on the file, so only data and meshes change:
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, fresh.pending_vertices.size() * sizeof(PackedVertex), fresh.pending_vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, fresh.pending_elements.size(), fresh.pending_elements.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	meshes = std::move(fresh.meshes);
+	mesh_ids_in_file_order = std::move(fresh.mesh_ids_in_file_order);
+	names_hash = fresh.names_hash;
+	fresh.pending_vertices = std::vector< PackedVertex >();
+	fresh.pending_elements = std::vector< char >();
+}
+
+const Mesh &MeshBuffer::lookup(NameKey const &name) const {
+	Mesh const *mesh = meshes.find(name);
+	if (!mesh) {
+		throw std::runtime_error("Looking up mesh '" + std::string(name.name) + "' that doesn't exist.");
+	}
+	return *mesh;
+}
+
+const Mesh &MeshBuffer::lookup_index(uint32_t index) const {
+	if (index >= mesh_ids_in_file_order.size()) {
+		throw std::runtime_error("Looking up mesh index " + std::to_string(index) + " but there are only " + std::to_string(mesh_ids_in_file_order.size()) + " meshes.");
 	}
-	return f->second;
+	return meshes.entries[mesh_ids_in_file_order[index]].value;
 }
 
 GLuint MeshBuffer::make_vao_for_program(GLuint program) const {
@@ -128,7 +306,10 @@ GLuint MeshBuffer::make_vao_for_program(GLuint program) const {
 	bind_attribute("Color", Color);
 	bind_attribute("TexCoord", TexCoord);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//element array binding is part of vertex array state, so leave it bound until the vao is unbound:
+	if (index_buffer != 0) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
 	glBindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 	//Check that all active attributes were bound:
 	GLint active = 0;
@@ -5,23 +5,44 @@
  *  the OpenGL pipeline together.
  * A "MeshBuffer" holds a collection of such meshes (loaded from a file) in
  *  a single OpenGL array buffer. Individual meshes can be looked up by name
- *  using the MeshBuffer::lookup() function.
+ *  using the MeshBuffer::lookup() function (see NameMap.hpp for name keys).
+ *
+ * Vertex data is quantized at load time (see Attrib comments below) to
+ *  20 bytes per vertex, down from the 36 bytes stored in the file.
+ *
+ * Files processed by the 'cook-meshes' tool (see MeshCooker.hpp) also contain
+ *  index data, which is loaded into a second (element array) buffer.
  *
  */
 
+#include "AssetArchive.hpp"
 #include "GL.hpp"
+#include "NameMap.hpp"
 #include <glm/glm.hpp>
-#include <map>
 #include <limits>
 #include <string>
+#include <vector>
+
 
+//GLSL function 'vec3 decode_normal(vec2 e)' for vertex shaders that read MeshBuffer normals:
+extern char const *octahedral_normal_glsl;
 
 struct Mesh {
 	//Meshes are vertex ranges (and primitive types) in their MeshBuffer:
 
 	GLenum type = GL_TRIANGLES; //type of primitives in mesh
-	GLuint start = 0; //index of first vertex
-	GLuint count = 0; //count of vertices
+	GLuint start = 0; //index of first vertex (or, if indexed, of first index)
+	GLuint count = 0; //count of vertices (or, if indexed, of indices)
+
+	//Indexed meshes (from files written by cook-meshes) are drawn with glDrawElementsBaseVertex:
+	GLenum index_type = 0; //GL_UNSIGNED_SHORT or GL_UNSIGNED_INT for indexed meshes; 0 otherwise
+	GLint base_vertex = 0; //added to every index
+
+	//Vertex positions are stored as 16-bit fixed point values in [0,1] (see MeshBuffer);
+	// the position in mesh space is position_offset + position_scale * Position.
+	// (Scene::draw folds this into the object matrices; see Scene::Drawable::Pipeline)
+	glm::vec3 position_scale = glm::vec3(1.0f);
+	glm::vec3 position_offset = glm::vec3(0.0f);
 
 	//Bounding box.
 	//useful for debug visualization and (perhaps, eventually) collision detection:
@@ -32,11 +53,27 @@ struct Mesh {
 struct MeshBuffer {
 	//construct from a file:
 	// note: will throw if file fails to read.
-	MeshBuffer(std::string const &filename);
+	//with UploadLater, the constructor doesn't call OpenGL (so it can run on a loading thread; see Load.hpp)
+	// and the data waits in 'pending_*' until upload() is called (on the main thread).
+	//'source' says where to read the file from (hot reloads use AssetFile::LooseOnly; see AssetArchive.hpp).
+	enum Upload { UploadNow, UploadLater };
+	MeshBuffer(std::string const &filename, Upload when = UploadNow, AssetFile::Source source = AssetFile::ArchiveOrLoose);
+
+	//create and fill the OpenGL buffers (needed once, if constructed with UploadLater):
+	void upload();
 
-	//look up a particular mesh by name:
+	//replace contents with those of 'fresh' (constructed with UploadLater), refilling the existing
+	// OpenGL buffers so vertex array objects from make_vao_for_program() keep working:
+	// (used for hot reloading; see HotReload.hpp)
+	void replace(MeshBuffer &&fresh);
+
+	//look up a particular mesh by name (a std::string, a literal, or a NameKey hashed ahead of time):
 	// note: will throw if mesh not found.
-	const Mesh &lookup(std::string const &name) const;
+	const Mesh &lookup(NameKey const &name) const;
+
+	//look up a mesh by its position in the file (as stored in scenes cooked by 'cook-scene'):
+	// note: will throw if index is out of range.
+	const Mesh &lookup_index(uint32_t index) const;
 	
 	//build a vertex array object that links this vbo to attributes to a program:
 	// note: will throw if program defines attributes not contained in this buffer
@@ -44,13 +81,39 @@ struct MeshBuffer {
 
 	//This is the OpenGL vertex buffer object containing the mesh data:
 	GLuint buffer = 0;
+	//..and the element buffer holding index data (if the file was cooked):
+	GLuint index_buffer = 0;
 
 	//-- internals ---
 
-	//used by the lookup() function:
-	std::map< std::string, Mesh > meshes;
+	//used by the lookup() function (meshes are in file order, except that repeated names are skipped):
+	NameMap< Mesh > meshes;
+
+	//used by the lookup_index() function (ids in 'meshes' of the meshes in file order):
+	std::vector< uint32_t > mesh_ids_in_file_order;
+	//hash_bytes() (see AssetArchive.hpp) of the mesh names in file order, each followed by a '\0':
+	// (cooked scenes store this to check that their mesh indices still match)
+	uint64_t names_hash = 0;
+
+	//The GPU gets a compact version of each vertex (see Attrib comments below):
+	struct PackedVertex {
+		glm::u16vec4 Position; //unsigned normalized within bounding box (w unused)
+		glm::i16vec2 Normal; //signed normalized octahedral encoding
+		glm::u8vec4 Color;
+		glm::u16vec2 TexCoord; //half floats
+	};
+	static_assert(sizeof(PackedVertex) == 4*2+2*2+4*1+2*2, "PackedVertex is packed.");
+
+	//data read from the file that upload() hasn't sent to the GPU yet:
+	std::vector< PackedVertex > pending_vertices;
+	std::vector< char > pending_elements;
+	bool has_elements = false;
 
 	//These 'Attrib' structures describe the location of various attributes within the buffer (in exactly format wanted by glVertexAttribPointer). They are set when the file is loaded and are used by the "make_vao_for_program" call:
+	// Position: 3 x GL_UNSIGNED_SHORT, normalized (dequantize with Mesh::position_scale/offset)
+	// Normal: 2 x GL_SHORT, normalized, octahedral-encoded (decode with octahedral_normal_glsl)
+	// Color: 4 x GL_UNSIGNED_BYTE, normalized
+	// TexCoord: 2 x GL_HALF_FLOAT
 	struct Attrib {
 		GLint size = 0;
 		GLenum type = 0;
@@ -0,0 +1,296 @@
+#include "MeshCooker.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace MeshCooker {
+
+void weld_vertices(Vertex const *soup, uint32_t count, std::vector< Vertex > *unique_, std::vector< uint32_t > *indices_) {
+	assert(unique_);
+	assert(indices_);
+	assert(count % 3 == 0);
+	auto &unique = *unique_;
+	auto &indices = *indices_;
+
+	unique.clear();
+	indices.clear();
+	indices.reserve(count);
+
+	//hash and compare vertices by their bytes (Vertex has no padding):
+	struct VertexHash {
+		size_t operator()(Vertex const &v) const {
+			//FNV-1a:
+			uint64_t h = 0xcbf29ce484222325ULL;
+			unsigned char const *bytes = reinterpret_cast< unsigned char const * >(&v);
+			for (size_t i = 0; i < sizeof(Vertex); ++i) {
+				h = (h ^ bytes[i]) * 0x100000001b3ULL;
+			}
+			return size_t(h);
+		}
+	};
+	struct VertexEqual {
+		bool operator()(Vertex const &a, Vertex const &b) const {
+			return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+		}
+	};
+	std::unordered_map< Vertex, uint32_t, VertexHash, VertexEqual > lookup;
+	lookup.reserve(count);
+
+	for (uint32_t t = 0; t + 3 <= count; t += 3) {
+		uint32_t tri[3];
+		for (uint32_t k = 0; k < 3; ++k) {
+			auto ret = lookup.emplace(soup[t+k], uint32_t(unique.size()));
+			if (ret.second) unique.emplace_back(soup[t+k]);
+			tri[k] = ret.first->second;
+		}
+		if (tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0]) continue; //zero-area
+		indices.insert(indices.end(), tri, tri + 3);
+	}
+}
+
+void optimize_vertex_cache(std::vector< uint32_t > *indices_, uint32_t vertex_count) {
+	assert(indices_);
+	auto &indices = *indices_;
+	assert(indices.size() % 3 == 0);
+
+	uint32_t const tri_count = uint32_t(indices.size() / 3);
+	if (tri_count == 0) return;
+
+	//scoring function (and constants) from Forsyth's article:
+	constexpr uint32_t CacheSize = 32;
+	auto vertex_score = [](int32_t cache_position, uint32_t remaining) -> float {
+		if (remaining == 0) return -1.0f; //no triangles left to use this vertex
+		float score = 0.0f;
+		if (cache_position >= 0) {
+			if (cache_position < 3) {
+				//vertices of the triangle just drawn get a fixed score, so no strip-like direction is favored:
+				score = 0.75f;
+			} else {
+				score = std::pow(1.0f - float(cache_position - 3) / float(CacheSize - 3), 1.5f);
+			}
+		}
+		//boost vertices with few triangles left, to avoid leaving lonely triangles behind:
+		score += 2.0f * std::pow(float(remaining), -0.5f);
+		return score;
+	};
+
+	//triangles using each vertex, stored as [adjacency_begin[v], adjacency_begin[v] + remaining[v]):
+	std::vector< uint32_t > remaining(vertex_count, 0);
+	for (uint32_t i : indices) {
+		assert(i < vertex_count);
+		remaining[i] += 1;
+	}
+	std::vector< uint32_t > adjacency_begin(vertex_count + 1, 0);
+	for (uint32_t v = 0; v < vertex_count; ++v) {
+		adjacency_begin[v+1] = adjacency_begin[v] + remaining[v];
+	}
+	std::vector< uint32_t > adjacency(indices.size());
+	{
+		std::vector< uint32_t > fill(adjacency_begin.begin(), adjacency_begin.end() - 1);
+		for (uint32_t i = 0; i < indices.size(); ++i) {
+			adjacency[fill[indices[i]]++] = i / 3;
+		}
+	}
+
+	std::vector< int32_t > cache_position(vertex_count, -1);
+	std::vector< float > score(vertex_count);
+	for (uint32_t v = 0; v < vertex_count; ++v) {
+		score[v] = vertex_score(-1, remaining[v]);
+	}
+
+	std::vector< float > tri_score(tri_count);
+	std::vector< bool > emitted(tri_count, false);
+	uint32_t best = 0;
+	for (uint32_t t = 0; t < tri_count; ++t) {
+		tri_score[t] = score[indices[3*t+0]] + score[indices[3*t+1]] + score[indices[3*t+2]];
+		if (tri_score[t] > tri_score[best]) best = t;
+	}
+
+	std::vector< uint32_t > cache, next_cache;
+	cache.reserve(CacheSize + 3);
+	next_cache.reserve(CacheSize + 3);
+
+	std::vector< uint32_t > out;
+	out.reserve(indices.size());
+
+	uint32_t scan = 0; //where to look for an unused triangle when the cache has none
+	while (true) {
+		//emit 'best':
+		emitted[best] = true;
+		uint32_t const *tri = &indices[3*best];
+		for (uint32_t k = 0; k < 3; ++k) {
+			uint32_t v = tri[k];
+			out.emplace_back(v);
+			//remove from v's list of triangles:
+			uint32_t *list = &adjacency[adjacency_begin[v]];
+			for (uint32_t j = 0; j < remaining[v]; ++j) {
+				if (list[j] == best) {
+					list[j] = list[remaining[v]-1];
+					break;
+				}
+			}
+			remaining[v] -= 1;
+		}
+
+		//move triangle's vertices to the front of the (LRU) cache:
+		next_cache.assign(tri, tri + 3);
+		for (uint32_t v : cache) {
+			if (v != tri[0] && v != tri[1] && v != tri[2]) next_cache.emplace_back(v);
+		}
+		for (uint32_t i = 0; i < next_cache.size(); ++i) {
+			uint32_t v = next_cache[i];
+			cache_position[v] = (i < CacheSize ? int32_t(i) : -1);
+			score[v] = vertex_score(cache_position[v], remaining[v]);
+		}
+
+		//re-score triangles touching changed vertices and pick the best one still in the cache:
+		float best_score = -1.0f;
+		uint32_t next = -1U;
+		for (uint32_t v : next_cache) {
+			uint32_t const *list = &adjacency[adjacency_begin[v]];
+			for (uint32_t j = 0; j < remaining[v]; ++j) {
+				uint32_t t = list[j];
+				tri_score[t] = score[indices[3*t+0]] + score[indices[3*t+1]] + score[indices[3*t+2]];
+				if (cache_position[v] >= 0 && tri_score[t] > best_score) {
+					best_score = tri_score[t];
+					next = t;
+				}
+			}
+		}
+
+		if (next_cache.size() > CacheSize) next_cache.resize(CacheSize);
+		std::swap(cache, next_cache);
+
+		//nothing in the cache? start again from any unused triangle:
+		if (next == -1U) {
+			while (scan < tri_count && emitted[scan]) ++scan;
+			if (scan == tri_count) break;
+			next = scan;
+		}
+		best = next;
+	}
+
+	assert(out.size() == indices.size());
+	indices = std::move(out);
+}
+
+void optimize_overdraw(std::vector< uint32_t > *indices_, std::vector< Vertex > const &vertices) {
+	assert(indices_);
+	auto &indices = *indices_;
+	assert(indices.size() % 3 == 0);
+
+	uint32_t const tri_count = uint32_t(indices.size() / 3);
+	if (tri_count == 0) return;
+
+	//split into clusters wherever a triangle misses the (FIFO) cache on all three vertices,
+	// since the vertex cache gets no reuse across such boundaries anyway:
+	constexpr uint32_t CacheSize = 16;
+	std::vector< uint32_t > fifo(CacheSize, -1U);
+	uint32_t head = 0;
+	std::vector< uint32_t > cluster_begin; //first triangle of each cluster
+	for (uint32_t t = 0; t < tri_count; ++t) {
+		uint32_t misses = 0;
+		for (uint32_t k = 0; k < 3; ++k) {
+			uint32_t v = indices[3*t+k];
+			if (std::find(fifo.begin(), fifo.end(), v) == fifo.end()) {
+				misses += 1;
+				fifo[head] = v;
+				head = (head + 1) % CacheSize;
+			}
+		}
+		if (t == 0 || misses == 3) cluster_begin.emplace_back(t);
+	}
+	cluster_begin.emplace_back(tri_count);
+	uint32_t const cluster_count = uint32_t(cluster_begin.size() - 1);
+	if (cluster_count < 2) return;
+
+	//area-weighted centroid and normal of each cluster and of the whole mesh:
+	struct Cluster {
+		glm::vec3 centroid = glm::vec3(0.0f);
+		glm::vec3 normal = glm::vec3(0.0f);
+		float area = 0.0f;
+		float sort_key = 0.0f;
+		uint32_t begin = 0, end = 0;
+	};
+	std::vector< Cluster > clusters(cluster_count);
+	glm::vec3 mesh_centroid = glm::vec3(0.0f);
+	float mesh_area = 0.0f;
+	for (uint32_t c = 0; c < cluster_count; ++c) {
+		Cluster &cluster = clusters[c];
+		cluster.begin = cluster_begin[c];
+		cluster.end = cluster_begin[c+1];
+		for (uint32_t t = cluster.begin; t < cluster.end; ++t) {
+			glm::vec3 const &a = vertices[indices[3*t+0]].Position;
+			glm::vec3 const &b = vertices[indices[3*t+1]].Position;
+			glm::vec3 const &d = vertices[indices[3*t+2]].Position;
+			glm::vec3 n = glm::cross(b - a, d - a); //length is twice the area
+			float area = 0.5f * glm::length(n);
+			cluster.centroid += (area / 3.0f) * (a + b + d);
+			cluster.normal += n;
+			cluster.area += area;
+		}
+		mesh_centroid += cluster.centroid;
+		mesh_area += cluster.area;
+		if (cluster.area > 0.0f) cluster.centroid /= cluster.area;
+	}
+	if (mesh_area > 0.0f) mesh_centroid /= mesh_area;
+
+	//clusters that face away from the center are likely in front of the ones that face in:
+	for (auto &cluster : clusters) {
+		float len = glm::length(cluster.normal);
+		if (len > 0.0f) cluster.sort_key = glm::dot(cluster.centroid - mesh_centroid, cluster.normal / len);
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](Cluster const &a, Cluster const &b) {
+		return a.sort_key > b.sort_key;
+	});
+
+	std::vector< uint32_t > out;
+	out.reserve(indices.size());
+	for (auto const &cluster : clusters) {
+		out.insert(out.end(), indices.begin() + 3 * cluster.begin, indices.begin() + 3 * cluster.end);
+	}
+	indices = std::move(out);
+}
+
+void optimize_vertex_fetch(std::vector< uint32_t > *indices_, std::vector< Vertex > *vertices_) {
+	assert(indices_);
+	assert(vertices_);
+	auto &indices = *indices_;
+	auto &vertices = *vertices_;
+
+	std::vector< uint32_t > remap(vertices.size(), -1U);
+	std::vector< Vertex > out;
+	out.reserve(vertices.size());
+	for (uint32_t &i : indices) {
+		assert(i < vertices.size());
+		if (remap[i] == -1U) {
+			remap[i] = uint32_t(out.size());
+			out.emplace_back(vertices[i]);
+		}
+		i = remap[i];
+	}
+	//(vertices not used by any triangle are dropped)
+	vertices = std::move(out);
+}
+
+float compute_acmr(std::vector< uint32_t > const &indices, uint32_t cache_size) {
+	assert(cache_size > 0);
+	if (indices.size() < 3) return 0.0f;
+
+	std::vector< uint32_t > fifo(cache_size, -1U);
+	uint32_t head = 0;
+	uint32_t misses = 0;
+	for (uint32_t v : indices) {
+		if (std::find(fifo.begin(), fifo.end(), v) == fifo.end()) {
+			misses += 1;
+			fifo[head] = v;
+			head = (head + 1) % cache_size;
+		}
+	}
+	return float(misses) / float(indices.size() / 3);
+}
+
+} //namespace MeshCooker
@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+ * MeshCooker turns the triangle soup written by export-meshes.py into
+ *  indexed meshes that are friendlier to the GPU:
+ *  - identical vertices are welded together,
+ *  - triangles are reordered for the post-transform vertex cache
+ *    (using Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"),
+ *  - clusters of triangles are reordered so outward-facing parts draw first
+ *    (reducing overdraw),
+ *  - vertices are renumbered in the order they are first used.
+ *
+ * This code uses no OpenGL; it is used by the offline 'cook-meshes' tool,
+ *  which writes the 'idx1' (per-mesh element ranges) and 'ele0' (16 or 32-bit
+ *  indices) chunks that MeshBuffer draws with glDrawElementsBaseVertex.
+ *
+ */
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+namespace MeshCooker {
+
+//Vertex layout of the 'pnct' chunk:
+struct Vertex {
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	glm::u8vec4 Color;
+	glm::vec2 TexCoord;
+};
+static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
+
+//Merge bit-identical vertices of a triangle list:
+// 'unique' gets the distinct vertices (in order of first use) and 'indices' three indices per triangle.
+// (triangles that use the same welded vertex twice have no area and are dropped)
+void weld_vertices(Vertex const *soup, uint32_t count, std::vector< Vertex > *unique, std::vector< uint32_t > *indices);
+
+//Reorder triangles so that recently-used vertices are reused while still in the vertex cache:
+void optimize_vertex_cache(std::vector< uint32_t > *indices, uint32_t vertex_count);
+
+//Reorder runs of triangles (split where the vertex cache would start fresh anyway)
+// so that runs facing away from the mesh center are drawn first:
+void optimize_overdraw(std::vector< uint32_t > *indices, std::vector< Vertex > const &vertices);
+
+//Renumber vertices in the order the index list first uses them (improves vertex fetch locality):
+void optimize_vertex_fetch(std::vector< uint32_t > *indices, std::vector< Vertex > *vertices);
+
+//Average cache miss ratio (vertex shader invocations per triangle) of an index list,
+// simulated with a FIFO cache of 'cache_size' entries. 3.0 is the worst case; ~0.5-0.7 is great:
+float compute_acmr(std::vector< uint32_t > const &indices, uint32_t cache_size = 16);
+
+} //namespace MeshCooker
@@ -0,0 +1,164 @@
+#include "NameIndex.hpp"
+
+#include "read_write_chunk.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <ostream>
+#include <stdexcept>
+
+//bucket and slot for a name's hash (slot mixing from splitmix64):
+static uint32_t hash_bucket(uint64_t h, size_t bucket_count) {
+	return uint32_t((h >> 32) % bucket_count);
+}
+
+static uint32_t hash_slot(uint64_t h, uint32_t displacement, size_t slot_count) {
+	uint64_t x = h + uint64_t(displacement) * 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	x = x ^ (x >> 31);
+	return uint32_t(x % slot_count);
+}
+
+NameIndex::NameIndex(std::vector< std::string > const &item_names) {
+	//items, sorted by name (stable, so items with the same name stay in order):
+	items.resize(item_names.size());
+	std::iota(items.begin(), items.end(), 0);
+	std::stable_sort(items.begin(), items.end(), [&](uint32_t a, uint32_t b) {
+		return item_names[a] < item_names[b];
+	});
+
+	//one Name (and one copy of its string) per run of equal names:
+	std::vector< uint64_t > hashes;
+	for (uint32_t i = 0; i < items.size(); ) {
+		std::string const &name = item_names[items[i]];
+		Name entry;
+		entry.name_begin = uint32_t(strings.size());
+		strings.insert(strings.end(), name.begin(), name.end());
+		entry.name_end = uint32_t(strings.size());
+		entry.items_begin = i;
+		while (i < items.size() && item_names[items[i]] == name) ++i;
+		entry.items_end = i;
+		names.emplace_back(entry);
+		hashes.emplace_back(hash_name(name));
+	}
+	while (strings.size() % 4 != 0) strings.emplace_back('\0');
+
+	if (names.empty()) return;
+
+	//hash and displace: place big buckets first, trying displacements until all of a bucket's names land in free slots:
+	slots.assign(names.size(), -1U);
+	displacements.assign(names.size() / 2 + 1, 0);
+
+	std::vector< std::vector< uint32_t > > buckets(displacements.size());
+	for (uint32_t n = 0; n < names.size(); ++n) {
+		buckets[hash_bucket(hashes[n], buckets.size())].emplace_back(n);
+	}
+	std::vector< uint32_t > order(buckets.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return buckets[a].size() > buckets[b].size();
+	});
+
+	std::vector< uint32_t > placed;
+	for (uint32_t b : order) {
+		if (buckets[b].empty()) break;
+		uint32_t d = 0;
+		while (true) {
+			placed.clear();
+			for (uint32_t n : buckets[b]) {
+				uint32_t s = hash_slot(hashes[n], d, slots.size());
+				if (slots[s] != -1U || std::find(placed.begin(), placed.end(), s) != placed.end()) break;
+				placed.emplace_back(s);
+			}
+			if (placed.size() == buckets[b].size()) break;
+			if (++d == 0x1000000) throw std::runtime_error("Failed to find a perfect hash for " + std::to_string(names.size()) + " names.");
+		}
+		displacements[b] = d;
+		for (uint32_t i = 0; i < placed.size(); ++i) {
+			slots[placed[i]] = buckets[b][i];
+		}
+	}
+}
+
+NameIndex::Items NameIndex::find(NameKey const &key) const {
+	Items ret;
+	if (names.empty()) return ret;
+
+	std::string_view const &name = key.name;
+	uint64_t h = key.hash;
+	Name const &entry = names[slots[hash_slot(h, displacements[hash_bucket(h, displacements.size())], slots.size())]];
+
+	//(every slot holds some name, so the name still needs checking)
+	if (entry.name_end - entry.name_begin != name.size()) return ret;
+	if (!name.empty() && std::memcmp(strings.data() + entry.name_begin, name.data(), name.size()) != 0) return ret;
+
+	ret.first = items.data() + entry.items_begin;
+	ret.last = items.data() + entry.items_end;
+	return ret;
+}
+
+NameIndex::Items NameIndex::find_prefix(std::string const &prefix) const {
+	//compare a name's first prefix.size() characters with the prefix:
+	auto compare = [&](Name const &entry) {
+		size_t length = std::min< size_t >(entry.name_end - entry.name_begin, prefix.size());
+		int c = std::memcmp(strings.data() + entry.name_begin, prefix.data(), length);
+		if (c == 0 && length < prefix.size()) c = -1; //(shorter than the prefix, so sorts before it)
+		return c;
+	};
+	auto first = std::partition_point(names.begin(), names.end(), [&](Name const &entry) { return compare(entry) < 0; });
+	auto last = std::partition_point(first, names.end(), [&](Name const &entry) { return compare(entry) == 0; });
+
+	Items ret;
+	if (first == last) return ret;
+	ret.first = items.data() + first->items_begin;
+	ret.last = items.data() + (last - 1)->items_end;
+	return ret;
+}
+
+void NameIndex::read(char const **at, char const *end) {
+	ChunkSpan< char > read_strings;
+	ChunkSpan< Name > read_names;
+	ChunkSpan< uint32_t > read_items, read_displacements, read_slots;
+	read_chunk(at, end, "nxs0", &read_strings);
+	read_chunk(at, end, "nxn0", &read_names);
+	read_chunk(at, end, "nxi0", &read_items);
+	read_chunk(at, end, "nxd0", &read_displacements);
+	read_chunk(at, end, "nxh0", &read_slots);
+
+	//check everything that find() and find_prefix() will index with:
+	uint32_t next_item = 0;
+	for (auto const &entry : read_names) {
+		if (!(entry.name_begin <= entry.name_end && entry.name_end <= read_strings.size())) {
+			throw std::runtime_error("name index has out-of-range name begin/end");
+		}
+		if (!(entry.items_begin == next_item && entry.items_begin < entry.items_end && entry.items_end <= read_items.size())) {
+			throw std::runtime_error("name index has invalid item ranges");
+		}
+		next_item = entry.items_end;
+	}
+	if (next_item != read_items.size()) {
+		throw std::runtime_error("name index has items that no name refers to");
+	}
+	if (read_slots.size() != read_names.size() || (!read_names.empty() && read_displacements.empty())) {
+		throw std::runtime_error("name index has the wrong number of slots or displacements");
+	}
+	for (uint32_t s : read_slots) {
+		if (s >= read_names.size()) throw std::runtime_error("name index has out-of-range slot");
+	}
+
+	strings.assign(read_strings.begin(), read_strings.end());
+	names.assign(read_names.begin(), read_names.end());
+	items.assign(read_items.begin(), read_items.end());
+	displacements.assign(read_displacements.begin(), read_displacements.end());
+	slots.assign(read_slots.begin(), read_slots.end());
+}
+
+void NameIndex::write(std::ostream *to) const {
+	write_chunk("nxs0", strings, to);
+	write_chunk("nxn0", names, to);
+	write_chunk("nxi0", items, to);
+	write_chunk("nxd0", displacements, to);
+	write_chunk("nxh0", slots, to);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+/*
+ * A NameIndex maps names to the items (e.g., scene transforms) that have them:
+ *  - each distinct name is stored once (an interned string table, in sorted order),
+ *  - exact lookups go through a minimal perfect hash ("hash and displace"), so
+ *    find() hashes the name once and does a single string compare,
+ *  - prefix queries (e.g., "vine_purp" finds "vine_purp.001", ...) binary search
+ *    the sorted names and return the matching items as one contiguous range.
+ *
+ * Building an index is O(n log n) (it sorts the names); the 'cook-scene' tool
+ *  stores prebuilt indices in scene files (see Scene::load) so loading just copies them.
+ *
+ * This code uses no OpenGL.
+ *
+ */
+
+#include "NameMap.hpp"
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+struct NameIndex {
+	//empty index:
+	NameIndex() = default;
+
+	//index items 0 .. names.size()-1, where item i is named names[i] (names may repeat):
+	// note: will throw if no perfect hash could be found (which shouldn't happen in practice)
+	NameIndex(std::vector< std::string > const &names);
+
+	//a range of item indices:
+	struct Items {
+		uint32_t const *first = nullptr;
+		uint32_t const *last = nullptr;
+		uint32_t const *begin() const { return first; }
+		uint32_t const *end() const { return last; }
+		size_t size() const { return last - first; }
+		bool empty() const { return first == last; }
+	};
+
+	//items named exactly 'name' (in item order):
+	// (takes a NameKey -- see NameMap.hpp -- so literal names can be hashed at compile time)
+	Items find(NameKey const &name) const;
+
+	//items whose names start with 'prefix' (ordered by name, then by item):
+	Items find_prefix(std::string const &prefix) const;
+
+	//number of items indexed:
+	size_t item_count() const { return items.size(); }
+
+	//read from / write to a sequence of chunks ("nxs0" "nxn0" "nxi0" "nxd0" "nxh0"):
+	// note: read() will throw on malformed data
+	void read(char const **at, char const *end);
+	void write(std::ostream *to) const;
+
+	//-- internals ---
+
+	struct Name {
+		uint32_t name_begin, name_end; //range in 'strings'
+		uint32_t items_begin, items_end; //range in 'items'
+	};
+	static_assert(sizeof(Name) == 16, "Name is packed.");
+
+	std::vector< char > strings; //every distinct name once (padded to a multiple of four bytes)
+	std::vector< Name > names; //sorted by name
+	std::vector< uint32_t > items; //item indices, grouped by name (in 'names' order)
+
+	//perfect hash: a name with hash h is names[slots[slot(h, displacements[bucket(h)])]]:
+	std::vector< uint32_t > displacements;
+	std::vector< uint32_t > slots;
+};
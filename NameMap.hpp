@@ -0,0 +1,163 @@
+#pragma once
+
+/*
+ * NameMap< Value > is an open-addressing (linear probing) hash table from names to values:
+ *  - names are interned: each is copied once into the map's string table and gets a
+ *    small integer id (its position in insertion order) that code can keep instead;
+ *  - lookups take a NameKey (a name plus its hash), which can be made from a std::string,
+ *    a string_view into some other buffer, or a literal -- so lookups never allocate,
+ *    and names used over and over can be hashed once (or at compile time, see below);
+ *  - entries are stored contiguously in insertion order, so iterating is a linear scan.
+ *
+ * Literal names can be hashed at compile time:
+ *   static constexpr NameKey Plane = "Plane"_name;
+ *   Mesh const &plane = meshes.lookup(Plane);
+ *
+ * Used for MeshBuffer mesh names and PathFont's layout cache; NameIndex (scene transform names)
+ *  uses the same keys. This code uses no OpenGL.
+ *
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//64-bit FNV-1a hash of a name, usable at compile time (hash_bytes() in AssetArchive.hpp forwards here):
+constexpr uint64_t hash_name(std::string_view name) {
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (char c : name) {
+		h = (h ^ uint8_t(c)) * 0x100000001b3ULL;
+	}
+	return h;
+}
+
+//a name and its hash:
+// (holds a view of the name, so it shouldn't outlive the string it was made from)
+struct NameKey {
+	std::string_view name;
+	uint64_t hash = 0;
+
+	constexpr NameKey(std::string_view name_) : name(name_), hash(hash_name(name_)) { }
+	constexpr NameKey(char const *name_) : NameKey(std::string_view(name_)) { }
+	NameKey(std::string const &name_) : NameKey(std::string_view(name_)) { }
+};
+
+//"name"_name makes a NameKey (hashed at compile time when used to initialize a constexpr variable):
+constexpr NameKey operator""_name(char const *name, size_t length) {
+	return NameKey(std::string_view(name, length));
+}
+
+template< typename Value >
+struct NameMap {
+	struct Entry {
+		uint32_t name_begin, name_end; //range in 'strings'
+		uint64_t hash;
+		Value value;
+	};
+
+	//add 'value' under 'key', unless the name is already in the map:
+	// returns the id of the name's entry and whether 'value' was added
+	std::pair< uint32_t, bool > insert(NameKey const &key, Value const &value);
+
+	//id of the entry for 'key' (or -1U if the name isn't in the map):
+	uint32_t find_id(NameKey const &key) const;
+
+	//value stored for 'key' (or nullptr if the name isn't in the map):
+	Value const *find(NameKey const &key) const {
+		uint32_t id = find_id(key);
+		return (id == -1U ? nullptr : &entries[id].value);
+	}
+	Value *find(NameKey const &key) {
+		uint32_t id = find_id(key);
+		return (id == -1U ? nullptr : &entries[id].value);
+	}
+
+	//names of entries (the views are invalidated by insert()):
+	std::string_view name(uint32_t id) const {
+		assert(id < entries.size());
+		return std::string_view(strings.data() + entries[id].name_begin, entries[id].name_end - entries[id].name_begin);
+	}
+	std::string_view name(Entry const &entry) const {
+		return std::string_view(strings.data() + entry.name_begin, entry.name_end - entry.name_begin);
+	}
+
+	size_t size() const { return entries.size(); }
+	bool empty() const { return entries.empty(); }
+	typename std::vector< Entry >::const_iterator begin() const { return entries.begin(); }
+	typename std::vector< Entry >::const_iterator end() const { return entries.end(); }
+
+	void clear() {
+		strings.clear();
+		entries.clear();
+		slots.clear();
+	}
+
+	//-- internals ---
+
+	std::vector< char > strings; //interned names, back to back
+	std::vector< Entry > entries; //in insertion order (an entry's id is its index)
+
+	//hash table: slot for a hash is (hash & (slots.size()-1)), then following slots until an empty one:
+	struct Slot {
+		uint32_t tag; //high bits of the hash (skips most string compares on collisions)
+		uint32_t id; //-1U if empty
+	};
+	std::vector< Slot > slots; //power-of-two size; at most 3/4 full
+
+	void rehash(size_t slot_count);
+};
+
+template< typename Value >
+uint32_t NameMap< Value >::find_id(NameKey const &key) const {
+	if (slots.empty()) return -1U;
+	size_t mask = slots.size() - 1;
+	uint32_t tag = uint32_t(key.hash >> 32);
+	for (size_t s = size_t(key.hash) & mask; ; s = (s + 1) & mask) {
+		Slot const &slot = slots[s];
+		if (slot.id == -1U) return -1U;
+		if (slot.tag != tag) continue;
+		Entry const &entry = entries[slot.id];
+		if (entry.name_end - entry.name_begin == key.name.size()
+		 && (key.name.empty() || std::memcmp(strings.data() + entry.name_begin, key.name.data(), key.name.size()) == 0)) {
+			return slot.id;
+		}
+	}
+}
+
+template< typename Value >
+std::pair< uint32_t, bool > NameMap< Value >::insert(NameKey const &key, Value const &value) {
+	uint32_t found = find_id(key);
+	if (found != -1U) return std::make_pair(found, false);
+
+	if ((entries.size() + 1) * 4 > slots.size() * 3) {
+		rehash(slots.empty() ? 16 : slots.size() * 2);
+	}
+
+	uint32_t id = uint32_t(entries.size());
+	Entry entry{uint32_t(strings.size()), uint32_t(strings.size() + key.name.size()), key.hash, value};
+	strings.insert(strings.end(), key.name.begin(), key.name.end());
+	entries.emplace_back(entry);
+
+	size_t mask = slots.size() - 1;
+	size_t s = size_t(key.hash) & mask;
+	while (slots[s].id != -1U) s = (s + 1) & mask;
+	slots[s] = Slot{uint32_t(key.hash >> 32), id};
+
+	return std::make_pair(id, true);
+}
+
+template< typename Value >
+void NameMap< Value >::rehash(size_t slot_count) {
+	assert(slot_count > 0 && (slot_count & (slot_count - 1)) == 0);
+	slots.assign(slot_count, Slot{0, -1U});
+	size_t mask = slot_count - 1;
+	for (uint32_t id = 0; id < entries.size(); ++id) {
+		size_t s = size_t(entries[id].hash) & mask;
+		while (slots[s].id != -1U) s = (s + 1) & mask;
+		slots[s] = Slot{uint32_t(entries[id].hash >> 32), id};
+	}
+}
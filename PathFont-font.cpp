@@ -1595,5 +1595,66 @@ namespace {
 		0.357675f, 0.546999f, 0.357675f, 0.546999f, 0.380799f, 0.530776f,
 		0.380799f, 0.530776f, 0.407815f, 0.504100f
 	};
+	constexpr const uint32_t font_trie_states = 96;
+	constexpr const uint32_t font_trie_root[256] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16,
+		17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32,
+		33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48,
+		49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64,
+		65, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76, 77, 78, 79, 80,
+		81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+	};
+	constexpr const uint32_t font_trie_glyphs[font_trie_states] = {
+		-1U, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+		11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22,
+		23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+		35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46,
+		47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58,
+		59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70,
+		71, 72, 73, 74, 75, 76, 77, 78, 79, 80, 81, 82,
+		83, 84, 85, 86, 87, 88, 89, 90, 91, 92, 93, 94
+	};
+	constexpr const uint32_t font_trie_edge_starts[font_trie_states+1] = {
+		0, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95,
+		95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95,
+		95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95,
+		95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95,
+		95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95,
+		95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95,
+		95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95,
+		95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95,
+		95
+	};
+	constexpr const uint8_t font_trie_edge_bytes[95] = {
+		32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43,
+		44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55,
+		56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67,
+		68, 69, 70, 71, 72, 73, 74, 75, 76, 77, 78, 79,
+		80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91,
+		92, 93, 94, 95, 96, 97, 98, 99, 100, 101, 102, 103,
+		104, 105, 106, 107, 108, 109, 110, 111, 112, 113, 114, 115,
+		116, 117, 118, 119, 120, 121, 122, 123, 124, 125, 126
+	};
+	constexpr const uint32_t font_trie_edge_states[95] = {
+		1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12,
+		13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+		25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36,
+		37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48,
+		49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60,
+		61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71, 72,
+		73, 74, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84,
+		85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95
+	};
 }
-PathFont PathFont::font(font_glyphs, font_glyph_widths, font_glyph_char_starts, font_chars, font_glyph_coord_starts, font_coords);
+PathFont PathFont::font(font_glyphs, font_glyph_widths, font_glyph_char_starts, font_chars, font_glyph_coord_starts, font_coords,
+	font_trie_root, font_trie_glyphs, font_trie_edge_starts, font_trie_edge_bytes, font_trie_edge_states);
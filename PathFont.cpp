@@ -3,22 +3,95 @@
 
 #include "PathFont.hpp"
 
-#include <iostream>
+#include <cassert>
 
 PathFont::PathFont(uint32_t glyphs_,
 	const float *glyph_widths_,
 	const uint32_t *glyph_char_starts_, const uint8_t *chars_,
-	const uint32_t *glyph_coord_starts_, const float *coords_
+	const uint32_t *glyph_coord_starts_, const float *coords_,
+	const uint32_t *trie_root_, const uint32_t *trie_glyphs_,
+	const uint32_t *trie_edge_starts_, const uint8_t *trie_edge_bytes_, const uint32_t *trie_edge_states_
 	) : glyphs(glyphs_),
 		glyph_widths(glyph_widths_),
 		glyph_char_starts(glyph_char_starts_), chars(chars_),
-		glyph_coord_starts(glyph_coord_starts_), coords(coords_) {
+		glyph_coord_starts(glyph_coord_starts_), coords(coords_),
+		trie_root(trie_root_), trie_glyphs(trie_glyphs_),
+		trie_edge_starts(trie_edge_starts_), trie_edge_bytes(trie_edge_bytes_), trie_edge_states(trie_edge_states_) {
+}
+
+uint32_t PathFont::match(std::string_view text, uint32_t *glyph) const {
+	assert(glyph);
+	if (text.empty()) return 0;
+
+	uint32_t matched = 0;
+	uint32_t state = trie_root[uint8_t(text[0])];
+	for (uint32_t i = 1; state != 0; ++i) {
+		if (trie_glyphs[state] != -1U) {
+			matched = i;
+			*glyph = trie_glyphs[state];
+		}
+		if (i == text.size()) break;
+
+		//follow the edge for the next byte (states past the root have very few edges):
+		uint32_t next = 0;
+		for (uint32_t e = trie_edge_starts[state]; e < trie_edge_starts[state+1]; ++e) {
+			if (trie_edge_bytes[e] == uint8_t(text[i])) {
+				next = trie_edge_states[e];
+				break;
+			}
+		}
+		state = next;
+	}
+	return matched;
+}
+
+float PathFont::layout_uncached(std::string_view text, std::vector< glm::vec2 > *coords_) const {
+	assert(coords_);
+	auto &out = *coords_;
 
-	for (uint32_t i = 0; i < glyphs; ++i) {
-		std::string str(reinterpret_cast< const char * >(chars + glyph_char_starts[i]), reinterpret_cast< const char * >(chars + glyph_char_starts[i+1]));
-		auto res = glyph_map.insert(std::make_pair(str, i));
-		if (!res.second) {
-			std::cerr << "WARNING: ignoring duplicate glyph for '" << str << "'." << std::endl;
+	float advance = 0.0f;
+	uint32_t start = 0;
+	while (start < text.size()) {
+		uint32_t glyph = -1U;
+		uint32_t length = match(text.substr(start), &glyph);
+		if (length == 0) {
+			length = 1;
+			//missing! draw a tofu:
+			for (const auto &pt : {
+				glm::vec2(0.1f, 0.1f), glm::vec2(0.6f, 0.1f),
+				glm::vec2(0.6f, 0.1f), glm::vec2(0.6f, 0.9f),
+				glm::vec2(0.9f, 0.6f), glm::vec2(0.1f, 0.9f),
+				glm::vec2(0.1f, 0.9f), glm::vec2(0.1f, 0.1f)
+			}) {
+				out.emplace_back(advance + pt.x, pt.y);
+			}
+			advance += 0.6f;
+		} else {
+			for (uint32_t c = glyph_coord_starts[glyph]; c + 1 < glyph_coord_starts[glyph+1]; c += 2) {
+				out.emplace_back(advance + coords[c], coords[c+1]);
+			}
+			advance += glyph_widths[glyph];
 		}
+		start += length;
 	}
+	return advance;
+}
+
+PathFont::Layout const &PathFont::layout(std::string_view text) {
+	NameKey key(text);
+	if (Layout const *found = layouts.find(key)) return *found;
+
+	//text that changes every frame (counters, timers) would grow the cache without bound, so start over now and then:
+	if (layouts.size() >= 1024 || layout_coords.size() >= (1 << 18)) {
+		layouts.clear();
+		layout_coords.clear();
+	}
+
+	layout_misses += 1;
+	Layout layout;
+	layout.coords_begin = uint32_t(layout_coords.size());
+	layout.width = layout_uncached(text, &layout_coords);
+	layout.coords_end = uint32_t(layout_coords.size());
+	uint32_t id = layouts.insert(key, layout).first;
+	return layouts.entries[id].value;
 }
@@ -8,18 +8,22 @@
  *
  */
 
+#include "NameMap.hpp"
+
 #include <glm/glm.hpp>
 
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map>
 
 struct PathFont {
 	//meant to be intitialized with some pointers to constant data:
 	PathFont(uint32_t glyphs,
 		const float *glyph_widths,
 		const uint32_t *glyph_char_starts, const uint8_t *chars,
-		const uint32_t *glyph_coord_starts, const float *coords
+		const uint32_t *glyph_coord_starts, const float *coords,
+		const uint32_t *trie_root, const uint32_t *trie_glyphs,
+		const uint32_t *trie_edge_starts, const uint8_t *trie_edge_bytes, const uint32_t *trie_edge_states
 		);
 	const uint32_t glyphs = 0;
 	const float *glyph_widths = nullptr;
@@ -30,10 +34,34 @@ struct PathFont {
 	const uint32_t *glyph_coord_starts = nullptr; //indices into 'coords' table
 	const float *coords = nullptr;
 
-	//computed in constructor:
-	std::map< std::string, uint32_t > glyph_map;
+	//byte trie over glyph characters (built by make-PathFont-font.py); state 0 is the root:
+	const uint32_t *trie_root = nullptr; //[256] state after each first byte (0 if no glyph starts with it)
+	const uint32_t *trie_glyphs = nullptr; //glyph whose characters end at each state (or -1U)
+	const uint32_t *trie_edge_starts = nullptr; //indices into the 'trie_edge_*' tables, per state
+	const uint8_t *trie_edge_bytes = nullptr; //(sorted within each state)
+	const uint32_t *trie_edge_states = nullptr;
+
+	//longest glyph whose characters start 'text': returns the number of bytes matched and sets *glyph,
+	// or returns 0 if no glyph matches:
+	uint32_t match(std::string_view text, uint32_t *glyph) const;
+
+	//line coordinates for 'text' -- pairs of endpoints in font units (character box 1 unit high,
+	// glyphs advanced along x), with a "tofu" box for any byte that starts no glyph:
+	// appends to *coords and returns the total advance
+	float layout_uncached(std::string_view text, std::vector< glm::vec2 > *coords) const;
+
+	//the same, cached by string (so drawing the same text every frame only transforms its coordinates):
+	struct Layout {
+		uint32_t coords_begin, coords_end; //range in layout_coords
+		float width; //total advance
+	};
+	//(returned reference is good until the next layout() call; not thread-safe)
+	Layout const &layout(std::string_view text);
+
+	NameMap< Layout > layouts;
+	std::vector< glm::vec2 > layout_coords;
+	uint32_t layout_misses = 0; //strings laid out (and not found in the cache) so far
 
 	//the default font:
 	static PathFont font;
 };
-
@@ -8,23 +8,33 @@
 #include "LitColorTextureProgram.hpp"
 #include "Mesh.hpp"
 #include "Load.hpp"
+#include "HotReload.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp>
 
+#include <algorithm>
+#include <memory>
 #include <random>
 #include <array>
 
+//the game's meshes and scene stream in after the first frame (see PlayMode::setup_scene):
+
+//file reading and quantizing happen on a loading thread; only the buffer upload is on the main thread:
+Load< MeshBuffer > game6_meshes(LoadTagStream, "game6_meshes", {}, []() -> MeshBuffer * {
+	return new MeshBuffer(data_path("game6.pnct"), MeshBuffer::UploadLater);
+}, [](MeshBuffer &buffer) {
+	buffer.upload();
+});
+
 GLuint game6_meshes_for_lit_color_texture_program = 0;
-Load< MeshBuffer > game6_meshes(LoadTagDefault, []() -> MeshBuffer const * {
-	MeshBuffer const *ret = new MeshBuffer(data_path("game6.pnct"));
-	game6_meshes_for_lit_color_texture_program = ret->make_vao_for_program(lit_color_texture_program->program);
-	return ret;
+static Load< void > game6_meshes_vao(LoadTagStream, "game6_meshes_vao", {"game6_meshes", "lit_color_texture_program"}, [](){
+	game6_meshes_for_lit_color_texture_program = game6_meshes->make_vao_for_program(lit_color_texture_program->program);
 });
 
-Load< Scene > game6_scene(LoadTagDefault, []() -> Scene const * {
-	return new Scene(data_path("game6.scene"), [&](Scene &scene, Scene::Transform *transform, std::string const &mesh_name){
-		Mesh const &mesh = game6_meshes->lookup(mesh_name);
+//read game6.scene, making drawables for meshes in 'meshes' (uploaded to the buffer behind the game6 vao):
+static Scene *load_game6_scene(MeshBuffer const &meshes, AssetFile::Source source = AssetFile::ArchiveOrLoose) {
+	return new Scene(data_path("game6.scene"), meshes, [&](Scene &scene, Scene::Transform *transform, Mesh const &mesh){
 		scene.drawables.emplace_back(transform);
 		Scene::Drawable &drawable = scene.drawables.back();
 
@@ -34,32 +44,54 @@ Load< Scene > game6_scene(LoadTagDefault, []() -> Scene const * {
 		drawable.pipeline.type = mesh.type;
 		drawable.pipeline.start = mesh.start;
 		drawable.pipeline.count = mesh.count;
-	});
-});
+		drawable.pipeline.index_type = mesh.index_type;
+		drawable.pipeline.base_vertex = mesh.base_vertex;
+		drawable.pipeline.position_scale = mesh.position_scale;
+		drawable.pipeline.position_offset = mesh.position_offset;
+	}, source);
+}
 
-PlayMode::PlayMode(Client &client_) 
-		: client(client_), 
-		  scene(*game6_scene) {
-	//get pointers to leg for convenience:
-	for (auto &transform : scene.transforms) {
-		if (transform.name.substr(0, 9) == "vine_purp") {
-			purple_vines.emplace_back(&transform);
+//(scene loading doesn't call OpenGL, so it can also run on a loading thread)
+Load< Scene > game6_scene(LoadTagStream, "game6_scene", {"game6_meshes", "game6_meshes_vao", "lit_color_texture_program"}, []() -> Scene const * {
+	return load_game6_scene(*game6_meshes);
+}, LoadOnWorkerThread);
+
+//PlayMode scenes (copied from game6_scene) that hot reloads should update:
+static std::vector< Scene * > game6_scene_copies;
+
+//reload game6 meshes and scene when they are re-exported (see HotReload.hpp):
+// (hot reloading is the one place loaded data changes, hence the const_casts)
+// (reloads read the loose files, since the asset archive was mapped at startup and never has the new versions)
+static Load< void > watch_game6(LoadTagStream, "watch_game6", {"game6_scene"}, [](){
+	//apply a freshly loaded scene to game6_scene and its copies, keeping their transforms:
+	auto apply_scene = [](Scene const &fresh) {
+		Scene &loaded = const_cast< Scene & >(*game6_scene);
+		for (Scene *copy : game6_scene_copies) {
+			copy->merge_reloaded(loaded, fresh);
 		}
-		else if (transform.name.substr(0, 10) == "vine_green") {
-			green_vines.emplace_back(&(transform));
-		}
-		else if (transform.name == "flower_purp") {
-			purple_flower = &transform;
-		}
-		else if (transform.name == "flower_green") {
-			green_flower = &transform;
-		}
-	}
+		loaded = fresh;
+	};
 
-	//get pointer to camera for convenience:
-	if (scene.cameras.size() != 1) throw std::runtime_error("Expecting scene to have exactly one camera, but it has " + std::to_string(scene.cameras.size()));
-	camera = &scene.cameras.front();
+	watch_file(data_path("game6.pnct"), [apply_scene]() -> std::function< void() > {
+		//drawables hold mesh ranges, so the scene is rebuilt against the new meshes and both swap together:
+		auto meshes = std::make_shared< MeshBuffer >(data_path("game6.pnct"), MeshBuffer::UploadLater, AssetFile::LooseOnly);
+		auto scene = std::shared_ptr< Scene >(load_game6_scene(*meshes, AssetFile::LooseOnly));
+		return [meshes, scene, apply_scene](){
+			const_cast< MeshBuffer & >(*game6_meshes).replace(std::move(*meshes));
+			apply_scene(*scene);
+		};
+	});
+
+	watch_file(data_path("game6.scene"), [apply_scene]() -> std::function< void() > {
+		auto scene = std::shared_ptr< Scene >(load_game6_scene(*game6_meshes, AssetFile::LooseOnly));
+		return [scene, apply_scene](){
+			apply_scene(*scene);
+		};
+	});
+});
 
+PlayMode::PlayMode(Client &client_) 
+		: client(client_) {
 	for (uint8_t i = 0; i < 5; i++) {
 		for (uint8_t j = 0; j < 5; j++) {
 			for (uint8_t k = 0; k < 5; k++) {
@@ -68,9 +100,51 @@ PlayMode::PlayMode(Client &client_)
 		};
 	};
 	occupied_cells[2][2][0] = true;
+
+	hud_status = hud.add();
+	hud_restart = hud.add();
+	hud_controls = hud.add();
+	for (auto &key : hud_keys) {
+		key = hud.add();
+	}
+
+	if (game6_scene.ready()) setup_scene();
 };
 
 PlayMode::~PlayMode() {
+	if (scene_ready) {
+		game6_scene_copies.erase(std::find(game6_scene_copies.begin(), game6_scene_copies.end(), &scene));
+	}
+}
+
+void PlayMode::setup_scene() {
+	assert(!scene_ready && game6_scene.ready());
+	scene = *game6_scene;
+	game6_scene_copies.emplace_back(&scene); //(so hot reloads update it)
+
+	//get pointers to vines and flowers for convenience:
+	static constexpr NameKey FlowerPurp = "flower_purp"_name;
+	static constexpr NameKey FlowerGreen = "flower_green"_name;
+	purple_vines = scene.find_prefix("vine_purp");
+	green_vines = scene.find_prefix("vine_green");
+	purple_flower = scene.find(FlowerPurp);
+	green_flower = scene.find(FlowerGreen);
+
+	//get pointer to camera for convenience:
+	if (scene.cameras.size() != 1) throw std::runtime_error("Expecting scene to have exactly one camera, but it has " + std::to_string(scene.cameras.size()));
+	camera = &scene.cameras.front();
+
+	//the scene doesn't include any lamps, so add a hemisphere light shining down from above:
+	// (Scene::draw hands all of scene.lights to the lit shader)
+	if (scene.lights.empty()) {
+		scene.transforms.emplace_back();
+		scene.transforms.back().name = "Sky";
+		scene.lights.emplace_back(&scene.transforms.back());
+		scene.lights.back().type = Scene::Light::Hemisphere;
+		scene.lights.back().energy = glm::vec3(1.0f, 1.0f, 0.95f);
+	}
+
+	scene_ready = true;
 }
 
 bool PlayMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size) {
@@ -141,6 +215,12 @@ bool PlayMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size)
 
 void PlayMode::update(float elapsed) {
 
+	//server messages move scene transforms, so leave them queued until the scene has arrived:
+	if (!scene_ready) {
+		if (!game6_scene.ready()) return;
+		setup_scene();
+	}
+
 	//queue data for sending to server:
 	controls.send_controls_message(&client.connection);
 
@@ -329,16 +409,26 @@ void PlayMode::update(float elapsed) {
 
 void PlayMode::draw(glm::uvec2 const &drawable_size) {
 
+	if (!scene_ready) {
+		//placeholder while the scene streams in:
+		glClearColor(0.f, 0.006f, 0.02f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glDisable(GL_DEPTH_TEST);
+		float aspect = float(drawable_size.x) / float(drawable_size.y);
+		DrawLines lines(glm::mat4(
+			1.0f / aspect, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f
+		));
+		lines.draw_text("Loading...", glm::vec3(-0.4f, -0.05f, 0.0f), glm::vec3(0.15f, 0.0f, 0.0f), glm::vec3(0.0f, 0.15f, 0.0f), glm::u8vec4(0xcc, 0x70, 0xff, 0xff));
+		GL_ERRORS();
+		return;
+	}
+
 	//update camera aspect ratio for drawable:
 	camera->aspect = float(drawable_size.x) / float(drawable_size.y);
 
-	//set up light type and position for lit_color_texture_program:
-	glUseProgram(lit_color_texture_program->program);
-	glUniform1i(lit_color_texture_program->LIGHT_TYPE_int, 1);
-	glUniform3fv(lit_color_texture_program->LIGHT_DIRECTION_vec3, 1, glm::value_ptr(glm::vec3(0.0f, 0.0f,-1.0f)));
-	glUniform3fv(lit_color_texture_program->LIGHT_ENERGY_vec3, 1, glm::value_ptr(glm::vec3(1.0f, 1.0f, 0.95f)));
-	glUseProgram(0);
-
 	glClearColor(0.f, 0.006f, 0.02f, 1.0f);
 	glClearDepth(1.0f); //1.0 is actually the default value to clear the depth buffer to, but FYI you can change it.
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -368,44 +458,55 @@ void PlayMode::draw(glm::uvec2 const &drawable_size) {
 		0.0f, 0.0f, 0.0f, 1.0f
 	);
 
-	DrawLines lines(world_to_clip);
-
-	//helper:
-	auto draw_text = [&](glm::vec2 const &at, std::string const &text, float H, glm::u8vec4 color) {
-		lines.draw_text(text,
-			glm::vec3(at.x, at.y, 0.0),
-			glm::vec3(H, 0.0f, 0.0f), glm::vec3(0.0f, H, 0.0f),
-			color);
-	};
+	//the HUD only changes with the phase, the turn, and which player this is:
+	uint32_t state = uint32_t(phase) | (uint32_t(my_turn) << 2) | (uint32_t(i_won) << 3) | (uint32_t(am_green) << 4);
+	if (state != hud_state) {
+		hud_state = state;
+
+		//helper:
+		auto set_text = [&](uint32_t element, glm::vec2 const &at, std::string const &text, float H, glm::u8vec4 color) {
+			hud.set_text(element, text,
+				glm::vec3(at.x, at.y, 0.0),
+				glm::vec3(H, 0.0f, 0.0f), glm::vec3(0.0f, H, 0.0f),
+				color);
+		};
 
-	glm::u8vec4 player_color = am_green ? glm::u8vec4(0xa0, 0xff, 0xa0, 0xff) : glm::u8vec4(0xcc, 0x70, 0xff, 0xff);
-	std::string game_text;
-	game_text = "You are the ";
-	game_text.append(am_green ? "green" : "purple");
-	game_text.append(" player.");
-	if (phase == 0) game_text.append(" Waiting for green player.");
-	else if (phase == 2) {
-		game_text.append(i_won ? " You win! ^-^" : "You lose ;-;");
-		draw_text(glm::vec2(-0.5f, 0.f), "Press R to restart", 0.15f, player_color);
-	}
-	else if (my_turn) {
-		game_text.append(" Your move!");
-	} else {
-		game_text.append(" Opponent's move.");
+		glm::u8vec4 player_color = am_green ? glm::u8vec4(0xa0, 0xff, 0xa0, 0xff) : glm::u8vec4(0xcc, 0x70, 0xff, 0xff);
+		std::string game_text;
+		game_text = "You are the ";
+		game_text.append(am_green ? "green" : "purple");
+		game_text.append(" player.");
+		if (phase == 0) game_text.append(" Waiting for green player.");
+		else if (phase == 2) {
+			game_text.append(i_won ? " You win! ^-^" : "You lose ;-;");
+			set_text(hud_restart, glm::vec2(-0.5f, 0.f), "Press R to restart", 0.15f, player_color);
+		}
+		else if (my_turn) {
+			game_text.append(" Your move!");
+		} else {
+			game_text.append(" Opponent's move.");
+		}
+		set_text(hud_status, glm::vec2(-1.4f, -1.f + Game::PlayerRadius), game_text, 0.15f, player_color);
+		hud.set_visible(hud_restart, phase == 2);
+
+		hud.set_lines(hud_controls, {
+			glm::vec3(-1.4, 0.833, 0.), glm::vec3(-1.2, 0.767, 0.),
+			glm::vec3(-1.3, 0.9, 0.), glm::vec3(-1.3, 0.7, 0.),
+			glm::vec3(-1.4, 0.767, 0.), glm::vec3(-1.2, 0.833, 0.)
+		}, player_color);
+		set_text(hud_keys[0], glm::vec3(-1.432, 0.823, 0.), "A", 0.04f, player_color);
+		set_text(hud_keys[1], glm::vec3(-1.18, 0.74, 0.), "D", 0.04f, player_color);
+		set_text(hud_keys[2], glm::vec3(-1.31, 0.91, 0.), "W", 0.04f, player_color);
+		set_text(hud_keys[3], glm::vec3(-1.31, 0.64, 0.), "S", 0.04f, player_color);
+		set_text(hud_keys[4], glm::vec3(-1.18, 0.823, 0.), "E", 0.04f, player_color);
+		set_text(hud_keys[5], glm::vec3(-1.43, 0.74, 0.), "Q", 0.04f, player_color);
+		hud.set_visible(hud_controls, phase < 2);
+		for (auto key : hud_keys) {
+			hud.set_visible(key, phase < 2);
+		}
 	}
-	draw_text(glm::vec2(-1.4f, -1.f + Game::PlayerRadius), game_text, 0.15f, player_color);
 
-	if (phase < 2) {
-		lines.draw(glm::vec3(-1.4, 0.833, 0.), glm::vec3(-1.2, 0.767, 0.), player_color);
-		lines.draw(glm::vec3(-1.3, 0.9, 0.), glm::vec3(-1.3, 0.7, 0.), player_color);
-		lines.draw(glm::vec3(-1.4, 0.767, 0.), glm::vec3(-1.2, 0.833, 0.), player_color);
-		draw_text(glm::vec3(-1.432, 0.823, 0.), "A", 0.04f, player_color);
-		draw_text(glm::vec3(-1.18, 0.74, 0.), "D", 0.04f, player_color);
-		draw_text(glm::vec3(-1.31, 0.91, 0.), "W", 0.04f, player_color);
-		draw_text(glm::vec3(-1.31, 0.64, 0.), "S", 0.04f, player_color);
-		draw_text(glm::vec3(-1.18, 0.823, 0.), "E", 0.04f, player_color);
-		draw_text(glm::vec3(-1.43, 0.74, 0.), "Q", 0.04f, player_color);
-	}
+	hud.draw(world_to_clip);
 
 	GL_ERRORS();
 }
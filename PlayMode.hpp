@@ -3,6 +3,7 @@
 #include "Connection.hpp"
 #include "Game.hpp"
 #include "Scene.hpp"
+#include "HUD.hpp"
 
 #include <glm/glm.hpp>
 
@@ -33,8 +34,11 @@ struct PlayMode : Mode {
 	Client &client;
 
 	// scene stuff
+	// (the scene streams in after the first frame; until it arrives, a loading screen is drawn and server messages wait)
 	Scene scene;
 	Scene::Camera *camera = nullptr;
+	bool scene_ready = false;
+	void setup_scene(); //copy game6_scene once it is loaded and find the transforms used below
 
 	// vine storage
 	const uint8_t max_vines = 125;
@@ -72,5 +76,11 @@ struct PlayMode : Mode {
 	uint8_t phase = 0; // 0: pre-game. 1: during game. 2: winner screen.
 	bool i_won = 0;
 
+	//HUD text and control diagram, re-tessellated only when hud_state changes:
+	HUD hud;
+	uint32_t hud_status, hud_restart, hud_controls;
+	std::array< uint32_t, 6 > hud_keys;
+	uint32_t hud_state = -1U; //phase, turn, and role the HUD was last set up for
+
 	// x, y, z order. players start at (2, 2, 0)
 };
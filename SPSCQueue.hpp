@@ -0,0 +1,47 @@
+#pragma once
+
+/*
+ * SPSCQueue< T, Size > is a fixed-size, lock-free, single-producer / single-consumer queue:
+ *  exactly one thread may call push() and exactly one (other) thread may call pop().
+ *  Neither call ever blocks or allocates, so it is safe to use from an audio callback.
+ *
+ * (Used by Sound to send commands from the game to the mixer, and finished voices back.)
+ *
+ */
+
+#include <atomic>
+#include <cstdint>
+
+template< typename T, uint32_t Size >
+struct SPSCQueue {
+	static_assert(Size > 0 && (Size & (Size - 1)) == 0, "Size should be a power of two.");
+
+	//producer: add a copy of 'value' to the queue; returns false (and does nothing) if full:
+	bool push(T const &value) {
+		uint32_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == Size) return false;
+		items[t & (Size - 1)] = value;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	//consumer: move the oldest value into *value; returns false if empty:
+	bool pop(T *value) {
+		uint32_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire)) return false;
+		*value = items[h & (Size - 1)];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	//(either side) number of values waiting -- may already be out of date when it returns:
+	uint32_t size() const {
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+	}
+
+	//-- internals ---
+	//head and tail count up forever (wrapping); they are on separate cache lines so the two threads don't contend:
+	alignas(64) std::atomic< uint32_t > head{0}; //next value to pop (written by consumer)
+	alignas(64) std::atomic< uint32_t > tail{0}; //next value to push (written by producer)
+	alignas(64) T items[Size];
+};
@@ -2,10 +2,15 @@
 
 #include "gl_errors.hpp"
 #include "read_write_chunk.hpp"
+#include "AssetArchive.hpp"
+#include "UniformBlocks.hpp"
+#include "LightClusters.hpp"
+#include "Mesh.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
-#include <fstream>
+#include <algorithm>
+#include <cstring>
 
 //-------------------------
 
@@ -82,83 +87,146 @@ glm::mat4 Scene::Camera::make_projection() const {
 
 void Scene::draw(Camera const &camera) const {
 	assert(camera.transform);
-	glm::mat4 world_to_clip = camera.make_projection() * glm::mat4(camera.transform->make_world_to_local());
+	glm::mat4 projection = camera.make_projection();
+	glm::mat4x3 world_to_view = camera.transform->make_world_to_local();
+	glm::mat4 world_to_clip = projection * glm::mat4(world_to_view);
 	glm::mat4x3 world_to_light = glm::mat4x3(1.0f);
+
+	{ //Bin this scene's lights into view-space clusters for the lit shaders:
+		//(static so storage is reused from frame to frame)
+		static LightClusters clusters;
+		clusters.clear();
+		for (auto const &light : lights) {
+			glm::mat4x3 light_to_world = light.transform->make_local_to_world();
+			LightClusters::Light l;
+			l.position = light_to_world[3];
+			l.direction = -glm::normalize(light_to_world[2]);
+			l.energy = light.energy;
+			if (light.type == Light::Point) {
+				l.type = float(LightClusters::Point);
+			} else if (light.type == Light::Hemisphere) {
+				l.type = float(LightClusters::Hemisphere);
+			} else if (light.type == Light::Spot) {
+				l.type = float(LightClusters::Spot);
+				l.cutoff = std::cos(0.5f * light.spot_fov);
+			} else { //(light.type == Light::Directional)
+				l.type = float(LightClusters::Directional);
+			}
+			clusters.add(l);
+		}
+		//world_to_light is identity, so light space is world space:
+		clusters.build(world_to_view, glm::vec2(projection[0][0], projection[1][1]));
+		set_lights(clusters);
+	}
+
 	draw(world_to_clip, world_to_light);
 }
 
 void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light) const {
 
-	//Iterate through all drawables, sending each one to OpenGL:
+	//Gather the drawables that will actually be sent to OpenGL:
+	std::vector< Drawable const * > &to_draw = draw_scratch_to_draw;
+	to_draw.clear();
 	for (auto const &drawable : drawables) {
-		//Reference to drawable's pipeline for convenience:
-		Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
-
 		//skip any drawables without a shader program set:
-		if (pipeline.program == 0) continue;
+		if (drawable.pipeline.program == 0) continue;
 		//skip any drawables that don't reference any vertex array:
-		if (pipeline.vao == 0) continue;
+		if (drawable.pipeline.vao == 0) continue;
 		//skip any drawables that don't contain any vertices:
-		if (pipeline.count == 0) continue;
-
+		if (drawable.pipeline.count == 0) continue;
 
-		//Set shader program:
-		glUseProgram(pipeline.program);
+		to_draw.emplace_back(&drawable);
+	}
+	if (to_draw.empty()) return;
 
-		//Set attribute sources:
-		glBindVertexArray(pipeline.vao);
+	{ //Camera data goes in the per-frame block:
+		FrameBlock frame;
+		frame.WORLD_TO_CLIP = world_to_clip;
+		for (uint32_t c = 0; c < 4; ++c) {
+			frame.WORLD_TO_LIGHT[c] = glm::vec4(world_to_light[c], 0.0f);
+		}
+		set_frame_block(frame);
+	}
 
-		//Configure program uniforms:
+	//Per-object matrices are computed in one batch and written to the object ring in one contiguous pass:
+	std::vector< ObjectTransform > &objects = draw_scratch_objects;
+	objects.clear();
+	for (auto const *drawable : to_draw) {
+		assert(drawable->transform); //drawables *must* have a transform
+		objects.emplace_back();
+		objects.back().object_to_world = drawable->transform->make_local_to_world();
+		objects.back().position_scale = drawable->pipeline.position_scale;
+		objects.back().position_offset = drawable->pipeline.position_offset;
+		objects.back().texcoord_scale = drawable->pipeline.texcoord_scale;
+		objects.back().texcoord_offset = drawable->pipeline.texcoord_offset;
+		objects.back().atlas_layer = drawable->pipeline.atlas_layer;
+	}
 
-		//the object-to-world matrix is used in all three of these uniforms:
-		assert(drawable.transform); //drawables *must* have a transform
-		glm::mat4x3 object_to_world = drawable.transform->make_local_to_world();
+	size_t stride = 0;
+	GLintptr offset = 0;
+	void *blocks = map_object_blocks(to_draw.size(), &stride, &offset);
+	compute_object_blocks(to_draw.size(), objects.data(), world_to_clip, world_to_light, blocks, stride);
+	unmap_object_blocks();
 
-		//OBJECT_TO_CLIP takes vertices from object space to clip space:
-		if (pipeline.OBJECT_TO_CLIP_mat4 != -1U) {
-			glm::mat4 object_to_clip = world_to_clip * glm::mat4(object_to_world);
-			glUniformMatrix4fv(pipeline.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(object_to_clip));
-		}
+	GLuint current_program = 0;
+	GLuint current_vao = 0;
+	Drawable::Pipeline::TextureInfo current_textures[Drawable::Pipeline::TextureCount];
 
-		//the object-to-light matrix is used in the next two uniforms:
-		glm::mat4x3 object_to_light = world_to_light * glm::mat4(object_to_world);
+	//Iterate through all drawables, sending each one to OpenGL:
+	for (size_t d = 0; d < to_draw.size(); ++d) {
+		//Reference to drawable's pipeline for convenience:
+		Scene::Drawable::Pipeline const &pipeline = to_draw[d]->pipeline;
 
-		//OBJECT_TO_CLIP takes vertices from object space to light space:
-		if (pipeline.OBJECT_TO_LIGHT_mat4x3 != -1U) {
-			glUniformMatrix4x3fv(pipeline.OBJECT_TO_LIGHT_mat4x3, 1, GL_FALSE, glm::value_ptr(object_to_light));
+		//Set shader program:
+		if (pipeline.program != current_program) {
+			glUseProgram(pipeline.program);
+			current_program = pipeline.program;
 		}
 
-		//NORMAL_TO_CLIP takes normals from object space to light space:
-		if (pipeline.NORMAL_TO_LIGHT_mat3 != -1U) {
-			glm::mat3 normal_to_light = glm::inverse(glm::transpose(glm::mat3(object_to_light)));
-			glUniformMatrix3fv(pipeline.NORMAL_TO_LIGHT_mat3, 1, GL_FALSE, glm::value_ptr(normal_to_light));
+		//Set attribute sources:
+		if (pipeline.vao != current_vao) {
+			glBindVertexArray(pipeline.vao);
+			current_vao = pipeline.vao;
 		}
 
+		//Point the Object block at this drawable's matrices:
+		bind_object_block(offset + GLintptr(d * stride));
+
 		//set any requested custom uniforms:
 		if (pipeline.set_uniforms) pipeline.set_uniforms();
 
-		//set up textures:
+		//set up textures (drawables sharing an atlas skip this):
 		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
-			if (pipeline.textures[i].texture != 0) {
+			Drawable::Pipeline::TextureInfo const &info = pipeline.textures[i];
+			if (info.texture != 0 && (info.texture != current_textures[i].texture || info.target != current_textures[i].target)) {
 				glActiveTexture(GL_TEXTURE0 + i);
-				glBindTexture(pipeline.textures[i].target, pipeline.textures[i].texture);
+				if (current_textures[i].texture != 0 && current_textures[i].target != info.target) {
+					glBindTexture(current_textures[i].target, 0);
+				}
+				glBindTexture(info.target, info.texture);
+				current_textures[i] = info;
 			}
 		}
 
 		//draw the object:
-		glDrawArrays(pipeline.type, pipeline.start, pipeline.count);
-
-		//un-bind textures:
-		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
-			if (pipeline.textures[i].texture != 0) {
-				glActiveTexture(GL_TEXTURE0 + i);
-				glBindTexture(pipeline.textures[i].target, 0);
-			}
+		if (pipeline.index_type != 0) {
+			GLsizeiptr index_size = (pipeline.index_type == GL_UNSIGNED_SHORT ? 2 : 4);
+			glDrawElementsBaseVertex(pipeline.type, pipeline.count, pipeline.index_type, (GLbyte *)0 + pipeline.start * index_size, pipeline.base_vertex);
+		} else {
+			glDrawArrays(pipeline.type, pipeline.start, pipeline.count);
 		}
-		glActiveTexture(GL_TEXTURE0);
 
 	}
 
+	//un-bind textures:
+	for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
+		if (current_textures[i].texture != 0) {
+			glActiveTexture(GL_TEXTURE0 + i);
+			glBindTexture(current_textures[i].target, 0);
+		}
+	}
+	glActiveTexture(GL_TEXTURE0);
+
 	glUseProgram(0);
 	glBindVertexArray(0);
 
@@ -166,13 +234,23 @@ void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_lig
 }
 
 
-void Scene::load(std::string const &filename,
-	std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
+//does the chunk at 'at' have the given magic number? (used to check for optional chunks)
+static bool next_chunk_is(char const *at, char const *end, char const *magic) {
+	return size_t(end - at) >= 8 && std::memcmp(at, magic, 4) == 0;
+}
 
-	std::ifstream file(filename, std::ios::binary);
+//shared by both versions of Scene::load (exactly one of on_drawable and mesh_buffer is used):
+static void load_scene(Scene &scene, std::string const &filename,
+	std::function< void(Scene &, Scene::Transform *, std::string const &) > const &on_drawable,
+	MeshBuffer const *mesh_buffer, std::function< void(Scene &, Scene::Transform *, Mesh const &) > const &on_mesh,
+	AssetFile::Source source) {
 
-	std::vector< char > names;
-	read_chunk(file, "str0", &names);
+	//chunks are read in place from the archive or mapped file; only names get copied (into Transform::name):
+	AssetFile file(filename, source);
+	char const *at = file.begin();
+
+	ChunkSpan< char > names;
+	read_chunk(&at, file.end(), "str0", &names);
 
 	struct HierarchyEntry {
 		uint32_t parent;
@@ -183,8 +261,8 @@ void Scene::load(std::string const &filename,
 		glm::vec3 scale;
 	};
 	static_assert(sizeof(HierarchyEntry) == 4 + 4 + 4 + 4*3 + 4*4 + 4*3, "HierarchyEntry is packed.");
-	std::vector< HierarchyEntry > hierarchy;
-	read_chunk(file, "xfh0", &hierarchy);
+	ChunkSpan< HierarchyEntry > hierarchy;
+	read_chunk(&at, file.end(), "xfh0", &hierarchy);
 
 	struct MeshEntry {
 		uint32_t transform;
@@ -192,8 +270,8 @@ void Scene::load(std::string const &filename,
 		uint32_t name_end;
 	};
 	static_assert(sizeof(MeshEntry) == 4 + 4 + 4, "MeshEntry is packed.");
-	std::vector< MeshEntry > meshes;
-	read_chunk(file, "msh0", &meshes);
+	ChunkSpan< MeshEntry > meshes;
+	read_chunk(&at, file.end(), "msh0", &meshes);
 
 	struct CameraEntry {
 		uint32_t transform;
@@ -202,8 +280,8 @@ void Scene::load(std::string const &filename,
 		float clip_near, clip_far;
 	};
 	static_assert(sizeof(CameraEntry) == 4 + 4 + 4 + 4 + 4, "CameraEntry is packed.");
-	std::vector< CameraEntry > loaded_cameras;
-	read_chunk(file, "cam0", &loaded_cameras);
+	ChunkSpan< CameraEntry > loaded_cameras;
+	read_chunk(&at, file.end(), "cam0", &loaded_cameras);
 
 	struct LightEntry {
 		uint32_t transform;
@@ -214,19 +292,46 @@ void Scene::load(std::string const &filename,
 		float fov;
 	};
 	static_assert(sizeof(LightEntry) == 4 + 1 + 3 + 4 + 4 + 4, "LightEntry is packed.");
-	std::vector< LightEntry > loaded_lights;
-	read_chunk(file, "lmp0", &loaded_lights);
+	ChunkSpan< LightEntry > loaded_lights;
+	read_chunk(&at, file.end(), "lmp0", &loaded_lights);
+
+	//scene files cooked by 'cook-scene' continue with the index of each mesh in the mesh file
+	// (along with a hash of that file's mesh names, to check the indices still apply) and a name index:
+	struct MeshNamesHash {
+		uint32_t low, high;
+	};
+	static_assert(sizeof(MeshNamesHash) == 8, "MeshNamesHash is packed.");
+	ChunkSpan< MeshNamesHash > mesh_names_hash;
+	ChunkSpan< uint32_t > mesh_indices;
+	std::shared_ptr< NameIndex > cooked_index;
+	if (next_chunk_is(at, file.end(), "mbh0")) {
+		read_chunk(&at, file.end(), "mbh0", &mesh_names_hash);
+		read_chunk(&at, file.end(), "msh1", &mesh_indices);
+		if (mesh_names_hash.size() != 1 || mesh_indices.size() != meshes.size()) {
+			throw std::runtime_error("scene file '" + filename + "' has the wrong number of cooked mesh indices");
+		}
+		cooked_index = std::make_shared< NameIndex >();
+		cooked_index->read(&at, file.end());
+		if (cooked_index->item_count() != hierarchy.size()) {
+			throw std::runtime_error("scene file '" + filename + "' has a name index that doesn't match its transforms");
+		}
+		for (uint32_t item : cooked_index->items) {
+			if (item >= hierarchy.size()) {
+				throw std::runtime_error("scene file '" + filename + "' has a name index with out-of-range transform");
+			}
+		}
+	}
 
 
 	//--------------------------------
 	//Now that file is loaded, create transforms for hierarchy entries:
 
-	std::vector< Transform * > hierarchy_transforms;
+	std::vector< Scene::Transform * > hierarchy_transforms;
 	hierarchy_transforms.reserve(hierarchy.size());
 
 	for (auto const &h : hierarchy) {
-		transforms.emplace_back();
-		Transform *t = &transforms.back();
+		scene.transforms.emplace_back();
+		Scene::Transform *t = &scene.transforms.back();
 		if (h.parent != -1U) {
 			if (h.parent >= hierarchy_transforms.size()) {
 				throw std::runtime_error("scene file '" + filename + "' did not contain transforms in topological-sort order.");
@@ -248,17 +353,36 @@ void Scene::load(std::string const &filename,
 	}
 	assert(hierarchy_transforms.size() == hierarchy.size());
 
-	for (auto const &m : meshes) {
+	//cooked mesh indices only apply to the mesh file they were made for:
+	bool use_mesh_indices = false;
+	if (mesh_buffer && !mesh_names_hash.empty()) {
+		uint64_t hash = (uint64_t(mesh_names_hash[0].high) << 32) | uint64_t(mesh_names_hash[0].low);
+		use_mesh_indices = (hash == mesh_buffer->names_hash);
+		if (!use_mesh_indices) {
+			std::cerr << "WARNING: scene file '" << filename << "' was cooked against different meshes; looking meshes up by name instead." << std::endl;
+		}
+	}
+
+	for (uint32_t i = 0; i < meshes.size(); ++i) {
+		auto const &m = meshes[i];
 		if (m.transform >= hierarchy_transforms.size()) {
 			throw std::runtime_error("scene file '" + filename + "' contains mesh entry with invalid transform index (" + std::to_string(m.transform) + ")");
 		}
+		if (use_mesh_indices) {
+			on_mesh(scene, hierarchy_transforms[m.transform], mesh_buffer->lookup_index(mesh_indices[i]));
+			continue;
+		}
 		if (!(m.name_begin <= m.name_end && m.name_end <= names.size())) {
 			throw std::runtime_error("scene file '" + filename + "' contains mesh entry with invalid name indices");
 		}
-		std::string name = std::string(names.begin() + m.name_begin, names.begin() + m.name_end);
 
-		if (on_drawable) {
-			on_drawable(*this, hierarchy_transforms[m.transform], name);
+		if (mesh_buffer) {
+			//(looked up straight from the file's string table)
+			std::string_view name(names.data() + m.name_begin, m.name_end - m.name_begin);
+			on_mesh(scene, hierarchy_transforms[m.transform], mesh_buffer->lookup(name));
+		} else if (on_drawable) {
+			std::string name = std::string(names.begin() + m.name_begin, names.begin() + m.name_end);
+			on_drawable(scene, hierarchy_transforms[m.transform], name);
 		}
 
 	}
@@ -271,8 +395,8 @@ void Scene::load(std::string const &filename,
 			std::cout << "Ignoring non-perspective camera (" + std::string(c.type, 4) + ") stored in file." << std::endl;
 			continue;
 		}
-		cameras.emplace_back(hierarchy_transforms[c.transform]);
-		Camera *camera = &cameras.back();
+		scene.cameras.emplace_back(hierarchy_transforms[c.transform]);
+		Scene::Camera *camera = &scene.cameras.back();
 		camera->fovy = c.data / 180.0f * 3.1415926f; //FOV is stored in degrees; convert to radians.
 		camera->near = c.clip_near;
 		//N.b. far plane is ignored because cameras use infinite perspective matrices.
@@ -294,17 +418,31 @@ void Scene::load(std::string const &filename,
 			std::cout << "Ignoring unrecognized lamp type (" + std::string(&l.type, 1) + ") stored in file." << std::endl;
 			continue;
 		}
-		lights.emplace_back(hierarchy_transforms[l.transform]);
-		Light *light = &lights.back();
-		light->type = static_cast<Light::Type>(l.type);
+		scene.lights.emplace_back(hierarchy_transforms[l.transform]);
+		Scene::Light *light = &scene.lights.back();
+		light->type = static_cast<Scene::Light::Type>(l.type);
 		light->energy = glm::vec3(l.color) / 255.0f * l.energy;
 		light->spot_fov = l.fov / 180.0f * 3.1415926f; //FOV is stored in degrees; convert to radians.
 	}
 
+	//index transforms by name (using the cooked index if there is one and nothing was loaded before):
+	bool first_load = scene.indexed_transforms.empty();
+	scene.indexed_transforms.insert(scene.indexed_transforms.end(), hierarchy_transforms.begin(), hierarchy_transforms.end());
+	if (cooked_index && first_load) {
+		scene.name_index = cooked_index;
+	} else {
+		std::vector< std::string > transform_names;
+		transform_names.reserve(scene.indexed_transforms.size());
+		for (Scene::Transform const *t : scene.indexed_transforms) {
+			transform_names.emplace_back(t->name);
+		}
+		scene.name_index = std::make_shared< NameIndex >(transform_names);
+	}
+
 	//load any extra that a subclass wants:
-	load_extra(file, names, hierarchy_transforms);
+	scene.load_extra(&at, file.end(), names, hierarchy_transforms);
 
-	if (file.peek() != EOF) {
+	if (at != file.end()) {
 		std::cerr << "WARNING: trailing data in scene file '" << filename << "'" << std::endl;
 	}
 
@@ -312,10 +450,29 @@ void Scene::load(std::string const &filename,
 
 }
 
+void Scene::load(std::string const &filename,
+	std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable,
+	AssetFile::Source source) {
+	load_scene(*this, filename, on_drawable, nullptr, nullptr, source);
+}
+
+void Scene::load(std::string const &filename, MeshBuffer const &meshes,
+	std::function< void(Scene &, Transform *, Mesh const &) > const &on_mesh,
+	AssetFile::Source source) {
+	assert(on_mesh);
+	load_scene(*this, filename, nullptr, &meshes, on_mesh, source);
+}
+
 //-------------------------
 
-Scene::Scene(std::string const &filename, std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
-	load(filename, on_drawable);
+Scene::Scene(std::string const &filename, std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable,
+	AssetFile::Source source) {
+	load(filename, on_drawable, source);
+}
+
+Scene::Scene(std::string const &filename, MeshBuffer const &meshes, std::function< void(Scene &, Transform *, Mesh const &) > const &on_mesh,
+	AssetFile::Source source) {
+	load(filename, meshes, on_mesh, source);
 }
 
 Scene::Scene(Scene const &other) {
@@ -374,4 +531,117 @@ void Scene::set(Scene const &other, std::unordered_map< Transform const *, Trans
 	for (auto &l : lights) {
 		l.transform = transform_to_transform.at(l.transform);
 	}
+
+	//share other's name index, updating transform pointers:
+	name_index = other.name_index;
+	indexed_transforms.clear();
+	indexed_transforms.reserve(other.indexed_transforms.size());
+	for (Transform *t : other.indexed_transforms) {
+		indexed_transforms.emplace_back(transform_to_transform.at(t));
+	}
+}
+
+void Scene::merge_reloaded(Scene const &before, Scene const &after) {
+	//transforms by name, in order (so that the n'th transform named X matches the n'th transform named X):
+	std::unordered_map< std::string, std::vector< Transform * > > live_by_name;
+	for (auto &t : transforms) {
+		live_by_name[t.name].emplace_back(&t);
+	}
+	std::unordered_map< std::string, std::vector< Transform const * > > before_by_name;
+	for (auto const &t : before.transforms) {
+		before_by_name[t.name].emplace_back(&t);
+	}
+
+	std::unordered_map< Transform const *, Transform * > after_to_live;
+	after_to_live.insert(std::make_pair(nullptr, nullptr));
+	std::unordered_map< std::string, size_t > seen;
+	for (auto const &t : after.transforms) {
+		size_t index = seen[t.name]++;
+
+		Transform *live = nullptr;
+		auto f = live_by_name.find(t.name);
+		if (f != live_by_name.end() && index < f->second.size()) live = f->second[index];
+
+		Transform const *old = nullptr;
+		auto b = before_by_name.find(t.name);
+		if (b != before_by_name.end() && index < b->second.size()) old = b->second[index];
+
+		if (!live) {
+			transforms.emplace_back();
+			live = &transforms.back();
+			live->name = t.name;
+			old = nullptr; //(so the values below get copied)
+		}
+		//keep values the game may have changed, unless the file changed them too:
+		if (!old || old->position != t.position || old->rotation != t.rotation || old->scale != t.scale) {
+			live->position = t.position;
+			live->rotation = t.rotation;
+			live->scale = t.scale;
+		}
+
+		after_to_live.insert(std::make_pair(&t, live));
+	}
+
+	for (auto const &t : after.transforms) {
+		after_to_live.at(&t)->parent = after_to_live.at(t.parent);
+	}
+
+	//drawables only hold pipeline data, so they are simply replaced:
+	drawables.clear();
+	for (auto const &d : after.drawables) {
+		drawables.emplace_back(d);
+		drawables.back().transform = after_to_live.at(d.transform);
+	}
+
+	//cameras and lights are updated in place when their transform already had one:
+	for (auto const &c : after.cameras) {
+		Transform *transform = after_to_live.at(c.transform);
+		auto f = std::find_if(cameras.begin(), cameras.end(), [&](Camera const &live) { return live.transform == transform; });
+		if (f == cameras.end()) {
+			cameras.emplace_back(c);
+			cameras.back().transform = transform;
+		} else {
+			f->fovy = c.fovy;
+			f->near = c.near;
+			//(aspect is usually set by the game to match the window, so it is left alone)
+		}
+	}
+
+	for (auto const &l : after.lights) {
+		Transform *transform = after_to_live.at(l.transform);
+		auto f = std::find_if(lights.begin(), lights.end(), [&](Light const &live) { return live.transform == transform; });
+		if (f == lights.end()) {
+			lights.emplace_back(l);
+			lights.back().transform = transform;
+		} else {
+			f->type = l.type;
+			f->energy = l.energy;
+			f->spot_fov = l.spot_fov;
+		}
+	}
+
+	//names now refer to the reloaded file's transforms:
+	name_index = after.name_index;
+	indexed_transforms.clear();
+	for (Transform *t : after.indexed_transforms) {
+		indexed_transforms.emplace_back(after_to_live.at(t));
+	}
+}
+
+Scene::Transform *Scene::find(NameKey const &name) const {
+	if (!name_index) return nullptr;
+	NameIndex::Items items = name_index->find(name);
+	if (items.empty()) return nullptr;
+	return indexed_transforms[*items.begin()];
+}
+
+std::vector< Scene::Transform * > Scene::find_prefix(std::string const &prefix) const {
+	std::vector< Transform * > found;
+	if (!name_index) return found;
+	NameIndex::Items items = name_index->find_prefix(prefix);
+	found.reserve(items.size());
+	for (uint32_t item : items) {
+		found.emplace_back(indexed_transforms[item]);
+	}
+	return found;
 }
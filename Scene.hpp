@@ -8,9 +8,17 @@
  *  - Camera information (via "Camera")
  *  - Light information (via "Light")
  *
+ * Transforms loaded from files can be found by name (or name prefix) through a
+ *  NameIndex; scene files cooked by the 'cook-scene' tool store a prebuilt index
+ *  and the MeshBuffer index of each mesh, so loading does no name lookups.
+ *
  */
 
+#include "AssetArchive.hpp"
 #include "GL.hpp"
+#include "read_write_chunk.hpp"
+#include "NameIndex.hpp"
+#include "UniformBlocks.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
@@ -22,6 +30,9 @@
 #include <vector>
 #include <unordered_map>
 
+struct Mesh;
+struct MeshBuffer;
+
 struct Scene {
 	struct Transform {
 		//Transform names are useful for debugging and looking up locations in a loaded scene:
@@ -65,19 +76,35 @@ struct Scene {
 			GLuint start = 0; //first vertex to draw; passed to glDrawArrays
 			GLuint count = 0; //number of vertices to draw; passed to glDrawArrays
 
+			//indexed drawing (used when index_type is non-zero):
+			// start and count are then in indices, and the vao must have an element buffer bound
+			GLenum index_type = 0; //GL_UNSIGNED_SHORT or GL_UNSIGNED_INT; passed to glDrawElementsBaseVertex
+			GLint base_vertex = 0; //added to each index; passed to glDrawElementsBaseVertex
+
+			//position dequantization (copy from Mesh::position_scale/offset for MeshBuffer vertices):
+			// folded into OBJECT_TO_CLIP and OBJECT_TO_LIGHT (but not NORMAL_TO_LIGHT) by Scene::draw
+			glm::vec3 position_scale = glm::vec3(1.0f);
+			glm::vec3 position_offset = glm::vec3(0.0f);
+
 			//uniforms:
-			GLuint OBJECT_TO_CLIP_mat4 = -1U; //uniform location for object to clip space matrix
-			GLuint OBJECT_TO_LIGHT_mat4x3 = -1U; //uniform location for object to light space (== world space) matrix
-			GLuint NORMAL_TO_LIGHT_mat3 = -1U; //uniform location for normal to light space (== world space) matrix
+			//OBJECT_TO_CLIP, OBJECT_TO_LIGHT, and NORMAL_TO_LIGHT are supplied through the 'Object' uniform block
+			// (see UniformBlocks.hpp), so programs should call bind_scene_blocks() after compiling.
 
 			std::function< void() > set_uniforms; //(optional) function to set any other useful uniforms
 
 			//texture objects to bind for the first TextureCount textures:
+			// (Scene::draw only rebinds textures that differ from the previous drawable's; units left at 0 keep what was bound)
 			enum : uint32_t { TextureCount = 4 };
 			struct TextureInfo {
 				GLuint texture = 0;
 				GLenum target = GL_TEXTURE_2D;
 			} textures[TextureCount];
+
+			//region of an atlas texture to map TexCoord into (see TextureAtlas.hpp; supplied through the 'Object' block):
+			// so drawables whose images share an atlas also share texture bindings
+			glm::vec2 texcoord_scale = glm::vec2(1.0f);
+			glm::vec2 texcoord_offset = glm::vec2(0.0f);
+			float atlas_layer = 0.0f;
 		} pipeline;
 	};
 
@@ -123,31 +150,71 @@ struct Scene {
 	std::list< Light > lights;
 
 	//The "draw" function provides a convenient way to pass all the things in a scene to OpenGL:
+	// (this also clusters 'lights' against the camera frustum and uploads them for lit shaders)
 	void draw(Camera const &camera) const;
 
 	//..sometimes, you want to draw with a custom projection matrix and/or light space:
+	// (NOTE: uses whatever lights were last uploaded with set_lights())
 	void draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light = glm::mat4x3(1.0f)) const;
 
 	//add transforms/objects/cameras from a scene file to this scene:
 	// the 'on_drawable' callback gives your code a chance to look up mesh data and make Drawables:
 	// throws on file format errors
+	// ('source' says where to read the file from; hot reloads use AssetFile::LooseOnly -- see AssetArchive.hpp)
 	void load(std::string const &filename,
-		std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable = nullptr
+		std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable = nullptr,
+		AssetFile::Source source = AssetFile::ArchiveOrLoose
+	);
+
+	//..or, with the meshes looked up in 'meshes' for you:
+	// (scenes cooked against the same mesh file use stored mesh indices; others look meshes up by name)
+	void load(std::string const &filename, MeshBuffer const &meshes,
+		std::function< void(Scene &, Transform *, Mesh const &) > const &on_mesh,
+		AssetFile::Source source = AssetFile::ArchiveOrLoose
 	);
 
 	//this function is called to read extra chunks from the scene file after the main chunks are read:
 	// this is useful if you, e.g., subclassing scene to represent a game level/area
-	virtual void load_extra(std::istream &from, std::vector< char > const &str0, std::vector< Transform * > const &xfh0) { }
+	// (the file is memory-mapped; read chunks in place with read_chunk(at, end, magic, &span), which advances *at)
+	virtual void load_extra(char const **at, char const *end, ChunkSpan< char > const &str0, std::vector< Transform * > const &xfh0) { }
 
 	//empty scene:
 	Scene() = default;
 
 	//load a scene:
-	Scene(std::string const &filename, std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable);
+	Scene(std::string const &filename, std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable,
+		AssetFile::Source source = AssetFile::ArchiveOrLoose);
+	Scene(std::string const &filename, MeshBuffer const &meshes, std::function< void(Scene &, Transform *, Mesh const &) > const &on_mesh,
+		AssetFile::Source source = AssetFile::ArchiveOrLoose);
 
 	//copy a scene (with proper pointer fixup):
 	Scene(Scene const &); //...as a constructor
 	Scene &operator=(Scene const &); //...as scene = scene
 	//... as a set() function that optionally returns the transform->transform mapping:
 	void set(Scene const &, std::unordered_map< Transform const *, Transform * > *transform_map = nullptr);
+
+	//apply the changes between two loads of a scene file ('before' and 'after') to this scene, which was copied from 'before':
+	// existing Transform, Camera, and Light objects are updated in place (so pointers to them stay valid);
+	// transforms are matched by name, and keep their current values unless the file changed them;
+	// anything new in 'after' is added; things no longer in the file are kept (but drawables are all replaced).
+	// (used for hot reloading; see HotReload.hpp)
+	void merge_reloaded(Scene const &before, Scene const &after);
+
+	//find transforms loaded from scene files by name:
+	// (transforms added by code aren't indexed, so these won't find them)
+	//..the first transform named 'name' (or nullptr if there isn't one):
+	// (a NameKey -- see NameMap.hpp -- so names used often can be hashed ahead of time)
+	Transform *find(NameKey const &name) const;
+	//..all transforms whose names start with 'prefix' (ordered by name), without visiting the others:
+	std::vector< Transform * > find_prefix(std::string const &prefix) const;
+
+	//name index items are positions in 'indexed_transforms' (the transforms loaded from files, in file order):
+	// (the index itself never changes after loading, so copies of a scene share it)
+	std::shared_ptr< NameIndex const > name_index;
+	std::vector< Transform * > indexed_transforms;
+
+	//scratch storage for draw(), kept from one call to the next so a steady-state frame doesn't allocate:
+	// (per scene, so drawing one scene never clobbers another's lists; not copied along with the scene)
+	mutable std::vector< Drawable const * > draw_scratch_to_draw;
+	mutable std::vector< ObjectTransform > draw_scratch_objects;
 };
@@ -0,0 +1,403 @@
+#include "Screenshot.hpp"
+
+#include "GL.hpp"
+#include "gl_errors.hpp"
+#include "load_save_png.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	//pixel buffers for readbacks in flight (each one's fence usually passes within a frame or two):
+	constexpr uint32_t SlotCount = 4;
+	//most images waiting for or being encoded at once (each holds a copy of the frame):
+	constexpr uint32_t MaxEncoding = 12;
+
+	struct Slot {
+		enum State {
+			Free,
+			Reading, //readback queued behind 'fence'
+			Copying, //mapped; the copier thread is copying the pixels out
+		} state = Free;
+		GLuint buffer = 0;
+		GLsizeiptr capacity = 0; //bytes of storage in 'buffer'
+		GLsync fence = 0;
+		glm::uvec2 size = glm::uvec2(0);
+		std::string filename;
+		bool announce = false; //print a message once saved (for single screenshots)
+		uint32_t started = 0; //frame the readback was started on
+		bool copied = false; //copier is done with the mapped memory (guarded by Screenshots::mutex)
+	};
+
+	//a mapped buffer for the copier thread to copy out of:
+	struct Copy {
+		uint32_t slot;
+		glm::u8vec4 const *pixels;
+		glm::uvec2 size;
+		std::string filename;
+		bool announce;
+	};
+
+	//a copied frame for an encoder thread to save:
+	struct Image {
+		std::vector< glm::u8vec4 > pixels;
+		glm::uvec2 size;
+		std::string filename;
+		bool announce;
+	};
+
+	struct Screenshots {
+		//---- main thread ----
+		Slot slots[SlotCount];
+		std::deque< std::string > singles; //requested by capture_screenshot()
+		std::string sequence_prefix;
+		uint32_t sequence_next = 0; //number of the next frame in the sequence
+		uint32_t sequence_left = 0; //frames left to capture (-1U = until stopped)
+		uint32_t frame = 0; //update_screenshots() calls so far
+		uint32_t captured = 0;
+		uint32_t skipped = 0;
+		uint32_t stall_frames = 0;
+		double stall_ms_total = 0.0;
+		float stall_ms_worst = 0.0f;
+		uint32_t readbacks = 0;
+		uint64_t readback_frames_total = 0;
+
+		//---- shared with the worker threads ----
+		//(copying out of mapped buffers gets its own thread, so buffers are never stuck waiting behind a slow encode)
+		std::mutex mutex;
+		std::condition_variable copy_cv; //copies added (or quitting)
+		std::condition_variable image_cv; //images added (or quitting)
+		std::condition_variable done_cv; //an image was saved
+		std::deque< Copy > copies;
+		std::deque< Image > images;
+		uint32_t encoding = 0; //frames waiting to be copied, copied, or saved
+		uint32_t saved = 0;
+		double copy_ms_total = 0.0;
+		double encode_ms_total = 0.0;
+		bool quit = false;
+		std::thread copier;
+		std::vector< std::thread > encoders;
+
+		~Screenshots() {
+			stop_workers();
+		}
+
+		void start_workers() {
+			if (copier.joinable()) return;
+			//(encoding is the slow part, so continuous capture wants a few threads -- but not all of them)
+			uint32_t threads = std::max(1U, std::min(4U, std::thread::hardware_concurrency() / 2));
+			quit = false;
+			copier = std::thread(&Screenshots::copy_work, this);
+			for (uint32_t t = 0; t < threads; ++t) {
+				encoders.emplace_back(&Screenshots::encode_work, this);
+			}
+		}
+
+		//finish the queued work and join the threads:
+		void stop_workers() {
+			{
+				std::unique_lock< std::mutex > lock(mutex);
+				quit = true;
+			}
+			copy_cv.notify_all();
+			if (copier.joinable()) copier.join();
+			image_cv.notify_all();
+			for (auto &encoder : encoders) encoder.join();
+			encoders.clear();
+		}
+
+		void copy_work() {
+			std::unique_lock< std::mutex > lock(mutex);
+			while (true) {
+				copy_cv.wait(lock, [this]() { return quit || !copies.empty(); });
+				if (copies.empty()) break; //(quitting, with nothing left to do)
+				Copy copy = std::move(copies.front());
+				copies.pop_front();
+				lock.unlock();
+
+				auto before = Clock::now();
+				//copy out of the mapped buffer, making every pixel opaque (the back buffer's alpha isn't meaningful):
+				Image image;
+				image.pixels.assign(copy.pixels, copy.pixels + size_t(copy.size.x) * copy.size.y);
+				for (auto &px : image.pixels) {
+					px.a = 0xff;
+				}
+				image.size = copy.size;
+				image.filename = std::move(copy.filename);
+				image.announce = copy.announce;
+				double ms = std::chrono::duration< double, std::milli >(Clock::now() - before).count();
+
+				lock.lock();
+				slots[copy.slot].copied = true; //(so the main thread can unmap the buffer)
+				copy_ms_total += ms;
+				images.emplace_back(std::move(image));
+				image_cv.notify_one();
+			}
+		}
+
+		void encode_work() {
+			std::unique_lock< std::mutex > lock(mutex);
+			while (true) {
+				image_cv.wait(lock, [this]() { return quit || !images.empty(); });
+				if (images.empty()) break; //(quitting, and the copier has finished)
+				Image image = std::move(images.front());
+				images.pop_front();
+				lock.unlock();
+
+				auto before = Clock::now();
+				save_png(image.filename, image.size, image.pixels.data(), LowerLeftOrigin, PNGSaveFast);
+				double ms = std::chrono::duration< double, std::milli >(Clock::now() - before).count();
+				if (image.announce) {
+					//(one string, so lines from different threads don't interleave)
+					std::cout << "Saved screenshot '" + image.filename + "' (" + std::to_string(ms) + "ms on a worker thread).\n";
+					std::cout.flush();
+				}
+
+				lock.lock();
+				saved += 1;
+				encode_ms_total += ms;
+				encoding -= 1;
+				done_cv.notify_all();
+			}
+		}
+
+		//map a slot whose fence has passed and hand it to the copier:
+		void map_slot(uint32_t s) {
+			Slot &slot = slots[s];
+			glDeleteSync(slot.fence);
+			slot.fence = 0;
+			readbacks += 1;
+			readback_frames_total += frame - slot.started;
+
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+			void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(slot.size.x) * slot.size.y * 4, GL_MAP_READ_BIT);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			if (!pixels) {
+				std::cerr << "WARNING: failed to map screenshot buffer; '" << slot.filename << "' not saved." << std::endl;
+				slot.state = Slot::Free;
+				return;
+			}
+
+			std::unique_lock< std::mutex > lock(mutex);
+			slot.copied = false;
+			slot.state = Slot::Copying;
+			Copy copy;
+			copy.slot = s;
+			copy.pixels = reinterpret_cast< glm::u8vec4 const * >(pixels);
+			copy.size = slot.size;
+			copy.filename = slot.filename;
+			copy.announce = slot.announce;
+			copies.emplace_back(std::move(copy));
+			encoding += 1;
+			copy_cv.notify_one();
+		}
+
+		//unmap a slot once the copier has copied the pixels out:
+		void unmap_slot(uint32_t s) {
+			Slot &slot = slots[s];
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			slot.state = Slot::Free;
+		}
+
+		//start reading the back buffer into a free slot (returns false if there isn't one, or encoding is too far behind):
+		bool start_readback(glm::uvec2 const &size, std::string const &filename, bool announce) {
+			uint32_t reading = 0;
+			for (auto const &slot : slots) {
+				if (slot.state == Slot::Reading) ++reading;
+			}
+			{
+				std::unique_lock< std::mutex > lock(mutex);
+				if (encoding + reading >= MaxEncoding) return false;
+			}
+			Slot *slot = nullptr;
+			for (auto &s : slots) {
+				if (s.state == Slot::Free) {
+					slot = &s;
+					break;
+				}
+			}
+			if (!slot) return false;
+
+			if (slot->buffer == 0) glGenBuffers(1, &slot->buffer);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+			GLsizeiptr bytes = GLsizeiptr(size.x) * size.y * 4;
+			if (slot->capacity < bytes) {
+				glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+				slot->capacity = bytes;
+			}
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+			glReadBuffer(GL_BACK);
+			//(with a pixel pack buffer bound, this queues a copy into it rather than waiting for the GPU)
+			glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+			slot->state = Slot::Reading;
+			slot->size = size;
+			slot->filename = filename;
+			slot->announce = announce;
+			slot->started = frame;
+			captured += 1;
+			return true;
+		}
+	} screenshots;
+}
+
+void capture_screenshot(std::string const &filename) {
+	screenshots.singles.emplace_back(filename);
+}
+
+void capture_screenshots(std::string const &prefix, uint32_t frames) {
+	screenshots.sequence_prefix = prefix;
+	screenshots.sequence_next = 0;
+	screenshots.sequence_left = (frames == 0 ? -1U : frames);
+}
+
+void stop_capturing_screenshots() {
+	screenshots.sequence_left = 0;
+}
+
+bool capturing_screenshots() {
+	return screenshots.sequence_left != 0;
+}
+
+void update_screenshots(glm::uvec2 const &drawable_size) {
+	Screenshots &s = screenshots;
+	s.frame += 1;
+
+	bool capture = (!s.singles.empty() || s.sequence_left != 0);
+	bool busy = false;
+	for (auto const &slot : s.slots) {
+		if (slot.state != Slot::Free) busy = true;
+	}
+	if (!capture && !busy) return;
+
+	auto before = Clock::now();
+	s.start_workers();
+
+	//collect readbacks whose fences have passed, and buffers the workers are done with:
+	for (uint32_t i = 0; i < SlotCount; ++i) {
+		Slot &slot = s.slots[i];
+		if (slot.state == Slot::Reading) {
+			GLenum status = glClientWaitSync(slot.fence, 0, 0); //(doesn't wait)
+			if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+				s.map_slot(i);
+			} else if (status == GL_WAIT_FAILED) {
+				std::cerr << "WARNING: screenshot fence failed; '" << slot.filename << "' not saved." << std::endl;
+				glDeleteSync(slot.fence);
+				slot.fence = 0;
+				slot.state = Slot::Free;
+			}
+		} else if (slot.state == Slot::Copying) {
+			bool copied;
+			{
+				std::unique_lock< std::mutex > lock(s.mutex);
+				copied = slot.copied;
+			}
+			if (copied) s.unmap_slot(i);
+		}
+	}
+
+	//start reading back this frame:
+	if (capture && drawable_size.x > 0 && drawable_size.y > 0) {
+		if (!s.singles.empty()) {
+			//(single screenshots wait for a slot rather than being skipped)
+			if (s.start_readback(drawable_size, s.singles.front(), true)) s.singles.pop_front();
+		} else {
+			char number[16];
+			std::snprintf(number, sizeof(number), "-%04u.png", s.sequence_next);
+			if (s.start_readback(drawable_size, s.sequence_prefix + number, false)) {
+				s.sequence_next += 1;
+			} else {
+				s.skipped += 1;
+			}
+			if (s.sequence_left != -1U) s.sequence_left -= 1;
+			if (s.sequence_left == 0) {
+				std::cout << "Captured " << s.sequence_next << " frames to '" << s.sequence_prefix << "-*.png'." << std::endl;
+			}
+		}
+	}
+
+	GL_ERRORS();
+	float ms = float(std::chrono::duration< double, std::milli >(Clock::now() - before).count());
+	s.stall_frames += 1;
+	s.stall_ms_total += ms;
+	s.stall_ms_worst = std::max(s.stall_ms_worst, ms);
+}
+
+void finish_screenshots() {
+	Screenshots &s = screenshots;
+	s.singles.clear();
+	if (s.sequence_left != 0) {
+		std::cout << "Captured " << s.sequence_next << " frames to '" << s.sequence_prefix << "-*.png'." << std::endl;
+		s.sequence_left = 0;
+	}
+
+	//wait for readbacks still in flight:
+	for (uint32_t i = 0; i < SlotCount; ++i) {
+		Slot &slot = s.slots[i];
+		if (slot.state != Slot::Reading) continue;
+		GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000); //(up to a second)
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+			s.map_slot(i);
+		} else {
+			glDeleteSync(slot.fence);
+			slot.fence = 0;
+			slot.state = Slot::Free;
+		}
+	}
+
+	//...and the encodes:
+	{
+		std::unique_lock< std::mutex > lock(s.mutex);
+		s.done_cv.wait(lock, [&s]() { return s.encoding == 0; });
+	}
+	for (uint32_t i = 0; i < SlotCount; ++i) {
+		Slot &slot = s.slots[i];
+		if (slot.state == Slot::Copying) s.unmap_slot(i);
+		if (slot.buffer != 0) {
+			glDeleteBuffers(1, &slot.buffer);
+			slot.buffer = 0;
+			slot.capacity = 0;
+		}
+	}
+	GL_ERRORS();
+
+	ScreenshotStats stats = get_screenshot_stats();
+	s.stop_workers();
+	if (stats.captured > 0) {
+		std::cout << "Screenshots: " << stats.saved << " saved, " << stats.skipped << " frames skipped; "
+			<< "the main thread spent " << stats.stall_ms_average << "ms on average, " << stats.stall_ms_worst << "ms at worst per frame; "
+			<< "readbacks were ready after " << stats.readback_frames_average << " frames; "
+			<< "copying took " << stats.copy_ms_average << "ms and encoding " << stats.encode_ms_average << "ms per image (on " << stats.encode_threads << " encoder threads)." << std::endl;
+	}
+}
+
+ScreenshotStats get_screenshot_stats() {
+	Screenshots &s = screenshots;
+	ScreenshotStats stats;
+	stats.captured = s.captured;
+	stats.skipped = s.skipped;
+	if (s.stall_frames) stats.stall_ms_average = float(s.stall_ms_total / s.stall_frames);
+	stats.stall_ms_worst = s.stall_ms_worst;
+	if (s.readbacks) stats.readback_frames_average = float(double(s.readback_frames_total) / s.readbacks);
+	stats.encode_threads = uint32_t(s.encoders.size());
+	std::unique_lock< std::mutex > lock(s.mutex);
+	stats.saved = s.saved;
+	if (s.saved) {
+		stats.copy_ms_average = float(s.copy_ms_total / s.saved);
+		stats.encode_ms_average = float(s.encode_ms_total / s.saved);
+	}
+	return stats;
+}
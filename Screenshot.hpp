@@ -0,0 +1,57 @@
+#pragma once
+
+/*
+ * Screenshots (and frame sequences, for video) without hitching the frame:
+ *
+ *  - update_screenshots(), called after drawing, starts an asynchronous copy of
+ *    the back buffer into a pixel buffer object and puts a fence after it;
+ *  - on later frames, once the fence has passed, it maps the buffer and hands
+ *    it to a copier thread, which copies the pixels out (making them opaque)
+ *    so the main thread can unmap the buffer, and passes them on to one of a
+ *    few encoder threads to write the PNG.
+ *
+ * So the main thread never waits on the GPU or on PNG encoding. If readbacks
+ *  or encoding fall behind (e.g., continuously capturing a big window), frames
+ *  are skipped rather than stalling, and counted in ScreenshotStats.
+ *
+ * e.g., in the main loop:
+ *   Mode::current->draw(drawable_size);
+ *   update_screenshots(drawable_size);
+ *   SDL_GL_SwapWindow(window);
+ *
+ */
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+
+//save the next frame drawn as 'filename':
+void capture_screenshot(std::string const &filename);
+
+//save the next 'frames' frames drawn as 'prefix'-0000.png, 'prefix'-0001.png, ...
+// (frames = 0 keeps capturing every frame until stop_capturing_screenshots())
+void capture_screenshots(std::string const &prefix, uint32_t frames = 0);
+void stop_capturing_screenshots();
+bool capturing_screenshots(); //is a sequence being captured?
+
+//start readbacks of the frame just drawn and collect finished ones:
+// (call once per frame, after drawing and before swapping; uses OpenGL)
+void update_screenshots(glm::uvec2 const &drawable_size);
+
+//wait for pending readbacks and encodes, free the buffers, and print ScreenshotStats:
+// (call before destroying the OpenGL context)
+void finish_screenshots();
+
+struct ScreenshotStats {
+	uint32_t captured = 0; //frames read back
+	uint32_t saved = 0; //...and written to disk
+	uint32_t skipped = 0; //frames not captured because readbacks or encoding were behind
+	float stall_ms_average = 0.0f; //main-thread time in update_screenshots, per frame that did any work
+	float stall_ms_worst = 0.0f;
+	float readback_frames_average = 0.0f; //frames from starting a readback until its fence had passed
+	float copy_ms_average = 0.0f; //copier thread time per image (out of the mapped buffer)
+	float encode_ms_average = 0.0f; //encoder thread time per image (PNG)
+	uint32_t encode_threads = 0;
+};
+ScreenshotStats get_screenshot_stats();
@@ -152,51 +152,58 @@ void ShowMeshesMode::draw(glm::uvec2 const &drawable_size) {
 }
 
 void ShowMeshesMode::select_prev_mesh() {
-	auto f = buffer.meshes.find(current_mesh_name);
-	if (f != buffer.meshes.end()) --f;
-	if (f == buffer.meshes.end()) f = buffer.meshes.begin();
+	//(meshes are in file order; stops at the first mesh)
+	uint32_t id = buffer.meshes.find_id(current_mesh_name);
+	if (id == -1U) id = 0;
+	else if (id > 0) id -= 1;
+	auto f = (id < buffer.meshes.size() ? buffer.meshes.begin() + id : buffer.meshes.end());
 
 	if (f != buffer.meshes.end()) {
-		current_mesh_name = f->first;
-		scene_drawable->pipeline.type = f->second.type;
-		scene_drawable->pipeline.start = f->second.start;
-		scene_drawable->pipeline.count = f->second.count;
-		current_mesh_min = f->second.min;
-		current_mesh_max = f->second.max;
+		current_mesh_name = std::string(buffer.meshes.name(*f));
+		scene_drawable->pipeline.type = f->value.type;
+		scene_drawable->pipeline.start = f->value.start;
+		scene_drawable->pipeline.count = f->value.count;
+		scene_drawable->pipeline.index_type = f->value.index_type;
+		scene_drawable->pipeline.base_vertex = f->value.base_vertex;
+		scene_drawable->pipeline.position_scale = f->value.position_scale;
+		scene_drawable->pipeline.position_offset = f->value.position_offset;
+		current_mesh_min = f->value.min;
+		current_mesh_max = f->value.max;
 	} else {
 		current_mesh_name = "";
 		scene_drawable->pipeline.type = GL_TRIANGLES;
 		scene_drawable->pipeline.start = 0;
 		scene_drawable->pipeline.count = 0;
+		scene_drawable->pipeline.index_type = 0;
 		current_mesh_min = glm::vec3(0.0f);
 		current_mesh_max = glm::vec3(0.0f);
 	}
 }
 
 void ShowMeshesMode::select_next_mesh() {
-	auto f = buffer.meshes.find(current_mesh_name);
-	if (f != buffer.meshes.end()) ++f;
-	if (f == buffer.meshes.end()) {
-		auto temp = buffer.meshes.rbegin();
-		if (temp != buffer.meshes.rend()) {
-			++temp;
-			f = temp.base();
-			assert(f != buffer.meshes.end());
-		}
-	}
+	//(meshes are in file order; stops at the last mesh)
+	uint32_t id = buffer.meshes.find_id(current_mesh_name);
+	if (id == -1U || id + 1 >= buffer.meshes.size()) id = uint32_t(buffer.meshes.size()) - 1;
+	else id += 1;
+	auto f = (id < buffer.meshes.size() ? buffer.meshes.begin() + id : buffer.meshes.end());
 
 	if (f != buffer.meshes.end()) {
-		current_mesh_name = f->first;
-		scene_drawable->pipeline.type = f->second.type;
-		scene_drawable->pipeline.start = f->second.start;
-		scene_drawable->pipeline.count = f->second.count;
-		current_mesh_min = f->second.min;
-		current_mesh_max = f->second.max;
+		current_mesh_name = std::string(buffer.meshes.name(*f));
+		scene_drawable->pipeline.type = f->value.type;
+		scene_drawable->pipeline.start = f->value.start;
+		scene_drawable->pipeline.count = f->value.count;
+		scene_drawable->pipeline.index_type = f->value.index_type;
+		scene_drawable->pipeline.base_vertex = f->value.base_vertex;
+		scene_drawable->pipeline.position_scale = f->value.position_scale;
+		scene_drawable->pipeline.position_offset = f->value.position_offset;
+		current_mesh_min = f->value.min;
+		current_mesh_max = f->value.max;
 	} else {
 		current_mesh_name = "";
 		scene_drawable->pipeline.type = GL_TRIANGLES;
 		scene_drawable->pipeline.start = 0;
 		scene_drawable->pipeline.count = 0;
+		scene_drawable->pipeline.index_type = 0;
 		current_mesh_min = glm::vec3(0.0f);
 		current_mesh_max = glm::vec3(0.0f);
 	}
@@ -2,18 +2,16 @@
 
 #include "gl_compile_program.hpp"
 #include "gl_errors.hpp"
+#include "UniformBlocks.hpp"
+#include "Mesh.hpp"
 
 Scene::Drawable::Pipeline show_scene_program_pipeline;
 
-Load< ShowSceneProgram > show_scene_program(LoadTagEarly, []() -> ShowSceneProgram * {
+Load< ShowSceneProgram > show_scene_program(LoadTagDefault, "show_scene_program", {}, []() -> ShowSceneProgram * {
 	auto *ret = new ShowSceneProgram();
 
 	show_scene_program_pipeline.program = ret->program;
 
-	show_scene_program_pipeline.OBJECT_TO_CLIP_mat4 = ret->OBJECT_TO_CLIP_mat4;
-	show_scene_program_pipeline.OBJECT_TO_LIGHT_mat4x3 = ret->OBJECT_TO_LIGHT_mat4x3;
-	show_scene_program_pipeline.NORMAL_TO_LIGHT_mat3 = ret->NORMAL_TO_LIGHT_mat3;
-
 	return ret;
 });
 
@@ -21,12 +19,11 @@ ShowSceneProgram::ShowSceneProgram() {
 	//Compile vertex and fragment shaders using the convenient 'gl_compile_program' helper function:
 	program = gl_compile_program(
 		//vertex shader:
-		"#version 330\n"
-		"uniform mat4 OBJECT_TO_CLIP;\n"
-		"uniform mat4x3 OBJECT_TO_LIGHT;\n"
-		"uniform mat3 NORMAL_TO_LIGHT;\n"
+		std::string("#version 330\n")
+		+ scene_blocks_glsl
+		+ octahedral_normal_glsl +
 		"in vec4 Position;\n"
-		"in vec3 Normal;\n"
+		"in vec2 Normal;\n"
 		"in vec4 Color;\n"
 		"in vec2 TexCoord;\n"
 		"out vec3 position;\n"
@@ -36,7 +33,7 @@ ShowSceneProgram::ShowSceneProgram() {
 		"void main() {\n"
 		"	gl_Position = OBJECT_TO_CLIP * Position;\n"
 		"	position = OBJECT_TO_LIGHT * Position;\n"
-		"	normal = NORMAL_TO_LIGHT * Normal;\n"
+		"	normal = NORMAL_TO_LIGHT * decode_normal(Normal);\n"
 		"	color = Color;\n"
 		"	texCoord = TexCoord;\n"
 		"}\n"
@@ -75,15 +72,14 @@ ShowSceneProgram::ShowSceneProgram() {
 
 	//look up the locations of vertex attributes:
 	Position_vec4 = glGetAttribLocation(program, "Position");
-	Normal_vec3 = glGetAttribLocation(program, "Normal");
+	Normal_vec2 = glGetAttribLocation(program, "Normal");
 	Color_vec4 = glGetAttribLocation(program, "Color");
 	TexCoord_vec2 = glGetAttribLocation(program, "TexCoord");
 
-	//look up the locations of uniforms:
-	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
-	OBJECT_TO_LIGHT_mat4x3 = glGetUniformLocation(program, "OBJECT_TO_LIGHT");
-	NORMAL_TO_LIGHT_mat3 = glGetUniformLocation(program, "NORMAL_TO_LIGHT");
+	//connect the shared Frame/Lights/Object uniform blocks:
+	bind_scene_blocks(program);
 
+	//look up the locations of uniforms:
 	INSPECT_MODE_int = glGetUniformLocation(program, "INSPECT_MODE");
 }
 
@@ -15,15 +15,14 @@ struct ShowSceneProgram {
 
 	//Attribute (per-vertex variable) locations:
 	GLuint Position_vec4 = -1U;
-	GLuint Normal_vec3 = -1U;
+	GLuint Normal_vec2 = -1U; //octahedral-encoded (see Mesh.hpp)
 	GLuint Color_vec4 = -1U;
 	GLuint TexCoord_vec2 = -1U;
 
-	//Uniform (per-invocation variable) locations:
-	GLuint OBJECT_TO_CLIP_mat4 = -1U;
-	GLuint OBJECT_TO_LIGHT_mat4x3 = -1U;
-	GLuint NORMAL_TO_LIGHT_mat3 = -1U;
+	//Uniform blocks (bound with bind_scene_blocks; see UniformBlocks.hpp):
+	//Object - OBJECT_TO_CLIP, OBJECT_TO_LIGHT, NORMAL_TO_LIGHT
 
+	//Uniform (per-invocation variable) locations:
 	GLuint INSPECT_MODE_int = -1U; //0: basic lighting; 1: position only; 2: normal only; 3: color only; 4: texcoord only
 
 	//Textures:
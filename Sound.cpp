@@ -1,35 +1,213 @@
 #include "Sound.hpp"
+#include "SoundMixer.hpp"
+#include "SoundStream.hpp"
+#include "SoundCodec.hpp"
+#include "SPSCQueue.hpp"
 #include "load_wav.hpp"
 #include "load_opus.hpp"
+#include "audio_cache.hpp"
 
 #include <SDL.h>
 
-#include <list>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <exception>
 #include <iostream>
 #include <algorithm>
+#include <thread>
 
 //local (to this file) data used by the audio system:
 namespace {
 
-	//handy constants:
-	constexpr uint32_t const AUDIO_RATE = 48000; //sampling rate
-	constexpr uint32_t const MIX_SAMPLES = 1024; //number of samples to mix per call of mix_audio callback; n.b. SDL requires this to be a power of two
-
 	//The audio device:
 	SDL_AudioDeviceID device = 0;
+	//...or offline mode (see Sound::init_offline):
+	bool offline = false;
+
+	//steady clock time in nanoseconds (used for the timing in Sound::Stats):
+	uint64_t now_ns() {
+		return uint64_t(std::chrono::duration_cast< std::chrono::nanoseconds >(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	//Commands are how the game thread changes what the mixer is doing:
+	struct Command {
+		enum Type : uint8_t {
+			Play, //start 'voice' playing data (or encoded)/size with volume, pan (or position/radius if is_3D)
+			SetVolume, SetPan, SetPosition, SetHalfVolumeRadius, Stop, //change 'voice' (if generation still matches)
+			StopAll,
+			SetMasterVolume, //uses volume
+			SetListener, //uses position, right
+			ReplaceData, //voices playing old_data (or old_encoded) switch to data (or encoded)/size
+			Seek, //move 'voice' to 'seek_to' (or, if streamed, to stream epoch 'epoch')
+			SetPriority, //uses priority
+			SetRate, //uses rate, ramp
+			SetVoiceLimit, //uses voice_limit
+		} type = Play;
+		bool loop = false;
+		bool is_3D = false;
+		uint32_t voice = -1U;
+		uint32_t generation = 0;
+		float ramp = 0.0f;
+		float volume = 1.0f;
+		float pan = 0.0f;
+		float half_volume_radius = 0.0f;
+		glm::vec3 position = glm::vec3(0.0f);
+		glm::vec3 right = glm::vec3(1.0f, 0.0f, 0.0f);
+		float const *data = nullptr;
+		uint8_t const *encoded = nullptr;
+		Sound::Sample::Storage storage = Sound::Sample::Float;
+		size_t size = 0;
+		float const *old_data = nullptr;
+		uint8_t const *old_encoded = nullptr;
+		Sound::SampleStream *stream = nullptr;
+		uint16_t epoch = 0;
+		uint64_t seek_to = 0; //in samples
+		int32_t priority = 0;
+		float rate = 1.0f;
+		uint32_t voice_limit = 0;
+		uint64_t sent_ns = 0; //when the command was pushed (for command_delay_ms_worst)
+	};
+
+	//game thread -> mixer:
+	SPSCQueue< Command, 1024 > commands;
+	//mixer -> game thread (voices that have finished and may be reused):
+	// (at most MaxVoices voices can be waiting to be reused, so this never fills)
+	SPSCQueue< uint32_t, Sound::MaxVoices > finished_voices;
+
+	//---- mixer (audio thread) state ----
+
+	Sound::Mixer mixer;
+
+	//timing, written by the mixer and read by Sound::get_stats():
+	std::atomic< uint32_t > callbacks{0};
+	std::atomic< uint64_t > callback_ns_total{0};
+	std::atomic< uint64_t > callback_ns_worst{0};
+	std::atomic< uint64_t > command_delay_ns_worst{0};
+	std::atomic< uint32_t > voices_playing{0};
+	std::atomic< uint32_t > voices_real{0};
+	std::atomic< uint32_t > stream_underruns{0};
+	std::atomic< uint64_t > commands_done{0}; //commands the mixer has applied
+
+	//---- game thread state ----
+
+	std::vector< uint32_t > free_voices; //voices the game may start playing
+	uint32_t voice_generation[Sound::MaxVoices] = {}; //bumped every time a voice is started
+	bool voice_busy[Sound::MaxVoices] = {}; //started and not yet reported finished
+	uint64_t commands_sent = 0;
+	uint64_t send_wait_ns_worst = 0;
+	uint32_t voices_dropped = 0;
+
+	//sample data swapped out by replace_sample_data, freed once the mixer has applied command 'after':
+	struct RetiredData {
+		uint64_t after;
+		std::vector< float > data;
+		std::vector< uint8_t > encoded;
+	};
+	std::vector< RetiredData > retired_data;
+
+	//applies commands queued for the mixer (defined below, with the audio callback):
+	void drain_commands(uint64_t now);
+
+	//send a command to the mixer (waiting for room if the queue is full):
+	void send(Command command) {
+		if (device == 0 && !offline) return;
+		command.sent_ns = now_ns();
+		if (!commands.push(command)) {
+			uint64_t before = command.sent_ns;
+			if (offline) {
+				//nothing else drains the queue in offline mode (and it would be drained before the next block anyway):
+				drain_commands(before);
+				commands.push(command);
+			} else {
+				//the mixer drains the queue every callback, so this only happens if the game sends
+				// more than a queue's worth of commands in one audio block:
+				do {
+					std::this_thread::yield();
+				} while (!commands.push(command));
+			}
+			send_wait_ns_worst = std::max(send_wait_ns_worst, now_ns() - before);
+		}
+		++commands_sent;
+	}
+
+	//pick up voices the mixer has finished with and free data it no longer uses:
+	void collect_finished() {
+		uint32_t v;
+		while (finished_voices.pop(&v)) {
+			assert(voice_busy[v]);
+			voice_busy[v] = false;
+			free_voices.emplace_back(v);
+		}
+		if (!retired_data.empty()) {
+			uint64_t done = commands_done.load(std::memory_order_acquire);
+			retired_data.erase(std::remove_if(retired_data.begin(), retired_data.end(), [done](RetiredData const &r) {
+				return r.after <= done;
+			}), retired_data.end());
+		}
+	}
+
+	//fill in the parts of a Play command that say what to play:
+	void set_sample(Command &command, Sound::Sample const &sample) {
+		command.storage = sample.storage;
+		if (sample.storage == Sound::Sample::Float) {
+			command.data = sample.data.data();
+			command.size = sample.data.size();
+		} else {
+			command.encoded = sample.encoded.data();
+			command.size = sample.encoded_samples;
+		}
+		command.stream = sample.stream.get();
+	}
+
+	//start a voice playing (returns a handle whether or not there was a voice for it):
+	std::shared_ptr< Sound::PlayingSample > start_voice(Command command) {
+		std::shared_ptr< Sound::PlayingSample > playing_sample = std::make_shared< Sound::PlayingSample >();
+		playing_sample->is_3D = command.is_3D;
+		playing_sample->loop = command.loop;
+		playing_sample->stream = command.stream;
+		if ((device == 0 && !offline) || (command.size == 0 && command.stream == nullptr)) return playing_sample;
+
+		collect_finished();
+		if (free_voices.empty()) {
+			++voices_dropped;
+			return playing_sample;
+		}
+		uint32_t v = free_voices.back();
+		free_voices.pop_back();
+		voice_busy[v] = true;
+		voice_generation[v] += 1;
+
+		playing_sample->voice = v;
+		playing_sample->generation = voice_generation[v];
+
+		if (command.stream) {
+			//a stream only has one read position, so it can only play on one voice:
+			Sound::SampleStream &stream = *command.stream;
+			if (stream.voice != -1U && voice_busy[stream.voice] && voice_generation[stream.voice] == stream.generation) {
+				Command stop;
+				stop.type = Command::Stop;
+				stop.voice = stream.voice;
+				stop.generation = stream.generation;
+				stop.ramp = 1.0f / 60.0f;
+				send(stop);
+			}
+			stream.voice = v;
+			stream.generation = voice_generation[v];
+			command.epoch = stream.restart(0, command.loop);
+		}
 
-	//list of all currently playing samples:
-	std::list< std::shared_ptr< Sound::PlayingSample > > playing_samples;
+		command.type = Command::Play;
+		command.voice = v;
+		command.generation = voice_generation[v];
+		send(command);
+		return playing_sample;
+	}
 
 }
 
 //public-facing data:
 
-//global volume control:
-Sound::Ramp< float > Sound::volume = Sound::Ramp< float >(1.0f);
-
 //global listener information:
 Sound::Listener Sound::listener;
 
@@ -38,22 +216,61 @@ void mix_audio(void *, Uint8 *buffer_, int len);
 
 //------------------------ public-facing --------------------------------
 
-Sound::Sample::Sample(std::string const &filename) {
-	if (filename.size() >= 4 && filename.substr(filename.size()-4) == ".wav") {
-		load_wav(filename, &data);
-	} else if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".opus") {
-		load_opus(filename, &data);
+Sound::Sample::Sample(std::string const &filename, Mode mode, Storage storage_) {
+	if (mode == Streamed) {
+		if (!(filename.size() >= 5 && filename.substr(filename.size()-5) == ".opus")) {
+			throw std::runtime_error("Sample '" + filename + "' doesn't end in \".opus\" -- only opus files can be streamed.");
+		}
+		if (storage_ != Float) {
+			throw std::runtime_error("Sample '" + filename + "' is Streamed, so it can't also use compressed storage.");
+		}
+		stream = std::make_shared< SampleStream >(filename);
 	} else {
-		throw std::runtime_error("Sample '" + filename + "' doesn't end in either \".png\" or \".opus\" -- unsure how to load.");
+		AudioDecoder decode = nullptr;
+		if (filename.size() >= 4 && filename.substr(filename.size()-4) == ".wav") {
+			decode = load_wav;
+		} else if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".opus") {
+			decode = load_opus;
+		} else {
+			throw std::runtime_error("Sample '" + filename + "' doesn't end in either \".wav\" or \".opus\" -- unsure how to load.");
+		}
+		AudioCacheLoad load = load_audio_cached(filename, decode, &data);
+		//(one string, so lines from samples loading on different threads don't interleave)
+		std::string message = "Sample '" + filename + "': ";
+		if (load.cached) {
+			message += "from cache in " + std::to_string(load.load_ms) + "ms (saved " + std::to_string(load.decode_ms - load.load_ms) + "ms of decoding).";
+		} else {
+			message += "decoded in " + std::to_string(load.decode_ms) + "ms.";
+		}
+		if (storage_ != Float) {
+			storage = storage_;
+			encode_samples(storage, data.data(), data.size(), &encoded);
+			encoded_samples = data.size();
+			message += " Stored as " + std::string(storage_name(storage)) + " (" + std::to_string(encoded.size() / 1024) + "kB instead of " + std::to_string(data.size() * sizeof(float) / 1024) + "kB).";
+			data = std::vector< float >();
+		}
+		std::cout << message + "\n";
+		std::cout.flush();
 	}
 }
 
-Sound::Sample::Sample(std::vector< float > const &data_) : data(data_) {
+Sound::Sample::Sample(std::vector< float > const &data_, Storage storage_) : storage(storage_) {
+	if (storage == Float) {
+		data = data_;
+	} else {
+		encode_samples(storage, data_.data(), data_.size(), &encoded);
+		encoded_samples = data_.size();
+	}
 }
 
 
 
 void Sound::init() {
+	free_voices.clear();
+	for (uint32_t v = MaxVoices - 1; v < MaxVoices; --v) {
+		free_voices.emplace_back(v);
+	}
+
 	if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
 		std::cerr << "Failed to initialize SDL audio subsytem:\n" << SDL_GetError() << std::endl;
 		std::cerr << "  (Will continue without audio.)\n" << std::endl;
@@ -63,10 +280,10 @@ void Sound::init() {
 	//Based on the example on https://wiki.libsdl.org/SDL_OpenAudioDevice
 	SDL_AudioSpec want, have;
 	SDL_zero(want);
-	want.freq = AUDIO_RATE;
+	want.freq = Sound::Rate;
 	want.format = AUDIO_F32SYS;
 	want.channels = 2;
-	want.samples = MIX_SAMPLES;
+	want.samples = Sound::BlockSamples; //n.b. SDL requires this to be a power of two
 	want.callback = mix_audio;
 
 	device = SDL_OpenAudioDevice(nullptr, 0, &want, &have, 0);
@@ -81,358 +298,421 @@ void Sound::init() {
 }
 
 
-void Sound::shutdown() {
-	if (device != 0) {
-		//stop audio playback:
-		SDL_PauseAudioDevice(device, 1);
-		SDL_CloseAudioDevice(device);
-		device = 0;
+void Sound::init_offline() {
+	free_voices.clear();
+	for (uint32_t v = MaxVoices - 1; v < MaxVoices; --v) {
+		free_voices.emplace_back(v);
 	}
+	offline = true;
 }
 
+void Sound::render(uint32_t blocks, std::vector< float > *out) {
+	assert(offline && "Sound::render is only for offline mode (see Sound::init_offline).");
+	assert(out);
+	size_t at = out->size();
+	out->resize(at + size_t(blocks) * BlockSamples * 2);
+	for (uint32_t b = 0; b < blocks; ++b) {
+		mix_audio(nullptr, reinterpret_cast< Uint8 * >(out->data() + at + size_t(b) * BlockSamples * 2), BlockSamples * 2 * sizeof(float));
+	}
+	collect_finished();
+}
 
-void Sound::lock() {
-	if (device) SDL_LockAudioDevice(device);
+void Sound::shutdown() {
+	if (device != 0 || offline) {
+		if (device != 0) {
+			//stop audio playback:
+			SDL_PauseAudioDevice(device, 1);
+			SDL_CloseAudioDevice(device);
+			device = 0;
+		}
+		offline = false;
+
+		Stats stats = get_stats();
+		std::cout << "Audio: " << stats.callbacks << " callbacks took " << stats.callback_ms_average << "ms on average, "
+			<< stats.callback_ms_worst << "ms at worst (budget " << stats.callback_ms_budget << "ms); "
+			<< "commands waited at most " << stats.command_delay_ms_worst << "ms in the queue, "
+			<< "and the game at most " << stats.send_wait_ms_worst << "ms for room; "
+			<< stats.voices_dropped << " plays dropped for lack of voices, "
+			<< stats.stream_underruns << " stream underruns." << std::endl;
+	}
+	retired_data.clear();
 }
 
-void Sound::unlock() {
-	if (device) SDL_UnlockAudioDevice(device);
+Sound::Stats Sound::get_stats() {
+	collect_finished();
+
+	Stats stats;
+	stats.callbacks = callbacks.load(std::memory_order_relaxed);
+	if (stats.callbacks) {
+		stats.callback_ms_average = float(double(callback_ns_total.load(std::memory_order_relaxed)) / stats.callbacks * 1.0e-6);
+	}
+	stats.callback_ms_worst = float(callback_ns_worst.load(std::memory_order_relaxed) * 1.0e-6);
+	stats.callback_ms_budget = float(BlockSamples) / float(Rate) * 1000.0f;
+	stats.command_delay_ms_worst = float(command_delay_ns_worst.load(std::memory_order_relaxed) * 1.0e-6);
+	stats.send_wait_ms_worst = float(send_wait_ns_worst * 1.0e-6);
+	stats.voices_playing = voices_playing.load(std::memory_order_relaxed);
+	stats.voices_real = std::min(stats.voices_playing, voices_real.load(std::memory_order_relaxed));
+	stats.voices_virtual = stats.voices_playing - stats.voices_real;
+	stats.voices_dropped = voices_dropped;
+	stats.stream_underruns = stream_underruns.load(std::memory_order_relaxed);
+	return stats;
 }
 
 std::shared_ptr< Sound::PlayingSample > Sound::play(Sample const &sample, float play_volume, float pan) {
-	std::shared_ptr< Sound::PlayingSample > playing_sample = std::make_shared< Sound::PlayingSample >(sample, play_volume, pan, false);
-	lock();
-	playing_samples.emplace_back(playing_sample);
-	unlock();
-	return playing_sample;
+	Command command;
+	set_sample(command, sample);
+	command.volume = play_volume;
+	command.pan = pan;
+	return start_voice(command);
 }
 
 std::shared_ptr< Sound::PlayingSample > Sound::play_3D(Sample const &sample, float play_volume, glm::vec3 const &position, float half_volume_radius) {
-	std::shared_ptr< Sound::PlayingSample > playing_sample = std::make_shared< Sound::PlayingSample >(sample, play_volume, position, half_volume_radius, false);
-	lock();
-	playing_samples.emplace_back(playing_sample);
-	unlock();
-	return playing_sample;
+	Command command;
+	command.is_3D = true;
+	set_sample(command, sample);
+	command.volume = play_volume;
+	command.position = position;
+	command.half_volume_radius = half_volume_radius;
+	return start_voice(command);
 }
 
 std::shared_ptr< Sound::PlayingSample > Sound::loop(Sample const &sample, float play_volume, float pan) {
-	std::shared_ptr< Sound::PlayingSample > playing_sample = std::make_shared< Sound::PlayingSample >(sample, play_volume, pan, true);
-	lock();
-	playing_samples.emplace_back(playing_sample);
-	unlock();
-	return playing_sample;
+	Command command;
+	command.loop = true;
+	set_sample(command, sample);
+	command.volume = play_volume;
+	command.pan = pan;
+	return start_voice(command);
 }
 
 
 
 std::shared_ptr< Sound::PlayingSample > Sound::loop_3D(Sample const &sample, float play_volume, glm::vec3 const &position, float half_volume_radius) {
-	std::shared_ptr< Sound::PlayingSample > playing_sample = std::make_shared< Sound::PlayingSample >(sample, play_volume, position, half_volume_radius, true);
-	lock();
-	playing_samples.emplace_back(playing_sample);
-	unlock();
-	return playing_sample;
+	Command command;
+	command.loop = true;
+	command.is_3D = true;
+	set_sample(command, sample);
+	command.volume = play_volume;
+	command.position = position;
+	command.half_volume_radius = half_volume_radius;
+	return start_voice(command);
 }
 
 
 void Sound::stop_all_samples() {
-	lock();
-	for (auto &s : playing_samples) {
-		s->stop();
+	Command command;
+	command.type = Command::StopAll;
+	command.ramp = 1.0f / 60.0f;
+	send(command);
+}
+
+void Sound::replace_sample_data(Sample &sample, std::vector< float > &&data) {
+	Command command;
+	command.type = Command::ReplaceData;
+	command.size = data.size();
+	std::vector< uint8_t > encoded;
+	if (sample.storage == Sample::Float) {
+		command.old_data = sample.data.data();
+		command.data = data.data();
+		sample.data.swap(data);
+	} else {
+		encode_samples(sample.storage, data.data(), data.size(), &encoded);
+		command.old_encoded = sample.encoded.data();
+		command.encoded = encoded.data();
+		sample.encoded.swap(encoded);
+		sample.encoded_samples = data.size();
+		data = std::vector< float >(); //(only the encoded data needs to wait for the mixer)
 	}
-	unlock();
+	if ((device == 0 && !offline) || (command.old_data == nullptr && command.old_encoded == nullptr)) return;
+	send(command);
+
+	//the mixer may be reading the old data until it applies the command:
+	retired_data.emplace_back();
+	retired_data.back().after = commands_sent;
+	retired_data.back().data.swap(data);
+	retired_data.back().encoded.swap(encoded);
+	collect_finished();
+}
+
+void Sound::set_voice_limit(uint32_t limit) {
+	Command command;
+	command.type = Command::SetVoiceLimit;
+	command.voice_limit = limit;
+	send(command);
 }
 
 void Sound::set_volume(float new_volume, float ramp) {
-	lock();
-	volume.set(new_volume, ramp);
-	unlock();
+	Command command;
+	command.type = Command::SetMasterVolume;
+	command.volume = new_volume;
+	command.ramp = ramp;
+	send(command);
 }
 
 //------------------
 
 void Sound::PlayingSample::set_volume(float new_volume, float ramp) {
-	Sound::lock();
-	if (!stopping) {
-		volume.set(new_volume, ramp);
-	}
-	Sound::unlock();
+	if (voice == -1U || stopping) return;
+	Command command;
+	command.type = Command::SetVolume;
+	command.voice = voice;
+	command.generation = generation;
+	command.volume = new_volume;
+	command.ramp = ramp;
+	send(command);
 }
 
 void Sound::PlayingSample::set_pan(float new_pan, float ramp) {
-	if (!(pan.value == pan.value)) return; //ignore if not in '2D' mode
-	Sound::lock();
-	pan.set(new_pan, ramp);
-	Sound::unlock();
+	if (voice == -1U || is_3D) return; //ignore if not in '2D' mode
+	Command command;
+	command.type = Command::SetPan;
+	command.voice = voice;
+	command.generation = generation;
+	command.pan = new_pan;
+	command.ramp = ramp;
+	send(command);
 }
 
 void Sound::PlayingSample::set_position(glm::vec3 const &new_position, float ramp) {
-	if (pan.value == pan.value) return; //ignore if not in '3D' mode
-	Sound::lock();
-	position.set(new_position, ramp);
-	Sound::unlock();
+	if (voice == -1U || !is_3D) return; //ignore if not in '3D' mode
+	Command command;
+	command.type = Command::SetPosition;
+	command.voice = voice;
+	command.generation = generation;
+	command.position = new_position;
+	command.ramp = ramp;
+	send(command);
 }
 
 void Sound::PlayingSample::set_half_volume_radius(float new_radius, float ramp) {
-	if (pan.value == pan.value) return; //ignore if not in '3D' mode
-	Sound::lock();
-	half_volume_radius.set(new_radius, ramp);
-	Sound::unlock();
+	if (voice == -1U || !is_3D) return; //ignore if not in '3D' mode
+	Command command;
+	command.type = Command::SetHalfVolumeRadius;
+	command.voice = voice;
+	command.generation = generation;
+	command.half_volume_radius = new_radius;
+	command.ramp = ramp;
+	send(command);
 }
 
 void Sound::PlayingSample::stop(float ramp) {
-	Sound::lock();
-	if (!(stopping || stopped)) {
-		stopping = true;
-		volume.target = 0.0f;
-		volume.ramp = ramp;
-	} else {
-		volume.ramp = std::min(volume.ramp, ramp);
+	if (voice == -1U) return;
+	stopping = true;
+	Command command;
+	command.type = Command::Stop;
+	command.voice = voice;
+	command.generation = generation;
+	command.ramp = ramp;
+	send(command);
+}
+
+void Sound::PlayingSample::set_rate(float new_rate, float ramp) {
+	if (voice == -1U || stream) return; //(streamed samples always play at their own rate)
+	Command command;
+	command.type = Command::SetRate;
+	command.voice = voice;
+	command.generation = generation;
+	command.rate = new_rate;
+	command.ramp = ramp;
+	send(command);
+}
+
+void Sound::PlayingSample::set_priority(int32_t priority) {
+	if (voice == -1U) return;
+	Command command;
+	command.type = Command::SetPriority;
+	command.voice = voice;
+	command.generation = generation;
+	command.priority = priority;
+	send(command);
+}
+
+void Sound::PlayingSample::seek(float time) {
+	if (voice == -1U) return;
+	Command command;
+	command.type = Command::Seek;
+	command.voice = voice;
+	command.generation = generation;
+	command.seek_to = uint64_t(std::max(0.0f, time) * Rate);
+	if (stream) {
+		if (stream->voice != voice || stream->generation != generation) return; //(stream has been played again since)
+		command.epoch = stream->restart(command.seek_to, loop);
 	}
-	Sound::unlock();
+	send(command);
+}
+
+bool Sound::PlayingSample::stopped() const {
+	if (voice == -1U) return true;
+	collect_finished();
+	return !voice_busy[voice] || voice_generation[voice] != generation;
 }
 
 //------------------
 
 void Sound::Listener::set_position_right(glm::vec3 const &new_position, glm::vec3 const &new_right, float ramp) {
-	Sound::lock();
-	position.set(new_position, ramp);
+	Command command;
+	command.type = Command::SetListener;
+	command.position = new_position;
 	//some extra code to make sure right is always a unit vector:
 	if (new_right == glm::vec3(0.0f)) {
-		right.set(glm::vec3(1.0f, 0.0f, 0.0f), ramp);
+		command.right = glm::vec3(1.0f, 0.0f, 0.0f);
 	} else {
-		right.set(glm::normalize(new_right), ramp);
+		command.right = glm::normalize(new_right);
 	}
-	Sound::unlock();
+	command.ramp = ramp;
+	send(command);
 }
 
 //------------------------ internals --------------------------------
 
 
-//helper: equal-power panning
-inline void compute_pan_weights(float pan, float *left, float *right) {
-	//clamp pan to -1 to 1 range:
-	pan = std::max(-1.0f, std::min(1.0f, pan));
-
-	//want left^2 + right^2 = 1.0, so use angles:
-	float ang = 0.5f * 3.1415926f * (0.5f * (pan + 1.0f));
-	*left = std::cos(ang);
-	*right = std::sin(ang);
-}
-
-//helper: 3D audio panning
-void compute_pan_from_listener_and_position(
-	glm::vec3 const &listener_position,
-	glm::vec3 const &listener_right,
-	glm::vec3 const &source_position,
-	float source_half_radius,
-	float *left, float *right
-	) {
-	glm::vec3 to = source_position - listener_position;
-	float distance = glm::length(to);
-	//start by panning based on direction.
-	//note that for a LR fade to sound uniform, sound power (squared magnitude) should remain constant.
-	if (distance == 0.0f) {
-		*left = *right = std::sqrt(2.0f);
-	} else {
-		//amt ranges from -1 (most left) to 1 (most right):
-		float amt = glm::dot(listener_right, to) / distance;
-		//turn into an angle from 0.0f (most left) to pi/2 (most right):
-		float ang = 0.5f * 3.1415926f * (0.5f * (amt + 1.0f));
-		*left = std::cos(ang);
-		*right = std::sin(ang);
-
-		//squared distance attenuation is realistic if there are no walls,
-		// but I'm going to use linear because it's sounds better to me.
-		// (feel free to change it, of course)
-		//want att = 0.5f at distance == half_volume_radius
-		float att = 1.0f / (1.0f + (distance / source_half_radius));
-		*left *= att;
-		*right *= att;
-	}
-}
-
-//helper: ramp updates...
-constexpr float const RAMP_STEP = float(MIX_SAMPLES) / float(AUDIO_RATE);
-
-//helper: ...for single values:
-void step_value_ramp(Sound::Ramp< float > &ramp) {
-	if (ramp.ramp < RAMP_STEP) {
-		ramp.value = ramp.target;
-		ramp.ramp = 0.0f;
-	} else {
-		ramp.value += (RAMP_STEP / ramp.ramp) * (ramp.target - ramp.value);
-		ramp.ramp -= RAMP_STEP;
-	}
-}
+namespace {
 
-//helper: ...for 3D positions:
-void step_position_ramp(Sound::Ramp< glm::vec3 > &ramp) {
-	if (ramp.ramp < RAMP_STEP) {
-		ramp.value = ramp.target;
-		ramp.ramp = 0.0f;
-	} else {
-		ramp.value = glm::mix(ramp.value, ramp.target, RAMP_STEP / ramp.ramp);
-		ramp.ramp -= RAMP_STEP;
-	}
-}
+	//helper: apply a command from the game thread:
+	void apply_command(Command const &command) {
+		//commands aimed at one voice are ignored if that voice has since finished (or been reused):
+		Sound::Mixer::Voice *voice = nullptr;
+		if (command.voice < Sound::MaxVoices) {
+			voice = &mixer.voices[command.voice];
+			if (command.type != Command::Play && (voice->active_index == -1U || voice->generation != command.generation)) return;
+		}
 
-//helper: ...for 3D directions:
-void step_direction_ramp(Sound::Ramp< glm::vec3 > &ramp) {
-	if (ramp.ramp < RAMP_STEP) {
-		ramp.value = ramp.target;
-		ramp.ramp = 0.0f;
-	} else {
-		//find normal to the plane containing value and target:
-		glm::vec3 norm = glm::cross(ramp.value, ramp.target);
-		if (norm == glm::vec3(0.0f)) {
-			if (ramp.target.x <= ramp.target.y && ramp.target.x <= ramp.target.z) {
-				norm = glm::vec3(1.0f, 0.0f, 0.0f);
-			} else if (ramp.target.y <= ramp.target.z) {
-				norm = glm::vec3(0.0f, 1.0f, 0.0f);
+		if (command.type == Command::Play) {
+			assert(voice && voice->active_index == -1U);
+			voice->data = command.data;
+			voice->encoded = command.encoded;
+			voice->storage = command.storage;
+			voice->size = command.size;
+			voice->i = 0;
+			voice->frac = 0;
+			voice->generation = command.generation;
+			voice->loop = command.loop;
+			voice->is_3D = command.is_3D;
+			voice->stopping = false;
+			voice->volume = Sound::Ramp< float >(command.volume);
+			voice->pan = Sound::Ramp< float >(command.pan);
+			voice->position = Sound::Ramp< glm::vec3 >(command.position);
+			voice->half_volume_radius = Sound::Ramp< float >(command.half_volume_radius);
+			voice->rate = Sound::Ramp< float >(1.0f);
+			voice->stream = command.stream;
+			voice->epoch = command.epoch;
+			voice->stream_started = false;
+			voice->priority = 0;
+			mixer.start(command.voice);
+		} else if (command.type == Command::SetVolume) {
+			if (!voice->stopping) voice->volume.set(command.volume, command.ramp);
+		} else if (command.type == Command::SetPan) {
+			voice->pan.set(command.pan, command.ramp);
+		} else if (command.type == Command::SetPosition) {
+			voice->position.set(command.position, command.ramp);
+		} else if (command.type == Command::SetHalfVolumeRadius) {
+			voice->half_volume_radius.set(command.half_volume_radius, command.ramp);
+		} else if (command.type == Command::Stop || command.type == Command::StopAll) {
+			auto stop = [&command](Sound::Mixer::Voice &voice) {
+				if (!voice.stopping) {
+					voice.stopping = true;
+					voice.volume.target = 0.0f;
+					voice.volume.ramp = command.ramp;
+				} else {
+					voice.volume.ramp = std::min(voice.volume.ramp, command.ramp);
+				}
+			};
+			if (command.type == Command::Stop) {
+				stop(*voice);
+			} else {
+				for (uint32_t a = 0; a < mixer.active_voice_count; ++a) {
+					stop(mixer.voices[mixer.active_voices[a]]);
+				}
+			}
+		} else if (command.type == Command::SetMasterVolume) {
+			mixer.volume.set(command.volume, command.ramp);
+		} else if (command.type == Command::SetListener) {
+			mixer.listener_position.set(command.position, command.ramp);
+			mixer.listener_right.set(command.right, command.ramp);
+		} else if (command.type == Command::SetPriority) {
+			voice->priority = command.priority;
+		} else if (command.type == Command::SetRate) {
+			voice->rate.set(command.rate, command.ramp);
+		} else if (command.type == Command::SetVoiceLimit) {
+			mixer.real_voice_limit = std::min(command.voice_limit, Sound::MaxVoices);
+		} else if (command.type == Command::Seek) {
+			if (voice->stream) {
+				voice->epoch = command.epoch;
+				voice->stream_started = false;
+			} else if (command.seek_to < voice->size) {
+				voice->i = size_t(command.seek_to);
+				voice->frac = 0;
+			} else if (voice->loop) {
+				voice->i = size_t(command.seek_to % voice->size);
+				voice->frac = 0;
 			} else {
-				norm = glm::vec3(0.0f, 0.0f, 1.0f);
+				mixer.finish(command.voice);
+			}
+		} else if (command.type == Command::ReplaceData) {
+			for (uint32_t a = 0; a < mixer.active_voice_count; /* later */) {
+				uint32_t v = mixer.active_voices[a];
+				Sound::Mixer::Voice &playing = mixer.voices[v];
+				if ((command.old_data && playing.data == command.old_data) || (command.old_encoded && playing.encoded == command.old_encoded)) {
+					playing.data = command.data;
+					playing.encoded = command.encoded;
+					playing.size = command.size;
+					if (playing.i >= playing.size) {
+						if (playing.loop && playing.size != 0) {
+							playing.i = 0;
+						} else {
+							//(the mixer expects a valid position, so finish now)
+							mixer.finish(v); //n.b. moves the last active voice to position 'a'
+							continue;
+						}
+					}
+				}
+				++a;
 			}
-			norm -= ramp.target * glm::dot(ramp.target, norm);
 		}
-		norm = glm::normalize(norm);
-		//find perpendicular to target in this plane:
-		glm::vec3 perp = glm::cross(norm, ramp.target);
-
-		//find angle from target to value:
-		float angle = std::acos(glm::clamp(glm::dot(ramp.value, ramp.target), -1.0f, 1.0f));
-
-		//figure out new target value by moving angle toward target:
-		angle *= (ramp.ramp - RAMP_STEP) / ramp.ramp;
-
-		ramp.value = ramp.target * std::cos(angle) + perp * std::sin(angle);
-		ramp.ramp -= RAMP_STEP;
 	}
-}
-
-
-//The audio callback -- invoked by SDL when it needs more sound to play:
-void mix_audio(void *, Uint8 *buffer_, int len) {
-	assert(buffer_); //should always have some audio buffer
 
-	struct LR {
-		float l;
-		float r;
-	};
-	static_assert(sizeof(LR) == 8, "Sample is packed");
-	assert(len == MIX_SAMPLES * sizeof(LR)); //should always have the expected number of samples
-	LR *buffer = reinterpret_cast< LR * >(buffer_);
-
-	//zero the output buffer:
-	for (uint32_t s = 0; s < MIX_SAMPLES; ++s) {
-		buffer[s].l = 0.0f;
-		buffer[s].r = 0.0f;
+	//helper: atomic max (only the mixer writes these, so a load and store is enough):
+	void store_max(std::atomic< uint64_t > &worst, uint64_t value) {
+		if (value > worst.load(std::memory_order_relaxed)) worst.store(value, std::memory_order_relaxed);
 	}
 
-	//update global values:
-	float start_volume = Sound::volume.value;
-	glm::vec3 start_position =  Sound::listener.position.value;
-	glm::vec3 start_right =  Sound::listener.right.value;
-
-	step_value_ramp(Sound::volume);
-	step_position_ramp( Sound::listener.position);
-	step_direction_ramp( Sound::listener.right);
-
-	float end_volume = Sound::volume.value;
-	glm::vec3 end_position =  Sound::listener.position.value;
-	glm::vec3 end_right =  Sound::listener.right.value;
-
-	//add audio from each playing sample into the buffer:
-	for (auto si = playing_samples.begin(); si != playing_samples.end(); /* later */) {
-		Sound::PlayingSample &playing_sample = **si; //much more convenient than writing ** everywhere.
-
-		//Figure out sample panning/volume at start...
-		LR start_pan;
-		if (!(playing_sample.pan.value == playing_sample.pan.value)) {
-			//3D panning
-			compute_pan_from_listener_and_position(
-				start_position, start_right,
-				playing_sample.position.value,
-				playing_sample.half_volume_radius.value,
-				&start_pan.l, &start_pan.r);
-
-			step_position_ramp(playing_sample.position);
-			step_value_ramp(playing_sample.half_volume_radius);
-		} else {
-			//2D panning
-			compute_pan_weights(playing_sample.pan.value, &start_pan.l, &start_pan.r);
-
-			step_value_ramp(playing_sample.pan);
+	//helper: apply everything the game has sent since the last callback:
+	void drain_commands(uint64_t now) {
+		Command command;
+		while (commands.pop(&command)) {
+			store_max(command_delay_ns_worst, now - std::min(now, command.sent_ns));
+			apply_command(command);
+			commands_done.fetch_add(1, std::memory_order_release);
 		}
-		start_pan.l *= start_volume * playing_sample.volume.value;
-		start_pan.r *= start_volume * playing_sample.volume.value;
-
-		step_value_ramp(playing_sample.volume);
-
-		//..and end of the mix period:
-		LR end_pan;
-		if (!(playing_sample.pan.value == playing_sample.pan.value)) {
-			//3D panning
-			compute_pan_from_listener_and_position(
-				end_position, end_right,
-				playing_sample.position.value,
-				playing_sample.half_volume_radius.value,
-				&end_pan.l, &end_pan.r);
-		} else {
-			//2D panning
-			compute_pan_weights(playing_sample.pan.value, &end_pan.l, &end_pan.r);
-		}
-
-		end_pan.l *= end_volume * playing_sample.volume.value;
-		end_pan.r *= end_volume * playing_sample.volume.value;
-
-		//figure out a step to add at each sample so that pan will move smoothly from start to end:
-		LR pan = start_pan;
-		LR pan_step;
-		pan_step.l = (end_pan.l - start_pan.l) / MIX_SAMPLES;
-		pan_step.r = (end_pan.r - start_pan.r) / MIX_SAMPLES;
+	}
 
-		assert(playing_sample.i < playing_sample.data.size());
+}
 
-		for (uint32_t i = 0; i < MIX_SAMPLES; ++i) {
-			//mix one sample based on current pan values:
-			buffer[i].l += pan.l * playing_sample.data[playing_sample.i];
-			buffer[i].r += pan.r * playing_sample.data[playing_sample.i];
+//The audio callback -- invoked by SDL when it needs more sound to play (or by Sound::render, offline):
+// (runs on SDL's audio thread: it must not allocate, lock, or wait on the game thread)
+void mix_audio(void *, Uint8 *buffer_, int len) {
+	assert(buffer_); //should always have some audio buffer
+	assert(len == Sound::BlockSamples * 2 * sizeof(float)); //should always have the expected number of samples
+	uint64_t callback_start = now_ns();
 
-			//update position in sample:
-			playing_sample.i += 1;
-			if (playing_sample.i == playing_sample.data.size()) {
-				if (playing_sample.loop) {
-					playing_sample.i = 0;
-				} else {
-					break;
-				}
-			}
+	drain_commands(callback_start);
 
-			//update pan values:
-			pan.l += pan_step.l;
-			pan.r += pan_step.r;
-		}
+	mixer.mix(reinterpret_cast< float * >(buffer_));
 
-		if (playing_sample.i >= playing_sample.data.size()
-		 || (playing_sample.stopping && playing_sample.volume.value == 0.0f)) { //sample has finished
-		 	playing_sample.stopped = true;
-			//erase from list:
-			auto old = si;
-			++si;
-			playing_samples.erase(old);
-		} else {
-			++si;
-		}
+	//hand finished voices back to the game:
+	for (uint32_t f = 0; f < mixer.finished_count; ++f) {
+		bool pushed = finished_voices.push(mixer.finished[f]);
+		assert(pushed); //(can't be full -- see finished_voices)
+		(void)pushed;
 	}
+	mixer.finished_count = 0;
 
-	/*//DEBUG: report output power:
-	float max_power = 0.0f;
-	for (uint32_t s = 0; s < MIX_SAMPLES; ++s) {
-		max_power = std::max(max_power, (buffer[s].l * buffer[s].l + buffer[s].r * buffer[s].r));
-	}
-	std::cout << "Max Power: " << std::sqrt(max_power) << "; playing samples: " << playing_samples.size() << std::endl; //DEBUG
-	*/
+	voices_playing.store(mixer.active_voice_count, std::memory_order_relaxed);
+	voices_real.store(mixer.real_voice_count, std::memory_order_relaxed);
+	stream_underruns.store(mixer.stream_underruns, std::memory_order_relaxed);
 
+	uint64_t callback_ns = now_ns() - callback_start;
+	callback_ns_total.fetch_add(callback_ns, std::memory_order_relaxed);
+	store_max(callback_ns_worst, callback_ns);
+	callbacks.fetch_add(1, std::memory_order_relaxed);
 }
-
-
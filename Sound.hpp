@@ -4,25 +4,68 @@
 
 #include <memory>
 #include <vector>
+#include <limits>
 #include <string>
 #include <cmath>
 
 //Game audio system. Simplified from f18-base3.
 //Uses 48kHz sampling rate.
+//
+//Threading: call these functions from one thread (the game's main thread). They never lock
+// the audio device; instead they push commands onto a lock-free queue that the audio callback
+// drains before each mix. The callback mixes from a fixed pool of voices and never allocates
+// or blocks (see SPSCQueue.hpp).
 
 namespace Sound {
 
+constexpr uint32_t Rate = 48000; //sampling rate
+constexpr uint32_t BlockSamples = 1024; //stereo frames mixed at a time
+
+//number of samples that can play at once (plays beyond this are dropped, and counted in Stats):
+// (only the most important few are actually mixed; see set_voice_limit, below)
+constexpr uint32_t MaxVoices = 4096;
+
+struct SampleStream; //see SoundStream.hpp
+
 //Sample objects hold mono (one-channel) audio.
 struct Sample {
+	//Decoded samples are loaded into memory; Streamed samples (only '.opus' files) keep the
+	// compressed file and decode a little at a time as they play (good for long music tracks):
+	enum Mode {
+		Decoded,
+		Streamed
+	};
+
+	//Decoded samples can be kept in memory as floats, or compressed and decoded a block at a time
+	// by the mixer as they play (a little mixing time for a lot less memory; see SoundCodec.hpp):
+	enum Storage : uint8_t {
+		Float, //32-bit float (11.5MB per minute)
+		PCM16, //16-bit linear (5.8MB per minute)
+		MuLaw, //8-bit mu-law (2.9MB per minute)
+		ADPCM, //4-bit IMA-ADPCM (1.6MB per minute)
+	};
+
 	//Load from a '.wav' or '.opus' file.
 	//  will warn and convert if sound is not already 48kHz mono:
-	Sample(std::string const &filename);
+	//  decoded data is kept in a cache for next time (see audio_cache.hpp)
+	//  safe to call from loader threads, so Load< Sound::Sample > loaders can use LoadOnWorkerThread to decode in parallel
+	//  (Streamed samples must use Float storage -- they are already compressed)
+	Sample(std::string const &filename, Mode mode = Decoded, Storage storage = Float);
 	
 	//Directly supply an audio buffer:
-	Sample(std::vector< float > const &data);
+	Sample(std::vector< float > const &data, Storage storage = Float);
 
 	//sample data is stored as 48kHz, mono, floating-point:
+	// (empty for Streamed samples and compressed samples)
 	std::vector< float > data;
+
+	//compressed samples keep 'encoded_samples' samples in 'encoded' instead:
+	Storage storage = Float;
+	std::vector< uint8_t > encoded;
+	size_t encoded_samples = 0;
+
+	//decoder for Streamed samples (a stream plays on one voice at a time; playing it again restarts it):
+	std::shared_ptr< SampleStream > stream;
 };
 
 //Ramp<> manages values that should be smoothly interpolated
@@ -48,9 +91,9 @@ struct Ramp {
 	float ramp = 0.0f;
 };
 
-// 'PlayingSample' objects book-keep samples that are currently playing:
+// 'PlayingSample' objects are handles to samples that are currently playing:
 struct PlayingSample {
-	//change the panning or volume of a playing sample (and do proper locking);
+	//change the panning or volume of a playing sample;
 	// value will change over 'ramp' seconds to avoid creating audible artifacts:
 	void set_volume(float new_volume, float ramp = 1.0f / 60.0f);
 	//set the panning of a sample (use only on samples in "2D" mode; no effect on "3D" samples):
@@ -60,31 +103,33 @@ struct PlayingSample {
 	//set the half-volume radius (use only on "3D" playing sounds):
 	void set_half_volume_radius(float new_radius, float ramp = 1.0f / 60.0f);
 
+	//play faster (higher pitched) or slower (lower pitched): 1 is the sample's own rate, 2 an octave up, 0.5 an octave down;
+	// (clamped to 1/16 .. 4; resampled with a windowed-sinc filter; no effect on Streamed samples)
+	void set_rate(float new_rate, float ramp = 1.0f / 60.0f);
+
 	//'stop' will fade sample out over 'ramp' seconds and then remove it from the active samples:
 	void stop(float ramp = 1.0f / 60.0f);
 
+	//samples with higher priority are mixed before lower ones when there are more than the
+	// voice limit playing (see set_voice_limit); among equal priorities, louder samples win:
+	void set_priority(int32_t priority);
+
+	//jump to 'time' seconds into the sample (past the end, looping samples wrap and others stop):
+	// (streamed samples go quiet for a moment while the decoder catches up)
+	void seek(float time);
+
+	//has playback finished (by running out of sample, or after stop())?
+	bool stopped() const;
+
 	//internals:
-	//NOTE: PlayingSample is used in a separate thread; so setting these values directly
-	// may result in bad results. Instead, use the functions above, which perform locking!
-	std::vector< float > const &data; //reference to sample data being played
-	uint32_t i = 0; //next data value to read
-	bool loop = false; //should playback loop after data runs out?
-	bool stopping = false; //is playing stopping?
-	bool stopped = false; //was playback stopped (either by running out of sample, or by stop())?
-
-	Ramp< float > volume = Ramp< float >(1.0f);
-
-	//2D playback panning control: ('NaN' if sound played in 3D mode)
-	Ramp< float > pan = Ramp< float >(std::numeric_limits< float >::quiet_NaN());
-
-	//3D playback panning control: ('NaN' if sound played in 2D mode)
-	Ramp< glm::vec3 > position = Ramp< glm::vec3 >(std::numeric_limits< float >::quiet_NaN());
-	Ramp< float > half_volume_radius = std::numeric_limits< float >::quiet_NaN();
-
-	PlayingSample(Sample const &sample_, float volume_, float pan_, bool loop_)
-		: data(sample_.data), loop(loop_), volume(volume_), pan(pan_) { }
-	PlayingSample(Sample const &sample_, float volume_, glm::vec3 const &position_, float half_volume_radius_, bool loop_)
-		: data(sample_.data), loop(loop_), volume(volume_), position(position_), half_volume_radius(half_volume_radius_) { }
+	//NOTE: the sample is mixed by a voice in the audio thread; the functions above send it commands
+	// (see "threading" below), so this handle holds only which voice that is:
+	uint32_t voice = -1U; //index in the mixer's voice pool (-1U if there was no free voice)
+	uint32_t generation = 0; //which use of that voice this is (so stale handles can't affect later sounds)
+	bool is_3D = false;
+	bool loop = false;
+	bool stopping = false;
+	SampleStream *stream = nullptr; //for Streamed samples
 };
 
 // ------- global functions -------
@@ -93,6 +138,12 @@ void init(); //call Sound::init() from main.cpp before using any member function
 
 void shutdown(); //call Sound::shutdown() from main.cpp to gracefully(-ish) exit
 
+//Offline mode -- call instead of init() to run without an audio device (e.g., for tests and benchmarks):
+// nothing plays on its own; render() mixes blocks whenever it is called (as fast as it can).
+void init_offline();
+//mix the next 'blocks' blocks (BlockSamples frames each) and append them (48kHz, interleaved stereo) to *out:
+void render(uint32_t blocks, std::vector< float > *out);
+
 //Call 'Sound::play' to play a sample once.
 //  if you hang on to the return value, you can change the panning, volume, or stop playback early.
 std::shared_ptr< PlayingSample > play(
@@ -124,26 +175,44 @@ std::shared_ptr< PlayingSample > loop_3D(
 );
 
 //Listener controls the panning of "3D" samples (ones played using the "position" version of the play functions):
+// (the mixer keeps the current position and right vector; this just sends it new ones)
 struct Listener {
 	void set_position_right(glm::vec3 const &new_position, glm::vec3 const &new_right, float ramp = 1.0f / 60.0f);
-
-	//internals:
-	Ramp< glm::vec3 > position = Ramp< glm::vec3 >(0.0f); //listener's location
-	Ramp< glm::vec3 > right = Ramp< glm::vec3 >(1.0f, 0.0f, 0.0f); //unit vector pointing to listener's right
 };
 extern struct Listener listener;
 
+//swap new data into a sample (e.g., when hot reloading; see HotReload.hpp):
+// copies of the sample that are playing continue from the same position (or stop, if past the new end)
+// (the old data is freed once the mixer has stopped using it; compressed samples compress the new data)
+void replace_sample_data(Sample &sample, std::vector< float > &&data);
+//NOTE: the mixer reads sample data directly, so samples should outlive their playback
+// (e.g., by being Load<> globals) and their data should only be changed with replace_sample_data.
+
 //"panic button" to shut off all currently playing sounds:
 void stop_all_samples();
 
 //set global volume:
 void set_volume(float new_volume, float ramp = 1.0f / 60.0f);
-extern Ramp< float > volume;
 
-//the audio callback doesn't run between Sound::lock() and Sound::unlock()
-// the set_*/stop/play/... functions already use these helpers, so you shouldn't need
-// to call them unless your code is modifying values directly:
-void lock();
-void unlock();
+//set how many samples are mixed at once (default 64):
+// other playing samples -- the quietest or lowest priority ones, or any that are inaudible --
+// are "virtual": they keep their place (and finish on time) but cost almost nothing.
+void set_voice_limit(uint32_t limit);
+
+//timing of the audio callback and of the command queue (printed by Sound::shutdown):
+struct Stats {
+	uint32_t callbacks = 0; //mix_audio calls so far
+	float callback_ms_average = 0.0f;
+	float callback_ms_worst = 0.0f;
+	float callback_ms_budget = 0.0f; //audio played per callback (taking longer than this glitches)
+	float command_delay_ms_worst = 0.0f; //longest a command waited in the queue before the mixer applied it
+	float send_wait_ms_worst = 0.0f; //longest the game thread waited for room in a full queue
+	uint32_t voices_playing = 0; //voices the mixer is using
+	uint32_t voices_real = 0; //...of which were mixed in the last block
+	uint32_t voices_virtual = 0; //...of which were only advanced
+	uint32_t voices_dropped = 0; //plays that found no free voice
+	uint32_t stream_underruns = 0; //blocks where a Streamed sample's decoder fell behind
+};
+Stats get_stats();
 
 } //namespace Sound
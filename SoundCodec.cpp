@@ -0,0 +1,296 @@
+#include "SoundCodec.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOUND_CODEC_SSE
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+//------------------------ PCM16 --------------------------------
+
+static int32_t to_pcm16(float x) {
+	return int32_t(std::max(-32768.0f, std::min(32767.0f, std::round(x * 32768.0f))));
+}
+
+static void decode_pcm16(uint8_t const *data, size_t begin, size_t count, float *out) {
+	int16_t const *in = reinterpret_cast< int16_t const * >(data) + begin;
+	size_t k = 0;
+#if defined(SOUND_CODEC_SSE)
+	//eight samples at a time (sign-extending each by putting it in the top half of a 32-bit lane and shifting down):
+	__m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+	for (; k + 8 <= count; k += 8) {
+		__m128i s = _mm_loadu_si128(reinterpret_cast< __m128i const * >(in + k));
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+		_mm_storeu_ps(out + k + 0, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+		_mm_storeu_ps(out + k + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+	}
+#endif
+	for (; k < count; ++k) {
+		out[k] = float(in[k]) * (1.0f / 32768.0f);
+	}
+}
+
+//------------------------ mu-law --------------------------------
+//(G.711: a sign bit, three bits of exponent, four of mantissa, all inverted)
+
+static constexpr int32_t MuLawBias = 0x84;
+
+static uint8_t mulaw_encode(int32_t s) {
+	uint8_t sign = (s < 0 ? 0x80 : 0x00);
+	s = std::min(std::abs(s), 32635) + MuLawBias;
+	uint32_t exponent = 7;
+	for (int32_t mask = 0x4000; !(s & mask) && exponent > 0; mask >>= 1) --exponent;
+	uint32_t mantissa = (s >> (exponent + 3)) & 0x0f;
+	return uint8_t(~(sign | (exponent << 4) | mantissa));
+}
+
+//(reconstructs the middle of each code's range, so truncating when encoding rounds to nearest)
+static float mulaw_decode(uint8_t u) {
+	u = uint8_t(~u);
+	int32_t exponent = (u >> 4) & 0x07;
+	int32_t mantissa = u & 0x0f;
+	int32_t s = (((mantissa << 3) + MuLawBias) << exponent) - MuLawBias;
+	return float((u & 0x80) ? -s : s) * (1.0f / 32768.0f);
+}
+
+static void decode_mulaw(uint8_t const *data, size_t begin, size_t count, float *out) {
+	uint8_t const *in = data + begin;
+	size_t k = 0;
+#if defined(SOUND_CODEC_SSE)
+	//sixteen samples at a time, computing (mantissa * 8 + bias) * 2^exponent in floating point
+	// (2^exponent is built directly in the float's exponent bits, which sidesteps SSE2's lack of per-lane shifts):
+	__m128i const zero = _mm_setzero_si128();
+	__m128i const ones = _mm_set1_epi8(-1);
+	__m128i const low4 = _mm_set1_epi32(0x0f);
+	__m128i const low3 = _mm_set1_epi32(0x07);
+	__m128i const sign_bit = _mm_set1_epi32(0x80);
+	__m128i const exponent_base = _mm_set1_epi32(127 - 15); //(the -15 folds in the 1/32768 scale)
+	__m128 const bias = _mm_set1_ps(float(MuLawBias));
+	__m128 const bias_scaled = _mm_set1_ps(float(MuLawBias) / 32768.0f);
+	for (; k + 16 <= count; k += 16) {
+		__m128i bytes = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast< __m128i const * >(in + k)), ones);
+		__m128i words[2] = { _mm_unpacklo_epi8(bytes, zero), _mm_unpackhi_epi8(bytes, zero) };
+		for (uint32_t q = 0; q < 4; ++q) {
+			__m128i const &half = words[q / 2];
+			__m128i u = (q % 2 == 0 ? _mm_unpacklo_epi16(half, zero) : _mm_unpackhi_epi16(half, zero));
+			__m128i mantissa = _mm_and_si128(u, low4);
+			__m128i exponent = _mm_and_si128(_mm_srli_epi32(u, 4), low3);
+			__m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(exponent, exponent_base), 23));
+			__m128 value = _mm_add_ps(_mm_cvtepi32_ps(_mm_slli_epi32(mantissa, 3)), bias);
+			value = _mm_sub_ps(_mm_mul_ps(value, scale), bias_scaled);
+			//flip the float's sign bit for negative samples:
+			__m128i sign = _mm_slli_epi32(_mm_and_si128(u, sign_bit), 24);
+			_mm_storeu_ps(out + k + 4 * q, _mm_xor_ps(value, _mm_castsi128_ps(sign)));
+		}
+	}
+#endif
+	for (; k < count; ++k) {
+		out[k] = mulaw_decode(in[k]);
+	}
+}
+
+//------------------------ IMA-ADPCM --------------------------------
+
+static int32_t const ADPCMStepSizes[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+static int32_t const ADPCMIndexChanges[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+//what a code does to the decoder's state, for every (step index, code) pair:
+struct ADPCMStep {
+	int32_t diff; //added to the predictor
+	uint32_t next; //next state (step index * 16)
+};
+static struct ADPCMTable {
+	ADPCMStep steps[89 * 16];
+	ADPCMTable() {
+		for (int32_t index = 0; index < 89; ++index) {
+			for (int32_t code = 0; code < 16; ++code) {
+				int32_t step = ADPCMStepSizes[index];
+				int32_t diff = step >> 3;
+				if (code & 4) diff += step;
+				if (code & 2) diff += step >> 1;
+				if (code & 1) diff += step >> 2;
+				int32_t next = std::max(0, std::min(88, index + ADPCMIndexChanges[code & 7]));
+				steps[index * 16 + code].diff = ((code & 8) ? -diff : diff);
+				steps[index * 16 + code].next = uint32_t(next * 16);
+			}
+		}
+	}
+} const adpcm_table;
+
+//apply one code to the decoder state, returning the sample it decodes to:
+static inline float adpcm_step(int32_t &predictor, uint32_t &state, uint32_t code) {
+	ADPCMStep const &step = adpcm_table.steps[state + code];
+	predictor = std::max(-32768, std::min(32767, predictor + step.diff));
+	state = step.next;
+	return float(predictor) * (1.0f / 32768.0f);
+}
+
+static void adpcm_read_header(uint8_t const *block, int32_t *predictor, uint32_t *state) {
+	int16_t p;
+	std::memcpy(&p, block, sizeof(p));
+	*predictor = p;
+	*state = uint32_t(std::min< uint8_t >(block[2], 88)) * 16;
+}
+
+static void encode_adpcm(float const *data, size_t count, std::vector< uint8_t > *out) {
+	out->assign(Sound::encoded_bytes(Sound::Sample::ADPCM, count), 0);
+	int32_t predictor = (count ? to_pcm16(data[0]) : 0);
+	uint32_t state = 0;
+	for (size_t begin = 0; begin < count; begin += Sound::ADPCMBlockSamples) {
+		uint8_t *block = out->data() + (begin / Sound::ADPCMBlockSamples) * Sound::ADPCMBlockBytes;
+		//(each block starts with the state the decoder will be in, so it can be decoded without the ones before)
+		int16_t p = int16_t(predictor);
+		std::memcpy(block, &p, sizeof(p));
+		block[2] = uint8_t(state / 16);
+		block[3] = 0;
+		for (uint32_t k = 0; k < Sound::ADPCMBlockSamples && begin + k < count; ++k) {
+			//pick the code that lands closest to the sample, bit by bit (the standard IMA encoder):
+			int32_t diff = to_pcm16(data[begin + k]) - predictor;
+			int32_t step = ADPCMStepSizes[state / 16];
+			uint32_t code = 0;
+			if (diff < 0) {
+				code = 8;
+				diff = -diff;
+			}
+			if (diff >= step) { code |= 4; diff -= step; }
+			step >>= 1;
+			if (diff >= step) { code |= 2; diff -= step; }
+			step >>= 1;
+			if (diff >= step) { code |= 1; }
+			//(and then track the decoder exactly)
+			adpcm_step(predictor, state, code);
+			block[4 + k / 2] |= uint8_t(code << (4 * (k % 2)));
+		}
+	}
+}
+
+//decode the first 'count' samples of a block:
+static void decode_adpcm_block(uint8_t const *block, uint32_t count, float *out) {
+	int32_t predictor;
+	uint32_t state;
+	adpcm_read_header(block, &predictor, &state);
+	for (uint32_t k = 0; k < count; ++k) {
+		out[k] = adpcm_step(predictor, state, (block[4 + k / 2] >> (4 * (k % 2))) & 0x0f);
+	}
+}
+
+//decode four whole blocks, interleaved:
+// (each sample depends on the one before, so one block is a chain of dependent loads and adds;
+//  four independent chains keep more of the CPU busy)
+static void decode_adpcm_blocks4(uint8_t const *blocks, float *out) {
+	constexpr uint32_t N = Sound::ADPCMBlockSamples;
+	constexpr uint32_t B = Sound::ADPCMBlockBytes;
+	int32_t p0, p1, p2, p3;
+	uint32_t s0, s1, s2, s3;
+	adpcm_read_header(blocks + 0 * B, &p0, &s0);
+	adpcm_read_header(blocks + 1 * B, &p1, &s1);
+	adpcm_read_header(blocks + 2 * B, &p2, &s2);
+	adpcm_read_header(blocks + 3 * B, &p3, &s3);
+	for (uint32_t k = 0; k < N / 2; ++k) {
+		uint32_t c0 = blocks[0 * B + 4 + k], c1 = blocks[1 * B + 4 + k], c2 = blocks[2 * B + 4 + k], c3 = blocks[3 * B + 4 + k];
+		out[0 * N + 2 * k] = adpcm_step(p0, s0, c0 & 0x0f);
+		out[1 * N + 2 * k] = adpcm_step(p1, s1, c1 & 0x0f);
+		out[2 * N + 2 * k] = adpcm_step(p2, s2, c2 & 0x0f);
+		out[3 * N + 2 * k] = adpcm_step(p3, s3, c3 & 0x0f);
+		out[0 * N + 2 * k + 1] = adpcm_step(p0, s0, c0 >> 4);
+		out[1 * N + 2 * k + 1] = adpcm_step(p1, s1, c1 >> 4);
+		out[2 * N + 2 * k + 1] = adpcm_step(p2, s2, c2 >> 4);
+		out[3 * N + 2 * k + 1] = adpcm_step(p3, s3, c3 >> 4);
+	}
+}
+
+static void decode_adpcm(uint8_t const *data, size_t begin, size_t count, float *out) {
+	constexpr uint32_t N = Sound::ADPCMBlockSamples;
+	constexpr uint32_t B = Sound::ADPCMBlockBytes;
+	size_t block = begin / N;
+
+	//start partway into a block by decoding its beginning to the side:
+	uint32_t skip = uint32_t(begin % N);
+	if (skip != 0) {
+		float temp[N];
+		uint32_t n = uint32_t(std::min< size_t >(count, N - skip));
+		decode_adpcm_block(data + block * B, skip + n, temp);
+		std::copy(temp + skip, temp + skip + n, out);
+		out += n;
+		count -= n;
+		++block;
+	}
+	//whole blocks:
+	for (; count >= 4 * N; count -= 4 * N, block += 4, out += 4 * N) {
+		decode_adpcm_blocks4(data + block * B, out);
+	}
+	for (; count >= N; count -= N, block += 1, out += N) {
+		decode_adpcm_block(data + block * B, N, out);
+	}
+	//and the start of the last one:
+	if (count > 0) {
+		decode_adpcm_block(data + block * B, uint32_t(count), out);
+	}
+}
+
+//------------------------ interface --------------------------------
+
+size_t Sound::encoded_bytes(Sample::Storage storage, size_t count) {
+	if (storage == Sample::Float) return count * sizeof(float);
+	else if (storage == Sample::PCM16) return count * sizeof(int16_t);
+	else if (storage == Sample::MuLaw) return count;
+	else if (storage == Sample::ADPCM) return (count + ADPCMBlockSamples - 1) / ADPCMBlockSamples * ADPCMBlockBytes;
+	assert(0 && "unknown storage");
+	return 0;
+}
+
+void Sound::encode_samples(Sample::Storage storage, float const *data, size_t count, std::vector< uint8_t > *out) {
+	assert(out);
+	if (storage == Sample::Float) {
+		out->resize(encoded_bytes(storage, count));
+		std::memcpy(out->data(), data, out->size());
+	} else if (storage == Sample::PCM16) {
+		out->resize(encoded_bytes(storage, count));
+		for (size_t k = 0; k < count; ++k) {
+			int16_t s = int16_t(to_pcm16(data[k]));
+			std::memcpy(out->data() + k * sizeof(int16_t), &s, sizeof(int16_t));
+		}
+	} else if (storage == Sample::MuLaw) {
+		out->resize(encoded_bytes(storage, count));
+		for (size_t k = 0; k < count; ++k) {
+			(*out)[k] = mulaw_encode(to_pcm16(data[k]));
+		}
+	} else if (storage == Sample::ADPCM) {
+		encode_adpcm(data, count, out);
+	} else {
+		assert(0 && "unknown storage");
+	}
+}
+
+void Sound::decode_samples(Sample::Storage storage, uint8_t const *data, size_t begin, size_t count, float *out) {
+	if (storage == Sample::Float) {
+		std::memcpy(out, data + begin * sizeof(float), count * sizeof(float));
+	} else if (storage == Sample::PCM16) {
+		decode_pcm16(data, begin, count, out);
+	} else if (storage == Sample::MuLaw) {
+		decode_mulaw(data, begin, count, out);
+	} else if (storage == Sample::ADPCM) {
+		decode_adpcm(data, begin, count, out);
+	} else {
+		assert(0 && "unknown storage");
+	}
+}
+
+char const *Sound::storage_name(Sample::Storage storage) {
+	if (storage == Sample::Float) return "float";
+	else if (storage == Sample::PCM16) return "pcm16";
+	else if (storage == Sample::MuLaw) return "mu-law";
+	else if (storage == Sample::ADPCM) return "adpcm";
+	return "unknown";
+}
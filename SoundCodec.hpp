@@ -0,0 +1,44 @@
+#pragma once
+
+/*
+ * Compressed in-memory sample storage (see Sound::Sample::Storage):
+ *
+ *  - PCM16: 16-bit linear samples (2 bytes per sample);
+ *  - MuLaw: 8-bit G.711 mu-law samples (1 byte per sample);
+ *  - ADPCM: 4-bit IMA-ADPCM in blocks of ADPCMBlockSamples, each starting with
+ *     the decoder state (so any block can be decoded on its own), 36 bytes per
+ *     64 samples.
+ *
+ * Sound::Mixer decodes just the part of a compressed sample it is about to mix,
+ * every block, so these decoders are meant to be fast: PCM16 and mu-law convert
+ * with SSE, and ADPCM uses a table of (index, code) -> (difference, next index)
+ * and decodes four blocks at once, interleaved, when it can.
+ *
+ * This code uses no SDL or OpenGL.
+ *
+ */
+
+#include "Sound.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Sound {
+
+constexpr uint32_t ADPCMBlockSamples = 64;
+constexpr uint32_t ADPCMBlockBytes = 4 + ADPCMBlockSamples / 2; //int16 predictor, uint8 step index, (pad), then a 4-bit code per sample
+
+//bytes needed to store 'count' samples:
+size_t encoded_bytes(Sample::Storage storage, size_t count);
+
+//encode 'count' samples (-1 .. 1; clamped) of 'data' into *out (replacing its contents):
+void encode_samples(Sample::Storage storage, float const *data, size_t count, std::vector< uint8_t > *out);
+
+//decode samples 'begin' .. 'begin + count - 1' of encoded 'data' into 'out':
+void decode_samples(Sample::Storage storage, uint8_t const *data, size_t begin, size_t count, float *out);
+
+//name of a storage format (for messages):
+char const *storage_name(Sample::Storage storage);
+
+} //namespace Sound
@@ -0,0 +1,513 @@
+#include "SoundMixer.hpp"
+#include "SoundStream.hpp"
+#include "SoundResampler.hpp"
+#include "SoundCodec.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOUND_MIXER_SSE
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+//------------------------ helpers --------------------------------
+
+//helper: equal-power panning
+static void compute_pan_weights(float pan, float *left, float *right) {
+	//clamp pan to -1 to 1 range:
+	pan = std::max(-1.0f, std::min(1.0f, pan));
+
+	//want left^2 + right^2 = 1.0, so use angles:
+	float ang = 0.5f * 3.1415926f * (0.5f * (pan + 1.0f));
+	*left = std::cos(ang);
+	*right = std::sin(ang);
+}
+
+//helper: 3D audio panning
+static void compute_pan_from_listener_and_position(
+	glm::vec3 const &listener_position,
+	glm::vec3 const &listener_right,
+	glm::vec3 const &source_position,
+	float source_half_radius,
+	float *left, float *right
+	) {
+	glm::vec3 to = source_position - listener_position;
+	float distance = glm::length(to);
+	//start by panning based on direction.
+	//note that for a LR fade to sound uniform, sound power (squared magnitude) should remain constant.
+	if (distance == 0.0f) {
+		*left = *right = std::sqrt(2.0f);
+	} else {
+		//amt ranges from -1 (most left) to 1 (most right):
+		float amt = glm::dot(listener_right, to) / distance;
+		//turn into an angle from 0.0f (most left) to pi/2 (most right):
+		float ang = 0.5f * 3.1415926f * (0.5f * (amt + 1.0f));
+		*left = std::cos(ang);
+		*right = std::sin(ang);
+
+		//squared distance attenuation is realistic if there are no walls,
+		// but I'm going to use linear because it's sounds better to me.
+		// (feel free to change it, of course)
+		//want att = 0.5f at distance == half_volume_radius
+		float att = 1.0f / (1.0f + (distance / source_half_radius));
+		*left *= att;
+		*right *= att;
+	}
+}
+
+//helper: ramp updates...
+constexpr float const RAMP_STEP = float(Sound::Mixer::BlockSamples) / float(Sound::Mixer::Rate);
+
+//helper: ...for single values:
+static void step_value_ramp(Sound::Ramp< float > &ramp) {
+	if (ramp.ramp < RAMP_STEP) {
+		ramp.value = ramp.target;
+		ramp.ramp = 0.0f;
+	} else {
+		ramp.value += (RAMP_STEP / ramp.ramp) * (ramp.target - ramp.value);
+		ramp.ramp -= RAMP_STEP;
+	}
+}
+
+//helper: ...for 3D positions:
+static void step_position_ramp(Sound::Ramp< glm::vec3 > &ramp) {
+	if (ramp.ramp < RAMP_STEP) {
+		ramp.value = ramp.target;
+		ramp.ramp = 0.0f;
+	} else {
+		ramp.value = glm::mix(ramp.value, ramp.target, RAMP_STEP / ramp.ramp);
+		ramp.ramp -= RAMP_STEP;
+	}
+}
+
+//helper: ...for 3D directions:
+static void step_direction_ramp(Sound::Ramp< glm::vec3 > &ramp) {
+	if (ramp.ramp < RAMP_STEP) {
+		ramp.value = ramp.target;
+		ramp.ramp = 0.0f;
+	} else {
+		//find normal to the plane containing value and target:
+		glm::vec3 norm = glm::cross(ramp.value, ramp.target);
+		if (norm == glm::vec3(0.0f)) {
+			if (ramp.target.x <= ramp.target.y && ramp.target.x <= ramp.target.z) {
+				norm = glm::vec3(1.0f, 0.0f, 0.0f);
+			} else if (ramp.target.y <= ramp.target.z) {
+				norm = glm::vec3(0.0f, 1.0f, 0.0f);
+			} else {
+				norm = glm::vec3(0.0f, 0.0f, 1.0f);
+			}
+			norm -= ramp.target * glm::dot(ramp.target, norm);
+		}
+		norm = glm::normalize(norm);
+		//find perpendicular to target in this plane:
+		glm::vec3 perp = glm::cross(norm, ramp.target);
+
+		//find angle from target to value:
+		float angle = std::acos(glm::clamp(glm::dot(ramp.value, ramp.target), -1.0f, 1.0f));
+
+		//figure out new target value by moving angle toward target:
+		angle *= (ramp.ramp - RAMP_STEP) / ramp.ramp;
+
+		ramp.value = ramp.target * std::cos(angle) + perp * std::sin(angle);
+		ramp.ramp -= RAMP_STEP;
+	}
+}
+
+//------------------------ kernels --------------------------------
+
+void Sound::mix_run_scalar(float *out, float const *data, uint32_t count, float left, float right, float left_step, float right_step) {
+	for (uint32_t k = 0; k < count; ++k) {
+		out[2*k+0] += data[k] * (left + float(k) * left_step);
+		out[2*k+1] += data[k] * (right + float(k) * right_step);
+	}
+}
+
+void Sound::mix_run_simd(float *out, float const *data, uint32_t count, float left, float right, float left_step, float right_step) {
+	uint32_t k = 0;
+#if defined(__AVX__)
+	//eight frames (sixteen output floats) at a time:
+	if (count >= 8) {
+		__m256 gain0 = _mm256_setr_ps(
+			left, right, left + left_step, right + right_step,
+			left + 2.0f * left_step, right + 2.0f * right_step, left + 3.0f * left_step, right + 3.0f * right_step);
+		__m256 gain1 = _mm256_add_ps(gain0, _mm256_setr_ps(
+			4.0f * left_step, 4.0f * right_step, 4.0f * left_step, 4.0f * right_step,
+			4.0f * left_step, 4.0f * right_step, 4.0f * left_step, 4.0f * right_step));
+		__m256 step = _mm256_setr_ps(
+			8.0f * left_step, 8.0f * right_step, 8.0f * left_step, 8.0f * right_step,
+			8.0f * left_step, 8.0f * right_step, 8.0f * left_step, 8.0f * right_step);
+		for (; k + 8 <= count; k += 8) {
+			__m256 s = _mm256_loadu_ps(data + k);
+			//duplicate each sample for left and right (unpack works within 128-bit lanes, so shuffle lanes after):
+			__m256 lo = _mm256_unpacklo_ps(s, s); //s0 s0 s1 s1 | s4 s4 s5 s5
+			__m256 hi = _mm256_unpackhi_ps(s, s); //s2 s2 s3 s3 | s6 s6 s7 s7
+			__m256 s0 = _mm256_permute2f128_ps(lo, hi, 0x20); //s0 .. s3
+			__m256 s1 = _mm256_permute2f128_ps(lo, hi, 0x31); //s4 .. s7
+			float *o = out + 2*k;
+			_mm256_storeu_ps(o + 0, _mm256_add_ps(_mm256_loadu_ps(o + 0), _mm256_mul_ps(s0, gain0)));
+			_mm256_storeu_ps(o + 8, _mm256_add_ps(_mm256_loadu_ps(o + 8), _mm256_mul_ps(s1, gain1)));
+			gain0 = _mm256_add_ps(gain0, step);
+			gain1 = _mm256_add_ps(gain1, step);
+		}
+	}
+#elif defined(SOUND_MIXER_SSE)
+	//four frames (eight output floats) at a time:
+	if (count >= 4) {
+		__m128 gain0 = _mm_setr_ps(left, right, left + left_step, right + right_step);
+		__m128 gain1 = _mm_setr_ps(left + 2.0f * left_step, right + 2.0f * right_step, left + 3.0f * left_step, right + 3.0f * right_step);
+		__m128 step = _mm_setr_ps(4.0f * left_step, 4.0f * right_step, 4.0f * left_step, 4.0f * right_step);
+		for (; k + 4 <= count; k += 4) {
+			__m128 s = _mm_loadu_ps(data + k);
+			float *o = out + 2*k;
+			_mm_storeu_ps(o + 0, _mm_add_ps(_mm_loadu_ps(o + 0), _mm_mul_ps(_mm_unpacklo_ps(s, s), gain0)));
+			_mm_storeu_ps(o + 4, _mm_add_ps(_mm_loadu_ps(o + 4), _mm_mul_ps(_mm_unpackhi_ps(s, s), gain1)));
+			gain0 = _mm_add_ps(gain0, step);
+			gain1 = _mm_add_ps(gain1, step);
+		}
+	}
+#endif
+	//leftover frames:
+	if (k < count) {
+		mix_run_scalar(out + 2*k, data + k, count - k, left + float(k) * left_step, right + float(k) * right_step, left_step, right_step);
+	}
+}
+
+//------------------------ Mixer --------------------------------
+
+void Sound::Mixer::start(uint32_t v) {
+	assert(v < MaxVoices);
+	Voice &voice = voices[v];
+	assert(voice.active_index == -1U);
+	assert(voice.stream || voice.i < voice.size);
+	voice.real = false;
+	voice.fresh = true;
+	voice.active_index = active_voice_count;
+	active_voices[active_voice_count++] = v;
+}
+
+void Sound::Mixer::finish(uint32_t v) {
+	Voice &voice = voices[v];
+	assert(voice.active_index < active_voice_count);
+	uint32_t last = active_voices[--active_voice_count];
+	active_voices[voice.active_index] = last;
+	voices[last].active_index = voice.active_index;
+	voice.active_index = -1U;
+	voice.data = nullptr;
+	voice.encoded = nullptr;
+	voice.stream = nullptr;
+	assert(finished_count < MaxVoices);
+	finished[finished_count++] = v;
+}
+
+bool Sound::Mixer::mix_stream(Voice &voice, MixKernel mix_kernel, float *out, float left, float right, float left_step, float right_step) {
+	SampleStream &stream = *voice.stream;
+
+	//wait (silently) until the decoder has started on this voice's epoch:
+	uint64_t published = stream.published.load(std::memory_order_acquire);
+	if (uint16_t(published >> 48) != voice.epoch) return false;
+	if (!voice.stream_started) {
+		stream.read.store(published & 0xffffffffffffULL, std::memory_order_release);
+		voice.stream_started = true;
+	}
+
+	uint64_t read = stream.read.load(std::memory_order_relaxed);
+	uint64_t write = stream.write.load(std::memory_order_acquire);
+	uint64_t end = stream.end.load(std::memory_order_acquire);
+
+	//mix in runs that end at the end of the block, the end of the decoded data, or the end of the ring:
+	bool ended = false;
+	for (uint32_t o = 0; o < BlockSamples; /* later */) {
+		if (read == end) {
+			ended = true;
+			break;
+		}
+		uint64_t available = std::min(write, end) - read;
+		if (available == 0) {
+			++stream_underruns;
+			break;
+		}
+		uint32_t count = uint32_t(std::min< uint64_t >({BlockSamples - o, available, SampleStream::RingSize - read % SampleStream::RingSize}));
+		if (mix_kernel) {
+			mix_kernel(out + 2 * o, stream.ring.get() + read % SampleStream::RingSize, count,
+				left + float(o) * left_step, right + float(o) * right_step,
+				left_step, right_step);
+		}
+		o += count;
+		read += count;
+	}
+
+	//(lets the decoder reuse that part of the ring)
+	stream.read.store(read, std::memory_order_release);
+	return ended;
+}
+
+bool Sound::Mixer::mix_resampled(Voice &voice, float rate, MixKernel mix_kernel, float *out, float left, float right, float left_step, float right_step) {
+	rate = std::max(MinRate, std::min(MaxRate, rate));
+	uint64_t step = uint64_t(double(rate) * 4294967296.0);
+	uint64_t end = uint64_t(voice.size) << 32;
+	uint64_t position = (uint64_t(voice.i) << 32) | voice.frac;
+	bool ended = false;
+
+	if (!mix_kernel) {
+		//virtual voices just advance:
+		position += step * BlockSamples;
+		if (position >= end) {
+			if (voice.loop) position %= end;
+			else ended = true;
+		}
+	} else {
+		ResampleFilter const &filter = playback_filter(rate);
+		uint32_t half = filter.taps / 2;
+
+		//resample into 'scratch' in runs whose taps are all inside the data (the fast case),
+		// or one sample at a time near the ends (where taps wrap around, or read silence):
+		uint32_t produced = 0;
+		while (produced < BlockSamples) {
+			if (position >= end) {
+				if (voice.loop) {
+					position %= end;
+				} else {
+					ended = true;
+					break;
+				}
+			}
+			size_t i = size_t(position >> 32);
+			if (i + 1 >= half && i + half < voice.size) {
+				uint64_t last = ((uint64_t(voice.size) - half) << 32) - 1; //last position with all taps inside
+				uint32_t count = uint32_t(std::min< uint64_t >(BlockSamples - produced, (last - position) / step + 1));
+				resample_run(scratch + produced, voice.data, position, step, count, filter);
+				produced += count;
+				position += step * count;
+			} else {
+				float taps[ResampleFilter::MaxTaps];
+				for (uint32_t k = 0; k < filter.taps; ++k) {
+					int64_t j = int64_t(i) - int64_t(half - 1) + int64_t(k);
+					if (voice.loop) {
+						j %= int64_t(voice.size);
+						if (j < 0) j += int64_t(voice.size);
+						taps[k] = voice.data[j];
+					} else {
+						taps[k] = (j >= 0 && j < int64_t(voice.size) ? voice.data[j] : 0.0f);
+					}
+				}
+				resample_run(scratch + produced, taps, (uint64_t(half - 1) << 32) | uint32_t(position), step, 1, filter);
+				produced += 1;
+				position += step;
+			}
+		}
+		mix_kernel(out, scratch, produced, left, right, left_step, right_step);
+	}
+
+	voice.i = size_t(position >> 32);
+	voice.frac = uint32_t(position);
+	return ended;
+}
+
+//helper: decode samples 'first' .. 'first + count - 1' of a compressed voice
+// (wrapping around if it loops, silence past the ends if it doesn't):
+static void decode_window(Sound::Mixer::Voice const &voice, int64_t first, uint32_t count, float *out) {
+	int64_t size = int64_t(voice.size);
+	for (uint32_t o = 0; o < count; /* later */) {
+		int64_t j = first + int64_t(o);
+		if (voice.loop) {
+			j %= size;
+			if (j < 0) j += size;
+		} else if (j < 0 || j >= size) {
+			//silence up to the start of the data or to the end of the window:
+			uint32_t n = (j < 0 ? uint32_t(std::min< int64_t >(count - o, -j)) : count - o);
+			std::fill(out + o, out + o + n, 0.0f);
+			o += n;
+			continue;
+		}
+		uint32_t n = uint32_t(std::min< int64_t >(count - o, size - j));
+		decode_samples(voice.storage, voice.encoded, size_t(j), n, out + o);
+		o += n;
+	}
+}
+
+bool Sound::Mixer::mix_encoded(Voice &voice, float rate, MixKernel mix_kernel, float *out, float left, float right, float left_step, float right_step) {
+	bool resampled = (rate != 1.0f || voice.frac != 0);
+	rate = std::max(MinRate, std::min(MaxRate, rate));
+	uint64_t step = (resampled ? uint64_t(double(rate) * 4294967296.0) : (uint64_t(1) << 32));
+	uint64_t end = uint64_t(voice.size) << 32;
+	uint64_t position = (uint64_t(voice.i) << 32) | voice.frac;
+
+	//(a voice that doesn't loop ends after the last output that starts before the end)
+	uint32_t frames = BlockSamples;
+	if (!voice.loop) frames = uint32_t(std::min< uint64_t >(BlockSamples, (end - position + step - 1) / step));
+
+	if (mix_kernel && frames > 0) {
+		if (!resampled) {
+			decode_window(voice, int64_t(voice.i), frames, window);
+			mix_kernel(out, window, frames, left, right, left_step, right_step);
+		} else {
+			//decode every input the filter will read, then resample from the window:
+			ResampleFilter const &filter = playback_filter(rate);
+			uint32_t half = filter.taps / 2;
+			int64_t first = int64_t(position >> 32) - int64_t(half - 1);
+			int64_t last = int64_t((position + step * (frames - 1)) >> 32) + int64_t(half);
+			assert(last - first + 1 <= int64_t(sizeof(window) / sizeof(window[0])));
+			decode_window(voice, first, uint32_t(last - first + 1), window);
+			resample_run(scratch, window, (uint64_t(half - 1) << 32) | uint32_t(position), step, frames, filter);
+			mix_kernel(out, scratch, frames, left, right, left_step, right_step);
+		}
+	}
+
+	position += step * frames;
+	bool ended = false;
+	if (position >= end) {
+		if (voice.loop) position %= end;
+		else ended = true;
+	}
+	voice.i = size_t(position >> 32);
+	voice.frac = uint32_t(position);
+	return ended;
+}
+
+void Sound::Mixer::mix(float *out) {
+	//zero the output buffer:
+	std::fill(out, out + 2 * BlockSamples, 0.0f);
+
+	//update global values:
+	float start_volume = volume.value;
+	glm::vec3 start_position = listener_position.value;
+	glm::vec3 start_right = listener_right.value;
+
+	step_value_ramp(volume);
+	step_position_ramp(listener_position);
+	step_direction_ramp(listener_right);
+
+	float end_volume = volume.value;
+	glm::vec3 end_position = listener_position.value;
+	glm::vec3 end_right = listener_right.value;
+
+	//figure out every voice's gains for this block:
+	for (uint32_t a = 0; a < active_voice_count; ++a) {
+		Voice &voice = voices[active_voices[a]];
+
+		//Figure out voice panning/volume at start...
+		if (voice.is_3D) {
+			//3D panning
+			compute_pan_from_listener_and_position(
+				start_position, start_right,
+				voice.position.value,
+				voice.half_volume_radius.value,
+				&voice.start_gain.x, &voice.start_gain.y);
+
+			step_position_ramp(voice.position);
+			step_value_ramp(voice.half_volume_radius);
+		} else {
+			//2D panning
+			compute_pan_weights(voice.pan.value, &voice.start_gain.x, &voice.start_gain.y);
+
+			step_value_ramp(voice.pan);
+		}
+		voice.start_gain *= start_volume * voice.volume.value;
+
+		step_value_ramp(voice.volume);
+
+		//..and end of the mix period:
+		if (voice.is_3D) {
+			//3D panning
+			compute_pan_from_listener_and_position(
+				end_position, end_right,
+				voice.position.value,
+				voice.half_volume_radius.value,
+				&voice.end_gain.x, &voice.end_gain.y);
+		} else {
+			//2D panning
+			compute_pan_weights(voice.pan.value, &voice.end_gain.x, &voice.end_gain.y);
+		}
+
+		voice.end_gain *= end_volume * voice.volume.value;
+	}
+
+	//pick the voices to mix: the highest-priority audible ones (loudest first), up to real_voice_limit:
+	uint32_t selected_count = 0;
+	for (uint32_t a = 0; a < active_voice_count; ++a) {
+		uint32_t v = active_voices[a];
+		Voice &voice = voices[v];
+		voice.selected = false;
+		float loudness = std::max(std::max(voice.start_gain.x, voice.start_gain.y), std::max(voice.end_gain.x, voice.end_gain.y));
+		if (loudness >= AudibleGain) {
+			voice.loudness = loudness;
+			ranked[selected_count++] = v;
+		}
+	}
+	if (selected_count > real_voice_limit) {
+		std::nth_element(ranked, ranked + real_voice_limit, ranked + selected_count, [this](uint32_t a, uint32_t b) {
+			if (voices[a].priority != voices[b].priority) return voices[a].priority > voices[b].priority;
+			return voices[a].loudness > voices[b].loudness;
+		});
+		selected_count = real_voice_limit;
+	}
+	for (uint32_t r = 0; r < selected_count; ++r) {
+		voices[ranked[r]].selected = true;
+	}
+
+	//add audio from each real voice into the buffer, and just advance virtual ones:
+	real_voice_count = 0;
+	virtual_voice_count = 0;
+	for (uint32_t a = 0; a < active_voice_count; /* later */) {
+		uint32_t v = active_voices[a];
+		Voice &voice = voices[v];
+
+		//voices changing between real and virtual fade in or out over the block (to avoid clicks),
+		// except that new voices start right away:
+		if (voice.selected && !voice.real && !voice.fresh) voice.start_gain = glm::vec2(0.0f);
+		if (!voice.selected && voice.real) voice.end_gain = glm::vec2(0.0f);
+		MixKernel mix_kernel = (voice.selected || voice.real ? kernel : nullptr);
+		voice.real = voice.selected;
+		voice.fresh = false;
+		if (voice.real) ++real_voice_count;
+		else ++virtual_voice_count;
+
+		//gain moves smoothly from start to end by this much per sample:
+		glm::vec2 step = (voice.end_gain - voice.start_gain) / float(BlockSamples);
+
+		//(rate changes are applied per block, at the average rate over the block)
+		float rate = voice.rate.value;
+		step_value_ramp(voice.rate);
+		rate = 0.5f * (rate + voice.rate.value);
+
+		bool ended = false;
+		if (voice.stream) {
+			ended = mix_stream(voice, mix_kernel, out, voice.start_gain.x, voice.start_gain.y, step.x, step.y);
+		} else if (voice.storage != Sample::Float) {
+			ended = mix_encoded(voice, rate, mix_kernel, out, voice.start_gain.x, voice.start_gain.y, step.x, step.y);
+		} else if (rate != 1.0f || voice.frac != 0) {
+			ended = mix_resampled(voice, rate, mix_kernel, out, voice.start_gain.x, voice.start_gain.y, step.x, step.y);
+		} else {
+			assert(voice.i < voice.size);
+
+			//mix in runs that end at the end of the block or the end of the data:
+			for (uint32_t o = 0; o < BlockSamples; /* later */) {
+				uint32_t count = uint32_t(std::min< size_t >(BlockSamples - o, voice.size - voice.i));
+				if (mix_kernel) {
+					mix_kernel(out + 2 * o, voice.data + voice.i, count,
+						voice.start_gain.x + float(o) * step.x, voice.start_gain.y + float(o) * step.y,
+						step.x, step.y);
+				}
+				o += count;
+				voice.i += count;
+				if (voice.i == voice.size) {
+					if (voice.loop) {
+						voice.i = 0;
+					} else {
+						ended = true;
+						break;
+					}
+				}
+			}
+		}
+
+		if (ended
+		 || (voice.stopping && voice.volume.value == 0.0f)) { //voice has finished
+			finish(v); //n.b. moves the last active voice to position 'a'
+		} else {
+			++a;
+		}
+	}
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+/*
+ * Sound::Mixer is the part of the audio system that turns playing voices into
+ * stereo output, one block at a time. Sound.cpp runs one from the SDL audio
+ * callback; it uses no SDL, so it can also be run (and benchmarked) offline.
+ *
+ * Playing voices are kept packed at the front of 'active_voices', and each
+ * voice is mixed in contiguous runs (up to the end of the block, or to the
+ * sample's end / loop point) by a SIMD kernel (SSE, or AVX when built with it).
+ *
+ * Streamed voices (see SoundStream.hpp) are mixed the same way, in runs of
+ * whatever the stream's decoder thread has put in its ring buffer.
+ *
+ * Voices playing at a rate other than 1 (see PlayingSample::set_rate) are
+ * resampled into a scratch buffer first (see SoundResampler.hpp), then mixed
+ * the same way; their positions have a 32-bit fractional part in 'frac'.
+ *
+ * Voices playing compressed samples (see Sample::Storage) decode just the
+ * stretch of the sample each block reads into 'window' (see SoundCodec.hpp),
+ * then are mixed (or resampled and mixed) from there.
+ *
+ * At most 'real_voice_limit' voices are mixed per block: the highest-priority
+ * audible ones, loudest first. The rest are "virtual" -- their positions keep
+ * advancing but they aren't mixed -- and become real again once they rank
+ * high enough. Voices fade over a block when switching, to avoid clicks.
+ *
+ */
+
+#include "Sound.hpp"
+#include "SoundResampler.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+namespace Sound {
+
+struct SampleStream;
+
+//mix 'count' samples of mono 'data' into interleaved stereo 'out':
+// out[2k] += data[k] * (left + k * left_step); out[2k+1] += data[k] * (right + k * right_step)
+typedef void (*MixKernel)(float *out, float const *data, uint32_t count, float left, float right, float left_step, float right_step);
+
+void mix_run_scalar(float *out, float const *data, uint32_t count, float left, float right, float left_step, float right_step);
+void mix_run_simd(float *out, float const *data, uint32_t count, float left, float right, float left_step, float right_step); //(same as scalar if no SIMD is available)
+
+struct Mixer {
+	static constexpr uint32_t Rate = Sound::Rate;
+	static constexpr uint32_t BlockSamples = Sound::BlockSamples; //stereo frames per mix() call
+
+	struct Voice {
+		float const *data = nullptr; //mono sample data (not owned)
+		uint8_t const *encoded = nullptr; //...or compressed data, for storage other than Float (not owned)
+		Sample::Storage storage = Sample::Float;
+		size_t size = 0;
+		size_t i = 0; //next position in data
+		uint32_t frac = 0; //fractional part of the position (in 1/2^32 samples; only nonzero for resampled voices)
+		uint32_t generation = 0;
+		uint32_t active_index = -1U; //position in active_voices (-1U if not playing)
+		bool loop = false;
+		bool is_3D = false;
+		bool stopping = false; //finishes once volume reaches zero
+		Ramp< float > volume = Ramp< float >(1.0f);
+		Ramp< float > pan = Ramp< float >(0.0f); //"2D" voices
+		Ramp< glm::vec3 > position = Ramp< glm::vec3 >(0.0f); //"3D" voices
+		Ramp< float > half_volume_radius = Ramp< float >(1.0f); //"3D" voices
+		Ramp< float > rate = Ramp< float >(1.0f); //playback rate (not streamed voices)
+		//streamed voices read from 'stream' instead of data/size/i (looping is done by its decoder):
+		SampleStream *stream = nullptr;
+		uint16_t epoch = 0; //stream epoch this voice plays (silent until the decoder publishes it)
+		bool stream_started = false; //has 'read' been moved to the start of the epoch?
+		int32_t priority = 0; //higher priority voices are mixed first (loudness breaks ties)
+		//used by mix():
+		bool real = false; //was mixed in the last block
+		bool fresh = false; //hasn't been through mix() yet
+		bool selected = false; //to be mixed in this block
+		float loudness = 0.0f;
+		glm::vec2 start_gain = glm::vec2(0.0f), end_gain = glm::vec2(0.0f); //left/right gain over this block
+	};
+
+	//voices quieter than this (-80dB) are never mixed:
+	static constexpr float AudibleGain = 1e-4f;
+
+	//start voice 'v' (whose fields have been filled in) playing:
+	void start(uint32_t v);
+	//stop voice 'v' now, adding it to 'finished':
+	void finish(uint32_t v);
+
+	//overwrite 'out' with the next BlockSamples interleaved stereo frames:
+	// (voices that run out of data or finish stopping are removed and added to 'finished')
+	void mix(float *out);
+
+	Voice voices[MaxVoices];
+
+	//indices of playing voices, packed at the front (so mixing only visits those):
+	uint32_t active_voices[MaxVoices];
+	uint32_t active_voice_count = 0;
+
+	//voices that have finished since the caller last cleared this list:
+	uint32_t finished[MaxVoices];
+	uint32_t finished_count = 0;
+
+	//most voices mixed per block (others are virtual):
+	uint32_t real_voice_limit = 64;
+	//voices that were real / virtual in the last block:
+	uint32_t real_voice_count = 0;
+	uint32_t virtual_voice_count = 0;
+
+	//blocks where a streamed voice ran out of decoded data and was padded with silence:
+	uint32_t stream_underruns = 0;
+
+	//global volume control:
+	Ramp< float > volume = Ramp< float >(1.0f);
+	//global listener information:
+	Ramp< glm::vec3 > listener_position = Ramp< glm::vec3 >(0.0f); //listener's location
+	Ramp< glm::vec3 > listener_right = Ramp< glm::vec3 >(1.0f, 0.0f, 0.0f); //unit vector pointing to listener's right
+
+	MixKernel kernel = mix_run_simd;
+
+	//helpers for mix():
+	uint32_t ranked[MaxVoices]; //candidates for mixing
+	//mix from a streamed voice's ring buffer (or just advance, if mix_kernel is null); returns true if the stream has ended:
+	bool mix_stream(Voice &voice, MixKernel mix_kernel, float *out, float left, float right, float left_step, float right_step);
+	//mix a voice playing at 'rate' through the resampler (or just advance, if mix_kernel is null); returns true if the voice has ended:
+	bool mix_resampled(Voice &voice, float rate, MixKernel mix_kernel, float *out, float left, float right, float left_step, float right_step);
+	float scratch[BlockSamples]; //resampled voice data
+	//mix a voice playing compressed data (or just advance, if mix_kernel is null); returns true if the voice has ended:
+	bool mix_encoded(Voice &voice, float rate, MixKernel mix_kernel, float *out, float left, float right, float left_step, float right_step);
+	float window[uint32_t(MaxRate) * BlockSamples + ResampleFilter::MaxTaps]; //decoded voice data (enough for a block at MaxRate)
+};
+
+} //namespace Sound
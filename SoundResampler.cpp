@@ -0,0 +1,137 @@
+#include "SoundResampler.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOUND_RESAMPLER_SSE
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+//helper: zeroth-order modified Bessel function of the first kind (for the Kaiser window):
+static double bessel_i0(double x) {
+	double sum = 1.0;
+	double term = 1.0;
+	for (uint32_t k = 1; k < 50; ++k) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if (term < sum * 1e-12) break;
+	}
+	return sum;
+}
+
+Sound::ResampleFilter::ResampleFilter(uint32_t taps_, float cutoff, float kaiser_beta) : taps(taps_) {
+	assert(taps % 4 == 0 && taps > 0 && taps <= MaxTaps);
+	double const Pi = 3.14159265358979323846;
+	double half = double(taps / 2);
+
+	//coefficients for each phase (fractional offset phase / Phases):
+	std::vector< double > rows((Phases + 1) * taps);
+	for (uint32_t p = 0; p <= Phases; ++p) {
+		double frac = double(p) / double(Phases);
+		double sum = 0.0;
+		for (uint32_t k = 0; k < taps; ++k) {
+			//distance from the output position to input sample k:
+			double x = double(k) - (half - 1.0) - frac;
+			double sinc = (x == 0.0 ? 1.0 : std::sin(2.0 * Pi * cutoff * x) / (2.0 * Pi * cutoff * x));
+			double w = x / half;
+			double window = (std::abs(w) >= 1.0 ? 0.0 : bessel_i0(kaiser_beta * std::sqrt(1.0 - w * w)) / bessel_i0(kaiser_beta));
+			rows[p * taps + k] = 2.0 * cutoff * sinc * window;
+			sum += rows[p * taps + k];
+		}
+		//(normalize so every phase passes DC unchanged)
+		for (uint32_t k = 0; k < taps; ++k) {
+			rows[p * taps + k] /= sum;
+		}
+	}
+
+	table.resize(Phases * 2 * taps + 2 * taps);
+	for (uint32_t p = 0; p <= Phases; ++p) {
+		float *row = table.data() + p * 2 * taps;
+		for (uint32_t k = 0; k < taps; ++k) {
+			row[k] = float(rows[p * taps + k]);
+			row[taps + k] = (p < Phases ? float(rows[(p + 1) * taps + k] - rows[p * taps + k]) : 0.0f);
+		}
+	}
+}
+
+void Sound::resample_run(float *out, float const *data, uint64_t position, uint64_t step, uint32_t count, ResampleFilter const &filter) {
+	uint32_t taps = filter.taps;
+	constexpr uint32_t FracBits = 32 - ResampleFilter::PhaseBits; //bits of fraction between phases
+	for (uint32_t o = 0; o < count; ++o, position += step) {
+		float const *d = data + (position >> 32) - (taps / 2 - 1);
+		uint32_t frac = uint32_t(position);
+		float const *row = filter.table.data() + (frac >> FracBits) * 2 * taps;
+		float t = float(frac & ((1U << FracBits) - 1)) * (1.0f / float(1U << FracBits));
+#if defined(SOUND_RESAMPLER_SSE)
+		uint32_t k = 0;
+		__m128 tt = _mm_set1_ps(t);
+		__m128 sum = _mm_setzero_ps();
+#if defined(__AVX__)
+		//eight taps at a time:
+		__m256 tt8 = _mm256_set1_ps(t);
+		__m256 sum8 = _mm256_setzero_ps();
+		for (; k + 8 <= taps; k += 8) {
+			__m256 coef = _mm256_add_ps(_mm256_loadu_ps(row + k), _mm256_mul_ps(tt8, _mm256_loadu_ps(row + taps + k)));
+			sum8 = _mm256_add_ps(sum8, _mm256_mul_ps(coef, _mm256_loadu_ps(d + k)));
+		}
+		sum = _mm_add_ps(_mm256_castps256_ps128(sum8), _mm256_extractf128_ps(sum8, 1));
+#endif
+		//four taps at a time:
+		for (; k < taps; k += 4) {
+			__m128 coef = _mm_add_ps(_mm_loadu_ps(row + k), _mm_mul_ps(tt, _mm_loadu_ps(row + taps + k)));
+			sum = _mm_add_ps(sum, _mm_mul_ps(coef, _mm_loadu_ps(d + k)));
+		}
+		//add the four lanes:
+		__m128 swapped = _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(2, 3, 0, 1));
+		sum = _mm_add_ps(sum, swapped);
+		sum = _mm_add_ss(sum, _mm_movehl_ps(swapped, sum));
+		out[o] = _mm_cvtss_f32(sum);
+#else
+		float sum = 0.0f;
+		for (uint32_t k = 0; k < taps; ++k) {
+			sum += (row[k] + t * row[taps + k]) * d[k];
+		}
+		out[o] = sum;
+#endif
+	}
+}
+
+//playback filters for rates up to each of these (made before main(), so the mixer never builds one):
+// (higher rates cut off lower, and need proportionally longer filters for the same transition width)
+static float const PlaybackRates[] = { 1.0f, 1.25f, 1.5f, 2.0f, 2.5f, 3.0f, Sound::MaxRate };
+static Sound::ResampleFilter const PlaybackFilters[] = {
+	Sound::ResampleFilter(32, 0.45f / PlaybackRates[0], 8.0f),
+	Sound::ResampleFilter(40, 0.45f / PlaybackRates[1], 8.0f),
+	Sound::ResampleFilter(48, 0.45f / PlaybackRates[2], 8.0f),
+	Sound::ResampleFilter(64, 0.45f / PlaybackRates[3], 8.0f),
+	Sound::ResampleFilter(80, 0.45f / PlaybackRates[4], 8.0f),
+	Sound::ResampleFilter(96, 0.45f / PlaybackRates[5], 8.0f),
+	Sound::ResampleFilter(Sound::ResampleFilter::MaxTaps, 0.45f / PlaybackRates[6], 8.0f),
+};
+static_assert(sizeof(PlaybackRates) / sizeof(PlaybackRates[0]) == sizeof(PlaybackFilters) / sizeof(PlaybackFilters[0]), "a filter for every rate");
+
+Sound::ResampleFilter const &Sound::playback_filter(float rate) {
+	uint32_t f = 0;
+	while (f + 1 < sizeof(PlaybackRates) / sizeof(PlaybackRates[0]) && rate > PlaybackRates[f]) ++f;
+	return PlaybackFilters[f];
+}
+
+void Sound::resample(std::vector< float > const &in, uint32_t in_rate, uint32_t out_rate, std::vector< float > *out_) {
+	assert(out_);
+	auto &out = *out_;
+	assert(in_rate > 0 && out_rate > 0);
+
+	//when downsampling, cut off below the output's Nyquist frequency:
+	ResampleFilter filter(64, 0.47f * std::min(1.0f, float(out_rate) / float(in_rate)), 9.0f);
+	uint32_t half = filter.taps / 2;
+
+	//pad with silence so every output's taps are in range:
+	std::vector< float > padded(half + in.size() + half + 1, 0.0f);
+	std::copy(in.begin(), in.end(), padded.begin() + half);
+
+	uint64_t step = (uint64_t(in_rate) << 32) / out_rate;
+	out.resize(size_t((uint64_t(in.size()) * out_rate + in_rate - 1) / in_rate));
+	resample_run(out.data(), padded.data(), uint64_t(half) << 32, step, uint32_t(out.size()), filter);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+ * Polyphase windowed-sinc resampling, used to convert samples to 48kHz when
+ *  they are loaded (see load_wav.cpp) and by Sound::Mixer to play voices at
+ *  other rates (see PlayingSample::set_rate).
+ *
+ * A ResampleFilter tabulates a Kaiser-windowed sinc lowpass at Phases
+ *  fractional offsets; output samples interpolate linearly between the two
+ *  nearest phases and take a 'taps'-long dot product with the input (with SSE,
+ *  four taps at a time, or AVX when built with it, eight).
+ *
+ * Positions in the input are 32.32 fixed point (sample index << 32 | fraction).
+ *
+ * This code uses no SDL or OpenGL.
+ *
+ */
+
+#include <cstdint>
+#include <vector>
+
+namespace Sound {
+
+//playback rates are clamped to this range (1 = original pitch, 2 = an octave up):
+constexpr float MinRate = 1.0f / 16.0f;
+constexpr float MaxRate = 4.0f;
+
+struct ResampleFilter {
+	//'taps' (a multiple of four, up to MaxTaps) input samples per output sample; 'cutoff' in cycles per input sample (0.5 = Nyquist):
+	ResampleFilter(uint32_t taps, float cutoff, float kaiser_beta);
+
+	static constexpr uint32_t MaxTaps = 128;
+	static constexpr uint32_t PhaseBits = 8;
+	static constexpr uint32_t Phases = 1 << PhaseBits;
+
+	uint32_t taps;
+	//for each phase 0 .. Phases (inclusive), 'taps' coefficients and then 'taps' differences to the next phase:
+	std::vector< float > table;
+};
+
+//compute 'count' output samples starting at 'position' in 'data', advancing 'step' per output:
+// (reads data[(position >> 32) - (taps/2 - 1)] through data[(position >> 32) + taps/2] for each output)
+void resample_run(float *out, float const *data, uint64_t position, uint64_t step, uint32_t count, ResampleFilter const &filter);
+
+//filter for playing back at 'rate' (lower cutoff for higher rates, so they don't alias):
+ResampleFilter const &playback_filter(float rate);
+
+//convert all of 'in' from 'in_rate' to 'out_rate' samples per second, with a longer filter than playback uses:
+void resample(std::vector< float > const &in, uint32_t in_rate, uint32_t out_rate, std::vector< float > *out);
+
+} //namespace Sound
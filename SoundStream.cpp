@@ -0,0 +1,121 @@
+#include "SoundStream.hpp"
+
+#include <opusfile.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+//opus frames are at most 120ms, so the decoder waits for this much room before reading:
+static constexpr uint32_t MaxFrameSamples = 5760;
+
+Sound::SampleStream::SampleStream(std::string const &filename_) : filename(filename_), file(filename_) {
+	int err = 0;
+	op = op_open_memory(reinterpret_cast< unsigned char const * >(file.data), file.size, &err);
+	if (err != 0 || op == nullptr) {
+		throw std::runtime_error("opusfile error " + std::to_string(err) + " opening \"" + filename + "\".");
+	}
+	ogg_int64_t total = op_pcm_total(op, -1);
+	length = (total > 0 ? uint64_t(total) : 0);
+	compressed_size = file.size;
+
+	ring.reset(new float[RingSize]);
+	std::fill(ring.get(), ring.get() + RingSize, 0.0f);
+
+	decoder = std::thread(&SampleStream::decode, this);
+}
+
+Sound::SampleStream::~SampleStream() {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		quit = true;
+	}
+	wake.notify_one();
+	decoder.join();
+	op_free(op);
+}
+
+uint16_t Sound::SampleStream::restart(uint64_t position, bool loop) {
+	epoch += 1;
+	if (epoch == 0) epoch = 1; //(epoch 0 means "nothing decoded yet")
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		request_epoch = epoch;
+		request_position = position;
+		request_loop = loop;
+	}
+	wake.notify_one();
+	return epoch;
+}
+
+void Sound::SampleStream::decode() {
+	std::vector< float > pcm(2 * MaxFrameSamples);
+
+	uint16_t current = 0; //epoch being decoded
+	bool loop = false;
+	bool at_end = true; //nothing (more) to decode until the next request
+	uint64_t wrapped_at = -1ULL; //'write' at the last loop (so an empty file doesn't loop forever)
+
+	std::unique_lock< std::mutex > lock(mutex);
+	while (!quit) {
+		if (request_epoch != current) {
+			//start decoding from the requested position:
+			current = request_epoch;
+			loop = request_loop;
+			uint64_t position = request_position;
+			lock.unlock();
+
+			if (length != 0 && position >= length) {
+				position = (loop ? position % length : length);
+			}
+			int ret = op_pcm_seek(op, ogg_int64_t(position));
+			if (ret != 0) {
+				std::cerr << "WARNING: opusfile error " << ret << " seeking in \"" << filename << "\"." << std::endl;
+			}
+			//(the mixer picks up the new epoch from 'published', so reset 'end' first)
+			uint64_t w = write.load(std::memory_order_relaxed);
+			end.store(ret == 0 ? -1ULL : w, std::memory_order_release);
+			published.store((uint64_t(current) << 48) | w, std::memory_order_release);
+			at_end = (ret != 0);
+			wrapped_at = -1ULL;
+
+			lock.lock();
+			continue;
+		}
+		if (at_end) {
+			wake.wait(lock);
+			continue;
+		}
+
+		//decode more if there is room for another frame:
+		// (the mixer only moves 'read' forward, so this room can't shrink before the writes below)
+		uint64_t w = write.load(std::memory_order_relaxed);
+		uint64_t room = RingSize - (w - read.load(std::memory_order_acquire));
+		if (room < MaxFrameSamples) {
+			wake.wait_for(lock, std::chrono::milliseconds(5));
+			continue;
+		}
+		lock.unlock();
+
+		int ret = op_read_float_stereo(op, pcm.data(), int(pcm.size()));
+		if (ret > 0) {
+			for (uint32_t i = 0; i < uint32_t(ret); ++i) {
+				ring[(w + i) % RingSize] = (pcm[2*i] + pcm[2*i+1]) * 0.5f; //downmix to mono by averaging (as load_opus does)
+			}
+			write.store(w + ret, std::memory_order_release);
+		} else if (ret == 0 && loop && w != wrapped_at && op_pcm_seek(op, 0) == 0) {
+			//wrapped around to the start
+			wrapped_at = w;
+		} else {
+			if (ret < 0) {
+				std::cerr << "WARNING: opusfile read error " << ret << " streaming \"" << filename << "\"." << std::endl;
+			}
+			end.store(w, std::memory_order_release);
+			at_end = true;
+		}
+
+		lock.lock();
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+/*
+ * A SampleStream plays a long '.opus' file (e.g., music) without decoding all of
+ *  it into memory: it keeps the compressed file (memory-mapped, or in the asset
+ *  archive) and a decoder thread keeps a small ring buffer of decoded samples
+ *  filled ahead of the mixer.
+ *
+ * The decoder thread also handles looping (it wraps back to the start of the
+ *  file) and seeking. The mixer (Sound::Mixer) reads the ring buffer without
+ *  locking; restart() bumps an 'epoch' so the mixer can tell when decoded data
+ *  from the new position starts.
+ *
+ * Made by Sound::Sample(filename, Sound::Sample::Streamed); a stream plays on at
+ *  most one voice at a time (playing it again restarts it).
+ *
+ * This code uses no SDL or OpenGL.
+ *
+ */
+
+#include "AssetArchive.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct OggOpusFile;
+
+namespace Sound {
+
+struct SampleStream {
+	//open an '.opus' file and start its (idle) decoder thread; throws on error:
+	SampleStream(std::string const &filename);
+	~SampleStream();
+
+	//samples decoded ahead of the mixer (~0.7 seconds at 48kHz):
+	static constexpr uint32_t RingSize = 1 << 15;
+
+	//--- game thread ---
+
+	//(re)start decoding at 'position' (in 48kHz samples), wrapping to the start at the end if 'loop':
+	// returns the epoch the mixer should wait for (see 'published', below)
+	uint16_t restart(uint64_t position, bool loop);
+
+	uint64_t length = 0; //in 48kHz samples (0 if the file doesn't say)
+	size_t compressed_size = 0; //bytes of the '.opus' file
+
+	//voice playing this stream (so playing it again can stop the old voice):
+	uint32_t voice = -1U;
+	uint32_t generation = 0;
+
+	//--- shared with the mixer ---
+
+	std::unique_ptr< float[] > ring; //RingSize mono samples; position p is at ring[p % RingSize]
+	//positions count samples ever decoded into the ring:
+	std::atomic< uint64_t > published{0}; //(epoch << 48) | position of the epoch's first sample
+	std::atomic< uint64_t > write{0}; //decoded up to here (written by the decoder)
+	std::atomic< uint64_t > read{0}; //mixed up to here (written by the mixer)
+	std::atomic< uint64_t > end{-1ULL}; //position where this epoch's data ends (-1 while more is coming)
+
+	//--- internals ---
+	std::string filename;
+	AssetFile file; //compressed bytes; must outlive 'op'
+	OggOpusFile *op = nullptr;
+	uint16_t epoch = 0; //last epoch given out by restart()
+
+	std::mutex mutex; //guards the request_* values and quit:
+	std::condition_variable wake;
+	uint16_t request_epoch = 0;
+	uint64_t request_position = 0;
+	bool request_loop = false;
+	bool quit = false;
+
+	std::thread decoder;
+	void decode(); //decoder thread
+};
+
+} //namespace Sound
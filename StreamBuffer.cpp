@@ -0,0 +1,138 @@
+#include "StreamBuffer.hpp"
+
+#include "Load.hpp"
+#include "gl_errors.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+
+StreamBuffer::StreamBuffer(GLsizeiptr size_) : size(size_) {
+	assert(size > 0);
+	if (char const *env = std::getenv("STREAM_BUFFER_ORPHAN")) {
+		orphan_every_map = (std::atoi(env) != 0);
+	}
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+StreamBuffer::~StreamBuffer() {
+	for (auto const &f : fenced) {
+		glDeleteSync(f.sync);
+	}
+	fenced.clear();
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+void StreamBuffer::orphan() {
+	//(expects buffer to be bound to GL_ARRAY_BUFFER)
+	glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	for (auto const &f : fenced) {
+		glDeleteSync(f.sync);
+	}
+	fenced.clear();
+	head = 0;
+	unfenced = 0;
+	stats.orphans += 1;
+}
+
+void *StreamBuffer::map(GLsizeiptr bytes, GLsizeiptr alignment, GLintptr *offset) {
+	assert(offset);
+	assert(bytes > 0);
+	assert(alignment > 0);
+	auto before = std::chrono::high_resolution_clock::now();
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	//draws from the previous range have been issued, so fence them:
+	if (unfenced != head) {
+		fenced.emplace_back(Fenced{ unfenced, head, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+		unfenced = head;
+	}
+
+	GLintptr at = (head + alignment - 1) / alignment * alignment;
+	if (bytes > size) {
+		//grow to fit:
+		while (size < bytes) size *= 2;
+		orphan();
+		at = 0;
+	} else if (orphan_every_map) {
+		orphan();
+		at = 0;
+	} else {
+		if (at + bytes > size) {
+			//wrap around:
+			at = 0;
+		}
+		//retire ranges the GPU is done with; if the new range overlaps one it isn't, orphan rather than wait:
+		while (!fenced.empty()) {
+			Fenced const &f = fenced.front();
+			GLenum status = glClientWaitSync(f.sync, 0, 0);
+			if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+				glDeleteSync(f.sync);
+				fenced.pop_front();
+				continue;
+			}
+			//(this and later ranges are still in use)
+			bool overlaps = false;
+			for (auto const &g : fenced) {
+				if (g.begin < at + bytes && at < g.end) overlaps = true;
+			}
+			if (overlaps) {
+				orphan();
+				at = 0;
+			}
+			break;
+		}
+	}
+
+	void *ret = glMapBufferRange(GL_ARRAY_BUFFER, at, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (!ret) {
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		throw std::runtime_error("Failed to map stream buffer.");
+	}
+	*offset = at;
+	unfenced = at;
+	head = at + bytes;
+
+	stats.bytes += uint64_t(bytes);
+	stats.maps += 1;
+	stats.driver_ms += std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - before).count();
+
+	return ret;
+}
+
+void StreamBuffer::unmap() {
+	auto before = std::chrono::high_resolution_clock::now();
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	stats.driver_ms += std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - before).count();
+}
+
+StreamBuffer::Stats StreamBuffer::take_stats() {
+	Stats ret = stats;
+	stats = Stats();
+	return ret;
+}
+
+//-------------------------
+
+//n.b. declared static so it doesn't conflict with similarly named global variables elsewhere:
+static StreamBuffer *stream = nullptr;
+
+static Load< void > setup_stream(LoadTagDefault, "vertex_stream", {}, [](){
+	//a few frames' worth of debug lines and text before the first wrap:
+	stream = new StreamBuffer(4 * 1024 * 1024);
+	GL_ERRORS();
+});
+
+StreamBuffer &vertex_stream() {
+	assert(stream && "vertex_stream is created at load time.");
+	return *stream;
+}
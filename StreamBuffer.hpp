@@ -0,0 +1,71 @@
+#pragma once
+
+/*
+ * A StreamBuffer hands out sub-ranges of one vertex buffer for data that is
+ *  written by the CPU every frame (immediate-mode helpers like DrawLines).
+ *
+ * Rather than reallocating storage with glBufferData for every upload, it
+ *  writes through unsynchronized glMapBufferRange calls at an advancing head.
+ *  Each range gets a fence once it has been drawn from; when the head wraps
+ *  back onto a range whose fence hasn't passed yet, the buffer is orphaned
+ *  (the driver keeps the old storage alive for the draws in flight) instead
+ *  of waiting, so the CPU never stalls on the GPU.
+ *
+ * Usage: map space, write, unmap, and issue the draws that read it before
+ *  mapping again (the next map() fences those draws):
+ *   GLintptr offset;
+ *   Vertex *v = reinterpret_cast< Vertex * >(vertex_stream().map(count * sizeof(Vertex), sizeof(Vertex), &offset));
+ *   ...write 'count' vertices...
+ *   vertex_stream().unmap();
+ *   glDrawArrays(GL_LINES, GLint(offset / sizeof(Vertex)), count); //(with a vao reading from vertex_stream().buffer)
+ *
+ * Setting the environment variable STREAM_BUFFER_ORPHAN=1 orphans on every
+ *  map (which is what a glBufferData per upload amounts to), for comparison.
+ *
+ */
+
+#include "GL.hpp"
+
+#include <cstdint>
+#include <deque>
+
+struct StreamBuffer {
+	StreamBuffer(GLsizeiptr size);
+	~StreamBuffer();
+	StreamBuffer(StreamBuffer const &) = delete;
+	StreamBuffer &operator=(StreamBuffer const &) = delete;
+
+	//map 'bytes' of space for writing; returns pointer and sets *offset to
+	// the buffer offset of the mapped space (a multiple of 'alignment', which needn't be a power of two):
+	// (grows the buffer if 'bytes' is larger than it)
+	void *map(GLsizeiptr bytes, GLsizeiptr alignment, GLintptr *offset);
+	void unmap();
+
+	GLuint buffer = 0; //GL_ARRAY_BUFFER
+	GLsizeiptr size = 0; //size of buffer storage
+
+	//counters (reset by take_stats(); e.g., once per frame for an overlay):
+	struct Stats {
+		uint64_t bytes = 0; //bytes mapped
+		uint32_t maps = 0;
+		uint32_t orphans = 0; //maps that had to orphan (or grow) the buffer
+		double driver_ms = 0.0; //CPU time spent in map()/unmap()
+	};
+	Stats take_stats();
+
+	//-- internals ---
+	Stats stats;
+	GLintptr head = 0; //next free byte
+	GLintptr unfenced = 0; //start of the range mapped since the last fence (ends at 'head')
+	struct Fenced {
+		GLintptr begin, end;
+		GLsync sync;
+	};
+	std::deque< Fenced > fenced; //oldest first
+	bool orphan_every_map = false; //(STREAM_BUFFER_ORPHAN)
+
+	void orphan(); //new storage; drops all fences
+};
+
+//The stream shared by DrawLines and other immediate-mode helpers (created at load time as "vertex_stream"):
+StreamBuffer &vertex_stream();
@@ -0,0 +1,105 @@
+#include "TextureAtlas.hpp"
+
+#include "load_save_png.hpp"
+#include "gl_errors.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+TextureAtlas::TextureAtlas(std::vector< std::string > const &filenames, Upload when, uint32_t layer_size_, uint32_t padding_, AtlasPacker::Method method)
+	: layer_size(layer_size_), padding(padding_) {
+
+	//decode (images come out bottom row first, as OpenGL wants them):
+	std::vector< PNGImage > images;
+	load_pngs(filenames, LowerLeftOrigin, &images);
+
+	std::vector< glm::uvec2 > sizes;
+	std::vector< glm::u8vec4 const * > pixels;
+	sizes.reserve(images.size());
+	pixels.reserve(images.size());
+	for (auto const &image : images) {
+		sizes.emplace_back(image.size);
+		pixels.emplace_back(image.data.data());
+	}
+
+	//pack (throws if an image doesn't fit) and copy into layers:
+	std::vector< AtlasPacker::Placement > placements;
+	layers = AtlasPacker::pack(sizes, layer_size, padding, method, &placements);
+	efficiency = AtlasPacker::packing_efficiency(sizes, layer_size, layers);
+	AtlasPacker::compose_pages(sizes, pixels, placements, layer_size, padding, layers, &pending_texels);
+
+	glm::vec2 texel = 1.0f / glm::vec2(layer_size);
+	for (size_t i = 0; i < filenames.size(); ++i) {
+		Region region;
+		region.scale = glm::vec2(sizes[i]) * texel;
+		region.offset = glm::vec2(placements[i].position) * texel;
+		region.layer = float(placements[i].page);
+		region.size = sizes[i];
+		regions[filenames[i]] = region;
+	}
+
+	std::cout << "TextureAtlas: " << filenames.size() << " images in " << layers << " " << layer_size.x << "x" << layer_size.y
+		<< " layers (" << std::fixed << std::setprecision(1) << efficiency * 100.0f << "% used)." << std::defaultfloat << std::endl;
+
+	if (when == UploadNow) upload();
+}
+
+TextureAtlas::~TextureAtlas() {
+	if (texture != 0) {
+		glDeleteTextures(1, &texture);
+		texture = 0;
+	}
+}
+
+void TextureAtlas::upload() {
+	assert(texture == 0 && "upload() should only be called once.");
+
+	GLint max_size = 0, max_layers = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+	if (layer_size.x > uint32_t(max_size) || layer_size.y > uint32_t(max_size) || layers > uint32_t(max_layers)) {
+		throw std::runtime_error("TextureAtlas of " + std::to_string(layers) + " " + std::to_string(layer_size.x) + "x" + std::to_string(layer_size.y)
+			+ " layers is larger than this OpenGL allows (" + std::to_string(max_layers) + " layers of up to " + std::to_string(max_size) + "x" + std::to_string(max_size) + ").");
+	}
+
+	//mip level n blurs across 2^n texels, so stop at the level where the padding runs out:
+	GLint max_level = 0;
+	while ((2U << max_level) <= padding) ++max_level;
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, layer_size.x, layer_size.y, std::max(layers, 1U), 0, GL_RGBA, GL_UNSIGNED_BYTE, pending_texels.empty() ? nullptr : pending_texels.data());
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, (max_level > 0 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, max_level);
+	if (max_level > 0) glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	pending_texels.clear();
+	pending_texels.shrink_to_fit();
+
+	GL_ERRORS();
+}
+
+TextureAtlas::Region const &TextureAtlas::lookup(std::string const &filename) const {
+	auto f = regions.find(filename);
+	if (f == regions.end()) {
+		throw std::runtime_error("Looking up image '" + filename + "' that isn't in the atlas.");
+	}
+	return f->second;
+}
+
+void TextureAtlas::apply(std::string const &filename, Scene::Drawable::Pipeline *pipeline) const {
+	assert(pipeline);
+	Region const &region = lookup(filename);
+	pipeline->textures[0].texture = texture;
+	pipeline->textures[0].target = GL_TEXTURE_2D_ARRAY;
+	pipeline->texcoord_scale = region.scale;
+	pipeline->texcoord_offset = region.offset;
+	pipeline->atlas_layer = region.layer;
+}
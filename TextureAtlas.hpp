@@ -0,0 +1,83 @@
+#pragma once
+
+/*
+ * A TextureAtlas packs a set of PNG images (see AtlasPacker.hpp) into the
+ *  layers of one GL_TEXTURE_2D_ARRAY, and remembers where each image went.
+ *
+ * Drawables that show different images from the same atlas bind the same
+ *  texture, so Scene::draw doesn't rebind textures between them; each
+ *  drawable's region is passed through the 'Object' uniform block instead
+ *  (texcoord_scale, texcoord_offset, and atlas_layer in Scene::Drawable::Pipeline).
+ *
+ * Programs that sample atlases (e.g., LitColorTextureProgram) map TexCoord
+ *  into the region as offset + scale * fract(TexCoord), so repeating textures
+ *  still repeat; the padding around each image holds wrapped-around texels
+ *  for filtering, and mipmaps stop at the level where the padding runs out.
+ *
+ * e.g.,
+ *  Load< TextureAtlas > crate_atlas(LoadTagDefault, "crate_atlas", {}, []() -> TextureAtlas * {
+ *  	return new TextureAtlas({data_path("crate.png"), data_path("label.png")}, TextureAtlas::UploadLater);
+ *  }, [](TextureAtlas &atlas) {
+ *  	atlas.upload();
+ *  });
+ *  ...
+ *  crate_atlas->apply(data_path("label.png"), &drawable.pipeline);
+ *
+ */
+
+#include "GL.hpp"
+#include "Scene.hpp"
+#include "AtlasPacker.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct TextureAtlas {
+	//load and pack PNG files (decoded on several threads; see load_pngs):
+	// note: will throw if a file fails to load or an image doesn't fit in a layer.
+	//with UploadLater, the constructor doesn't call OpenGL (so it can run on a loading thread; see Load.hpp)
+	// and the layers wait in 'pending_texels' until upload() is called (on the main thread).
+	enum Upload { UploadNow, UploadLater };
+	TextureAtlas(std::vector< std::string > const &filenames, Upload when = UploadNow,
+		uint32_t layer_size = 2048, uint32_t padding = 4, AtlasPacker::Method method = AtlasPacker::MaxRects);
+	~TextureAtlas();
+	TextureAtlas(TextureAtlas const &) = delete;
+	TextureAtlas &operator=(TextureAtlas const &) = delete;
+
+	//create the array texture, fill it, and build mipmaps (needed once, if constructed with UploadLater):
+	// note: will throw if layer_size is larger than GL_MAX_TEXTURE_SIZE.
+	void upload();
+
+	//where an image ended up (in texture coordinates):
+	struct Region {
+		glm::vec2 scale = glm::vec2(1.0f);
+		glm::vec2 offset = glm::vec2(0.0f);
+		float layer = 0.0f;
+		glm::uvec2 size = glm::uvec2(0); //in texels
+	};
+
+	//look up an image by the filename it was loaded from:
+	// note: will throw if it isn't in the atlas.
+	Region const &lookup(std::string const &filename) const;
+
+	//bind the atlas as 'pipeline' texture zero and point the pipeline's region at an image:
+	// (call after upload(), so the texture exists)
+	void apply(std::string const &filename, Scene::Drawable::Pipeline *pipeline) const;
+
+	//The OpenGL GL_TEXTURE_2D_ARRAY holding the images:
+	GLuint texture = 0;
+
+	glm::uvec2 layer_size = glm::uvec2(0);
+	uint32_t layers = 0;
+	uint32_t padding = 0;
+	float efficiency = 0.0f; //fraction of the layers' area covered by images (see AtlasPacker::packing_efficiency)
+
+	//-- internals ---
+	std::unordered_map< std::string, Region > regions;
+
+	//layers composed by the constructor that upload() hasn't sent to the GPU yet:
+	std::vector< glm::u8vec4 > pending_texels;
+};
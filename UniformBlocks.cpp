@@ -0,0 +1,278 @@
+#include "UniformBlocks.hpp"
+
+#include "LightClusters.hpp"
+#include "Load.hpp"
+#include "gl_errors.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+char const *scene_blocks_glsl =
+	"layout(std140) uniform Frame {\n"
+	"	mat4 WORLD_TO_CLIP;\n"
+	"	mat4x3 WORLD_TO_LIGHT;\n"
+	"};\n"
+	"layout(std140) uniform Lights {\n"
+	"	uvec4 CLUSTER_GRID;\n"
+	"	vec4 CLUSTER_DEPTH;\n"
+	"};\n"
+	"uniform samplerBuffer LIGHTS;\n"
+	"uniform usamplerBuffer CLUSTERS;\n"
+	"uniform usamplerBuffer LIGHT_INDICES;\n"
+	"layout(std140) uniform Object {\n"
+	"	mat4 OBJECT_TO_CLIP;\n"
+	"	mat4x3 OBJECT_TO_LIGHT;\n"
+	"	mat3 NORMAL_TO_LIGHT;\n"
+	"	vec4 TEXCOORD_TO_ATLAS;\n" //xy: scale, zw: offset
+	"	float ATLAS_LAYER;\n"
+	"};\n"
+;
+
+void bind_scene_blocks(GLuint program) {
+	auto bind = [&](char const *name, GLuint binding) {
+		GLuint index = glGetUniformBlockIndex(program, name);
+		if (index == GL_INVALID_INDEX) return; //program doesn't use this block
+		glUniformBlockBinding(program, index, binding);
+	};
+	bind("Frame", FrameBlockBinding);
+	bind("Lights", LightsBlockBinding);
+	bind("Object", ObjectBlockBinding);
+
+	//light samplers always refer to the same texture units:
+	glUseProgram(program);
+	auto set_unit = [&](char const *name, GLuint unit) {
+		GLint location = glGetUniformLocation(program, name);
+		if (location == -1) return; //program doesn't use this sampler
+		glUniform1i(location, GLint(unit));
+	};
+	set_unit("LIGHTS", LightsTextureUnit);
+	set_unit("CLUSTERS", ClustersTextureUnit);
+	set_unit("LIGHT_INDICES", LightIndicesTextureUnit);
+	glUseProgram(0);
+}
+
+//-------------------------
+
+void compute_object_blocks(
+	size_t count,
+	ObjectTransform const *objects,
+	glm::mat4 const &world_to_clip,
+	glm::mat4x3 const &world_to_light,
+	void *out_, size_t stride) {
+
+	assert(stride >= sizeof(ObjectBlock));
+	char *out = reinterpret_cast< char * >(out_);
+
+	for (size_t i = 0; i < count; ++i) {
+		ObjectBlock &block = *reinterpret_cast< ObjectBlock * >(out + i * stride);
+		ObjectTransform const &object = objects[i];
+		glm::mat4 const object_to_world4 = glm::mat4(object.object_to_world); //pads with a (0,0,0,1) row
+
+		//vertex positions go through dequantization first; this is just a scale and offset:
+		glm::mat4 const position_to_world4 = object_to_world4 * glm::mat4(
+			glm::vec4(object.position_scale.x, 0.0f, 0.0f, 0.0f),
+			glm::vec4(0.0f, object.position_scale.y, 0.0f, 0.0f),
+			glm::vec4(0.0f, 0.0f, object.position_scale.z, 0.0f),
+			glm::vec4(object.position_offset, 1.0f)
+		);
+
+		//OBJECT_TO_CLIP takes (quantized) vertices from object space to clip space:
+		block.OBJECT_TO_CLIP = world_to_clip * position_to_world4;
+
+		//OBJECT_TO_LIGHT takes (quantized) vertices from object space to light space:
+		glm::mat4x3 const position_to_light = world_to_light * position_to_world4;
+		for (uint32_t c = 0; c < 4; ++c) {
+			block.OBJECT_TO_LIGHT[c] = glm::vec4(position_to_light[c], 0.0f);
+		}
+
+		//(normals aren't quantized relative to the box, so they use the plain object transform)
+		glm::mat4x3 const object_to_light = world_to_light * object_to_world4;
+
+		//NORMAL_TO_LIGHT takes normals from object space to light space:
+		// this is inverse(transpose(mat3(object_to_light))), which is the
+		// cofactor matrix divided by the determinant; no general inverse needed.
+		glm::vec3 const &a = object_to_light[0];
+		glm::vec3 const &b = object_to_light[1];
+		glm::vec3 const &c = object_to_light[2];
+		glm::vec3 const bc = glm::cross(b, c);
+		float const det = glm::dot(a, bc);
+		//degenerate (e.g., zero-scale) transforms get a zero normal matrix rather than NaNs:
+		float const inv_det = (det == 0.0f ? 0.0f : 1.0f / det);
+		block.NORMAL_TO_LIGHT[0] = glm::vec4(bc * inv_det, 0.0f);
+		block.NORMAL_TO_LIGHT[1] = glm::vec4(glm::cross(c, a) * inv_det, 0.0f);
+		block.NORMAL_TO_LIGHT[2] = glm::vec4(glm::cross(a, b) * inv_det, 0.0f);
+
+		//texture atlas region is passed straight through:
+		block.TEXCOORD_TO_ATLAS = glm::vec4(object.texcoord_scale, object.texcoord_offset);
+		block.ATLAS_LAYER = glm::vec4(object.atlas_layer, 0.0f, 0.0f, 0.0f);
+	}
+}
+
+//-------------------------
+
+UniformRing::UniformRing(GLsizeiptr size_) : size(size_) {
+	assert(size > 0);
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if (alignment <= 0) alignment = 256;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformRing::~UniformRing() {
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+void *UniformRing::map(GLsizeiptr bytes, GLintptr *offset) {
+	assert(offset);
+	assert(bytes > 0);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+
+	if (bytes > size) {
+		//grow to fit:
+		while (size < bytes) size *= 2;
+		glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		head = 0;
+	} else if (head + bytes > size) {
+		//wrap around; orphaning the old storage lets draws still in flight keep reading it:
+		glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		head = 0;
+	}
+
+	//the range past 'head' is not referenced by any queued draw, so no need to synchronize:
+	void *ret = glMapBufferRange(GL_UNIFORM_BUFFER, head, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (!ret) {
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		throw std::runtime_error("Failed to map uniform ring buffer.");
+	}
+	*offset = head;
+
+	head += bytes;
+	head = (head + alignment - 1) / alignment * alignment;
+
+	return ret;
+}
+
+void UniformRing::unmap() {
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glUnmapBuffer(GL_UNIFORM_BUFFER);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+//-------------------------
+
+//Buffers shared by all scene drawing are created at load time:
+
+//n.b. declared static so they don't conflict with similarly named global variables elsewhere:
+static GLuint frame_buffer = 0;
+static GLuint lights_buffer = 0;
+static UniformRing *object_ring = nullptr;
+
+//texture buffers holding light data:
+struct LightTextureBuffer {
+	GLuint buffer = 0;
+	GLuint texture = 0;
+	GLenum format = 0;
+	GLuint unit = 0;
+};
+static LightTextureBuffer light_data, light_clusters, light_indices;
+
+static Load< void > setup_buffers(LoadTagDefault, "uniform_blocks", {}, [](){
+	auto make_block_buffer = [](GLuint binding, GLsizeiptr size, void const *data) -> GLuint {
+		GLuint buffer = 0;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferData(GL_UNIFORM_BUFFER, size, data, GL_STREAM_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		//bindings are context state, so they only need to be set once:
+		glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+		return buffer;
+	};
+
+	FrameBlock frame;
+	frame.WORLD_TO_CLIP = glm::mat4(1.0f);
+	frame.WORLD_TO_LIGHT[0] = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+	frame.WORLD_TO_LIGHT[1] = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+	frame.WORLD_TO_LIGHT[2] = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+	frame.WORLD_TO_LIGHT[3] = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+	frame_buffer = make_block_buffer(FrameBlockBinding, sizeof(FrameBlock), &frame);
+
+	LightsBlock lights;
+	lights_buffer = make_block_buffer(LightsBlockBinding, sizeof(LightsBlock), &lights);
+
+	//room for a few hundred draws before the first wrap:
+	object_ring = new UniformRing(256 * 1024);
+
+	auto make_texture_buffer = [](GLenum format, GLuint unit) -> LightTextureBuffer {
+		LightTextureBuffer ret;
+		ret.format = format;
+		ret.unit = unit;
+		glGenBuffers(1, &ret.buffer);
+		glGenTextures(1, &ret.texture);
+		//start with a little zeroed data so the texture is complete:
+		uint32_t zeros[4] = {0, 0, 0, 0};
+		glBindBuffer(GL_TEXTURE_BUFFER, ret.buffer);
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(zeros), zeros, GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		//texture units at and above LightsTextureUnit are reserved, so these can stay bound:
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_BUFFER, ret.texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, format, ret.buffer);
+		glActiveTexture(GL_TEXTURE0);
+		return ret;
+	};
+	light_data = make_texture_buffer(GL_RGBA32F, LightsTextureUnit);
+	light_clusters = make_texture_buffer(GL_RG32UI, ClustersTextureUnit);
+	light_indices = make_texture_buffer(GL_R32UI, LightIndicesTextureUnit);
+
+	GL_ERRORS(); //PARANOIA: make sure nothing strange happened during setup
+});
+
+void set_frame_block(FrameBlock const &frame) {
+	glBindBuffer(GL_UNIFORM_BUFFER, frame_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), &frame, GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void set_lights(LightClusters const &clusters) {
+	LightsBlock lights;
+	lights.CLUSTER_GRID = glm::uvec4(clusters.grid, clusters.global_count);
+	lights.CLUSTER_DEPTH = glm::vec4(clusters.near, clusters.depth_scale, 0.0f, 0.0f);
+	glBindBuffer(GL_UNIFORM_BUFFER, lights_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(LightsBlock), &lights, GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	auto upload = [](LightTextureBuffer const &tb, void const *data, size_t bytes) {
+		if (bytes == 0) return; //keep old (unreferenced) contents rather than making an empty texture
+		glBindBuffer(GL_TEXTURE_BUFFER, tb.buffer);
+		glBufferData(GL_TEXTURE_BUFFER, bytes, data, GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		//re-attach in case the driver moved the data store:
+		glActiveTexture(GL_TEXTURE0 + tb.unit);
+		glTexBuffer(GL_TEXTURE_BUFFER, tb.format, tb.buffer);
+		glActiveTexture(GL_TEXTURE0);
+	};
+	upload(light_data, clusters.lights.data(), clusters.lights.size() * sizeof(LightClusters::Light));
+	upload(light_clusters, clusters.clusters.data(), clusters.clusters.size() * sizeof(glm::uvec2));
+	upload(light_indices, clusters.indices.data(), clusters.indices.size() * sizeof(uint32_t));
+}
+
+void *map_object_blocks(size_t count, size_t *stride, GLintptr *offset) {
+	assert(object_ring && "map_object_blocks called before load functions.");
+	assert(stride);
+	size_t align = size_t(object_ring->alignment);
+	*stride = (sizeof(ObjectBlock) + align - 1) / align * align;
+	return object_ring->map(GLsizeiptr(count * *stride), offset);
+}
+
+void unmap_object_blocks() {
+	object_ring->unmap();
+}
+
+void bind_object_block(GLintptr offset) {
+	glBindBufferRange(GL_UNIFORM_BUFFER, ObjectBlockBinding, object_ring->buffer, offset, sizeof(ObjectBlock));
+}
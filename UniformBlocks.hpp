@@ -0,0 +1,125 @@
+#pragma once
+
+/*
+ * Uniform blocks shared by the scene-drawing shader programs.
+ *
+ * Rather than setting per-object matrices and lighting parameters with
+ *  individual glUniform* calls, programs declare the blocks in
+ *  'scene_blocks_glsl' and get them bound to fixed binding points with
+ *  'bind_scene_blocks()'. Scene::draw fills the Frame and Object blocks,
+ *  and uploads the scene's lights (clustered by LightClusters) with set_lights().
+ *
+ * All structures below mirror the std140 layout of the GLSL declarations.
+ *
+ */
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+//binding points used for the shared blocks:
+enum SceneBlockBinding : GLuint {
+	FrameBlockBinding = 0,
+	LightsBlockBinding = 1,
+	ObjectBlockBinding = 2,
+};
+
+//GLSL declarations of the blocks; paste into both vertex and fragment shader source:
+extern char const *scene_blocks_glsl;
+
+//per-frame camera data (set by Scene::draw):
+struct FrameBlock {
+	glm::mat4 WORLD_TO_CLIP;
+	glm::vec4 WORLD_TO_LIGHT[4]; //mat4x3; std140 pads columns to vec4
+};
+static_assert(sizeof(FrameBlock) == 64 + 64, "FrameBlock matches std140 layout.");
+
+//per-frame lighting data (set by set_lights):
+// the lights themselves live in texture buffers (see LightClusters.hpp for the layout)
+struct LightsBlock {
+	glm::uvec4 CLUSTER_GRID = glm::uvec4(1, 1, 1, 0); //xyz: number of clusters; w: number of global lights
+	glm::vec4 CLUSTER_DEPTH = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f); //x: near; y: depth scale
+};
+static_assert(sizeof(LightsBlock) == 32, "LightsBlock matches std140 layout.");
+
+//texture units used for the light texture buffers:
+// (Scene::Drawable::Pipeline uses units below TextureCount for drawable textures)
+enum SceneLightsTextureUnit : GLuint {
+	LightsTextureUnit = 4, //samplerBuffer, three RGBA32F texels per light
+	ClustersTextureUnit = 5, //usamplerBuffer, RG32UI (first index, count) per cluster
+	LightIndicesTextureUnit = 6, //usamplerBuffer, R32UI light index list
+};
+
+//per-drawable transformation data (set by Scene::draw):
+struct ObjectBlock {
+	glm::mat4 OBJECT_TO_CLIP;
+	glm::vec4 OBJECT_TO_LIGHT[4]; //mat4x3; std140 pads columns to vec4
+	glm::vec4 NORMAL_TO_LIGHT[3]; //mat3; std140 pads columns to vec4
+	glm::vec4 TEXCOORD_TO_ATLAS; //xy: scale, zw: offset (see TextureAtlas.hpp)
+	glm::vec4 ATLAS_LAYER; //float; std140 pads the block to a multiple of vec4
+};
+static_assert(sizeof(ObjectBlock) == 64 + 64 + 48 + 16 + 16, "ObjectBlock matches std140 layout.");
+
+//connect a program's blocks and light samplers (if it uses them) to the binding points above:
+void bind_scene_blocks(GLuint program);
+
+//upload clustered lights for all scene programs (call after LightClusters::build):
+struct LightClusters;
+void set_lights(LightClusters const &clusters);
+
+//per-object input to compute_object_blocks:
+struct ObjectTransform {
+	glm::mat4x3 object_to_world = glm::mat4x3(1.0f);
+	//quantized vertex positions are dequantized as position_offset + position_scale * Position:
+	glm::vec3 position_scale = glm::vec3(1.0f);
+	glm::vec3 position_offset = glm::vec3(0.0f);
+	//texture atlas region (copied to TEXCOORD_TO_ATLAS and ATLAS_LAYER):
+	glm::vec2 texcoord_scale = glm::vec2(1.0f);
+	glm::vec2 texcoord_offset = glm::vec2(0.0f);
+	float atlas_layer = 0.0f;
+};
+
+//fill 'count' ObjectBlocks (spaced 'stride' bytes apart starting at 'out')
+// from an array of object transforms:
+// (written as straight-line loops over contiguous arrays so the compiler can vectorize them)
+void compute_object_blocks(
+	size_t count,
+	ObjectTransform const *objects,
+	glm::mat4 const &world_to_clip,
+	glm::mat4x3 const &world_to_light,
+	void *out, size_t stride
+);
+
+//A UniformRing hands out sub-ranges of a single uniform buffer for
+// short-lived (e.g., per-draw) data, orphaning the buffer when it wraps:
+struct UniformRing {
+	UniformRing(GLsizeiptr size);
+	~UniformRing();
+
+	//map 'bytes' of space for writing; returns pointer and sets *offset to
+	// the buffer offset of the mapped space (aligned to 'alignment'):
+	// (call unmap() before drawing with the data)
+	void *map(GLsizeiptr bytes, GLintptr *offset);
+	void unmap();
+
+	GLuint buffer = 0;
+	GLsizeiptr size = 0; //size of buffer storage
+	GLintptr head = 0; //next free byte
+	GLint alignment = 256; //GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+};
+
+//Scene::draw helpers -- these use buffers created at load time:
+
+//upload camera data for this frame's draws:
+void set_frame_block(FrameBlock const &frame);
+
+//get space for 'count' ObjectBlocks (spaced '*stride' bytes apart):
+// (sets *offset to the buffer offset of the first block; pass to bind_object_block)
+void *map_object_blocks(size_t count, size_t *stride, GLintptr *offset);
+void unmap_object_blocks();
+
+//bind the ObjectBlock at 'offset' for the next draw:
+void bind_object_block(GLintptr offset);
@@ -0,0 +1,160 @@
+#include "audio_cache.hpp"
+
+#include "AssetArchive.hpp"
+#include "MappedFile.hpp"
+#include "data_path.hpp"
+#include "read_write_chunk.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+#include <direct.h>
+#include <process.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//bump this when decoding changes (e.g., a new resampler), so old cache entries are decoded again:
+static constexpr uint32_t CacheVersion = 3; //2: WAV files resampled with Sound::resample; 3: sample count in CacheInfo
+
+//Cache file layout (chunks as in read_write_chunk.hpp):
+// inf0: one CacheInfo
+// pcm0: decoded samples (48kHz mono floats)
+struct CacheInfo {
+	uint64_t source_hash; //hash_bytes() of the source file
+	uint64_t source_size; //size of the source file
+	uint64_t samples; //number of floats in pcm0 (so truncated entries aren't used)
+	float decode_ms; //how long decoding took when the entry was written
+	uint32_t version; //CacheVersion
+};
+static_assert(sizeof(CacheInfo) == 8 + 8 + 8 + 4 + 4, "CacheInfo is packed.");
+
+static std::mutex directory_mutex; //guards 'directory':
+static bool directory_set = false;
+static std::string directory;
+
+std::string audio_cache_directory() {
+	std::unique_lock< std::mutex > lock(directory_mutex);
+	if (!directory_set) {
+		char const *env = std::getenv("AUDIO_CACHE");
+		directory = (env ? std::string(env) : data_path("audio-cache"));
+		directory_set = true;
+	}
+	return directory;
+}
+
+void set_audio_cache_directory(std::string const &directory_) {
+	std::unique_lock< std::mutex > lock(directory_mutex);
+	directory = directory_;
+	directory_set = true;
+}
+
+//cache file name for source file contents:
+static std::string cache_path(std::string const &dir, AssetFile const &file) {
+	uint64_t hash = (file.hash != 0 ? file.hash : hash_bytes(file.data, file.size)); //(archive files come with a hash)
+	char hex[17];
+	std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+	return dir + "/" + hex + ".pcm";
+}
+
+std::string audio_cache_path(std::string const &filename) {
+	std::string dir = audio_cache_directory();
+	if (dir.empty()) return "";
+	return cache_path(dir, AssetFile(filename));
+}
+
+AudioCacheLoad load_audio_cached(std::string const &filename, AudioDecoder decode, std::vector< float > *data) {
+	auto before = std::chrono::high_resolution_clock::now();
+	auto ms_since = [](std::chrono::high_resolution_clock::time_point then) {
+		return float(std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - then).count() * 1000.0);
+	};
+
+	AudioCacheLoad result;
+	std::string dir = audio_cache_directory();
+	if (dir.empty()) {
+		decode(filename, data);
+		result.load_ms = result.decode_ms = ms_since(before);
+		return result;
+	}
+
+	std::string path;
+	uint64_t source_hash, source_size;
+	{ //(source is only mapped for hashing -- the decoder opens it again if needed)
+		AssetFile source(filename);
+		path = cache_path(dir, source);
+		source_hash = (source.hash != 0 ? source.hash : hash_bytes(source.data, source.size));
+		source_size = source.size;
+	}
+
+	//--- hit: copy samples out of the mapped cache file ---
+	try {
+		MappedFile cached(path);
+		char const *at = cached.begin();
+		ChunkSpan< CacheInfo > info;
+		read_chunk(&at, cached.end(), "inf0", &info);
+		ChunkSpan< float > pcm;
+		read_chunk(&at, cached.end(), "pcm0", &pcm);
+		if (info.size() == 1 && info[0].version == CacheVersion && info[0].source_hash == source_hash && info[0].source_size == source_size
+		 && info[0].samples == pcm.size()) {
+			data->assign(pcm.begin(), pcm.end());
+			result.cached = true;
+			result.decode_ms = info[0].decode_ms;
+			result.load_ms = ms_since(before);
+			return result;
+		}
+	} catch (std::exception &) {
+		//missing or damaged cache file; decode (and rewrite it) below
+	}
+
+	//--- miss: decode and save ---
+	auto decode_before = std::chrono::high_resolution_clock::now();
+	decode(filename, data);
+	result.decode_ms = ms_since(decode_before);
+
+	//make sure the directory exists (ignoring errors -- writing will fail, below, if it doesn't):
+	#if defined(_WIN32)
+	_mkdir(dir.c_str());
+	#else
+	mkdir(dir.c_str(), 0755);
+	#endif
+
+	//write to a name no other thread or process will use, then rename into place:
+	// (thread ids are only unique within a process, so the process id is part of the name too)
+	#if defined(_WIN32)
+	unsigned long long pid = (unsigned long long)_getpid();
+	#else
+	unsigned long long pid = (unsigned long long)getpid();
+	#endif
+	std::string temp = path + "." + std::to_string(pid) + "-" + std::to_string(std::hash< std::thread::id >()(std::this_thread::get_id())) + ".tmp";
+	bool written = false;
+	{
+		std::ofstream out(temp, std::ios::binary);
+		CacheInfo info;
+		info.source_hash = source_hash;
+		info.source_size = source_size;
+		info.samples = data->size();
+		info.decode_ms = result.decode_ms;
+		info.version = CacheVersion;
+		write_chunk("inf0", std::vector< CacheInfo >{ info }, &out);
+		write_chunk("pcm0", *data, &out);
+		written = bool(out);
+	}
+	if (!written || std::rename(temp.c_str(), path.c_str()) != 0) {
+		//(on Windows, rename fails if another loader just wrote the same entry -- which is fine)
+		std::remove(temp.c_str());
+		if (!written) {
+			std::cerr << "WARNING: failed to write decoded audio cache file '" << path << "'." << std::endl;
+		}
+	}
+
+	result.load_ms = ms_since(before);
+	return result;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+/*
+ * The decoded audio cache saves the output of load_wav/load_opus (48kHz mono
+ *  floats) so later runs can skip decoding: the cached copy is memory-mapped
+ *  and copied out instead.
+ *
+ * Cache files are named by a hash of the source file's contents (so edited
+ *  files are decoded again, and identical files share an entry) and are written
+ *  to a temporary name and then renamed, so several loader threads (or several
+ *  copies of the game) can share a cache directory.
+ *
+ * Used by Sound::Sample; safe to call from several threads at once.
+ *
+ * This code uses no SDL or OpenGL.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//decoder to use on a cache miss (load_wav or load_opus):
+typedef void (*AudioDecoder)(std::string const &filename, std::vector< float > *data);
+
+struct AudioCacheLoad {
+	bool cached = false; //was the data loaded from the cache?
+	float load_ms = 0.0f; //time taken by this load
+	float decode_ms = 0.0f; //time taken by the decoder (now, or when the cache entry was written)
+};
+
+//load 'filename' with 'decode', or -- if it was decoded before -- from the cache; throws on error:
+AudioCacheLoad load_audio_cached(std::string const &filename, AudioDecoder decode, std::vector< float > *data);
+
+//cache directory: $AUDIO_CACHE if set (set it empty to turn the cache off), else data_path("audio-cache"):
+std::string audio_cache_directory();
+//use a different cache directory ("" turns the cache off; e.g., for benchmarks):
+void set_audio_cache_directory(std::string const &directory);
+
+//name of the cache file for 'filename' (whether or not it exists; "" if the cache is off):
+std::string audio_cache_path(std::string const &filename);
@@ -0,0 +1,195 @@
+//Headless benchmark comparing the two ways of reading chunked assets:
+// 'stream' -- std::ifstream + read_chunk into std::vectors (the old MeshBuffer/Scene path)
+// 'mmap'   -- MappedFile + in-place read_chunk into ChunkSpans (the current path)
+//
+//Each mode walks every chunk of every file and touches all of the data (as an upload would).
+//Run each mode in its own process to compare peak memory use.
+//
+//Usage:
+//	bench/asset-load <stream|mmap> [iterations] <file.pnct|file.scene> [...]
+//	bench/asset-load --make-large <in.pnct> <out.pnct> <copies>   (writes a big test file)
+
+#include "MappedFile.hpp"
+#include "read_write_chunk.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+//ask the OS to drop cached pages for a file, so the next read comes from disk (if supported):
+static bool evict_from_cache(std::string const &filename) {
+#if defined(__linux__)
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) return false;
+	bool ok = (posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0);
+	close(fd);
+	return ok;
+#else
+	(void)filename;
+	return false;
+#endif
+}
+
+static size_t peak_rss_kb() {
+#if !defined(_WIN32)
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+	return size_t(usage.ru_maxrss) / 1024; //bytes on macOS
+#else
+	return size_t(usage.ru_maxrss); //kilobytes on linux
+#endif
+#else
+	return 0;
+#endif
+}
+
+//a cheap checksum so the compiler can't skip reading the data:
+static uint32_t touch(char const *data, size_t size) {
+	uint32_t sum = 0;
+	for (size_t i = 0; i < size; i += 4) {
+		uint32_t word = 0;
+		std::memcpy(&word, data + i, std::min< size_t >(4, size - i));
+		sum = (sum * 31) ^ word;
+	}
+	return sum;
+}
+
+//walk all chunks, whatever their magic:
+static uint32_t load_stream(std::string const &filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) throw std::runtime_error("Failed to open '" + filename + "'.");
+	uint32_t sum = 0;
+	while (file.peek() != EOF) {
+		char magic[4];
+		file.read(magic, 4);
+		file.seekg(-4, std::ios::cur);
+		std::vector< char > data;
+		read_chunk(file, std::string(magic, 4), &data);
+		sum ^= touch(data.data(), data.size());
+	}
+	return sum;
+}
+
+static uint32_t load_mmap(std::string const &filename) {
+	MappedFile file(filename);
+	char const *at = file.begin();
+	uint32_t sum = 0;
+	while (at != file.end()) {
+		if (file.end() - at < 4) throw std::runtime_error("Truncated chunk in '" + filename + "'.");
+		ChunkSpan< char > data;
+		read_chunk(&at, file.end(), std::string(at, 4), &data);
+		sum ^= touch(data.data(), data.size());
+	}
+	return sum;
+}
+
+static int make_large(std::string const &in_file, std::string const &out_file, uint32_t copies) {
+	struct IndexEntry {
+		uint32_t name_begin, name_end;
+		uint32_t vertex_begin, vertex_end;
+	};
+	static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
+
+	std::ifstream in(in_file, std::ios::binary);
+	std::vector< char > vertices; //(treated as bytes; 36 per vertex)
+	std::vector< char > strings;
+	std::vector< IndexEntry > index;
+	read_chunk(in, "pnct", &vertices);
+	read_chunk(in, "str0", &strings);
+	read_chunk(in, "idx0", &index);
+
+	std::vector< char > out_vertices, out_strings;
+	std::vector< IndexEntry > out_index;
+	for (uint32_t c = 0; c < copies; ++c) {
+		uint32_t vertex_offset = uint32_t(out_vertices.size() / 36);
+		out_vertices.insert(out_vertices.end(), vertices.begin(), vertices.end());
+		for (auto entry : index) {
+			std::string name = std::string(strings.data() + entry.name_begin, strings.data() + entry.name_end) + "." + std::to_string(c);
+			entry.name_begin = uint32_t(out_strings.size());
+			out_strings.insert(out_strings.end(), name.begin(), name.end());
+			entry.name_end = uint32_t(out_strings.size());
+			entry.vertex_begin += vertex_offset;
+			entry.vertex_end += vertex_offset;
+			out_index.emplace_back(entry);
+		}
+	}
+	while (out_strings.size() % 4 != 0) out_strings.emplace_back('\0'); //keep idx0 aligned
+
+	std::ofstream out(out_file, std::ios::binary);
+	write_chunk("pnct", out_vertices, &out);
+	write_chunk("str0", out_strings, &out);
+	write_chunk("idx0", out_index, &out);
+	std::cout << "Wrote " << (out_vertices.size() / 36) << " vertices to '" << out_file << "'." << std::endl;
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	std::vector< std::string > args(argv + 1, argv + argc);
+
+	auto usage = [&]() {
+		std::cerr << "Usage:\n"
+			<< "\t" << argv[0] << " <stream|mmap> [iterations] <file.pnct|file.scene> [...]\n"
+			<< "\t" << argv[0] << " --make-large <in.pnct> <out.pnct> <copies>" << std::endl;
+		return 1;
+	};
+
+	if (!args.empty() && args[0] == "--make-large") {
+		if (args.size() != 4) return usage();
+		return make_large(args[1], args[2], uint32_t(std::stoul(args[3])));
+	}
+
+	if (args.size() < 2 || !(args[0] == "stream" || args[0] == "mmap")) return usage();
+	bool use_mmap = (args[0] == "mmap");
+	size_t first_file = 1;
+	uint32_t iterations = 20;
+	if (args[1].find_first_not_of("0123456789") == std::string::npos) {
+		iterations = std::max(1u, uint32_t(std::stoul(args[1])));
+		first_file = 2;
+	}
+	if (first_file >= args.size()) return usage();
+
+	std::cout << "asset-load (" << args[0] << "):" << std::endl;
+	std::cout << "  " << std::left << std::setw(32) << "file" << std::right
+		<< std::setw(12) << "bytes"
+		<< std::setw(12) << "cold ms"
+		<< std::setw(12) << "warm ms" << std::endl;
+
+	uint32_t sum = 0;
+	for (size_t f = first_file; f < args.size(); ++f) {
+		std::string const &filename = args[f];
+		size_t bytes = MappedFile(filename).size;
+
+		bool evicted = evict_from_cache(filename);
+		auto before = std::chrono::high_resolution_clock::now();
+		sum += (use_mmap ? load_mmap(filename) : load_stream(filename));
+		auto after = std::chrono::high_resolution_clock::now();
+		double cold = std::chrono::duration< double, std::milli >(after - before).count();
+
+		before = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < iterations; ++i) {
+			sum += (use_mmap ? load_mmap(filename) : load_stream(filename));
+		}
+		after = std::chrono::high_resolution_clock::now();
+		double warm = std::chrono::duration< double, std::milli >(after - before).count() / iterations;
+
+		std::cout << "  " << std::left << std::setw(32) << filename << std::right
+			<< std::setw(12) << bytes
+			<< std::setw(12) << std::fixed << std::setprecision(3) << cold << (evicted ? " " : "*")
+			<< std::setw(11) << warm << std::endl;
+	}
+	std::cout << "  (* = couldn't evict file from OS cache, so 'cold' is really warm)" << std::endl;
+	std::cout << "  peak RSS: " << peak_rss_kb() << " kB (checksum " << std::hex << sum << std::dec << ")" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,136 @@
+//Headless benchmark comparing startup loading of loose data files against one packed archive:
+// 'loose'   -- maps each file separately (what loaders do with no archive)
+// 'archive' -- maps the archive once and looks each file up in its directory
+//
+//The loose files are the ones named in the archive, found next to it (e.g., dist/assets.pack -> dist/game6.pnct).
+//Each pass touches all of the data (as loading would).
+//
+//Usage:
+//	bench/asset-startup <assets.pack> [iterations]
+
+#include "AssetArchive.hpp"
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//ask the OS to drop cached pages for a file, so the next read comes from disk (if supported):
+static bool evict_from_cache(std::string const &filename) {
+#if defined(__linux__)
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) return false;
+	bool ok = (posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0);
+	close(fd);
+	return ok;
+#else
+	(void)filename;
+	return false;
+#endif
+}
+
+//a cheap checksum so the compiler can't skip reading the data:
+static uint32_t touch(char const *data, size_t size) {
+	uint32_t sum = 0;
+	for (size_t i = 0; i < size; i += 4) {
+		uint32_t word = 0;
+		std::memcpy(&word, data + i, std::min< size_t >(4, size - i));
+		sum = (sum * 31) ^ word;
+	}
+	return sum;
+}
+
+int main(int argc, char **argv) {
+	if (argc != 2 && argc != 3) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <assets.pack> [iterations]" << std::endl;
+		return 1;
+	}
+	std::string pack = argv[1];
+	uint32_t iterations = (argc == 3 ? std::max(1u, uint32_t(std::stoul(argv[2]))) : 20);
+
+	std::string dir = ".";
+	if (size_t slash = pack.find_last_of("/\\"); slash != std::string::npos) dir = pack.substr(0, slash);
+
+	std::vector< std::string > names;
+	size_t bytes = 0;
+	{
+		AssetArchive archive(pack);
+		for (auto const &[name, file] : archive.files) {
+			names.emplace_back(name);
+			bytes += file.size;
+		}
+	}
+	std::sort(names.begin(), names.end());
+
+	auto load_loose = [&]() {
+		uint32_t sum = 0;
+		for (auto const &name : names) {
+			MappedFile file(dir + "/" + name);
+			sum += touch(file.data, file.size);
+		}
+		return sum;
+	};
+	auto load_archive = [&]() {
+		uint32_t sum = 0;
+		AssetArchive archive(pack);
+		for (auto const &name : names) {
+			AssetArchive::File const *file = archive.find(name);
+			sum += touch(file->data, file->size);
+		}
+		return sum;
+	};
+	auto evict_loose = [&]() {
+		bool ok = true;
+		for (auto const &name : names) ok = evict_from_cache(dir + "/" + name) && ok;
+		return ok;
+	};
+	auto evict_archive = [&]() {
+		return evict_from_cache(pack);
+	};
+
+	std::cout << "asset-startup: " << names.size() << " files, " << bytes << " bytes; " << iterations << " warm iterations." << std::endl;
+	std::cout << "  " << std::left << std::setw(10) << "mode" << std::right
+		<< std::setw(8) << "opens"
+		<< std::setw(12) << "cold ms"
+		<< std::setw(12) << "warm ms" << std::endl;
+
+	uint32_t sum_loose = 0, sum_archive = 0;
+	auto run = [&](char const *mode, size_t opens, auto &&evict, auto &&load, uint32_t *sum) {
+		bool evicted = evict();
+		auto before = std::chrono::high_resolution_clock::now();
+		*sum = load();
+		auto after = std::chrono::high_resolution_clock::now();
+		double cold = std::chrono::duration< double, std::milli >(after - before).count();
+
+		before = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < iterations; ++i) {
+			load();
+		}
+		after = std::chrono::high_resolution_clock::now();
+		double warm = std::chrono::duration< double, std::milli >(after - before).count() / iterations;
+
+		std::cout << "  " << std::left << std::setw(10) << mode << std::right
+			<< std::setw(8) << opens
+			<< std::setw(12) << std::fixed << std::setprecision(3) << cold << (evicted ? " " : "*")
+			<< std::setw(11) << warm << std::endl;
+	};
+	run("loose", names.size(), evict_loose, load_loose, &sum_loose);
+	run("archive", 1, evict_archive, load_archive, &sum_archive);
+
+	std::cout << "  (* = couldn't evict files from OS cache, so 'cold' is really warm)" << std::endl;
+	if (sum_loose != sum_archive) {
+		std::cerr << "WARNING: loose files and archive contents differ (checksums " << std::hex << sum_loose << " vs " << sum_archive << std::dec << ") -- rebuild the archive?" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
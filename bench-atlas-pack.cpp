@@ -0,0 +1,165 @@
+//Benchmark for texture atlas packing (AtlasPacker.hpp):
+//
+// - for the skyline and max-rects packers, with and without padding:
+//   the number of pages (array texture layers) needed, the packing efficiency
+//   (fraction of page area covered by images), and the time to pack;
+// - the time to compose the pages' texels.
+//
+//Uses several generated sets of image sizes (icons, sprites, and textures)
+// unless given '.png' files, whose sizes are used.
+//
+//Usage:
+//	bench/atlas-pack [--page-size N] [file.png ...]
+
+#include "AtlasPacker.hpp"
+#include "load_save_png.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static double seconds_since(std::chrono::high_resolution_clock::time_point before) {
+	return std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - before).count();
+}
+
+struct Corpus {
+	std::string name;
+	std::vector< glm::uvec2 > sizes;
+};
+
+static std::vector< Corpus > generated_corpora() {
+	std::mt19937 mt(0xa71a5);
+	std::vector< Corpus > corpora;
+
+	//UI icons: power-of-two squares, mostly small:
+	corpora.emplace_back(Corpus{ "icons", {} });
+	for (uint32_t i = 0; i < 2000; ++i) {
+		uint32_t s = 16U << (mt() % 4 == 0 ? 2 + mt() % 2 : mt() % 2);
+		corpora.back().sizes.emplace_back(s, s);
+	}
+
+	//sprites: arbitrary rectangles:
+	corpora.emplace_back(Corpus{ "sprites", {} });
+	for (uint32_t i = 0; i < 600; ++i) {
+		corpora.back().sizes.emplace_back(12 + mt() % 240, 12 + mt() % 240);
+	}
+
+	//material textures: power-of-two sizes, some non-square, a few big:
+	corpora.emplace_back(Corpus{ "textures", {} });
+	for (uint32_t i = 0; i < 80; ++i) {
+		uint32_t w = 64U << (mt() % 4), h = (mt() % 3 == 0 ? w / 2 : w);
+		if (i % 20 == 0) w = h = 1024;
+		corpora.back().sizes.emplace_back(w, h);
+	}
+
+	return corpora;
+}
+
+int main(int argc, char **argv) {
+	uint32_t page = 2048;
+	std::vector< std::string > files;
+	for (int a = 1; a < argc; ++a) {
+		std::string arg = argv[a];
+		if (arg == "--page-size" && a + 1 < argc) {
+			page = uint32_t(std::stoul(argv[++a]));
+		} else if (arg.size() >= 4 && arg.substr(arg.size()-4) == ".png") {
+			files.emplace_back(arg);
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--page-size N] [file.png ...]" << std::endl;
+			return 1;
+		}
+	}
+	glm::uvec2 const page_size(page);
+
+	std::vector< Corpus > corpora;
+	std::vector< PNGImage > images;
+	if (files.empty()) {
+		corpora = generated_corpora();
+	} else {
+		try {
+			load_pngs(files, LowerLeftOrigin, &images);
+		} catch (std::exception &e) {
+			std::cerr << "ERROR: " << e.what() << std::endl;
+			return 1;
+		}
+		corpora.emplace_back(Corpus{ "files", {} });
+		for (auto const &image : images) corpora.back().sizes.emplace_back(image.size);
+	}
+
+	std::cout << "atlas-pack: " << page_size.x << "x" << page_size.y << " pages." << std::endl;
+	std::cout << std::setw(10) << "images" << std::setw(10) << "method" << std::setw(9) << "padding"
+		<< std::setw(8) << "pages" << std::setw(12) << "efficiency" << std::setw(12) << "pack ms" << std::setw(14) << "compose ms" << std::endl;
+
+	for (Corpus const &corpus : corpora) {
+		uint64_t area = 0;
+		for (auto const &size : corpus.sizes) area += uint64_t(size.x) * size.y;
+		std::cout << corpus.name << ": " << corpus.sizes.size() << " images, " << std::fixed << std::setprecision(2)
+			<< double(area) / (double(page_size.x) * page_size.y) << " pages of texels (so at least "
+			<< (area + uint64_t(page_size.x) * page_size.y - 1) / (uint64_t(page_size.x) * page_size.y) << " pages)" << std::endl;
+
+		//fake image data (or the real thing) for composing:
+		std::vector< std::vector< glm::u8vec4 > > fake;
+		std::vector< glm::u8vec4 const * > pixels;
+		for (size_t i = 0; i < corpus.sizes.size(); ++i) {
+			if (!images.empty()) {
+				pixels.emplace_back(images[i].data.data());
+			} else {
+				fake.emplace_back(size_t(corpus.sizes[i].x) * corpus.sizes[i].y, glm::u8vec4(uint8_t(i), 0x80, 0x40, 0xff));
+				pixels.emplace_back(fake.back().data());
+			}
+		}
+
+		for (AtlasPacker::Method method : { AtlasPacker::Skyline, AtlasPacker::MaxRects }) {
+			for (uint32_t padding : { 0U, 4U }) {
+				std::vector< AtlasPacker::Placement > placements;
+				uint32_t pages = 0;
+				uint32_t const Passes = 5;
+				double pack_seconds = 0.0;
+				try {
+					auto before = std::chrono::high_resolution_clock::now();
+					for (uint32_t pass = 0; pass < Passes; ++pass) {
+						pages = AtlasPacker::pack(corpus.sizes, page_size, padding, method, &placements);
+					}
+					pack_seconds = seconds_since(before) / Passes;
+				} catch (std::exception &e) {
+					std::cout << std::setw(10) << "" << std::setw(10) << (method == AtlasPacker::Skyline ? "skyline" : "maxrects")
+						<< std::setw(9) << padding << "  " << e.what() << std::endl;
+					continue;
+				}
+
+				//placements must stay on their pages and never overlap (padding included):
+				for (size_t a = 0; a < placements.size(); ++a) {
+					glm::uvec2 min_a = placements[a].position - glm::uvec2(padding), max_a = placements[a].position + corpus.sizes[a] + glm::uvec2(padding);
+					if (placements[a].position.x < padding || placements[a].position.y < padding || max_a.x > page_size.x || max_a.y > page_size.y || placements[a].page >= pages) {
+						std::cerr << "ERROR: image " << a << " was placed off its page." << std::endl;
+						return 1;
+					}
+					for (size_t b = 0; b < a; ++b) {
+						if (placements[a].page != placements[b].page) continue;
+						glm::uvec2 min_b = placements[b].position - glm::uvec2(padding), max_b = placements[b].position + corpus.sizes[b] + glm::uvec2(padding);
+						if (min_a.x < max_b.x && min_b.x < max_a.x && min_a.y < max_b.y && min_b.y < max_a.y) {
+							std::cerr << "ERROR: images " << b << " and " << a << " overlap." << std::endl;
+							return 1;
+						}
+					}
+				}
+
+				std::vector< glm::u8vec4 > texels;
+				auto before = std::chrono::high_resolution_clock::now();
+				AtlasPacker::compose_pages(corpus.sizes, pixels, placements, page_size, padding, pages, &texels);
+				double compose_seconds = seconds_since(before);
+
+				std::cout << std::setw(10) << "" << std::setw(10) << (method == AtlasPacker::Skyline ? "skyline" : "maxrects")
+					<< std::setw(9) << padding << std::setw(8) << pages
+					<< std::setw(11) << std::setprecision(1) << 100.0f * AtlasPacker::packing_efficiency(corpus.sizes, page_size, pages) << "%"
+					<< std::setw(12) << std::setprecision(3) << pack_seconds * 1.0e3
+					<< std::setw(14) << std::setprecision(2) << compose_seconds * 1.0e3 << std::endl;
+			}
+		}
+	}
+
+	return 0;
+}
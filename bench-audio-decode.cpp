@@ -0,0 +1,121 @@
+//Headless benchmark for loading samples -- decodes a set of '.wav'/'.opus'
+// files on one thread and on a pool of threads (as Load<> loaders running
+// LoadOnWorkerThread do), then loads them again through the decoded audio cache
+// (see audio_cache.hpp) cold (decoding and writing entries) and warm.
+//
+//Reports the time for each, and how much of the decoding time a warm cache saves;
+// also checks that cached data matches freshly decoded data.
+//
+//The cache entries are written to 'bench-audio-cache/' in the current directory
+// (and removed afterward).
+//
+//Usage:
+//	bench/audio-decode <file.wav|file.opus> [...]
+
+#include "audio_cache.hpp"
+#include "load_opus.hpp"
+#include "load_wav.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static AudioDecoder decoder_for(std::string const &filename) {
+	if (filename.size() >= 4 && filename.substr(filename.size()-4) == ".wav") return load_wav;
+	if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".opus") return load_opus;
+	return nullptr;
+}
+
+//load every file on 'threads' threads (pulling files from a shared counter), returning milliseconds taken:
+static double load_all(std::vector< std::string > const &files, uint32_t threads, bool cached, std::vector< std::vector< float > > *out, uint32_t *hits) {
+	out->assign(files.size(), std::vector< float >());
+	std::atomic< uint32_t > next(0);
+	std::atomic< uint32_t > cache_hits(0);
+	auto work = [&]() {
+		for (uint32_t i; (i = next.fetch_add(1)) < files.size(); ) {
+			if (cached) {
+				if (load_audio_cached(files[i], decoder_for(files[i]), &(*out)[i]).cached) cache_hits.fetch_add(1);
+			} else {
+				decoder_for(files[i])(files[i], &(*out)[i]);
+			}
+		}
+	};
+
+	auto before = std::chrono::high_resolution_clock::now();
+	std::vector< std::thread > workers;
+	for (uint32_t t = 1; t < threads; ++t) workers.emplace_back(work);
+	work(); //(this thread is one of the workers)
+	for (auto &worker : workers) worker.join();
+	double ms = std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - before).count() * 1000.0;
+
+	if (hits) *hits = cache_hits.load();
+	return ms;
+}
+
+int main(int argc, char **argv) {
+	std::vector< std::string > files(argv + 1, argv + argc);
+	if (files.empty()) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <file.wav|file.opus> [...]" << std::endl;
+		return 1;
+	}
+	for (auto const &file : files) {
+		if (!decoder_for(file)) {
+			std::cerr << "ERROR: '" << file << "' isn't a '.wav' or '.opus' file." << std::endl;
+			return 1;
+		}
+	}
+
+	//as many threads as Load<> would use:
+	uint32_t cores = std::thread::hardware_concurrency();
+	uint32_t threads = (cores > 2 ? cores - 1 : 1);
+	std::string on_threads = std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+
+	set_audio_cache_directory("bench-audio-cache");
+	auto clear_cache = [&files]() {
+		for (auto const &file : files) std::remove(audio_cache_path(file).c_str());
+	};
+	clear_cache();
+
+	std::vector< std::vector< float > > decoded, loaded;
+	uint32_t hits = 0;
+	size_t total_samples = 0;
+
+	std::cout << "audio-decode: " << files.size() << " files; " << on_threads << "." << std::endl;
+	std::cout << std::setw(30) << "" << std::setw(12) << "ms" << std::setw(12) << "cached" << std::endl;
+	auto row = [](std::string const &name, double ms, std::string const &cached) {
+		std::cout << std::setw(30) << name << std::setw(12) << std::fixed << std::setprecision(2) << ms << std::setw(12) << cached << std::endl;
+	};
+
+	double serial_ms = load_all(files, 1, false, &decoded, nullptr);
+	row("decode, 1 thread", serial_ms, "-");
+	for (auto const &data : decoded) total_samples += data.size();
+
+	double parallel_ms = load_all(files, threads, false, &loaded, nullptr);
+	row("decode, " + on_threads, parallel_ms, "-");
+
+	double cold_ms = load_all(files, threads, true, &loaded, &hits);
+	row("cold cache, " + on_threads, cold_ms, std::to_string(hits) + "/" + std::to_string(files.size()));
+
+	double warm_serial_ms = load_all(files, 1, true, &loaded, &hits);
+	row("warm cache, 1 thread", warm_serial_ms, std::to_string(hits) + "/" + std::to_string(files.size()));
+
+	double warm_ms = load_all(files, threads, true, &loaded, &hits);
+	row("warm cache, " + on_threads, warm_ms, std::to_string(hits) + "/" + std::to_string(files.size()));
+
+	clear_cache();
+
+	std::cout << "(" << std::setprecision(1) << total_samples / 48000.0 << " seconds of audio; a warm cache saves "
+		<< serial_ms - warm_serial_ms << "ms on one thread, " << parallel_ms - warm_ms << "ms on " << on_threads << ")" << std::endl;
+
+	if (loaded != decoded || hits != files.size()) {
+		std::cerr << "ERROR: cached audio doesn't match decoded audio." << std::endl;
+		return 1;
+	}
+	return 0;
+}
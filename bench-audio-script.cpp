@@ -0,0 +1,341 @@
+//Headless benchmark and regression test for the whole audio path -- plays a
+// script of play/stop/ramp events through Sound (in offline mode, so no audio
+// device is needed) and renders the result as fast as possible.
+//
+//Reports how much faster than real time the mix ran and the distribution of
+// time per block; can save the output as a WAV file and compare it to a
+// "golden" WAV rendered earlier (failing if they differ).
+//
+//Usage:
+//	bench/audio-script [script.txt] [--wav out.wav] [--golden golden.wav | --update-golden golden.wav]
+//
+//Scripts have one command per line ('#' starts a comment). Samples are made first:
+//	sample <name> sine <hz> <seconds>
+//	sample <name> noise <seconds>
+//	sample <name> file <path.wav or path.opus>
+//...then events, in time order (time in seconds; the event applies at the first block starting at or after it):
+//	<time> play <sample> <handle> <volume> <pan>
+//	<time> loop <sample> <handle> <volume> <pan>
+//	<time> play3d <sample> <handle> <volume> <x> <y> <z> <half volume radius>
+//	<time> loop3d <sample> <handle> <volume> <x> <y> <z> <half volume radius>
+//	<time> volume <handle> <volume> <ramp>
+//	<time> pan <handle> <pan> <ramp>
+//	<time> position <handle> <x> <y> <z> <ramp>
+//	<time> rate <handle> <rate> <ramp>
+//	<time> priority <handle> <priority>
+//	<time> seek <handle> <time>
+//	<time> stop <handle> <ramp>
+//	<time> stopall
+//	<time> master <volume> <ramp>
+//	<time> listener <x> <y> <z> <right x> <right y> <right z> <ramp>
+//	<time> limit <voices>
+//	<time> end
+
+#include "Sound.hpp"
+#include "load_wav.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//used when no script is given -- a bit of everything the mixer does:
+static char const *DefaultScript = R"(
+sample tone sine 440 0.5
+sample low sine 110 2.0
+sample hiss noise 1.0
+sample blip sine 1760 0.05
+
+0.0 loop low bed 0.3 0.0
+0.0 master 0.8 0.5
+0.1 play tone a 0.5 -0.5
+0.2 play tone b 0.5 0.5
+0.3 loop3d hiss wind 0.2 5 0 0 2
+0.5 position wind -5 0 0 1.0
+0.5 listener 0 0 0 0 1 0 1.0
+1.0 pan bed -1.0 0.5
+1.0 priority bed 1
+1.2 volume wind 0.0 0.3
+1.5 seek bed 0.25
+1.6 stop wind 0.1
+1.7 limit 4
+2.0 play blip c1 0.3 0.0
+2.0 play blip c2 0.3 0.2
+2.0 play blip c3 0.3 -0.2
+2.0 play3d blip c4 0.3 1 1 0 1
+2.0 play3d blip c5 0.3 -1 1 0 1
+2.0 play3d blip c6 0.3 0 -1 0 1
+2.5 limit 64
+2.5 pan bed 1.0 0.5
+3.0 stop bed 0.5
+3.0 loop3d tone orbit 0.4 0 3 0 1
+3.1 rate orbit 0.5 0.4
+3.2 position orbit 3 0 0 0.2
+3.4 position orbit 0 -3 0 0.2
+3.6 position orbit -3 0 0 0.2
+3.8 stopall
+4.0 end
+)";
+
+struct Event {
+	float time = 0.0f;
+	std::string type;
+	std::vector< std::string > args;
+	uint32_t line = 0;
+};
+
+//read a float WAV file written by save_wav (the golden output):
+static std::vector< float > load_float_wav(std::string const &filename) {
+	std::ifstream in(filename, std::ios::binary);
+	std::vector< char > file((std::istreambuf_iterator< char >(in)), std::istreambuf_iterator< char >());
+	if (file.size() < 12 || std::memcmp(file.data(), "RIFF", 4) != 0 || std::memcmp(file.data() + 8, "WAVE", 4) != 0) {
+		throw std::runtime_error("'" + filename + "' is not a WAV file.");
+	}
+	//walk the chunks for 'fmt ' and 'data':
+	bool float_stereo = false;
+	for (size_t at = 12; at + 8 <= file.size(); ) {
+		uint32_t size;
+		std::memcpy(&size, file.data() + at + 4, 4);
+		char const *chunk = file.data() + at + 8;
+		if (at + 8 + size > file.size()) break;
+		if (std::memcmp(file.data() + at, "fmt ", 4) == 0 && size >= 16) {
+			uint16_t format, channels, bits;
+			uint32_t rate;
+			std::memcpy(&format, chunk + 0, 2);
+			std::memcpy(&channels, chunk + 2, 2);
+			std::memcpy(&rate, chunk + 4, 4);
+			std::memcpy(&bits, chunk + 14, 2);
+			float_stereo = (format == 3 && channels == 2 && rate == Sound::Rate && bits == 32);
+		} else if (std::memcmp(file.data() + at, "data", 4) == 0) {
+			if (!float_stereo) break;
+			std::vector< float > data(size / sizeof(float));
+			std::memcpy(data.data(), chunk, data.size() * sizeof(float));
+			return data;
+		}
+		at += 8 + size + (size & 1);
+	}
+	throw std::runtime_error("'" + filename + "' isn't 48kHz 32-bit float stereo audio.");
+}
+
+int main(int argc, char **argv) {
+	std::string script_file, wav_file, golden_file;
+	bool update_golden = false;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--wav" && i + 1 < argc) {
+			wav_file = argv[++i];
+		} else if ((arg == "--golden" || arg == "--update-golden") && i + 1 < argc && golden_file.empty()) {
+			golden_file = argv[++i];
+			update_golden = (arg == "--update-golden");
+		} else if (arg.substr(0, 2) != "--" && script_file.empty()) {
+			script_file = arg;
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [script.txt] [--wav out.wav] [--golden golden.wav | --update-golden golden.wav]" << std::endl;
+			return 1;
+		}
+	}
+
+	//--- parse the script ---
+	std::string script = DefaultScript;
+	if (!script_file.empty()) {
+		std::ifstream in(script_file, std::ios::binary);
+		if (!in) {
+			std::cerr << "ERROR: failed to open script '" << script_file << "'." << std::endl;
+			return 1;
+		}
+		script.assign(std::istreambuf_iterator< char >(in), std::istreambuf_iterator< char >());
+	} else {
+		script_file = "(default script)";
+	}
+
+	std::map< std::string, Sound::Sample > samples;
+	std::vector< Event > events;
+	float end_time = 0.0f;
+	try {
+		std::istringstream lines(script);
+		std::string line;
+		uint32_t line_number = 0;
+		std::mt19937 mt(0xa0d10); //(noise samples are the same every run, so golden output matches)
+		while (std::getline(lines, line)) {
+			++line_number;
+			line = line.substr(0, line.find('#'));
+			std::istringstream tokens(line);
+			std::vector< std::string > words;
+			for (std::string word; tokens >> word; ) words.emplace_back(word);
+			if (words.empty()) continue;
+
+			auto bad_line = [&]() {
+				return std::runtime_error(script_file + ":" + std::to_string(line_number) + ": can't understand '" + line + "'.");
+			};
+
+			if (words[0] == "sample") {
+				if (words.size() < 4) throw bad_line();
+				std::vector< float > data;
+				if (words[2] == "sine" && words.size() == 5) {
+					float hz = std::stof(words[3]);
+					data.resize(size_t(std::stof(words[4]) * Sound::Rate));
+					for (size_t i = 0; i < data.size(); ++i) {
+						data[i] = std::sin(float(i) / Sound::Rate * hz * 2.0f * 3.1415926f);
+					}
+				} else if (words[2] == "noise" && words.size() == 4) {
+					data.resize(size_t(std::stof(words[3]) * Sound::Rate));
+					for (float &f : data) f = mt() / float(mt.max()) * 2.0f - 1.0f;
+				} else if (words[2] == "file" && words.size() == 4) {
+					samples.erase(words[1]);
+					samples.emplace(words[1], Sound::Sample(words[3]));
+					continue;
+				} else {
+					throw bad_line();
+				}
+				samples.erase(words[1]);
+				samples.emplace(words[1], Sound::Sample(data));
+			} else {
+				Event event;
+				event.time = std::stof(words[0]);
+				if (words.size() < 2 || (!events.empty() && event.time < events.back().time)) throw bad_line();
+				event.type = words[1];
+				event.args.assign(words.begin() + 2, words.end());
+				event.line = line_number;
+				events.emplace_back(event);
+				end_time = std::max(end_time, event.time);
+			}
+		}
+	} catch (std::exception &e) {
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+
+	//--- play it ---
+	Sound::init_offline();
+
+	uint32_t blocks = uint32_t(std::ceil(end_time * Sound::Rate / Sound::BlockSamples));
+	std::vector< float > out;
+	out.reserve(size_t(blocks) * Sound::BlockSamples * 2); //(so render() doesn't reallocate while being timed)
+	std::vector< double > block_us;
+	block_us.reserve(blocks);
+
+	std::map< std::string, std::shared_ptr< Sound::PlayingSample > > handles;
+	size_t next_event = 0;
+	try {
+		for (uint32_t b = 0; b <= blocks; ++b) { //(the last pass just applies -- and checks -- events at the end time)
+			float block_time = float(b) * Sound::BlockSamples / Sound::Rate;
+			for (; next_event < events.size() && events[next_event].time <= block_time; ++next_event) {
+				Event const &event = events[next_event];
+				auto arg = [&](uint32_t i) {
+					if (i >= event.args.size()) throw std::runtime_error(script_file + ":" + std::to_string(event.line) + ": missing arguments for '" + event.type + "'.");
+					return event.args[i];
+				};
+				auto number = [&](uint32_t i) { return std::stof(arg(i)); };
+				auto sample = [&](uint32_t i) -> Sound::Sample const & {
+					auto f = samples.find(arg(i));
+					if (f == samples.end()) throw std::runtime_error(script_file + ":" + std::to_string(event.line) + ": no sample named '" + arg(i) + "'.");
+					return f->second;
+				};
+				auto handle = [&](uint32_t i) -> Sound::PlayingSample & {
+					auto f = handles.find(arg(i));
+					if (f == handles.end()) throw std::runtime_error(script_file + ":" + std::to_string(event.line) + ": nothing playing as '" + arg(i) + "'.");
+					return *f->second;
+				};
+
+				if (event.type == "play") handles[arg(1)] = Sound::play(sample(0), number(2), number(3));
+				else if (event.type == "loop") handles[arg(1)] = Sound::loop(sample(0), number(2), number(3));
+				else if (event.type == "play3d") handles[arg(1)] = Sound::play_3D(sample(0), number(2), glm::vec3(number(3), number(4), number(5)), number(6));
+				else if (event.type == "loop3d") handles[arg(1)] = Sound::loop_3D(sample(0), number(2), glm::vec3(number(3), number(4), number(5)), number(6));
+				else if (event.type == "volume") handle(0).set_volume(number(1), number(2));
+				else if (event.type == "pan") handle(0).set_pan(number(1), number(2));
+				else if (event.type == "position") handle(0).set_position(glm::vec3(number(1), number(2), number(3)), number(4));
+				else if (event.type == "rate") handle(0).set_rate(number(1), number(2));
+				else if (event.type == "priority") handle(0).set_priority(int32_t(std::stol(arg(1))));
+				else if (event.type == "seek") handle(0).seek(number(1));
+				else if (event.type == "stop") handle(0).stop(number(1));
+				else if (event.type == "stopall") Sound::stop_all_samples();
+				else if (event.type == "master") Sound::set_volume(number(0), number(1));
+				else if (event.type == "listener") Sound::listener.set_position_right(glm::vec3(number(0), number(1), number(2)), glm::vec3(number(3), number(4), number(5)), number(6));
+				else if (event.type == "limit") Sound::set_voice_limit(uint32_t(std::stoul(arg(0))));
+				else if (event.type == "end") { }
+				else throw std::runtime_error(script_file + ":" + std::to_string(event.line) + ": unknown event '" + event.type + "'.");
+			}
+
+			if (b == blocks) break;
+
+			auto before = std::chrono::high_resolution_clock::now();
+			Sound::render(1, &out);
+			block_us.emplace_back(std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - before).count() * 1.0e6);
+		}
+	} catch (std::exception &e) {
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+
+	//--- report ---
+	double total_us = 0.0;
+	for (double us : block_us) total_us += us;
+	std::vector< double > sorted = block_us;
+	std::sort(sorted.begin(), sorted.end());
+	auto percentile = [&sorted](double p) {
+		return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, size_t(p * sorted.size()))];
+	};
+	double seconds = double(blocks) * Sound::BlockSamples / Sound::Rate;
+	Sound::Stats stats = Sound::get_stats();
+
+	std::cout << "audio-script: " << script_file << ", " << blocks << " blocks (" << std::fixed << std::setprecision(2) << seconds << " seconds) in "
+		<< total_us * 1.0e-3 << "ms -- " << std::setprecision(0) << (total_us > 0.0 ? seconds * 1.0e6 / total_us : 0.0) << "x faster than real time." << std::endl;
+	std::cout << "block us: min " << std::setprecision(1) << percentile(0.0)
+		<< ", median " << percentile(0.5)
+		<< ", p95 " << percentile(0.95)
+		<< ", p99 " << percentile(0.99)
+		<< ", max " << (sorted.empty() ? 0.0 : sorted.back())
+		<< " (budget " << 1.0e6 * Sound::BlockSamples / Sound::Rate << ")" << std::endl;
+	std::cout << "voices: " << stats.voices_playing << " playing at the end, " << stats.voices_dropped << " dropped; "
+		<< stats.stream_underruns << " stream underruns." << std::endl;
+
+	Sound::shutdown();
+
+	//--- output ---
+	bool ok = true;
+	try {
+		if (!wav_file.empty()) {
+			save_wav(wav_file, out);
+			std::cout << "Wrote '" << wav_file << "'." << std::endl;
+		}
+		if (!golden_file.empty() && update_golden) {
+			save_wav(golden_file, out);
+			std::cout << "Wrote golden output '" << golden_file << "'." << std::endl;
+		} else if (!golden_file.empty()) {
+			std::vector< float > golden = load_float_wav(golden_file);
+			//(small differences are expected from different compilers and SIMD kernels)
+			constexpr float Tolerance = 1e-4f;
+			float max_difference = 0.0f;
+			double error_power = 0.0, golden_power = 0.0;
+			for (size_t i = 0; i < std::min(golden.size(), out.size()); ++i) {
+				float d = out[i] - golden[i];
+				max_difference = std::max(max_difference, std::abs(d));
+				error_power += double(d) * double(d);
+				golden_power += double(golden[i]) * double(golden[i]);
+			}
+			std::cout << "golden: max difference " << std::scientific << std::setprecision(1) << max_difference << std::fixed
+				<< ", error " << (error_power > 0.0 ? 10.0 * std::log10(error_power / std::max(golden_power, 1e-30)) : -INFINITY) << "dB";
+			if (golden.size() != out.size()) {
+				std::cout << "; length " << out.size() / 2 << " frames vs. " << golden.size() / 2 << " golden";
+				ok = false;
+			}
+			std::cout << std::endl;
+			if (max_difference > Tolerance) ok = false;
+			if (!ok) std::cerr << "ERROR: output doesn't match '" << golden_file << "'." << std::endl;
+		}
+	} catch (std::exception &e) {
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return ok ? 0 : 1;
+}
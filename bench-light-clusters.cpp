@@ -0,0 +1,82 @@
+//Headless benchmark for LightClusters::build -- bins random point and spot lights
+// into the cluster grid and reports timing and cluster occupancy.
+//
+//Usage:
+//	bench/light-clusters [iterations]
+
+#include "LightClusters.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+int main(int argc, char **argv) {
+	uint32_t iterations = 200;
+	if (argc == 2) {
+		iterations = uint32_t(std::max(1, std::stoi(argv[1])));
+	} else if (argc != 1) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [iterations]" << std::endl;
+		return 1;
+	}
+
+	//camera roughly like the game's: 60 degree fov, 16:9 window, looking at the origin from a distance:
+	float fovy = glm::radians(60.0f);
+	float aspect = 16.0f / 9.0f;
+	glm::vec2 clip_scale = glm::vec2(1.0f / (aspect * std::tan(0.5f * fovy)), 1.0f / std::tan(0.5f * fovy));
+	glm::mat4x3 world_to_view = glm::mat4x3(glm::lookAt(glm::vec3(0.0f,-20.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+
+	std::cout << "light-clusters: " << iterations << " iterations per row." << std::endl;
+	std::cout << std::setw(8) << "lights"
+		<< std::setw(12) << "build ms"
+		<< std::setw(14) << "avg/cluster"
+		<< std::setw(14) << "max/cluster"
+		<< std::setw(12) << "indices" << std::endl;
+
+	for (uint32_t count = 16; count <= 1024; count *= 2) {
+		std::mt19937 mt(0x15466); //same lights every run
+		auto rand01 = [&mt]() { return mt() / float(mt.max()); };
+
+		LightClusters clusters;
+		for (uint32_t i = 0; i < count; ++i) {
+			LightClusters::Light light;
+			light.type = float(i % 4 == 0 ? LightClusters::Spot : LightClusters::Point);
+			light.position = glm::vec3(rand01() * 40.0f - 20.0f, rand01() * 40.0f - 20.0f, rand01() * 10.0f);
+			light.direction = glm::vec3(0.0f, 0.0f,-1.0f);
+			light.cutoff = std::cos(glm::radians(30.0f));
+			light.energy = glm::vec3(rand01(), rand01(), rand01()) * 0.2f;
+			clusters.add(light);
+		}
+		//one global light, like the game's sky:
+		LightClusters::Light sky;
+		sky.type = float(LightClusters::Hemisphere);
+		clusters.add(sky);
+
+		auto before = std::chrono::high_resolution_clock::now();
+		for (uint32_t iter = 0; iter < iterations; ++iter) {
+			clusters.build(world_to_view, clip_scale);
+		}
+		auto after = std::chrono::high_resolution_clock::now();
+		double ms = std::chrono::duration< double >(after - before).count() * 1000.0 / iterations;
+
+		uint32_t total = 0;
+		uint32_t max = 0;
+		for (auto const &cluster : clusters.clusters) {
+			total += cluster.y;
+			max = std::max(max, cluster.y);
+		}
+
+		std::cout << std::setw(8) << count
+			<< std::setw(12) << std::fixed << std::setprecision(4) << ms
+			<< std::setw(14) << std::setprecision(2) << (total / float(clusters.clusters.size()))
+			<< std::setw(14) << max
+			<< std::setw(12) << clusters.indices.size() << std::endl;
+	}
+
+	return 0;
+}
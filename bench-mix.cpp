@@ -0,0 +1,114 @@
+//Headless benchmark for Sound::Mixer -- renders some seconds of audio with
+// 1 to 1024 looping voices playing (half "2D" and half "3D", with a moving
+// listener) and reports how many voices one core could mix in
+// real time at 48kHz, for the SIMD kernel and for the plain scalar loop.
+//
+//Usage:
+//	bench/mix [seconds]
+
+#include "SoundMixer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+//mix 'blocks' blocks with 'count' voices using 'kernel'; returns seconds taken (and the output in *out):
+static double render(uint32_t count, uint32_t blocks, Sound::MixKernel kernel, std::vector< std::vector< float > > const &samples, std::vector< float > *out) {
+	static Sound::Mixer mixer; //(static: a Mixer is big)
+	mixer = Sound::Mixer();
+	mixer.kernel = kernel;
+	mixer.real_voice_limit = count; //(mix every voice)
+
+	std::mt19937 mt(0x15466); //same voices every run
+	auto rand01 = [&mt]() { return mt() / float(mt.max()); };
+
+	for (uint32_t v = 0; v < count; ++v) {
+		Sound::Mixer::Voice &voice = mixer.voices[v];
+		std::vector< float > const &sample = samples[v % samples.size()];
+		voice.data = sample.data();
+		voice.size = sample.size();
+		voice.i = mt() % sample.size();
+		voice.loop = true; //(so every voice plays the whole time)
+		voice.is_3D = (v % 2 == 0);
+		voice.volume = Sound::Ramp< float >(1.0f / count);
+		voice.pan = Sound::Ramp< float >(rand01() * 2.0f - 1.0f);
+		voice.position = Sound::Ramp< glm::vec3 >(rand01() * 20.0f - 10.0f, rand01() * 20.0f - 10.0f, 0.0f);
+		voice.half_volume_radius = Sound::Ramp< float >(5.0f);
+		mixer.start(v);
+	}
+
+	out->assign(blocks * Sound::Mixer::BlockSamples * 2, 0.0f);
+	auto before = std::chrono::high_resolution_clock::now();
+	for (uint32_t b = 0; b < blocks; ++b) {
+		//turn the listener a little every block, as a game would:
+		float angle = 0.01f * b;
+		mixer.listener_right.set(glm::vec3(std::cos(angle), std::sin(angle), 0.0f), 1.0f / 60.0f);
+		mixer.mix(out->data() + b * Sound::Mixer::BlockSamples * 2);
+		mixer.finished_count = 0;
+	}
+	auto after = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration< double >(after - before).count();
+}
+
+int main(int argc, char **argv) {
+	float seconds = 10.0f;
+	if (argc == 2) {
+		seconds = std::max(0.1f, std::stof(argv[1]));
+	} else if (argc != 1) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [seconds]" << std::endl;
+		return 1;
+	}
+	uint32_t blocks = uint32_t(std::ceil(seconds * Sound::Mixer::Rate / Sound::Mixer::BlockSamples));
+	double audio_seconds = double(blocks) * Sound::Mixer::BlockSamples / Sound::Mixer::Rate;
+
+	//some noise samples of different lengths (so voices hit their loop points at different times):
+	std::vector< std::vector< float > > samples;
+	{
+		std::mt19937 mt(0x5a3);
+		for (uint32_t length : {480u, 4801u, 48017u, 96001u}) {
+			samples.emplace_back(length);
+			for (float &f : samples.back()) f = mt() / float(mt.max()) * 2.0f - 1.0f;
+		}
+	}
+
+	std::cout << "mix: " << audio_seconds << " seconds of audio per row." << std::endl;
+	std::cout << std::setw(8) << "voices"
+		<< std::setw(12) << "scalar ms"
+		<< std::setw(10) << "simd ms"
+		<< std::setw(10) << "speedup"
+		<< std::setw(22) << "scalar voices/core"
+		<< std::setw(20) << "simd voices/core"
+		<< std::setw(14) << "max error" << std::endl;
+
+	for (uint32_t count = 1; count <= 1024; count *= 2) {
+		std::vector< float > scalar_out, simd_out;
+		double scalar = render(count, blocks, Sound::mix_run_scalar, samples, &scalar_out);
+		double simd = render(count, blocks, Sound::mix_run_simd, samples, &simd_out);
+
+		//the kernels step gains differently, so expect tiny rounding differences:
+		float error = 0.0f;
+		for (size_t i = 0; i < scalar_out.size(); ++i) {
+			error = std::max(error, std::abs(scalar_out[i] - simd_out[i]));
+		}
+		if (!(error < 1e-4f)) {
+			std::cerr << "ERROR: SIMD and scalar kernels disagree (by " << error << ")." << std::endl;
+			return 1;
+		}
+
+		//voices one core could keep mixing in real time:
+		std::cout << std::setw(8) << count
+			<< std::setw(12) << std::fixed << std::setprecision(2) << scalar * 1000.0
+			<< std::setw(10) << simd * 1000.0
+			<< std::setw(10) << std::setprecision(2) << scalar / simd
+			<< std::setw(22) << std::setprecision(0) << count * audio_seconds / scalar
+			<< std::setw(20) << count * audio_seconds / simd
+			<< std::setw(14) << std::scientific << std::setprecision(1) << error << std::defaultfloat << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,100 @@
+//Headless benchmark for name lookups -- compares NameMap (see NameMap.hpp) with
+// std::map and std::unordered_map for 10 to 100k mesh-like names.
+//
+//Lookups go in a shuffled order over names that are all present, as when a scene
+// looks up its meshes. NameMap is timed twice: hashing each std::string as it goes,
+// and with NameKeys hashed ahead of time.
+//
+//Usage:
+//	bench/name-map [lookups]
+
+#include "NameMap.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//time 'lookups' calls of 'fn(name index)' cycling through 'count' names; returns nanoseconds per call:
+template< typename F >
+static double time_ns(uint32_t lookups, std::vector< uint32_t > const &order, F const &fn) {
+	auto before = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < lookups; ++i) {
+		fn(order[i % order.size()]);
+	}
+	auto after = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration< double >(after - before).count() * 1.0e9 / lookups;
+}
+
+int main(int argc, char **argv) {
+	uint32_t lookups = 2000000;
+	if (argc == 2) {
+		lookups = uint32_t(std::max(1, std::stoi(argv[1])));
+	} else if (argc != 1) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [lookups]" << std::endl;
+		return 1;
+	}
+
+	std::cout << "name-map: " << lookups << " lookups per column (ns per lookup)." << std::endl;
+	std::cout << std::setw(8) << "names"
+		<< std::setw(12) << "std::map"
+		<< std::setw(16) << "unordered_map"
+		<< std::setw(12) << "NameMap"
+		<< std::setw(20) << "NameMap (hashed)" << std::endl;
+
+	for (uint32_t count : {10, 100, 1000, 10000, 100000}) {
+		std::mt19937 mt(0x15466); //same names every run
+
+		//names like the ones Blender exports ("Cube.012", "vine_purp.117"):
+		static char const *stems[] = {"Cube", "Plane", "vine_purp", "vine_green", "flower_purp", "Cylinder", "dot_grid", "Circle"};
+		std::vector< std::string > names;
+		for (uint32_t i = 0; i < count; ++i) {
+			std::string number = std::to_string(i / 8);
+			names.emplace_back(std::string(stems[i % 8]) + "." + std::string(number.size() < 3 ? 3 - number.size() : 0, '0') + number);
+		}
+
+		std::map< std::string, uint32_t > tree;
+		std::unordered_map< std::string, uint32_t > unordered;
+		NameMap< uint32_t > flat;
+		for (uint32_t i = 0; i < count; ++i) {
+			tree.emplace(names[i], i);
+			unordered.emplace(names[i], i);
+			flat.insert(names[i], i);
+		}
+		std::vector< NameKey > keys(names.begin(), names.end());
+
+		std::vector< uint32_t > order(count);
+		for (uint32_t i = 0; i < count; ++i) order[i] = i;
+		std::shuffle(order.begin(), order.end(), mt);
+
+		//(the sums keep the compiler from skipping lookups, and check that every map found every name)
+		uint64_t expected = 0;
+		for (uint32_t i = 0; i < lookups; ++i) expected += order[i % count];
+		uint64_t sums[4] = {0, 0, 0, 0};
+
+		double tree_ns = time_ns(lookups, order, [&](uint32_t i) { sums[0] += tree.find(names[i])->second; });
+		double unordered_ns = time_ns(lookups, order, [&](uint32_t i) { sums[1] += unordered.find(names[i])->second; });
+		double flat_ns = time_ns(lookups, order, [&](uint32_t i) { sums[2] += *flat.find(names[i]); });
+		double hashed_ns = time_ns(lookups, order, [&](uint32_t i) { sums[3] += *flat.find(keys[i]); });
+
+		for (uint64_t sum : sums) {
+			if (sum != expected) {
+				std::cerr << "ERROR: lookups returned the wrong values." << std::endl;
+				return 1;
+			}
+		}
+
+		std::cout << std::setw(8) << count
+			<< std::setw(12) << std::fixed << std::setprecision(1) << tree_ns
+			<< std::setw(16) << unordered_ns
+			<< std::setw(12) << flat_ns
+			<< std::setw(20) << hashed_ns << std::endl;
+	}
+
+	return 0;
+}
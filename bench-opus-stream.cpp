@@ -0,0 +1,169 @@
+//Headless benchmark for streamed samples -- compares decoding a whole '.opus'
+// file up front (load_opus, as Sound::Sample does by default) with streaming it
+// through a SampleStream (Sound::Sample::Streamed), and checks that both play
+// the same audio through Sound::Mixer when played once, looped, and seeked.
+//
+//Reports startup time (to decoded data / to the first block of streamed data),
+// memory held while playing, and how much faster than real time the decoder runs.
+//
+//Usage:
+//	bench/opus-stream <file.opus>
+
+#include "SoundMixer.hpp"
+#include "SoundStream.hpp"
+#include "load_opus.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static double seconds_since(std::chrono::high_resolution_clock::time_point before) {
+	return std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - before).count();
+}
+
+//wait for the decoder to start on a streamed voice's epoch, then point 'read' at it:
+// (the game's mixer does this itself on the first block after the epoch is published)
+static void begin_stream(Sound::Mixer::Voice &voice) {
+	Sound::SampleStream &stream = *voice.stream;
+	uint64_t published;
+	while (uint16_t((published = stream.published.load(std::memory_order_acquire)) >> 48) != voice.epoch) {
+		std::this_thread::yield();
+	}
+	stream.read.store(published & 0xffffffffffffULL, std::memory_order_release);
+	voice.stream_started = true;
+}
+
+//wait until a started streamed voice can mix a whole block (or its stream has ended):
+// (the game's mixer can't wait, of course -- it plays silence and counts an underrun)
+static void wait_for_stream(Sound::Mixer::Voice const &voice) {
+	Sound::SampleStream &stream = *voice.stream;
+	while (stream.end.load() == -1ULL && stream.write.load() - stream.read.load() < Sound::Mixer::BlockSamples) {
+		std::this_thread::yield();
+	}
+}
+
+//start voice 0 of 'mixer' playing 'data' or 'stream' from 'position':
+static void start(Sound::Mixer &mixer, std::vector< float > const *data, Sound::SampleStream *stream, uint64_t position, bool loop) {
+	mixer = Sound::Mixer();
+	Sound::Mixer::Voice &voice = mixer.voices[0];
+	voice.loop = loop;
+	if (stream) {
+		voice.stream = stream;
+		voice.epoch = stream->restart(position, loop);
+		begin_stream(voice);
+	} else {
+		voice.data = data->data();
+		voice.size = data->size();
+		voice.i = position % data->size();
+	}
+	mixer.start(0);
+}
+
+//mix up to 'blocks' blocks (stopping early if the voice finishes) into *out:
+static void render(Sound::Mixer &mixer, uint32_t blocks, std::vector< float > *out) {
+	out->clear();
+	std::vector< float > block(Sound::Mixer::BlockSamples * 2);
+	for (uint32_t b = 0; b < blocks && mixer.active_voice_count; ++b) {
+		if (mixer.voices[0].stream) wait_for_stream(mixer.voices[0]);
+		mixer.mix(block.data());
+		out->insert(out->end(), block.begin(), block.end());
+	}
+}
+
+static float max_difference(std::vector< float > const &a, std::vector< float > const &b) {
+	if (a.size() != b.size()) return INFINITY;
+	float diff = 0.0f;
+	for (size_t i = 0; i < a.size(); ++i) {
+		diff = std::max(diff, std::abs(a[i] - b[i]));
+	}
+	return diff;
+}
+
+int main(int argc, char **argv) {
+	if (argc != 2) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <file.opus>" << std::endl;
+		return 1;
+	}
+	std::string filename = argv[1];
+
+	//--- startup ---
+	auto before = std::chrono::high_resolution_clock::now();
+	std::vector< float > decoded;
+	load_opus(filename, &decoded);
+	double decode_seconds = seconds_since(before);
+	if (decoded.empty()) {
+		std::cerr << "ERROR: '" << filename << "' has no audio." << std::endl;
+		return 1;
+	}
+
+	before = std::chrono::high_resolution_clock::now();
+	Sound::SampleStream stream(filename);
+	double open_seconds = seconds_since(before);
+
+	Sound::Mixer::Voice first;
+	first.stream = &stream;
+	first.epoch = stream.restart(0, false);
+	begin_stream(first);
+	wait_for_stream(first);
+	double first_block_seconds = seconds_since(before);
+
+	double length_seconds = double(decoded.size()) / Sound::Mixer::Rate;
+	std::cout << "opus-stream: '" << filename << "', " << std::fixed << std::setprecision(1) << length_seconds << " seconds." << std::endl;
+	std::cout << std::setw(10) << "" << std::setw(14) << "startup ms" << std::setw(16) << "memory MB" << std::endl;
+	std::cout << std::setw(10) << "decoded" << std::setw(14) << std::setprecision(2) << decode_seconds * 1000.0
+		<< std::setw(16) << decoded.size() * sizeof(float) / (1024.0 * 1024.0) << std::endl;
+	std::cout << std::setw(10) << "streamed" << std::setw(14) << first_block_seconds * 1000.0
+		<< std::setw(16) << (Sound::SampleStream::RingSize * sizeof(float) + stream.compressed_size) / (1024.0 * 1024.0)
+		<< "  (open " << open_seconds * 1000.0 << "ms; ring " << Sound::SampleStream::RingSize * sizeof(float) / 1024 << "kB + "
+		<< stream.compressed_size / 1024 << "kB compressed, mapped)" << std::endl;
+
+	//--- playback through the mixer ---
+	static Sound::Mixer decoded_mixer, streamed_mixer; //(static: a Mixer is big)
+	std::vector< float > decoded_out, streamed_out;
+	uint32_t track_blocks = uint32_t(decoded.size() / Sound::Mixer::BlockSamples) + 2;
+	bool ok = true;
+
+	//played once (and timed, to see how fast the decoder thread keeps up):
+	start(decoded_mixer, &decoded, nullptr, 0, false);
+	render(decoded_mixer, track_blocks, &decoded_out);
+	start(streamed_mixer, nullptr, &stream, 0, false);
+	before = std::chrono::high_resolution_clock::now();
+	render(streamed_mixer, track_blocks, &streamed_out);
+	double stream_seconds = seconds_since(before);
+	float once_diff = max_difference(decoded_out, streamed_out);
+	std::cout << "once:  max difference " << std::scientific << std::setprecision(1) << once_diff
+		<< std::fixed << "; streamed " << std::setprecision(0) << length_seconds / stream_seconds << "x faster than real time" << std::endl;
+	ok = ok && (once_diff < 1e-5f);
+
+	//looped (past the end a couple of times):
+	uint32_t loop_blocks = track_blocks * 2 + 10;
+	start(decoded_mixer, &decoded, nullptr, 0, true);
+	render(decoded_mixer, loop_blocks, &decoded_out);
+	start(streamed_mixer, nullptr, &stream, 0, true);
+	render(streamed_mixer, loop_blocks, &streamed_out);
+	float loop_diff = max_difference(decoded_out, streamed_out);
+	std::cout << "loop:  max difference " << std::scientific << std::setprecision(1) << loop_diff << std::fixed << std::endl;
+	ok = ok && (loop_diff < 1e-5f);
+
+	//seeked to the middle:
+	// (opus decoders need some pre-roll after a seek, so the start may differ very slightly)
+	uint64_t middle = decoded.size() / 2;
+	start(decoded_mixer, &decoded, nullptr, middle, false);
+	render(decoded_mixer, 100, &decoded_out);
+	start(streamed_mixer, nullptr, &stream, middle, false);
+	render(streamed_mixer, 100, &streamed_out);
+	float seek_diff = max_difference(decoded_out, streamed_out);
+	std::cout << "seek:  max difference " << std::scientific << std::setprecision(1) << seek_diff << std::fixed << std::endl;
+	ok = ok && (seek_diff < 1e-2f);
+
+	if (!ok) {
+		std::cerr << "ERROR: streamed playback doesn't match decoded playback." << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,202 @@
+//Benchmark for PNG loading and saving (load_save_png.hpp):
+//
+// - decode speed reading through a std::istream (as load_png used to) vs.
+//   decoding the memory-mapped file, and of load_pngs on one vs. several threads;
+// - encode speed and file size for several compression levels and row filters
+//   (including the old default and PNGSaveFast).
+//
+//Speeds are in MB/s of (RGBA8) pixels. Uses generated, screenshot-like test
+// images (written to the working directory and removed afterward) unless given
+// '.png' files.
+//
+//Usage:
+//	bench/png [file.png ...]
+
+#include "load_save_png.hpp"
+
+#include <png.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+static double seconds_since(std::chrono::high_resolution_clock::time_point before) {
+	return std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - before).count();
+}
+
+//--- the old way: libpng pulling from an ifstream ---
+static void read_from_stream(png_structp png, png_bytep data, png_size_t length) {
+	std::istream *from = reinterpret_cast< std::istream * >(png_get_io_ptr(png));
+	if (!from->read(reinterpret_cast< char * >(data), length)) {
+		png_error(png, "Error reading.");
+	}
+}
+
+static void stream_load_png(std::string const &filename, glm::uvec2 *size, std::vector< glm::u8vec4 > *data) {
+	std::ifstream file(filename, std::ios::binary);
+	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop info = png_create_info_struct(png);
+	std::vector< png_bytep > rows;
+	if (setjmp(png_jmpbuf(png))) {
+		png_destroy_read_struct(&png, &info, NULL);
+		throw std::runtime_error("Failed to read '" + filename + "'.");
+	}
+	png_set_read_fn(png, &file, read_from_stream);
+	png_read_info(png, info);
+	png_set_expand(png);
+	png_set_gray_to_rgb(png);
+	png_set_strip_16(png);
+	png_set_add_alpha(png, 0xff, PNG_FILLER_AFTER);
+	png_read_update_info(png, info);
+	*size = glm::uvec2(png_get_image_width(png, info), png_get_image_height(png, info));
+	data->resize(size_t(size->x) * size->y);
+	rows.resize(size->y);
+	for (uint32_t r = 0; r < size->y; ++r) rows[size->y - 1 - r] = (png_bytep)&(*data)[size_t(r) * size->x];
+	png_read_image(png, rows.data());
+	png_read_end(png, NULL);
+	png_destroy_read_struct(&png, &info, NULL);
+}
+
+//something like a screenshot: smooth gradients, flat-shaded shapes, and a little noise:
+static std::vector< glm::u8vec4 > test_image(glm::uvec2 size, uint32_t seed) {
+	std::mt19937 mt(seed);
+	std::vector< glm::u8vec4 > image(size_t(size.x) * size.y);
+	for (uint32_t y = 0; y < size.y; ++y) {
+		for (uint32_t x = 0; x < size.x; ++x) {
+			image[size_t(y) * size.x + x] = glm::u8vec4(x * 255 / size.x, y * 255 / size.y, (x + y + seed * 37) & 0xff, 0xff);
+		}
+	}
+	for (uint32_t b = 0; b < 40; ++b) {
+		glm::uvec2 min(mt() % size.x, mt() % size.y);
+		glm::uvec2 max = glm::min(size, min + glm::uvec2(mt() % (size.x / 4) + 8, mt() % (size.y / 4) + 8));
+		glm::u8vec4 color(mt() & 0xff, mt() & 0xff, mt() & 0xff, 0xff);
+		for (uint32_t y = min.y; y < max.y; ++y) {
+			for (uint32_t x = min.x; x < max.x; ++x) image[size_t(y) * size.x + x] = color;
+		}
+	}
+	for (glm::u8vec4 &px : image) {
+		if ((mt() & 7) == 0) px.r ^= 1; //(dithering-like noise in the low bits)
+	}
+	return image;
+}
+
+int main(int argc, char **argv) {
+	std::vector< std::string > files(argv + 1, argv + argc);
+	bool generated = files.empty();
+	if (generated) {
+		glm::uvec2 const Sizes[] = { glm::uvec2(1920, 1080), glm::uvec2(2048, 2048), glm::uvec2(2560, 1440), glm::uvec2(1024, 1024) };
+		for (uint32_t i = 0; i < 8; ++i) {
+			glm::uvec2 size = Sizes[i % 4];
+			std::vector< glm::u8vec4 > image = test_image(size, i);
+			files.emplace_back("bench-png-" + std::to_string(i) + ".png");
+			save_png(files.back(), size, image.data(), LowerLeftOrigin);
+		}
+	}
+
+	uint32_t cores = std::thread::hardware_concurrency();
+	uint32_t threads = (cores > 2 ? cores - 1 : 1);
+	std::string on_threads = std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+
+	//--- decoding ---
+	std::vector< PNGImage > streamed(files.size());
+	double pixel_mb = 0.0;
+	try {
+		for (size_t i = 0; i < files.size(); ++i) {
+			stream_load_png(files[i], &streamed[i].size, &streamed[i].data); //(warm the file cache)
+			pixel_mb += double(streamed[i].data.size() * sizeof(glm::u8vec4)) * 1.0e-6;
+		}
+	} catch (std::exception &e) {
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+	std::cout << "png: " << files.size() << (generated ? " generated" : "") << " images, " << std::fixed << std::setprecision(1)
+		<< pixel_mb << " MB of pixels; " << on_threads << "." << std::endl;
+
+	uint32_t const Passes = 3;
+	auto row = [&](std::string const &name, double seconds) {
+		std::cout << std::setw(32) << name << std::setw(10) << std::setprecision(1) << Passes * pixel_mb / seconds << " MB/s" << std::endl;
+	};
+
+	std::cout << "\ndecode:" << std::endl;
+	auto before = std::chrono::high_resolution_clock::now();
+	for (uint32_t pass = 0; pass < Passes; ++pass) {
+		for (size_t i = 0; i < files.size(); ++i) stream_load_png(files[i], &streamed[i].size, &streamed[i].data);
+	}
+	row("istream, 1 thread", seconds_since(before));
+
+	std::vector< PNGImage > mapped(files.size());
+	before = std::chrono::high_resolution_clock::now();
+	for (uint32_t pass = 0; pass < Passes; ++pass) {
+		for (size_t i = 0; i < files.size(); ++i) load_png(files[i], &mapped[i].size, &mapped[i].data, LowerLeftOrigin);
+	}
+	row("mapped, 1 thread", seconds_since(before));
+
+	std::vector< PNGImage > batch;
+	before = std::chrono::high_resolution_clock::now();
+	for (uint32_t pass = 0; pass < Passes; ++pass) load_pngs(files, LowerLeftOrigin, &batch, threads);
+	row("load_pngs, " + on_threads, seconds_since(before));
+
+	for (size_t i = 0; i < files.size(); ++i) {
+		if (mapped[i].size != streamed[i].size || mapped[i].data != streamed[i].data
+		 || batch[i].size != streamed[i].size || batch[i].data != streamed[i].data) {
+			std::cerr << "ERROR: '" << files[i] << "' decoded differently." << std::endl;
+			return 1;
+		}
+	}
+
+	//--- encoding ---
+	struct Setting {
+		std::string name;
+		PNGSaveOptions options;
+	};
+	std::vector< Setting > settings{
+		{ "level 6, adaptive (default)", PNGSaveOptions() },
+		{ "level 9, adaptive", PNGSaveOptions{ 9, PNGFilterAdaptive } },
+		{ "level 3, sub", PNGSaveOptions{ 3, PNGFilterSub } },
+		{ "level 1, adaptive", PNGSaveOptions{ 1, PNGFilterAdaptive } },
+		{ "level 1, none", PNGSaveOptions{ 1, PNGFilterNone } },
+		{ "level 1, sub (PNGSaveFast)", PNGSaveFast },
+		{ "level 1, up", PNGSaveOptions{ 1, PNGFilterUp } },
+		{ "level 1, paeth", PNGSaveOptions{ 1, PNGFilterPaeth } },
+		{ "level 0, none", PNGSaveOptions{ 0, PNGFilterNone } },
+	};
+	std::cout << "\nencode (1 thread):" << std::setw(37) << "size" << std::endl;
+	std::vector< char > png;
+	for (Setting const &setting : settings) {
+		size_t bytes = 0;
+		before = std::chrono::high_resolution_clock::now();
+		for (uint32_t pass = 0; pass < Passes; ++pass) {
+			bytes = 0;
+			for (PNGImage const &image : mapped) {
+				encode_png(image.size, image.data.data(), LowerLeftOrigin, setting.options, &png);
+				bytes += png.size();
+			}
+		}
+		double seconds = seconds_since(before);
+		std::cout << std::setw(32) << setting.name << std::setw(10) << std::setprecision(1) << Passes * pixel_mb / seconds << " MB/s"
+			<< std::setw(10) << std::setprecision(2) << bytes * 1.0e-6 << " MB" << std::endl;
+	}
+
+	//the encoded images should decode to the originals:
+	for (PNGImage const &image : mapped) {
+		PNGImage round_trip;
+		encode_png(image.size, image.data.data(), LowerLeftOrigin, PNGSaveFast, &png);
+		decode_png(png.data(), png.data() + png.size(), &round_trip.size, &round_trip.data, LowerLeftOrigin);
+		if (round_trip.size != image.size || round_trip.data != image.data) {
+			std::cerr << "ERROR: image didn't survive encoding and decoding." << std::endl;
+			return 1;
+		}
+	}
+
+	if (generated) {
+		for (auto const &file : files) std::remove(file.c_str());
+	}
+	return 0;
+}
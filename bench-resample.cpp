@@ -0,0 +1,195 @@
+//Benchmark for the polyphase resampler (SoundResampler.hpp):
+//
+// - load-time conversion (44.1kHz -> 48kHz) of test tones with Sound::resample,
+//   linear interpolation, and SDL's converter (which load_wav used before);
+// - playback at other rates through Sound::Mixer vs. stepping through the
+//   data with nearest-sample or linear interpolation;
+// - mixing cost per voice for resampled voices vs. voices at their own rate.
+//
+//Quality is reported as signal-to-noise ratio against the ideal output (higher is better).
+//
+//Usage:
+//	bench/resample [seconds]
+
+#include "SoundMixer.hpp"
+#include "SoundResampler.hpp"
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static double const Pi = 3.14159265358979323846;
+
+//signal-to-noise ratio of 'out' vs. 'ideal' over [begin, end), in dB:
+static double snr(std::vector< float > const &out, std::vector< double > const &ideal, size_t begin, size_t end) {
+	double signal = 0.0, noise = 0.0;
+	for (size_t i = begin; i < end && i < out.size() && i < ideal.size(); ++i) {
+		signal += ideal[i] * ideal[i];
+		noise += (out[i] - ideal[i]) * (out[i] - ideal[i]);
+	}
+	return (noise > 0.0 ? 10.0 * std::log10(signal / noise) : INFINITY);
+}
+
+static double seconds_since(std::chrono::high_resolution_clock::time_point before) {
+	return std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - before).count();
+}
+
+//linear interpolation between the two nearest input samples (silence past the ends):
+static float linear_at(std::vector< float > const &data, double position) {
+	size_t i = size_t(position);
+	float t = float(position - double(i));
+	float a = (i < data.size() ? data[i] : 0.0f);
+	float b = (i + 1 < data.size() ? data[i + 1] : 0.0f);
+	return a + t * (b - a);
+}
+
+static void convert_sdl(std::vector< float > const &in, uint32_t in_rate, uint32_t out_rate, std::vector< float > *out) {
+	SDL_AudioCVT cvt;
+	SDL_BuildAudioCVT(&cvt, AUDIO_F32SYS, 1, int(in_rate), AUDIO_F32SYS, 1, int(out_rate));
+	std::vector< Uint8 > buffer(in.size() * sizeof(float) * cvt.len_mult);
+	std::copy(reinterpret_cast< Uint8 const * >(in.data()), reinterpret_cast< Uint8 const * >(in.data() + in.size()), buffer.begin());
+	cvt.len = int(in.size() * sizeof(float));
+	cvt.buf = buffer.data();
+	SDL_ConvertAudio(&cvt);
+	out->assign(reinterpret_cast< float * >(buffer.data()), reinterpret_cast< float * >(buffer.data() + cvt.len_cvt));
+}
+
+int main(int argc, char **argv) {
+	float seconds = 5.0f;
+	if (argc == 2) {
+		seconds = std::max(0.1f, std::stof(argv[1]));
+	} else if (argc != 1) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [seconds]" << std::endl;
+		return 1;
+	}
+
+	//--- load-time conversion ---
+	{
+		uint32_t const InRate = 44100, OutRate = Sound::Mixer::Rate;
+		std::cout << "load: " << InRate << "Hz -> " << OutRate << "Hz test tones; SNR in dB (and conversion time in ms per second of audio)." << std::endl;
+		std::cout << std::setw(10) << "tone Hz" << std::setw(16) << "resample" << std::setw(16) << "linear" << std::setw(16) << "SDL" << std::endl;
+		for (float hz : {100.0f, 1000.0f, 5000.0f, 10000.0f, 15000.0f, 19000.0f}) {
+			std::vector< float > in(InRate);
+			for (size_t i = 0; i < in.size(); ++i) in[i] = float(std::sin(2.0 * Pi * hz * double(i) / InRate));
+			std::vector< double > ideal(OutRate);
+			for (size_t i = 0; i < ideal.size(); ++i) ideal[i] = std::sin(2.0 * Pi * hz * double(i) / OutRate);
+
+			std::vector< float > out;
+			std::cout << std::setw(10) << hz << std::fixed << std::setprecision(1);
+			auto report = [&](double ms) {
+				//(skipping the ends, where every method fades in from / out to silence)
+				std::cout << std::setw(8) << snr(out, ideal, 64, OutRate - 64) << " (" << std::setw(5) << ms << ")";
+			};
+
+			auto before = std::chrono::high_resolution_clock::now();
+			Sound::resample(in, InRate, OutRate, &out);
+			report(seconds_since(before) * 1000.0);
+
+			before = std::chrono::high_resolution_clock::now();
+			out.resize(OutRate);
+			for (size_t i = 0; i < out.size(); ++i) out[i] = linear_at(in, double(i) * InRate / OutRate);
+			report(seconds_since(before) * 1000.0);
+
+			before = std::chrono::high_resolution_clock::now();
+			convert_sdl(in, InRate, OutRate, &out);
+			report(seconds_since(before) * 1000.0);
+
+			std::cout << std::endl;
+		}
+	}
+
+	//--- playback at other rates ---
+	static Sound::Mixer mixer; //(static: a Mixer is big)
+	{
+		std::cout << "\nplayback: looping test tones at different rates; SNR in dB." << std::endl;
+		std::cout << std::setw(10) << "tone Hz" << std::setw(8) << "rate" << std::setw(12) << "mixer" << std::setw(12) << "nearest" << std::setw(12) << "linear" << std::endl;
+		uint32_t const Blocks = 20;
+		uint32_t const Frames = Blocks * Sound::Mixer::BlockSamples;
+		for (float hz : {1000.0f, 8000.0f}) {
+			//one second of the tone loops seamlessly:
+			std::vector< float > tone(Sound::Mixer::Rate);
+			for (size_t i = 0; i < tone.size(); ++i) tone[i] = float(std::sin(2.0 * Pi * hz * double(i) / Sound::Mixer::Rate));
+
+			for (float rate : {0.5f, 0.9f, 1.5f, 2.5f, 3.5f}) {
+				std::cout << std::setw(10) << hz << std::setw(8) << std::setprecision(2) << rate << std::setprecision(1);
+				//(the mixer's filters roll off above about 17kHz -- on purpose, so higher rates don't alias)
+				if (hz * rate >= 0.35f * Sound::Mixer::Rate) {
+					std::cout << std::setw(12) << "(filtered)" << std::endl;
+					continue;
+				}
+				//(same fixed-point step as the mixer, so the ideal output lines up exactly)
+				uint64_t step = uint64_t(double(rate) * 4294967296.0);
+				std::vector< double > ideal(Frames);
+				for (size_t k = 0; k < Frames; ++k) ideal[k] = std::sin(2.0 * Pi * hz * (double(k * step) / 4294967296.0) / Sound::Mixer::Rate);
+
+				mixer = Sound::Mixer();
+				Sound::Mixer::Voice &voice = mixer.voices[0];
+				voice.data = tone.data();
+				voice.size = tone.size();
+				voice.loop = true;
+				voice.rate = Sound::Ramp< float >(rate);
+				mixer.start(0);
+				std::vector< float > stereo(Frames * 2), out(Frames);
+				for (uint32_t b = 0; b < Blocks; ++b) {
+					mixer.mix(stereo.data() + b * Sound::Mixer::BlockSamples * 2);
+				}
+				float gain = std::cos(0.5f * 3.1415926f * 0.5f); //(centered "2D" voice)
+				for (size_t k = 0; k < Frames; ++k) out[k] = stereo[2*k] / gain;
+				std::cout << std::setw(12) << snr(out, ideal, 0, Frames);
+
+				for (size_t k = 0; k < Frames; ++k) out[k] = tone[size_t((k * step) >> 32) % tone.size()];
+				std::cout << std::setw(12) << snr(out, ideal, 0, Frames);
+
+				for (size_t k = 0; k < Frames; ++k) out[k] = linear_at(tone, std::fmod(double(k * step) / 4294967296.0, double(tone.size())));
+				std::cout << std::setw(12) << snr(out, ideal, 0, Frames - 1) << std::endl;
+			}
+		}
+	}
+
+	//--- cost ---
+	{
+		uint32_t const Voices = 64;
+		uint32_t blocks = uint32_t(std::ceil(seconds * Sound::Mixer::Rate / Sound::Mixer::BlockSamples));
+		double audio_seconds = double(blocks) * Sound::Mixer::BlockSamples / Sound::Mixer::Rate;
+		std::cout << "\ncost: " << Voices << " looping voices, " << audio_seconds << " seconds of audio per row." << std::endl;
+		std::cout << std::setw(8) << "rate" << std::setw(16) << "us/voice/block" << std::setw(16) << "voices/core" << std::endl;
+
+		std::vector< float > noise(48017);
+		std::mt19937 mt(0x5a3);
+		for (float &f : noise) f = mt() / float(mt.max()) * 2.0f - 1.0f;
+		std::vector< float > block(Sound::Mixer::BlockSamples * 2);
+
+		for (float rate : {1.0f, 0.5f, 0.9f, 1.5f, 2.5f, 3.5f}) {
+			mixer = Sound::Mixer();
+			mixer.real_voice_limit = Voices;
+			for (uint32_t v = 0; v < Voices; ++v) {
+				Sound::Mixer::Voice &voice = mixer.voices[v];
+				voice.data = noise.data();
+				voice.size = noise.size();
+				voice.i = mt() % noise.size();
+				voice.loop = true;
+				voice.volume = Sound::Ramp< float >(1.0f / Voices);
+				voice.rate = Sound::Ramp< float >(rate);
+				mixer.start(v);
+			}
+			auto before = std::chrono::high_resolution_clock::now();
+			for (uint32_t b = 0; b < blocks; ++b) {
+				mixer.mix(block.data());
+			}
+			double elapsed = seconds_since(before);
+			std::cout << std::setw(8) << std::setprecision(2) << rate << (rate == 1.0f ? "*" : " ")
+				<< std::setw(15) << std::setprecision(2) << elapsed * 1.0e6 / (double(blocks) * Voices)
+				<< std::setw(16) << std::setprecision(0) << Voices * audio_seconds / elapsed << std::endl;
+		}
+		std::cout << "(* = not resampled)" << std::endl;
+	}
+
+	return 0;
+}
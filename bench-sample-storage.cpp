@@ -0,0 +1,164 @@
+//Benchmark for compressed sample storage (Sound::Sample::Storage, SoundCodec.hpp):
+//
+// - memory per minute of audio for each storage format;
+// - quality (signal-to-noise ratio vs. the float data, higher is better);
+// - decoding speed, in the block-sized pieces the mixer decodes;
+// - mixing cost per voice (looping voices at their own rate and resampled)
+//   vs. voices playing float data.
+//
+//Uses a synthetic test signal (a few seconds of decaying harmonic notes over
+// quiet noise) unless given '.wav'/'.opus' files, which are concatenated.
+//
+//Usage:
+//	bench/sample-storage [file.wav|file.opus ...]
+
+#include "SoundMixer.hpp"
+#include "SoundCodec.hpp"
+#include "load_opus.hpp"
+#include "load_wav.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static double seconds_since(std::chrono::high_resolution_clock::time_point before) {
+	return std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - before).count();
+}
+
+//ten seconds of plucked-sounding notes (harmonics with exponential decay) over quiet noise:
+static std::vector< float > test_signal() {
+	double const Pi = 3.14159265358979323846;
+	std::vector< float > data(10 * Sound::Mixer::Rate, 0.0f);
+	std::mt19937 mt(0x5a4);
+	for (float &f : data) f = 0.002f * (mt() / float(mt.max()) * 2.0f - 1.0f);
+	float const notes[] = { 220.0f, 277.2f, 329.6f, 440.0f, 164.8f, 392.0f, 523.3f, 246.9f };
+	for (uint32_t n = 0; n < 20; ++n) {
+		size_t start = size_t(n) * data.size() / 20;
+		float hz = notes[n % 8];
+		for (size_t i = start; i < data.size(); ++i) {
+			double t = double(i - start) / Sound::Mixer::Rate;
+			double envelope = 0.2 * std::exp(-3.0 * t);
+			if (envelope < 1e-5) break;
+			double value = 0.0;
+			for (uint32_t h = 1; h <= 6; ++h) {
+				value += std::sin(2.0 * Pi * hz * h * t) / h;
+			}
+			data[i] += float(envelope * value);
+		}
+	}
+	return data;
+}
+
+int main(int argc, char **argv) {
+	std::vector< float > data;
+	for (int a = 1; a < argc; ++a) {
+		std::string file = argv[a];
+		std::vector< float > more;
+		if (file.size() >= 4 && file.substr(file.size()-4) == ".wav") {
+			load_wav(file, &more);
+		} else if (file.size() >= 5 && file.substr(file.size()-5) == ".opus") {
+			load_opus(file, &more);
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [file.wav|file.opus ...]" << std::endl;
+			return 1;
+		}
+		data.insert(data.end(), more.begin(), more.end());
+	}
+	if (argc == 1) data = test_signal();
+	if (data.size() < 4 * Sound::Mixer::BlockSamples) {
+		std::cerr << "ERROR: need at least " << 4 * Sound::Mixer::BlockSamples << " samples of audio." << std::endl;
+		return 1;
+	}
+	std::cout << "sample-storage: " << std::fixed << std::setprecision(1) << double(data.size()) / Sound::Mixer::Rate << " seconds of "
+		<< (argc == 1 ? "test signal" : "audio") << "." << std::endl;
+
+	Sound::Sample::Storage const Storages[] = { Sound::Sample::Float, Sound::Sample::PCM16, Sound::Sample::MuLaw, Sound::Sample::ADPCM };
+
+	//--- size, quality, decoding speed ---
+	std::cout << "\n" << std::setw(10) << "storage" << std::setw(12) << "MB/minute" << std::setw(10) << "ratio" << std::setw(10) << "SNR dB"
+		<< std::setw(16) << "decode Ms/s" << std::endl;
+	for (auto storage : Storages) {
+		std::vector< uint8_t > encoded;
+		Sound::encode_samples(storage, data.data(), data.size(), &encoded);
+
+		std::vector< float > decoded(data.size());
+		Sound::decode_samples(storage, encoded.data(), 0, data.size(), decoded.data());
+		double signal = 0.0, noise = 0.0;
+		for (size_t i = 0; i < data.size(); ++i) {
+			signal += double(data[i]) * data[i];
+			noise += double(decoded[i] - data[i]) * (decoded[i] - data[i]);
+		}
+
+		//decode a block at a time from unaligned starts, as the mixer does:
+		uint32_t const Passes = 20;
+		auto before = std::chrono::high_resolution_clock::now();
+		for (uint32_t pass = 0; pass < Passes; ++pass) {
+			for (size_t begin = pass * 7; begin + Sound::Mixer::BlockSamples <= data.size(); begin += Sound::Mixer::BlockSamples) {
+				Sound::decode_samples(storage, encoded.data(), begin, Sound::Mixer::BlockSamples, decoded.data() + begin);
+			}
+		}
+		double elapsed = seconds_since(before);
+
+		double per_minute = double(Sound::encoded_bytes(storage, 60 * Sound::Mixer::Rate)) * 1.0e-6;
+		std::cout << std::setw(10) << Sound::storage_name(storage)
+			<< std::setw(12) << std::setprecision(2) << per_minute
+			<< std::setw(9) << std::setprecision(1) << double(data.size() * sizeof(float)) / double(encoded.size()) << "x"
+			<< std::setw(10) << (noise > 0.0 ? 10.0 * std::log10(signal / noise) : INFINITY)
+			<< std::setw(16) << std::setprecision(0) << Passes * double(data.size()) / elapsed * 1.0e-6 << std::endl;
+	}
+
+	//--- mixing cost ---
+	static Sound::Mixer mixer; //(static: a Mixer is big)
+	uint32_t const Voices = 64;
+	uint32_t const Blocks = 500;
+	std::cout << "\nmixing: " << Voices << " looping voices, " << Blocks << " blocks; us per voice per block (and overhead vs. float)." << std::endl;
+	std::cout << std::setw(10) << "storage";
+	for (float rate : {1.0f, 1.5f}) std::cout << std::setw(20) << ("rate " + std::to_string(rate).substr(0, 3));
+	std::cout << std::endl;
+
+	std::vector< float > block(Sound::Mixer::BlockSamples * 2);
+	double float_us[2] = { 0.0, 0.0 };
+	for (auto storage : Storages) {
+		std::vector< uint8_t > encoded;
+		Sound::encode_samples(storage, data.data(), data.size(), &encoded);
+		std::cout << std::setw(10) << Sound::storage_name(storage);
+		uint32_t column = 0;
+		for (float rate : {1.0f, 1.5f}) {
+			mixer = Sound::Mixer();
+			mixer.real_voice_limit = Voices;
+			std::mt19937 mt(0x5a5);
+			for (uint32_t v = 0; v < Voices; ++v) {
+				Sound::Mixer::Voice &voice = mixer.voices[v];
+				if (storage == Sound::Sample::Float) {
+					voice.data = data.data();
+				} else {
+					voice.encoded = encoded.data();
+					voice.storage = storage;
+				}
+				voice.size = data.size();
+				voice.i = mt() % data.size();
+				voice.loop = true;
+				voice.volume = Sound::Ramp< float >(1.0f / Voices);
+				voice.rate = Sound::Ramp< float >(rate);
+				mixer.start(v);
+			}
+			auto before = std::chrono::high_resolution_clock::now();
+			for (uint32_t b = 0; b < Blocks; ++b) {
+				mixer.mix(block.data());
+			}
+			double us = seconds_since(before) * 1.0e6 / (double(Blocks) * Voices);
+			if (storage == Sound::Sample::Float) float_us[column] = us;
+			std::cout << std::setw(10) << std::setprecision(2) << us << " (" << std::showpos << std::setw(6) << us - float_us[column] << ")" << std::noshowpos;
+			++column;
+		}
+		std::cout << std::endl;
+	}
+	std::cout << "(one block is " << std::setprecision(0) << 1.0e6 * Sound::Mixer::BlockSamples / Sound::Mixer::Rate << "us of audio)" << std::endl;
+
+	return 0;
+}
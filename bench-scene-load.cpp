@@ -0,0 +1,136 @@
+//Headless benchmark for scene instantiation -- loads a scene as exported and as cooked
+// by 'cook-scene' (making drawables from a MeshBuffer, as the game does), copies it,
+// and compares name lookups through Scene::find / find_prefix with linear scans.
+//
+//Usage:
+//	bench/scene-load <meshes.pnct> <exported.scene> <cooked.scene> [iterations]
+//
+//(only file reading and CPU work are timed; no window is opened and nothing is uploaded)
+
+#include "Scene.hpp"
+#include "Mesh.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//time 'iterations' calls of 'fn'; returns milliseconds per call:
+template< typename F >
+static double time_ms(uint32_t iterations, F const &fn) {
+	auto before = std::chrono::high_resolution_clock::now();
+	for (uint32_t iter = 0; iter < iterations; ++iter) {
+		fn();
+	}
+	auto after = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration< double >(after - before).count() * 1000.0 / iterations;
+}
+
+int main(int argc, char **argv) {
+	if (argc != 4 && argc != 5) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <meshes.pnct> <exported.scene> <cooked.scene> [iterations]" << std::endl;
+		return 1;
+	}
+	std::string mesh_file = argv[1];
+	std::vector< std::string > scene_files{ argv[2], argv[3] };
+	uint32_t iterations = 200;
+	if (argc == 5) iterations = uint32_t(std::max(1, std::stoi(argv[4])));
+
+	MeshBuffer meshes(mesh_file, MeshBuffer::UploadLater);
+
+	//make drawables like PlayMode does (minus the OpenGL objects):
+	auto on_mesh = [](Scene &scene, Scene::Transform *transform, Mesh const &mesh) {
+		scene.drawables.emplace_back(transform);
+		Scene::Drawable::Pipeline &pipeline = scene.drawables.back().pipeline;
+		pipeline.type = mesh.type;
+		pipeline.start = mesh.start;
+		pipeline.count = mesh.count;
+		pipeline.index_type = mesh.index_type;
+		pipeline.base_vertex = mesh.base_vertex;
+		pipeline.position_scale = mesh.position_scale;
+		pipeline.position_offset = mesh.position_offset;
+	};
+
+	std::cout << "scene-load: " << iterations << " iterations per column." << std::endl;
+	std::cout << std::left << std::setw(12) << "scene" << std::right
+		<< std::setw(12) << "load ms"
+		<< std::setw(12) << "copy ms"
+		<< std::setw(16) << "find ns (scan)"
+		<< std::setw(16) << "find ns (index)"
+		<< std::setw(18) << "prefix ns (scan)"
+		<< std::setw(18) << "prefix ns (index)" << std::endl;
+
+	for (uint32_t s = 0; s < scene_files.size(); ++s) {
+		double load_ms = time_ms(iterations, [&]() {
+			Scene scene(scene_files[s], meshes, on_mesh);
+		});
+
+		Scene loaded(scene_files[s], meshes, on_mesh);
+		double copy_ms = time_ms(iterations, [&]() {
+			Scene copy = loaded;
+		});
+
+		//queries: every distinct name, and every name up to its first '.' (e.g. "vine_purp" for "vine_purp.001"):
+		std::vector< std::string > queries, prefixes;
+		for (auto const &t : loaded.transforms) {
+			queries.emplace_back(t.name);
+			prefixes.emplace_back(t.name.substr(0, t.name.find('.')));
+		}
+		for (auto *list : {&queries, &prefixes}) {
+			std::sort(list->begin(), list->end());
+			list->erase(std::unique(list->begin(), list->end()), list->end());
+		}
+
+		//(the counts keep the compiler from skipping the lookups, and check that both ways agree)
+		size_t scan_found = 0, index_found = 0;
+		double find_scan_ms = time_ms(iterations, [&]() {
+			for (auto const &query : queries) {
+				for (auto &t : loaded.transforms) {
+					if (t.name == query) { scan_found += 1; break; }
+				}
+			}
+		});
+		double find_index_ms = time_ms(iterations, [&]() {
+			for (auto const &query : queries) {
+				if (loaded.find(query)) index_found += 1;
+			}
+		});
+
+		size_t scan_matches = 0, index_matches = 0;
+		double prefix_scan_ms = time_ms(iterations, [&]() {
+			for (auto const &prefix : prefixes) {
+				std::vector< Scene::Transform * > found;
+				for (auto &t : loaded.transforms) {
+					if (t.name.substr(0, prefix.size()) == prefix) found.emplace_back(&t);
+				}
+				scan_matches += found.size();
+			}
+		});
+		double prefix_index_ms = time_ms(iterations, [&]() {
+			for (auto const &prefix : prefixes) {
+				index_matches += loaded.find_prefix(prefix).size();
+			}
+		});
+
+		if (scan_found != index_found || scan_matches != index_matches) {
+			std::cerr << "ERROR: index lookups (" << index_found << " found, " << index_matches << " prefix matches) don't match scans ("
+				<< scan_found << " found, " << scan_matches << " prefix matches)." << std::endl;
+			return 1;
+		}
+
+		auto per_query_ns = [](double ms, size_t count) { return count ? ms * 1.0e6 / count : 0.0; };
+		std::cout << std::left << std::setw(12) << (s == 0 ? "exported" : "cooked") << std::right
+			<< std::setw(12) << std::fixed << std::setprecision(4) << load_ms
+			<< std::setw(12) << copy_ms
+			<< std::setw(16) << std::setprecision(1) << per_query_ns(find_scan_ms, queries.size())
+			<< std::setw(16) << per_query_ns(find_index_ms, queries.size())
+			<< std::setw(18) << per_query_ns(prefix_scan_ms, prefixes.size())
+			<< std::setw(18) << per_query_ns(prefix_index_ms, prefixes.size()) << std::endl;
+	}
+
+	std::cout << "(" << scene_files[0] << " vs " << scene_files[1] << "; " << meshes.meshes.size() << " meshes)" << std::endl;
+
+	return 0;
+}
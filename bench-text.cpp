@@ -0,0 +1,282 @@
+//Headless benchmark for PathFont text layout (as done by DrawLines::draw_text) -- text
+// throughput in glyphs per millisecond, for:
+//
+// - "std::map": greedy longest match with a substring copy and an ordered-map lookup
+//   per extended prefix (how draw_text used to find glyphs);
+// - "NameMap": the same longest match, with string_view keys into a hash map;
+// - "trie": PathFont::match over the generated glyph trie (PathFont::layout_uncached);
+// - "cached": PathFont::layout, for strings drawn again (as HUD text is every frame).
+//
+//The "layout" rows also write the line vertices (anchor + x * u + y * v), as draw_text does;
+// the "lookup" rows only find glyphs.
+//
+//Usage:
+//	bench/text [passes]
+
+#include "PathFont.hpp"
+#include "NameMap.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+//same layout as DrawLines::Vertex:
+struct Vertex {
+	Vertex(glm::vec3 const &Position_, glm::u8vec4 const &Color_) : Position(Position_), Color(Color_) { }
+	glm::vec3 Position;
+	glm::u8vec4 Color;
+};
+
+static glm::vec3 const Anchor(-1.4f, -0.9f, 0.0f), X(0.15f, 0.0f, 0.0f), Y(0.0f, 0.15f, 0.0f);
+static glm::u8vec4 const Color(0xa0, 0xff, 0xa0, 0xff);
+
+//draw_text's layout before the trie; lookup(text, start, end) finds the glyph for text[start,end) (or nullptr):
+template< typename Lookup >
+static void layout_greedy(std::string const &text, Lookup const &lookup, std::vector< Vertex > *out) {
+	PathFont const &font = PathFont::font;
+	glm::vec3 anchor = Anchor;
+	uint32_t start = 0;
+	while (start < text.size()) {
+		uint32_t end = start;
+		uint32_t glyph = -1U;
+		while (end < text.size()) {
+			end += 1;
+			uint32_t const *f = lookup(text, start, end);
+			if (!f) {
+				end -= 1;
+				break;
+			}
+			glyph = *f;
+		}
+		if (glyph == -1U) {
+			end += 1;
+			for (const auto &pt : {
+				glm::vec2(0.1f, 0.1f), glm::vec2(0.6f, 0.1f),
+				glm::vec2(0.6f, 0.1f), glm::vec2(0.6f, 0.9f),
+				glm::vec2(0.9f, 0.6f), glm::vec2(0.1f, 0.9f),
+				glm::vec2(0.1f, 0.9f), glm::vec2(0.1f, 0.1f)
+			}) {
+				out->emplace_back(anchor + pt.x * X + pt.y * Y, Color);
+			}
+			anchor += X * 0.6f;
+		} else {
+			for (uint32_t c = font.glyph_coord_starts[glyph]; c + 1 < font.glyph_coord_starts[glyph+1]; c += 2) {
+				out->emplace_back(anchor + X * font.coords[c] + Y * font.coords[c+1], Color);
+			}
+			anchor += X * font.glyph_widths[glyph];
+		}
+		start = end;
+	}
+}
+
+//just the glyph lookups of layout_greedy; returns the number of glyphs (and tofu) found:
+template< typename Lookup >
+static uint32_t lookup_greedy(std::string const &text, Lookup const &lookup) {
+	uint32_t found = 0;
+	uint32_t start = 0;
+	while (start < text.size()) {
+		uint32_t end = start;
+		while (end < text.size()) {
+			end += 1;
+			if (!lookup(text, start, end)) {
+				end -= 1;
+				break;
+			}
+		}
+		start = std::max(end, start + 1);
+		found += 1;
+	}
+	return found;
+}
+
+//write a laid-out string's vertices, as draw_text does:
+static void emit(glm::vec2 const *coords, uint32_t begin, uint32_t end, std::vector< Vertex > *out) {
+	for (uint32_t c = begin; c < end; ++c) {
+		out->emplace_back(Anchor + X * coords[c].x + Y * coords[c].y, Color);
+	}
+}
+
+int main(int argc, char **argv) {
+	uint32_t passes = 2000;
+	if (argc == 2) {
+		passes = uint32_t(std::max(1, std::stoi(argv[1])));
+	} else if (argc != 1) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [passes]" << std::endl;
+		return 1;
+	}
+
+	PathFont &font = PathFont::font;
+
+	//the glyph maps draw_text used to search:
+	std::map< std::string, uint32_t > std_map;
+	NameMap< uint32_t > name_map;
+	for (uint32_t i = 0; i < font.glyphs; ++i) {
+		std::string str(reinterpret_cast< const char * >(font.chars + font.glyph_char_starts[i]), font.glyph_char_starts[i+1] - font.glyph_char_starts[i]);
+		std_map.emplace(str, i);
+		name_map.insert(str, i);
+	}
+
+	//the trie should find the same glyphs:
+	for (uint32_t i = 0; i < font.glyphs; ++i) {
+		std::string_view str(reinterpret_cast< const char * >(font.chars + font.glyph_char_starts[i]), font.glyph_char_starts[i+1] - font.glyph_char_starts[i]);
+		uint32_t glyph = -1U;
+		if (font.match(str, &glyph) != str.size() || glyph != i) {
+			std::cerr << "ERROR: trie doesn't match glyph " << i << " ('" << str << "')." << std::endl;
+			return 1;
+		}
+	}
+
+	//text sets:
+	struct Corpus {
+		std::string name;
+		std::vector< std::string > strings;
+	};
+	std::vector< Corpus > corpora;
+	corpora.emplace_back(Corpus{ "hud", {
+		"You are the green player. Your move!",
+		"You are the purple player. Opponent's move.",
+		"Press R to restart",
+		"A", "D", "W", "S", "E", "Q",
+		"stream: 12.3 kB/frame",
+		"driver: 0.041 ms/frame",
+		"maps: 3.0/frame, orphans: 0.00/frame"
+	} });
+	{ //labels like the ones show-scene draws over transforms:
+		corpora.emplace_back(Corpus{ "labels", {} });
+		static char const *stems[] = {"Cube", "Plane", "vine_purp", "vine_green", "flower_purp", "Cylinder", "dot_grid", "Circle"};
+		for (uint32_t i = 0; i < 64; ++i) {
+			std::string number = std::to_string(i);
+			corpora.back().strings.emplace_back("'" + std::string(stems[i % 8]) + "." + std::string(3 - number.size(), '0') + number + "'");
+		}
+	}
+	{ //paragraphs of random printable text, with some bytes the font lacks (drawn as tofu):
+		corpora.emplace_back(Corpus{ "random", {} });
+		std::mt19937 mt(0x7e47);
+		for (uint32_t i = 0; i < 16; ++i) {
+			std::string str;
+			for (uint32_t c = 0; c < 200; ++c) {
+				str += (mt() % 50 == 0 ? char(0x80 + mt() % 0x80) : char(0x20 + mt() % 0x5f));
+			}
+			corpora.back().strings.emplace_back(str);
+		}
+	}
+
+	std::cout << "text: " << passes << " passes over each set (glyphs per ms; higher is better)." << std::endl;
+	std::cout << std::setw(8) << "set" << std::setw(9) << "glyphs" << std::setw(8) << ""
+		<< std::setw(12) << "std::map" << std::setw(12) << "NameMap" << std::setw(12) << "trie" << std::setw(12) << "cached" << std::endl;
+
+	std::vector< Vertex > out;
+	std::vector< glm::vec2 > coords;
+	for (Corpus const &corpus : corpora) {
+		uint64_t glyphs = 0;
+		for (auto const &str : corpus.strings) {
+			std::string_view view(str);
+			for (uint32_t start = 0; start < str.size(); ) {
+				uint32_t glyph;
+				uint32_t length = font.match(view.substr(start), &glyph);
+				start += std::max(1U, length);
+				glyphs += 1;
+			}
+		}
+
+		//each column: ms for all passes; vertex count checked against the first column:
+		size_t expected = 0;
+		auto time = [&](auto const &layout_all) {
+			auto before = std::chrono::high_resolution_clock::now();
+			size_t vertices = 0;
+			for (uint32_t pass = 0; pass < passes; ++pass) {
+				out.clear();
+				layout_all();
+				vertices += out.size();
+			}
+			double ms = std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - before).count();
+			if (expected == 0) expected = vertices;
+			if (vertices != expected) {
+				std::cerr << "ERROR: layouts of '" << corpus.name << "' differ in vertex count." << std::endl;
+				std::exit(1);
+			}
+			return double(glyphs) * passes / ms;
+		};
+
+		auto std_map_lookup = [&](std::string const &text, uint32_t start, uint32_t end) -> uint32_t const * {
+			auto f = std_map.find(text.substr(start, end-start));
+			return (f == std_map.end() ? nullptr : &f->second);
+		};
+		auto name_map_lookup = [&](std::string const &text, uint32_t start, uint32_t end) {
+			return name_map.find(std::string_view(text).substr(start, end-start));
+		};
+
+		double std_map_rate = time([&](){
+			for (auto const &str : corpus.strings) layout_greedy(str, std_map_lookup, &out);
+		});
+		double name_map_rate = time([&](){
+			for (auto const &str : corpus.strings) layout_greedy(str, name_map_lookup, &out);
+		});
+		double trie_rate = time([&](){
+			for (auto const &str : corpus.strings) {
+				coords.clear();
+				font.layout_uncached(str, &coords);
+				emit(coords.data(), 0, uint32_t(coords.size()), &out);
+			}
+		});
+		uint32_t misses_before = font.layout_misses;
+		double cached_rate = time([&](){
+			for (auto const &str : corpus.strings) {
+				PathFont::Layout const &layout = font.layout(str);
+				emit(font.layout_coords.data(), layout.coords_begin, layout.coords_end, &out);
+			}
+		});
+		if (font.layout_misses - misses_before != corpus.strings.size()) {
+			std::cerr << "WARNING: expected one cache miss per string, got " << (font.layout_misses - misses_before) << "." << std::endl;
+		}
+
+		//lookups alone: glyphs per ms, checked against the glyph count:
+		auto time_lookups = [&](auto const &lookup_all) {
+			auto before = std::chrono::high_resolution_clock::now();
+			uint64_t found = 0;
+			for (uint32_t pass = 0; pass < passes; ++pass) {
+				found += lookup_all();
+			}
+			double ms = std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - before).count();
+			if (found != glyphs * passes) {
+				std::cerr << "ERROR: lookups of '" << corpus.name << "' found the wrong number of glyphs." << std::endl;
+				std::exit(1);
+			}
+			return double(found) / ms;
+		};
+		double std_map_lookup_rate = time_lookups([&](){
+			uint32_t found = 0;
+			for (auto const &str : corpus.strings) found += lookup_greedy(str, std_map_lookup);
+			return found;
+		});
+		double name_map_lookup_rate = time_lookups([&](){
+			uint32_t found = 0;
+			for (auto const &str : corpus.strings) found += lookup_greedy(str, name_map_lookup);
+			return found;
+		});
+		double trie_lookup_rate = time_lookups([&](){
+			uint32_t found = 0;
+			for (auto const &str : corpus.strings) {
+				std::string_view view(str);
+				for (uint32_t start = 0; start < view.size(); found += 1) {
+					uint32_t glyph;
+					start += std::max(1U, font.match(view.substr(start), &glyph));
+				}
+			}
+			return found;
+		});
+
+		std::cout << std::setw(8) << corpus.name << std::setw(9) << glyphs << std::setw(8) << "layout" << std::fixed << std::setprecision(0)
+			<< std::setw(12) << std_map_rate << std::setw(12) << name_map_rate << std::setw(12) << trie_rate << std::setw(12) << cached_rate << std::endl;
+		std::cout << std::setw(8) << "" << std::setw(9) << "" << std::setw(8) << "lookup"
+			<< std::setw(12) << std_map_lookup_rate << std::setw(12) << name_map_lookup_rate << std::setw(12) << trie_lookup_rate << std::setw(12) << "-" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,131 @@
+//Headless stress benchmark for the voice limit in Sound::Mixer -- thousands of
+// looping 3D emitters scattered over a large area, with the listener walking
+// through them, mixed with different real-voice limits.
+//
+//Reports time per block, how many voices were real vs. virtual, and how far the
+// output is from mixing every voice (as the level of the difference relative to
+// the full mix, in dB; lower is better).
+//
+//Usage:
+//	bench/voices [seconds]
+
+#include "SoundMixer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Result {
+	double block_ms_average = 0.0;
+	double block_ms_worst = 0.0;
+	double real_average = 0.0;
+	double virtual_average = 0.0;
+};
+
+//mix 'blocks' blocks of 'count' emitters with at most 'limit' real voices into *out:
+static Result render(uint32_t count, uint32_t limit, uint32_t blocks, std::vector< std::vector< float > > const &samples, std::vector< float > *out) {
+	static Sound::Mixer mixer; //(static: a Mixer is big)
+	mixer = Sound::Mixer();
+	mixer.real_voice_limit = limit;
+
+	std::mt19937 mt(0x15466); //same emitters every run
+	auto rand01 = [&mt]() { return mt() / float(mt.max()); };
+
+	for (uint32_t v = 0; v < count; ++v) {
+		Sound::Mixer::Voice &voice = mixer.voices[v];
+		std::vector< float > const &sample = samples[v % samples.size()];
+		voice.data = sample.data();
+		voice.size = sample.size();
+		voice.i = mt() % sample.size();
+		voice.loop = true;
+		voice.is_3D = true;
+		voice.volume = Sound::Ramp< float >(0.1f);
+		voice.position = Sound::Ramp< glm::vec3 >(rand01() * 200.0f - 100.0f, rand01() * 200.0f - 100.0f, 0.0f);
+		voice.half_volume_radius = Sound::Ramp< float >(2.0f);
+		voice.priority = (v % 512 == 0 ? 1 : 0); //a few "important" emitters
+		mixer.start(v);
+	}
+
+	Result result;
+	out->assign(blocks * Sound::Mixer::BlockSamples * 2, 0.0f);
+	for (uint32_t b = 0; b < blocks; ++b) {
+		//walk across the area, turning slowly:
+		float t = float(b) / float(blocks);
+		mixer.listener_position.set(glm::vec3(200.0f * t - 100.0f, 20.0f * std::sin(10.0f * t), 0.0f), 1.0f / 60.0f);
+		mixer.listener_right.set(glm::vec3(std::cos(3.0f * t), std::sin(3.0f * t), 0.0f), 1.0f / 60.0f);
+
+		auto before = std::chrono::high_resolution_clock::now();
+		mixer.mix(out->data() + b * Sound::Mixer::BlockSamples * 2);
+		double ms = std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - before).count() * 1000.0;
+		mixer.finished_count = 0;
+
+		result.block_ms_average += ms / blocks;
+		result.block_ms_worst = std::max(result.block_ms_worst, ms);
+		result.real_average += double(mixer.real_voice_count) / blocks;
+		result.virtual_average += double(mixer.virtual_voice_count) / blocks;
+	}
+	return result;
+}
+
+int main(int argc, char **argv) {
+	float seconds = 5.0f;
+	if (argc == 2) {
+		seconds = std::max(0.1f, std::stof(argv[1]));
+	} else if (argc != 1) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [seconds]" << std::endl;
+		return 1;
+	}
+	uint32_t blocks = uint32_t(std::ceil(seconds * Sound::Mixer::Rate / Sound::Mixer::BlockSamples));
+
+	//some noise samples of different lengths:
+	std::vector< std::vector< float > > samples;
+	{
+		std::mt19937 mt(0x5a3);
+		for (uint32_t length : {4801u, 48017u, 96001u}) {
+			samples.emplace_back(length);
+			for (float &f : samples.back()) f = mt() / float(mt.max()) * 2.0f - 1.0f;
+		}
+	}
+
+	std::cout << "voices: " << blocks << " blocks (" << blocks * Sound::Mixer::BlockSamples / float(Sound::Mixer::Rate) << " seconds) per row; block budget "
+		<< std::fixed << std::setprecision(2) << 1000.0f * Sound::Mixer::BlockSamples / Sound::Mixer::Rate << "ms." << std::endl;
+	std::cout << std::setw(10) << "emitters"
+		<< std::setw(8) << "limit"
+		<< std::setw(12) << "avg ms"
+		<< std::setw(12) << "worst ms"
+		<< std::setw(10) << "real"
+		<< std::setw(10) << "virtual"
+		<< std::setw(16) << "error dB" << std::endl;
+
+	for (uint32_t count : {256u, 1024u, Sound::MaxVoices}) {
+		std::vector< float > full, limited;
+		Result all = render(count, count, blocks, samples, &full);
+		double full_power = 0.0;
+		for (float f : full) full_power += double(f) * double(f);
+
+		for (uint32_t limit : {16u, 32u, 64u, 128u, count}) {
+			Result result = (limit == count ? all : render(count, limit, blocks, samples, &limited));
+			double error_power = 0.0;
+			if (limit != count) {
+				for (size_t i = 0; i < full.size(); ++i) {
+					double d = double(full[i]) - double(limited[i]);
+					error_power += d * d;
+				}
+			}
+			std::cout << std::setw(10) << count
+				<< std::setw(8) << (limit == count ? std::string("all") : std::to_string(limit))
+				<< std::setw(12) << std::setprecision(3) << result.block_ms_average
+				<< std::setw(12) << result.block_ms_worst
+				<< std::setw(10) << std::setprecision(1) << result.real_average
+				<< std::setw(10) << result.virtual_average
+				<< std::setw(16) << (error_power > 0.0 ? 10.0 * std::log10(error_power / full_power) : -INFINITY) << std::endl;
+		}
+	}
+
+	return 0;
+}
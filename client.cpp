@@ -3,9 +3,11 @@
 #include "Connection.hpp"
 #include "Mode.hpp"
 #include "Load.hpp"
+#include "HotReload.hpp"
 #include "Sound.hpp"
 #include "GL.hpp"
-#include "load_save_png.hpp"
+#include "Screenshot.hpp"
+#include "DebugOverlay.hpp"
 
 #include <SDL.h>
 
@@ -33,6 +35,12 @@ int main(int argc, char **argv) {
 	//when compiled on windows, unhandled exceptions don't have their message printed, which can make debugging simple issues difficult.
 	try {
 #endif
+	//for time-to-first-frame / time-to-fully-loaded reporting:
+	auto const launch_time = std::chrono::high_resolution_clock::now();
+	auto ms_since_launch = [&launch_time]() {
+		return std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - launch_time).count();
+	};
+
 	//------------ command line arguments ------------
 	if (argc != 3) {
 		std::cerr << "Usage:\n\t./client <host> <port>" << std::endl;
@@ -109,6 +117,7 @@ int main(int argc, char **argv) {
 	Sound::init();
 
 	//------------ load assets --------------
+	//(loaders tagged LoadTagStream keep loading in the background; see update_load_functions() below)
 	call_load_functions();
 
 	//------------ create game mode + make current --------------
@@ -131,6 +140,9 @@ int main(int argc, char **argv) {
 	};
 	on_resize();
 
+	bool first_frame = true;
+	bool streaming = true;
+
 	//This will loop until the current mode is set to null:
 	while (Mode::current) {
 		//every pass through the game loop creates one frame of output
@@ -149,25 +161,42 @@ int main(int argc, char **argv) {
 				} else if (evt.type == SDL_QUIT) {
 					Mode::set_current(nullptr);
 					break;
+				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F3) {
+					debug_overlay_enabled = !debug_overlay_enabled;
 				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_PRINTSCREEN) {
-					// --- screenshot key ---
-					std::string filename = "screenshot.png";
-					std::cout << "Saving screenshot to '" << filename << "'." << std::endl;
-					glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-					glReadBuffer(GL_FRONT);
-					int w,h;
-					SDL_GL_GetDrawableSize(window, &w, &h);
-					std::vector< glm::u8vec4 > data(w*h);
-					glReadPixels(0,0,w,h, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
-					for (auto &px : data) {
-						px.a = 0xff;
+					// --- screenshot key (saved in the background; see Screenshot.hpp) ---
+					if (evt.key.keysym.mod & KMOD_CTRL) {
+						//ctrl: start/stop capturing every frame (e.g., for video):
+						if (capturing_screenshots()) {
+							stop_capturing_screenshots();
+						} else {
+							std::cout << "Capturing every frame to 'frame-*.png' (ctrl+printscreen again to stop)." << std::endl;
+							capture_screenshots("frame");
+						}
+					} else if (evt.key.keysym.mod & KMOD_SHIFT) {
+						//shift: capture a one-second burst:
+						std::cout << "Capturing 60 frames to 'burst-*.png'." << std::endl;
+						capture_screenshots("burst", 60);
+					} else {
+						std::string filename = "screenshot.png";
+						std::cout << "Saving screenshot to '" << filename << "'." << std::endl;
+						capture_screenshot(filename);
 					}
-					save_png(filename, glm::uvec2(w,h), data.data(), LowerLeftOrigin);
 				}
 			}
 			if (!Mode::current) break;
 		}
 
+		//swap in any assets that changed on disk (see HotReload.hpp):
+		update_hot_reload();
+
+		if (streaming) { //finish streamed assets, spending at most a few milliseconds per frame on OpenGL uploads:
+			streaming = update_load_functions(2.0f);
+			if (!streaming) {
+				std::cout << "Fully loaded after " << ms_since_launch() << " ms." << std::endl;
+			}
+		}
+
 		{ //(2) call the current mode's "update" function to deal with elapsed time:
 			auto current_time = std::chrono::high_resolution_clock::now();
 			static auto previous_time = current_time;
@@ -187,12 +216,28 @@ int main(int argc, char **argv) {
 			Mode::current->draw(drawable_size);
 		}
 
+		//read back the frame for any screenshots being captured:
+		update_screenshots(drawable_size);
+
+		//stats overlay (F3; drawn after the readback, so it isn't in screenshots):
+		draw_debug_overlay(drawable_size);
+
 		//Wait until the recently-drawn frame is shown before doing it all again:
 		SDL_GL_SwapWindow(window);
+
+		if (first_frame) {
+			first_frame = false;
+			std::cout << "First frame after " << ms_since_launch() << " ms." << std::endl;
+		}
 	}
 
 
 	//------------  teardown ------------
+	finish_screenshots();
+
+	stop_hot_reload();
+	stop_load_functions();
+
 	Sound::shutdown();
 
 	SDL_GL_DeleteContext(context);
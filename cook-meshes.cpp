@@ -0,0 +1,200 @@
+//cook-meshes: welds and reorders the triangle soup in a .pnct file
+// (see MeshCooker.hpp) and writes an indexed .pnct that MeshBuffer draws
+// with glDrawElementsBaseVertex.
+//
+//Usage:
+//	scenes/cook-meshes <in.pnct> <out.pnct>   (in and out may be the same file)
+//	scenes/cook-meshes --report <in.pnct> [more.pnct ...]
+//
+//Either way, prints per-mesh vertex cache (ACMR) and memory statistics.
+
+#include "MeshCooker.hpp"
+#include "read_write_chunk.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using MeshCooker::Vertex;
+
+//Same layout as in Mesh.cpp:
+struct IndexEntry {
+	uint32_t name_begin, name_end;
+	uint32_t vertex_begin, vertex_end;
+};
+static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
+
+struct ElementEntry {
+	uint32_t element_begin, element_end;
+	uint32_t element_size;
+};
+static_assert(sizeof(ElementEntry) == 12, "Element entry should be packed");
+
+struct Totals {
+	size_t soup_bytes = 0;
+	size_t cooked_bytes = 0;
+};
+
+//cook all meshes in 'in_file'; write result to 'out_file' unless it is empty:
+static void cook(std::string const &in_file, std::string const &out_file, Totals *totals) {
+	std::vector< Vertex > soup;
+	std::vector< char > strings;
+	std::vector< IndexEntry > index;
+	{
+		std::ifstream file(in_file, std::ios::binary);
+		if (!file) throw std::runtime_error("Failed to open '" + in_file + "'.");
+		read_chunk(file, "pnct", &soup);
+		read_chunk(file, "str0", &strings);
+		read_chunk(file, "idx0", &index);
+		if (file.peek() != EOF) {
+			throw std::runtime_error("'" + in_file + "' has data after its 'idx0' chunk (already cooked?)");
+		}
+	}
+
+	std::vector< Vertex > out_vertices;
+	std::vector< IndexEntry > out_index;
+	std::vector< ElementEntry > out_elements;
+	std::vector< char > out_element_data;
+
+	std::cout << in_file << ":\n";
+	std::cout << "  " << std::left << std::setw(24) << "mesh" << std::right
+		<< std::setw(8) << "tris"
+		<< std::setw(16) << "verts"
+		<< std::setw(9) << "welded"
+		<< std::setw(9) << "cooked"
+		<< std::setw(22) << "bytes"
+		<< std::setw(8) << "saved" << "\n";
+	std::cout << "  " << std::setw(24 + 8 + 16) << ""
+		<< std::setw(9) << "ACMR"
+		<< std::setw(9) << "ACMR" << "\n";
+
+	for (auto const &entry : index) {
+		if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
+			throw std::runtime_error("index entry has out-of-range name begin/end");
+		}
+		if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= soup.size())) {
+			throw std::runtime_error("index entry has out-of-range vertex start/count");
+		}
+		std::string name(strings.data() + entry.name_begin, strings.data() + entry.name_end);
+		uint32_t count = entry.vertex_end - entry.vertex_begin;
+		if (count % 3 != 0) {
+			throw std::runtime_error("mesh '" + name + "' has a vertex count that isn't a multiple of three");
+		}
+
+		std::vector< Vertex > vertices;
+		std::vector< uint32_t > indices;
+		MeshCooker::weld_vertices(soup.data() + entry.vertex_begin, count, &vertices, &indices);
+		float welded_acmr = MeshCooker::compute_acmr(indices);
+
+		MeshCooker::optimize_vertex_cache(&indices, uint32_t(vertices.size()));
+		MeshCooker::optimize_overdraw(&indices, vertices);
+		MeshCooker::optimize_vertex_fetch(&indices, &vertices);
+		float cooked_acmr = MeshCooker::compute_acmr(indices);
+
+		//16-bit indices whenever they fit (indices are relative to the mesh's first vertex):
+		uint32_t element_size = (vertices.size() <= 0x10000 ? 2 : 4);
+
+		//flat-shaded meshes share few vertices; if indexing doesn't save space, keep the soup:
+		// (an element size of zero tells MeshBuffer to draw the vertices directly)
+		if (vertices.size() * sizeof(Vertex) + indices.size() * element_size >= count * sizeof(Vertex)) {
+			vertices.assign(soup.begin() + entry.vertex_begin, soup.begin() + entry.vertex_end);
+			indices.clear();
+			element_size = 0;
+			cooked_acmr = 3.0f;
+		}
+
+		IndexEntry out_entry = entry;
+		out_entry.vertex_begin = uint32_t(out_vertices.size());
+		out_vertices.insert(out_vertices.end(), vertices.begin(), vertices.end());
+		out_entry.vertex_end = uint32_t(out_vertices.size());
+		out_index.emplace_back(out_entry);
+
+		//keep every mesh's elements 4-byte aligned:
+		while (out_element_data.size() % 4 != 0) out_element_data.emplace_back('\0');
+		ElementEntry element;
+		element.element_size = element_size;
+		element.element_begin = uint32_t(out_element_data.size());
+		for (uint32_t i : indices) {
+			if (element_size == 2) {
+				uint16_t i16 = uint16_t(i);
+				out_element_data.insert(out_element_data.end(), reinterpret_cast< char const * >(&i16), reinterpret_cast< char const * >(&i16) + 2);
+			} else {
+				out_element_data.insert(out_element_data.end(), reinterpret_cast< char const * >(&i), reinterpret_cast< char const * >(&i) + 4);
+			}
+		}
+		element.element_end = uint32_t(out_element_data.size());
+		out_elements.emplace_back(element);
+
+		size_t soup_bytes = count * sizeof(Vertex);
+		size_t cooked_bytes = vertices.size() * sizeof(Vertex) + indices.size() * element_size;
+		totals->soup_bytes += soup_bytes;
+		totals->cooked_bytes += cooked_bytes;
+
+		std::cout << "  " << std::left << std::setw(24) << name << std::right
+			<< std::setw(8) << (count / 3)
+			<< std::setw(16) << (std::to_string(count) + " -> " + std::to_string(vertices.size()))
+			<< std::setw(9) << std::fixed << std::setprecision(3) << welded_acmr
+			<< std::setw(9) << cooked_acmr
+			<< std::setw(22) << (std::to_string(soup_bytes) + " -> " + std::to_string(cooked_bytes))
+			<< std::setw(7) << std::setprecision(1) << (soup_bytes ? 100.0 * (1.0 - double(cooked_bytes) / double(soup_bytes)) : 0.0) << "%\n";
+	}
+	std::cout.flush();
+
+	if (out_file != "") {
+		//(keep the chunks that follow aligned)
+		while (strings.size() % 4 != 0) strings.emplace_back('\0');
+
+		std::ofstream file(out_file, std::ios::binary);
+		write_chunk("pnct", out_vertices, &file);
+		write_chunk("str0", strings, &file);
+		write_chunk("idx0", out_index, &file);
+		write_chunk("idx1", out_elements, &file);
+		write_chunk("ele0", out_element_data, &file);
+		if (!file) throw std::runtime_error("Failed to write '" + out_file + "'.");
+		std::cout << "  wrote " << out_vertices.size() << " vertices and " << out_element_data.size() << " bytes of indices to '" << out_file << "'." << std::endl;
+	}
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	//when compiled on windows, unhandled exceptions don't have their message printed, which can make debugging simple issues difficult.
+	try {
+#endif
+
+	std::vector< std::string > args(argv + 1, argv + argc);
+
+	bool report_only = (!args.empty() && args[0] == "--report");
+	if (!(report_only ? args.size() >= 2 : args.size() == 2)) {
+		std::cerr << "Usage:\n"
+			<< "\t" << argv[0] << " <in.pnct> <out.pnct>\n"
+			<< "\t" << argv[0] << " --report <in.pnct> [more.pnct ...]" << std::endl;
+		return 1;
+	}
+
+	//(ACMR: average vertex shader invocations per triangle, with a 16-entry FIFO cache; unindexed soup is always 3.0)
+	Totals totals;
+	if (report_only) {
+		for (size_t i = 1; i < args.size(); ++i) {
+			cook(args[i], "", &totals);
+		}
+	} else {
+		cook(args[0], args[1], &totals);
+	}
+
+	std::cout << "total: " << totals.soup_bytes << " bytes as triangle soup -> " << totals.cooked_bytes << " bytes indexed." << std::endl;
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
@@ -0,0 +1,200 @@
+//cook-scene: prepares a .scene file for fast loading (see Scene::load):
+// - interns names (each distinct name is stored once in the string table),
+// - stores the index of each mesh in the mesh file, so loading needs no mesh name lookups,
+// - stores a prebuilt name index (see NameIndex.hpp) for Scene::find and Scene::find_prefix.
+//
+//Usage:
+//	scenes/cook-scene <in.scene> <meshes.pnct> <out.scene>   (in and out may be the same file)
+//
+//Cooked scenes still load without their mesh file; if the mesh file changes,
+// Scene::load notices (via a hash of the mesh names) and falls back to name lookups.
+
+#include "NameIndex.hpp"
+#include "AssetArchive.hpp"
+#include "read_write_chunk.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Same layouts as in Scene.cpp:
+struct HierarchyEntry {
+	uint32_t parent;
+	uint32_t name_begin;
+	uint32_t name_end;
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+};
+static_assert(sizeof(HierarchyEntry) == 4 + 4 + 4 + 4*3 + 4*4 + 4*3, "HierarchyEntry is packed.");
+
+struct MeshEntry {
+	uint32_t transform;
+	uint32_t name_begin;
+	uint32_t name_end;
+};
+static_assert(sizeof(MeshEntry) == 4 + 4 + 4, "MeshEntry is packed.");
+
+struct MeshNamesHash {
+	uint32_t low, high;
+};
+static_assert(sizeof(MeshNamesHash) == 8, "MeshNamesHash is packed.");
+
+//..and as in Mesh.cpp:
+struct IndexEntry {
+	uint32_t name_begin, name_end;
+	uint32_t vertex_begin, vertex_end;
+};
+static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
+
+//check the magic number of the next chunk in 'file' without reading it:
+static bool next_chunk_is(std::istream &file, char const *magic) {
+	char next[4];
+	std::streampos at = file.tellg();
+	bool match = file.read(next, 4) && std::string(next, 4) == magic;
+	file.clear();
+	file.seekg(at);
+	return match;
+}
+
+static std::string name_at(std::vector< char > const &strings, uint32_t begin, uint32_t end, std::string const &what) {
+	if (!(begin <= end && end <= strings.size())) {
+		throw std::runtime_error(what + " has out-of-range name begin/end");
+	}
+	return std::string(strings.begin() + begin, strings.begin() + end);
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	//when compiled on windows, unhandled exceptions don't have their message printed, which can make debugging simple issues difficult.
+	try {
+#endif
+
+	if (argc != 4) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <in.scene> <meshes.pnct> <out.scene>" << std::endl;
+		return 1;
+	}
+	std::string in_file = argv[1];
+	std::string mesh_file = argv[2];
+	std::string out_file = argv[3];
+
+	//------ read scene ------
+	std::vector< char > strings;
+	std::vector< HierarchyEntry > hierarchy;
+	std::vector< MeshEntry > meshes;
+	std::vector< char > cameras, lights; //(copied through as-is)
+	std::vector< char > extra; //(chunks for Scene::load_extra, also copied as-is)
+	{
+		std::ifstream file(in_file, std::ios::binary);
+		if (!file) throw std::runtime_error("Failed to open '" + in_file + "'.");
+		read_chunk(file, "str0", &strings);
+		read_chunk(file, "xfh0", &hierarchy);
+		read_chunk(file, "msh0", &meshes);
+		read_chunk(file, "cam0", &cameras);
+		read_chunk(file, "lmp0", &lights);
+
+		//drop what an earlier cook added:
+		if (next_chunk_is(file, "mbh0")) {
+			std::vector< char > skip;
+			for (char const *magic : {"mbh0", "msh1", "nxs0", "nxn0", "nxi0", "nxd0", "nxh0"}) {
+				read_chunk(file, magic, &skip);
+			}
+		}
+
+		extra.assign(std::istreambuf_iterator< char >(file), std::istreambuf_iterator< char >());
+	}
+
+	//------ read mesh names (in file order) ------
+	std::unordered_map< std::string, uint32_t > mesh_index;
+	std::string all_mesh_names; //(hashed the same way as MeshBuffer::names_hash)
+	{
+		std::ifstream file(mesh_file, std::ios::binary);
+		if (!file) throw std::runtime_error("Failed to open '" + mesh_file + "'.");
+		std::vector< char > vertices;
+		std::vector< char > mesh_strings;
+		std::vector< IndexEntry > index;
+		read_chunk(file, "pnct", &vertices);
+		read_chunk(file, "str0", &mesh_strings);
+		read_chunk(file, "idx0", &index);
+		for (uint32_t i = 0; i < index.size(); ++i) {
+			std::string name = name_at(mesh_strings, index[i].name_begin, index[i].name_end, "mesh index entry");
+			mesh_index.emplace(name, i); //(like MeshBuffer, the first mesh with a name wins)
+			all_mesh_names += name;
+			all_mesh_names += '\0';
+		}
+	}
+	uint64_t hash = hash_bytes(all_mesh_names.data(), all_mesh_names.size());
+
+	//------ intern names ------
+	std::vector< char > interned;
+	std::unordered_map< std::string, std::pair< uint32_t, uint32_t > > interned_ranges;
+	auto intern = [&](std::string const &name, uint32_t *begin, uint32_t *end) {
+		auto ret = interned_ranges.emplace(name, std::make_pair(uint32_t(interned.size()), uint32_t(interned.size() + name.size())));
+		if (ret.second) interned.insert(interned.end(), name.begin(), name.end());
+		*begin = ret.first->second.first;
+		*end = ret.first->second.second;
+	};
+
+	std::vector< std::string > transform_names;
+	transform_names.reserve(hierarchy.size());
+	for (auto &h : hierarchy) {
+		transform_names.emplace_back(name_at(strings, h.name_begin, h.name_end, "hierarchy entry"));
+		intern(transform_names.back(), &h.name_begin, &h.name_end);
+	}
+
+	std::vector< uint32_t > mesh_indices;
+	mesh_indices.reserve(meshes.size());
+	for (auto &m : meshes) {
+		std::string name = name_at(strings, m.name_begin, m.name_end, "mesh entry");
+		auto f = mesh_index.find(name);
+		if (f == mesh_index.end()) {
+			throw std::runtime_error("Scene uses mesh '" + name + "', which isn't in '" + mesh_file + "'.");
+		}
+		mesh_indices.emplace_back(f->second);
+		intern(name, &m.name_begin, &m.name_end);
+	}
+	//(keep the chunks that follow aligned)
+	while (interned.size() % 4 != 0) interned.emplace_back('\0');
+
+	NameIndex name_index(transform_names);
+
+	//------ write cooked scene ------
+	{
+		std::ofstream file(out_file, std::ios::binary);
+		write_chunk("str0", interned, &file);
+		write_chunk("xfh0", hierarchy, &file);
+		write_chunk("msh0", meshes, &file);
+		write_chunk("cam0", cameras, &file);
+		write_chunk("lmp0", lights, &file);
+		write_chunk("mbh0", std::vector< MeshNamesHash >{ MeshNamesHash{ uint32_t(hash), uint32_t(hash >> 32) } }, &file);
+		write_chunk("msh1", mesh_indices, &file);
+		name_index.write(&file);
+		file.write(extra.data(), extra.size());
+		if (!file) throw std::runtime_error("Failed to write '" + out_file + "'.");
+	}
+
+	std::cout << in_file << ": " << hierarchy.size() << " transforms (" << name_index.names.size() << " distinct names), "
+		<< meshes.size() << " meshes resolved against '" << mesh_file << "'.\n"
+		<< "  strings: " << strings.size() << " -> " << interned.size() << " bytes; "
+		<< "name index: " << (name_index.strings.size() + name_index.names.size() * sizeof(NameIndex::Name) + (name_index.items.size() + name_index.displacements.size() + name_index.slots.size()) * 4) << " bytes.\n"
+		<< "  wrote '" << out_file << "'." << std::endl;
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
@@ -1,4 +1,5 @@
 #include "load_opus.hpp"
+#include "AssetArchive.hpp"
 
 #include <opusfile.h>
 
@@ -13,12 +14,13 @@ void load_opus(std::string const &filename, std::vector< float > *data_) {
 	auto &data = *data_;
 	data.clear();
 
-	std::cout << "loading '" << filename << "'..."; std::cout.flush();
+	//compressed bytes (from the asset archive, if present); must outlive 'op':
+	AssetFile file(filename);
 
 	//will hold opusfile * int a std::unique_ptr so that it will automatically be deleted:
 	int err = 0;
 	std::unique_ptr< OggOpusFile, decltype(&op_free) > op(
-		op_open_file(filename.c_str(), &err), //pointer to hold
+		op_open_memory(reinterpret_cast< unsigned char const * >(file.data), file.size, &err), //pointer to hold
 		op_free //deletion function
 	);
 	if (err != 0) {
@@ -49,6 +51,4 @@ void load_opus(std::string const &filename, std::vector< float > *data_) {
 			throw std::runtime_error("opusfile read error " + std::to_string(ret) + " reading \"" + filename + "\".");
 		}
 	}
-
-	std::cout << " done." << std::endl;
 }
@@ -1,94 +1,84 @@
 #include "load_save_png.hpp"
 
+#include "AssetArchive.hpp"
+
 #include <png.h>
 
-#include <iostream>
-#include <fstream>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
 #define LOG_ERROR( X ) std::cerr << X << std::endl
 
 using std::vector;
 
-bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vector< glm::u8vec4 > *data, OriginLocation origin);
-void save_png(std::ostream &to, unsigned int width, unsigned int height, glm::u8vec4 const *data, OriginLocation origin);
-
-void load_png(std::string filename, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin) {
-	assert(size);
-
-	std::ifstream file(filename.c_str(), std::ios::binary);
-	if (!file) {
-		throw std::runtime_error("Failed to open PNG image file '" + filename + "'.");
-	}
-	if (!load_png(file, &size->x, &size->y, data, origin)) {
-		throw std::runtime_error("Failed to read PNG image from '" + filename + "'.");
-	}
+//libpng reports errors by calling this and expecting it not to return;
+// it keeps the message (so it can be thrown once control is back in C++) and jumps to the setjmp():
+static void on_png_error(png_structp png, png_const_charp message) {
+	std::string *error = reinterpret_cast< std::string * >(png_get_error_ptr(png));
+	if (error) *error = message;
+	png_longjmp(png, 1);
 }
 
-void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin) {
-	std::ofstream file(filename.c_str(), std::ios::binary);
-	save_png(file, size.x, size.y, data, origin);
+static void on_png_warning(png_structp, png_const_charp) {
+	//(ignored -- e.g., warnings about unusual but harmless chunks)
 }
 
+//------------------------ reading --------------------------------
 
-static void user_read_data(png_structp png_ptr, png_bytep data, png_size_t length) {
-	std::istream *from = reinterpret_cast< std::istream * >(png_get_io_ptr(png_ptr));
-	assert(from);
-	if (!from->read(reinterpret_cast< char * >(data), length)) {
-		png_error(png_ptr, "Error reading.");
-	}
-}
-
-static void user_write_data(png_structp png_ptr, png_bytep data, png_size_t length) {
-	std::ostream *to = reinterpret_cast< std::ostream * >(png_get_io_ptr(png_ptr));
-	assert(to);
-	if (!to->write(reinterpret_cast< char * >(data), length)) {
-		png_error(png_ptr, "Error writing.");
-	}
-}
+struct PNGReader {
+	char const *at;
+	char const *end;
+};
 
-static void user_flush_data(png_structp png_ptr) {
-	std::ostream *to = reinterpret_cast< std::ostream * >(png_get_io_ptr(png_ptr));
-	assert(to);
-	if (!to->flush()) {
-		png_error(png_ptr, "Error flushing.");
+static void read_from_memory(png_structp png, png_bytep data, png_size_t length) {
+	PNGReader *reader = reinterpret_cast< PNGReader * >(png_get_io_ptr(png));
+	assert(reader);
+	if (size_t(reader->end - reader->at) < length) {
+		png_error(png, "Unexpected end of data.");
 	}
+	std::memcpy(data, reader->at, length);
+	reader->at += length;
 }
 
-
-bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vector< glm::u8vec4 > *data, OriginLocation origin) {
+void decode_png(char const *begin, char const *end, glm::uvec2 *size, vector< glm::u8vec4 > *data, OriginLocation origin) {
+	assert(size);
 	assert(data);
-	uint32_t local_width, local_height;
-	if (width == nullptr) width = &local_width;
-	if (height == nullptr) height = &local_height;
-	*width = *height = 0;
+	*size = glm::uvec2(0);
 	data->clear();
-	//..... load file ......
-	//Load a png file, as per the libpng docs:
-	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp)NULL, (png_error_ptr)NULL, (png_error_ptr)NULL);
 
-	png_set_read_fn(png, &from, user_read_data);
+	if (end - begin < 8 || png_sig_cmp(reinterpret_cast< png_const_bytep >(begin), 0, 8) != 0) {
+		throw std::runtime_error("Not PNG data.");
+	}
 
+	std::string error = "unknown error";
+	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, &error, on_png_error, on_png_warning);
 	if (!png) {
-		LOG_ERROR("  cannot alloc read struct.");
-		return false;
+		throw std::runtime_error("Cannot allocate PNG read struct.");
 	}
 	png_infop info = png_create_info_struct(png);
 	if (!info) {
-		LOG_ERROR("  cannot alloc info struct.");
-		png_destroy_read_struct(&png, (png_infopp)NULL, (png_infopp)NULL);
-		return false;
+		png_destroy_read_struct(&png, NULL, NULL);
+		throw std::runtime_error("Cannot allocate PNG info struct.");
 	}
-	png_bytep *row_pointers = NULL;
+	PNGReader reader{ begin, end };
+	png_set_read_fn(png, &reader, read_from_memory);
+
+	vector< png_bytep > row_pointers;
 	if (setjmp(png_jmpbuf(png))) {
-		LOG_ERROR("  png interal error.");
-		png_destroy_read_struct(&png, &info, (png_infopp)NULL);
-		if (row_pointers != NULL) delete[] row_pointers;
+		png_destroy_read_struct(&png, &info, NULL);
 		data->clear();
-		return false;
+		throw std::runtime_error("PNG decoding failed: " + error);
 	}
-	//not needed with custom read/write functions: png_init_io(png, NULL);
+
 	png_read_info(png, info);
 	unsigned int w = png_get_image_width(png, info);
 	unsigned int h = png_get_image_height(png, info);
@@ -96,7 +86,9 @@ bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vec
 		png_set_palette_to_rgb(png);
 	if (png_get_color_type(png, info) == PNG_COLOR_TYPE_GRAY || png_get_color_type(png, info) == PNG_COLOR_TYPE_GRAY_ALPHA)
 		png_set_gray_to_rgb(png);
-	if (!(png_get_color_type(png, info) & PNG_COLOR_MASK_ALPHA))
+	if (png_get_valid(png, info, PNG_INFO_tRNS))
+		png_set_tRNS_to_alpha(png);
+	else if (!(png_get_color_type(png, info) & PNG_COLOR_MASK_ALPHA))
 		png_set_add_alpha(png, 0xff, PNG_FILLER_AFTER);
 	if (png_get_bit_depth(png, info) < 8)
 		png_set_packing(png);
@@ -107,69 +99,145 @@ bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vec
 	png_read_update_info(png, info);
 	size_t rowbytes = png_get_rowbytes(png, info);
 	//Make sure it's the format we think it is...
-	assert(rowbytes == w*sizeof(uint32_t));
+	if (rowbytes != w * sizeof(uint32_t)) {
+		png_error(png, "Unexpected pixel format after conversion.");
+	}
 
-	data->resize(w*h);
-	row_pointers = new png_bytep[h];
+	//rows are decoded straight into 'data':
+	data->resize(size_t(w) * h);
+	row_pointers.resize(h);
 	for (unsigned int r = 0; r < h; ++r) {
 		if (origin == LowerLeftOrigin) {
-			row_pointers[h-1-r] = (png_bytep)(&(*data)[r*w]);
+			row_pointers[h-1-r] = (png_bytep)(&(*data)[size_t(r) * w]);
 		} else {
-			row_pointers[r] = (png_bytep)(&(*data)[r*w]);
+			row_pointers[r] = (png_bytep)(&(*data)[size_t(r) * w]);
 		}
 	}
-	png_read_image(png, row_pointers);
+	png_read_image(png, row_pointers.data());
+	png_read_end(png, NULL);
 	png_destroy_read_struct(&png, &info, NULL);
-	delete[] row_pointers;
 
-	*width = w;
-	*height = h;
-	return true;
+	*size = glm::uvec2(w, h);
 }
 
+void load_png(std::string filename, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin) {
+	assert(size);
 
-void save_png(std::ostream &to, unsigned int width, unsigned int height, glm::u8vec4 const *data, OriginLocation origin) {
-//After the libpng example.c
-	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-
-	png_set_write_fn(png_ptr, &to, user_write_data, user_flush_data);
-
-	if (png_ptr == NULL) {
-		LOG_ERROR("Can't create write struct.");
-		return;
+	std::unique_ptr< AssetFile > file;
+	try {
+		file.reset(new AssetFile(filename));
+	} catch (std::exception &) {
+		throw std::runtime_error("Failed to open PNG image file '" + filename + "'.");
 	}
+	try {
+		decode_png(file->begin(), file->end(), size, data, origin);
+	} catch (std::exception &e) {
+		throw std::runtime_error("Failed to read PNG image from '" + filename + "': " + e.what());
+	}
+}
 
-	png_infop info_ptr = png_create_info_struct(png_ptr);
-	if (info_ptr == NULL) {
-		png_destroy_write_struct(&png_ptr, NULL);
-		LOG_ERROR("Can't craete info pointer");
-		return;
+void load_pngs(std::vector< std::string > const &filenames, OriginLocation origin, std::vector< PNGImage > *images, uint32_t threads) {
+	assert(images);
+	images->assign(filenames.size(), PNGImage());
+	if (threads == 0) {
+		//(same as Load<>: a thread per core, less one)
+		uint32_t cores = std::thread::hardware_concurrency();
+		threads = (cores > 2 ? cores - 1 : 1);
+	}
+	threads = std::max(1U, std::min(threads, uint32_t(filenames.size())));
+
+	//each thread takes the next file until there are none left:
+	std::atomic< size_t > next(0);
+	std::vector< std::exception_ptr > errors(filenames.size());
+	auto work = [&]() {
+		for (size_t i; (i = next.fetch_add(1)) < filenames.size(); ) {
+			try {
+				load_png(filenames[i], &(*images)[i].size, &(*images)[i].data, origin);
+			} catch (...) {
+				errors[i] = std::current_exception();
+			}
+		}
+	};
+	std::vector< std::thread > workers;
+	for (uint32_t t = 1; t < threads; ++t) workers.emplace_back(work);
+	work(); //(this thread is one of the workers)
+	for (auto &worker : workers) worker.join();
+
+	for (auto const &error : errors) {
+		if (error) std::rethrow_exception(error);
 	}
+}
 
-	if (setjmp(png_jmpbuf(png_ptr))) {
-		png_destroy_write_struct(&png_ptr, &info_ptr);
-		LOG_ERROR("Error writing png.");
-		return;
+//------------------------ writing --------------------------------
+
+static void write_to_memory(png_structp png, png_bytep data, png_size_t length) {
+	vector< char > *out = reinterpret_cast< vector< char > * >(png_get_io_ptr(png));
+	assert(out);
+	out->insert(out->end(), reinterpret_cast< char const * >(data), reinterpret_cast< char const * >(data) + length);
+}
+
+static void flush_memory(png_structp) {
+}
+
+void encode_png(glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin, PNGSaveOptions const &options, std::vector< char > *out) {
+	assert(out);
+	out->clear();
+	out->reserve(size_t(size.x) * size.y + 1024); //(a guess; most images compress to less than a quarter)
+
+	std::string error = "unknown error";
+	png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, &error, on_png_error, on_png_warning);
+	if (!png) {
+		throw std::runtime_error("Cannot allocate PNG write struct.");
+	}
+	png_infop info = png_create_info_struct(png);
+	if (!info) {
+		png_destroy_write_struct(&png, NULL);
+		throw std::runtime_error("Cannot allocate PNG info struct.");
 	}
+	png_set_write_fn(png, out, write_to_memory, flush_memory);
 
-	//Not needed with custom read/write functions: png_init_io(png_ptr, fp);
-	png_set_IHDR(png_ptr, info_ptr, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+	vector< png_bytep > row_pointers;
+	if (setjmp(png_jmpbuf(png))) {
+		png_destroy_write_struct(&png, &info);
+		out->clear();
+		throw std::runtime_error("PNG encoding failed: " + error);
+	}
 
-	png_write_info(png_ptr, info_ptr);
-	//png_set_swap_alpha(png_ptr) // might need?
-	vector< png_bytep > row_pointers(height);
-	for (unsigned int i = 0; i < height; ++i) {
+	png_set_IHDR(png, info, size.x, size.y, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+	png_set_compression_level(png, std::max(0, std::min(9, options.level)));
+	int filters = PNG_ALL_FILTERS;
+	if (options.filter == PNGFilterNone) filters = PNG_FILTER_NONE;
+	else if (options.filter == PNGFilterSub) filters = PNG_FILTER_SUB;
+	else if (options.filter == PNGFilterUp) filters = PNG_FILTER_UP;
+	else if (options.filter == PNGFilterPaeth) filters = PNG_FILTER_PAETH;
+	png_set_filter(png, PNG_FILTER_TYPE_BASE, filters);
+	png_set_compression_buffer_size(png, 1 << 16); //(fewer, larger writes than the default 8kB)
+
+	png_write_info(png, info);
+	row_pointers.resize(size.y);
+	for (unsigned int i = 0; i < size.y; ++i) {
 		if (origin == UpperLeftOrigin) {
-			row_pointers[i] = (png_bytep)&(data[i * width]);
+			row_pointers[i] = (png_bytep)&(data[size_t(i) * size.x]);
 		} else {
-			row_pointers[i] = (png_bytep)&(data[(height - 1 - i) * width]);
+			row_pointers[i] = (png_bytep)&(data[size_t(size.y - 1 - i) * size.x]);
 		}
 	}
-	png_write_image(png_ptr, &(row_pointers[0]));
-
-	png_write_end(png_ptr, info_ptr);
-
-	png_destroy_write_struct(&png_ptr, &info_ptr);
+	png_write_image(png, row_pointers.data());
+	png_write_end(png, info);
+	png_destroy_write_struct(&png, &info);
+}
 
-	return;
+void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin, PNGSaveOptions const &options) {
+	vector< char > png;
+	try {
+		encode_png(size, data, origin, options, &png);
+	} catch (std::exception &e) {
+		LOG_ERROR("WARNING: not saving '" << filename << "': " << e.what());
+		return;
+	}
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	file.write(png.data(), png.size());
+	if (!file) {
+		LOG_ERROR("WARNING: failed to write PNG image '" << filename << "'.");
+	}
 }
@@ -8,6 +8,14 @@
 
 /*
  * Load and save PNG files.
+ *
+ * Loading decodes straight out of memory -- the file comes from the asset
+ *  archive or is memory-mapped (see AssetArchive.hpp) -- and load_pngs
+ *  decodes a batch of files on several threads.
+ *
+ * Saving encodes into memory and writes the file in one go; PNGSaveOptions
+ *  trade file size for speed (PNGSaveFast is several times faster than the
+ *  default, for screenshots and captured frames).
  */
 
 enum OriginLocation {
@@ -15,6 +23,34 @@ enum OriginLocation {
 	UpperLeftOrigin,
 };
 
+//row filters (applied before compression; adaptive picks the best of all of them per row, which is slowest):
+enum PNGFilter : uint8_t {
+	PNGFilterAdaptive,
+	PNGFilterNone,
+	PNGFilterSub,
+	PNGFilterUp,
+	PNGFilterPaeth,
+};
+
+struct PNGSaveOptions {
+	int level = 6; //zlib compression level: 0 (store) .. 9 (smallest)
+	PNGFilter filter = PNGFilterAdaptive;
+};
+constexpr PNGSaveOptions PNGSaveFast = { 1, PNGFilterSub }; //(see bench/png)
+
 //NOTE: load_png will throw on error
 void load_png(std::string filename, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin);
-void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin);
+//NOTE: save_png prints a warning on error
+void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin, PNGSaveOptions const &options = PNGSaveOptions());
+
+//decode/encode PNG data in memory (both throw on error):
+void decode_png(char const *begin, char const *end, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin);
+void encode_png(glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin, PNGSaveOptions const &options, std::vector< char > *png);
+
+//load several files at once, on 'threads' threads (0 = as many as Load<> uses):
+// throws (once all have been tried) if any fail
+struct PNGImage {
+	glm::uvec2 size = glm::uvec2(0);
+	std::vector< glm::u8vec4 > data;
+};
+void load_pngs(std::vector< std::string > const &filenames, OriginLocation origin, std::vector< PNGImage > *images, uint32_t threads = 0);
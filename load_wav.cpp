@@ -1,7 +1,10 @@
 #include "load_wav.hpp"
+#include "AssetArchive.hpp"
+#include "SoundResampler.hpp"
 
 #include <SDL.h>
 
+#include <fstream>
 #include <iostream>
 #include <cassert>
 #include <algorithm>
@@ -16,16 +19,21 @@ void load_wav(std::string const &filename, std::vector< float > *data_) {
 	Uint8 *audio_buf = nullptr;
 	Uint32 audio_len = 0;
 
-	SDL_AudioSpec *have = SDL_LoadWAV(filename.c_str(), &audio_spec, &audio_buf, &audio_len);
+	//read from the asset archive (if present) via an in-memory SDL_RWops (freed by SDL_LoadWAV_RW):
+	AssetFile file(filename);
+	SDL_AudioSpec *have = SDL_LoadWAV_RW(SDL_RWFromConstMem(file.data, int(file.size)), 1, &audio_spec, &audio_buf, &audio_len);
 	if (!have) {
 		throw std::runtime_error("Failed to load WAV file '" + filename + "'; SDL says \"" + std::string(SDL_GetError()) + "\"");
 	}
 
 	//based on the SDL_AudioCVT example in the docs: https://wiki.libsdl.org/SDL_AudioCVT
+	// (SDL only converts the format and channels; the rate is converted below, with Sound::resample)
 	SDL_AudioCVT cvt;
-	SDL_BuildAudioCVT(&cvt, have->format, have->channels, have->freq, AUDIO_F32SYS, 1, AUDIO_RATE);
-	if (cvt.needed) {
+	SDL_BuildAudioCVT(&cvt, have->format, have->channels, have->freq, AUDIO_F32SYS, 1, have->freq);
+	if (cvt.needed || have->freq != int(AUDIO_RATE)) {
 		std::cout << "WAV file '" + filename + "' didn't load as " + std::to_string(AUDIO_RATE) + " Hz, float32, mono; converting." << std::endl;
+	}
+	if (cvt.needed) {
 		cvt.len = audio_len;
 		cvt.buf = (Uint8 *)SDL_malloc(cvt.len * cvt.len_mult);
 		SDL_memcpy(cvt.buf, audio_buf, audio_len);
@@ -40,11 +48,45 @@ void load_wav(std::string const &filename, std::vector< float > *data_) {
 	}
 	SDL_FreeWAV(audio_buf);
 
-	float min = 0.0f;
-	float max = 0.0f;
-	for (auto d : data) {
-		min = std::min(min, d);
-		max = std::max(max, d);
+	if (have->freq != int(AUDIO_RATE)) {
+		std::vector< float > resampled;
+		Sound::resample(data, uint32_t(have->freq), AUDIO_RATE, &resampled);
+		data.swap(resampled);
+	}
+}
+
+void save_wav(std::string const &filename, std::vector< float > const &data, uint32_t channels, uint32_t rate) {
+	//header for a RIFF file with a 'fmt ' chunk (WAVE_FORMAT_IEEE_FLOAT) and a 'data' chunk:
+	// (fields are little-endian, which is what every platform we build for uses)
+	struct Header {
+		char riff[4] = {'R', 'I', 'F', 'F'};
+		uint32_t riff_size;
+		char wave[4] = {'W', 'A', 'V', 'E'};
+		char fmt[4] = {'f', 'm', 't', ' '};
+		uint32_t fmt_size = 16;
+		uint16_t format = 3; //WAVE_FORMAT_IEEE_FLOAT
+		uint16_t channels;
+		uint32_t rate;
+		uint32_t byte_rate;
+		uint16_t block_align;
+		uint16_t bits = 32;
+		char data[4] = {'d', 'a', 't', 'a'};
+		uint32_t data_size;
+	};
+	static_assert(sizeof(Header) == 44, "WAV header is packed.");
+
+	Header header;
+	header.data_size = uint32_t(data.size() * sizeof(float));
+	header.riff_size = uint32_t(sizeof(Header) - 8 + header.data_size);
+	header.channels = uint16_t(channels);
+	header.rate = rate;
+	header.block_align = uint16_t(channels * sizeof(float));
+	header.byte_rate = rate * header.block_align;
+
+	std::ofstream out(filename, std::ios::binary);
+	out.write(reinterpret_cast< char const * >(&header), sizeof(header));
+	out.write(reinterpret_cast< char const * >(data.data()), header.data_size);
+	if (!out) {
+		throw std::runtime_error("Failed to write WAV file '" + filename + "'.");
 	}
-	std::cout << "Range: " << min << ", " << max << std::endl;
 }
@@ -2,6 +2,10 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 
 //Load a WAV file as 48kHz floating-point mono; throws on error:
 void load_wav(std::string const &filename, std::vector< float > *data);
+
+//Save interleaved floating-point audio as a 32-bit float WAV file (e.g., Sound::render output); throws on error:
+void save_wav(std::string const &filename, std::vector< float > const &data, uint32_t channels = 2, uint32_t rate = 48000);
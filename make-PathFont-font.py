@@ -506,6 +506,38 @@ for char_glyph in sorted(glyphs.items()):
 	for pair in glyph_lines:
 		out_coords += list(pair)
 
+#byte trie over glyph names, for the longest-match lookup in PathFont::match():
+# state 0 is the root; a state's out-edges are sorted by byte;
+# out_trie_glyphs[state] is the glyph whose name ends at that state (or None)
+trie_edges = [dict()]
+out_trie_glyphs = [None]
+for g in range(0, out_glyphs):
+	state = 0
+	for b in out_chars[out_glyph_char_starts[g]:(out_glyph_char_starts[g+1] if g + 1 < out_glyphs else len(out_chars))]:
+		if b not in trie_edges[state]:
+			trie_edges[state][b] = len(trie_edges)
+			trie_edges.append(dict())
+			out_trie_glyphs.append(None)
+		state = trie_edges[state][b]
+	assert(out_trie_glyphs[state] == None) #(glyph names are unique)
+	out_trie_glyphs[state] = g
+
+out_trie_edge_starts = []
+out_trie_edge_bytes = []
+out_trie_edge_states = []
+for edges in trie_edges:
+	out_trie_edge_starts += [len(out_trie_edge_bytes)]
+	for b in sorted(edges.keys()):
+		out_trie_edge_bytes += [b]
+		out_trie_edge_states += [edges[b]]
+
+#the root's edges again, as a table indexed by byte (0 meaning no glyph starts with that byte):
+out_trie_root = [0] * 256
+for b in trie_edges[0]:
+	out_trie_root[b] = trie_edges[0][b]
+
+print("Glyph trie has " + str(len(trie_edges)) + " states.")
+
 print("Font covers: " + ", ".join(map(lambda x: "'" + x + "'", sorted(glyphs.keys()))))
 missing = []
 for m in range(0x20, 0x7f):
@@ -554,7 +586,29 @@ wd(out_coords, "{:.6f}f", 6)
 w('\t};\n')
 
 
+w('\tconstexpr const uint32_t font_trie_states = ' + str(len(trie_edges)) + ';\n')
+w('\tconstexpr const uint32_t font_trie_root[256] = {\n')
+wd(out_trie_root, "{}", 16)
+w('\t};\n')
+
+w('\tconstexpr const uint32_t font_trie_glyphs[font_trie_states] = {\n')
+wd(list(map(lambda g: '-1U' if g == None else str(g), out_trie_glyphs)), "{}", 12)
+w('\t};\n')
+
+w('\tconstexpr const uint32_t font_trie_edge_starts[font_trie_states+1] = {\n')
+wd(out_trie_edge_starts + [len(out_trie_edge_bytes)], "{}", 12)
+w('\t};\n')
+
+w('\tconstexpr const uint8_t font_trie_edge_bytes[' + str(len(out_trie_edge_bytes)) + '] = {\n')
+wd(out_trie_edge_bytes, "{}", 12)
+w('\t};\n')
+
+w('\tconstexpr const uint32_t font_trie_edge_states[' + str(len(out_trie_edge_states)) + '] = {\n')
+wd(out_trie_edge_states, "{}", 12)
+w('\t};\n')
+
 w('}\n')
-w('PathFont PathFont::font(font_glyphs, font_glyph_widths, font_glyph_char_starts, font_chars, font_glyph_coord_starts, font_coords);\n')
+w('PathFont PathFont::font(font_glyphs, font_glyph_widths, font_glyph_char_starts, font_chars, font_glyph_coord_starts, font_coords,\n')
+w('\tfont_trie_root, font_trie_glyphs, font_trie_edge_starts, font_trie_edge_bytes, font_trie_edge_states);\n')
 
 cppfile.close()
@@ -0,0 +1,90 @@
+//pack-assets: packs data files into one archive (see AssetArchive.hpp),
+// which the game maps once at startup instead of opening each file.
+//
+//Usage:
+//	scenes/pack-assets <out.pack> <dir> <file> [more files ...]
+//
+//Files are named in the archive by their path relative to <dir> (which is
+// how loaders find them, relative to data_path()); e.g.:
+//	scenes/pack-assets ../dist/assets.pack ../dist game6.pnct game6.scene dusty-floor.opus
+
+#include "AssetArchive.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	//when compiled on windows, unhandled exceptions don't have their message printed, which can make debugging simple issues difficult.
+	try {
+#endif
+
+	if (argc < 4) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <out.pack> <dir> <file> [more files ...]" << std::endl;
+		return 1;
+	}
+	std::string out_file = argv[1];
+	std::string dir = argv[2];
+	std::vector< std::string > names(argv + 3, argv + argc);
+
+	std::vector< std::vector< char > > contents;
+	contents.reserve(names.size());
+	for (auto const &name : names) {
+		std::ifstream file(dir + "/" + name, std::ios::binary);
+		if (!file) throw std::runtime_error("Failed to open '" + dir + "/" + name + "'.");
+		contents.emplace_back((std::istreambuf_iterator< char >(file)), std::istreambuf_iterator< char >());
+	}
+
+	std::vector< char > strings;
+	std::vector< AssetArchive::DirectoryEntry > directory;
+	for (auto const &name : names) {
+		AssetArchive::DirectoryEntry entry;
+		entry.name_begin = uint32_t(strings.size());
+		strings.insert(strings.end(), name.begin(), name.end());
+		entry.name_end = uint32_t(strings.size());
+		directory.emplace_back(entry);
+	}
+	//pad names so the directory (which holds 64-bit hashes) is 8-byte aligned:
+	while (strings.size() % 8 != 0) strings.emplace_back('\0');
+
+	//contents start where the 'dat0' chunk's data does:
+	size_t const data_start = (8 + strings.size()) + (8 + directory.size() * sizeof(AssetArchive::DirectoryEntry)) + 8;
+
+	//lay out contents so every file starts 16-byte aligned in the archive (and thus in the mapping):
+	std::vector< char > data;
+	for (size_t i = 0; i < names.size(); ++i) {
+		while ((data_start + data.size()) % 16 != 0) data.emplace_back('\0');
+		auto &entry = directory[i];
+		entry.offset = uint32_t(data.size());
+		entry.size = uint32_t(contents[i].size());
+		entry.hash = hash_bytes(contents[i].data(), contents[i].size());
+		data.insert(data.end(), contents[i].begin(), contents[i].end());
+		if (data.size() > 0xffffffffULL) throw std::runtime_error("Archive contents don't fit in 32-bit offsets.");
+	}
+
+	std::ofstream file(out_file, std::ios::binary);
+	write_chunk("str0", strings, &file);
+	write_chunk("dir0", directory, &file);
+	write_chunk("dat0", data, &file);
+	if (!file) throw std::runtime_error("Failed to write '" + out_file + "'.");
+
+	for (size_t i = 0; i < names.size(); ++i) {
+		std::cout << "  " << names[i] << " (" << directory[i].size << " bytes)\n";
+	}
+	std::cout << "wrote " << names.size() << " files (" << data.size() << " bytes) to '" << out_file << "'." << std::endl;
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
@@ -1,9 +1,14 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <stdexcept>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
 
 //helper function that reads an array of structures preceded by a simple header:
 //Expected format:
@@ -41,6 +46,69 @@ void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *
 }
 
 
+//A 'ChunkSpan' is a read-only view of an array of T that lives in someone else's memory
+// (e.g., a MappedFile; see MappedFile.hpp):
+// (it has the read-only parts of std::vector's interface, so code can switch between the two)
+template< typename T >
+struct ChunkSpan {
+	T const *first = nullptr;
+	size_t count = 0;
+	std::shared_ptr< std::vector< T > > copy; //owns the data if it had to be copied (see read_chunk)
+
+	T const *data() const { return first; }
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	T const *begin() const { return first; }
+	T const *end() const { return first + count; }
+	T const &operator[](size_t i) const { assert(i < count); return first[i]; }
+};
+
+//helper function that reads a chunk (same format as above) in place from memory:
+// on return, *at_ points just past the chunk and *to_ views the chunk's data
+// note: will throw if the chunk runs past 'end'
+// note: data not aligned for T (e.g., after an unpadded "str0" chunk in files written before
+//  writers padded it) is copied into aligned storage owned by *to_ instead of viewed in place
+template< typename T >
+void read_chunk(char const **at_, char const *end, std::string const &magic, ChunkSpan< T > *to_) {
+	assert(at_);
+	assert(to_);
+	char const *&at = *at_;
+	auto &to = *to_;
+
+	struct ChunkHeader {
+		char magic[4] = {'\0', '\0', '\0', '\0'};
+		uint32_t size = 0;
+	};
+	static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+
+	if (size_t(end - at) < sizeof(ChunkHeader)) {
+		throw std::runtime_error("Failed to read chunk header");
+	}
+	ChunkHeader header;
+	std::memcpy(&header, at, sizeof(header)); //(header itself may be unaligned)
+	if (std::string(header.magic,4) != magic) {
+		throw std::runtime_error("Unexpected magic number in chunk");
+	}
+	if (header.size % sizeof(T) != 0) {
+		throw std::runtime_error("Size of chunk not divisible by element size");
+	}
+	char const *data = at + sizeof(ChunkHeader);
+	if (size_t(end - data) < header.size) {
+		throw std::runtime_error("Failed to read chunk data.");
+	}
+	to.count = header.size / sizeof(T);
+	if (reinterpret_cast< uintptr_t >(data) % alignof(T) != 0) {
+		static_assert(std::is_trivially_copyable< T >::value, "chunk elements are copied bytewise");
+		to.copy = std::make_shared< std::vector< T > >(to.count);
+		if (to.count) std::memcpy(to.copy->data(), data, header.size);
+		to.first = to.copy->data();
+	} else {
+		to.copy.reset();
+		to.first = reinterpret_cast< T const * >(data);
+	}
+	at = data + header.size;
+}
+
 //helper function to write a chunk of data in the same format as read_chunk:
 template< typename T >
 void write_chunk(std::string const &magic, std::vector< T > const &from, std::ostream *to_) {
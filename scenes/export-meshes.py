@@ -205,6 +205,8 @@ blob.write(struct.pack('4s',b'pnct')) #type
 blob.write(struct.pack('I', len(data))) #length
 blob.write(data)
 #second chunk: the strings
+#(padded so the chunks that follow stay 4-byte aligned for in-place loading)
+while len(strings) % 4 != 0: strings += b'\0'
 blob.write(struct.pack('4s',b'str0')) #type
 blob.write(struct.pack('I', len(strings))) #length
 blob.write(strings)
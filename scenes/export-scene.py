@@ -220,6 +220,8 @@ def write_chunk(magic, data):
 	blob.write(struct.pack('I', len(data))) #length
 	blob.write(data)
 
+#(pad strings so the chunks that follow stay 4-byte aligned for in-place loading)
+while len(strings_data) % 4 != 0: strings_data += b'\0'
 write_chunk(b'str0', strings_data)
 write_chunk(b'xfh0', xfh_data)
 write_chunk(b'msh0', mesh_data)
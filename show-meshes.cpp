@@ -2,7 +2,8 @@
 #include "ShowMeshesMode.hpp"
 #include "Load.hpp"
 #include "GL.hpp"
-#include "load_save_png.hpp"
+#include "Screenshot.hpp"
+#include "DebugOverlay.hpp"
 
 #include <SDL.h>
 
@@ -136,20 +137,27 @@ int main(int argc, char **argv) {
 				} else if (evt.type == SDL_QUIT) {
 					Mode::set_current(nullptr);
 					break;
+				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F3) {
+					debug_overlay_enabled = !debug_overlay_enabled;
 				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_PRINTSCREEN) {
-					// --- screenshot key ---
-					std::string filename = "screenshot.png";
-					std::cout << "Saving screenshot to '" << filename << "'." << std::endl;
-					glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-					glReadBuffer(GL_FRONT);
-					int w,h;
-					SDL_GL_GetDrawableSize(window, &w, &h);
-					std::vector< glm::u8vec4 > data(w*h);
-					glReadPixels(0,0,w,h, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
-					for (auto &px : data) {
-						px.a = 0xff;
+					// --- screenshot key (saved in the background; see Screenshot.hpp) ---
+					if (evt.key.keysym.mod & KMOD_CTRL) {
+						//ctrl: start/stop capturing every frame (e.g., for video):
+						if (capturing_screenshots()) {
+							stop_capturing_screenshots();
+						} else {
+							std::cout << "Capturing every frame to 'frame-*.png' (ctrl+printscreen again to stop)." << std::endl;
+							capture_screenshots("frame");
+						}
+					} else if (evt.key.keysym.mod & KMOD_SHIFT) {
+						//shift: capture a one-second burst:
+						std::cout << "Capturing 60 frames to 'burst-*.png'." << std::endl;
+						capture_screenshots("burst", 60);
+					} else {
+						std::string filename = "screenshot.png";
+						std::cout << "Saving screenshot to '" << filename << "'." << std::endl;
+						capture_screenshot(filename);
 					}
-					save_png(filename, glm::uvec2(w,h), data.data(), LowerLeftOrigin);
 				}
 			}
 			if (!Mode::current) break;
@@ -174,12 +182,20 @@ int main(int argc, char **argv) {
 			Mode::current->draw(drawable_size);
 		}
 
+		//read back the frame for any screenshots being captured:
+		update_screenshots(drawable_size);
+
+		//stats overlay (F3; drawn after the readback, so it isn't in screenshots):
+		draw_debug_overlay(drawable_size);
+
 		//Wait until the recently-drawn frame is shown before doing it all again:
 		SDL_GL_SwapWindow(window);
 	}
 
 
 	//------------  teardown ------------
+	finish_screenshots();
+
 	SDL_GL_DeleteContext(context);
 	context = 0;
 